@@ -55,3 +55,31 @@ define_property(GLOBAL PROPERTY TEST_SOURCE_FILES
     FULL_DOCS "List of test source files to be compiled."
 )
 
+
+
+################################################################################
+# Add to benchmark files
+################################################################################
+
+# Adds all arguments to the global BENCHMARK_SOURCE_FILES property.
+#
+# Usage:
+#
+#    add_benchmark_sources(benchmark.cpp benchmark_class.cpp)
+#
+function(add_benchmark_sources)
+    # make absolute paths
+    set(ABSOLUTE_FILENAMES)
+    foreach(FILENAME IN LISTS ARGN)
+        get_filename_component(FILENAME "${FILENAME}" ABSOLUTE)
+        list(APPEND ABSOLUTE_FILENAMES "${FILENAME}")
+    endforeach()
+  # append to global list
+  set_property(GLOBAL APPEND PROPERTY BENCHMARK_SOURCE_FILES "${ABSOLUTE_FILENAMES}")
+endfunction()
+
+# A bit of documentation for the BENCHMARK_SOURCE_FILES property
+define_property(GLOBAL PROPERTY BENCHMARK_SOURCE_FILES
+    BRIEF_DOCS "List of benchmark source files"
+    FULL_DOCS "List of benchmark source files to be compiled."
+)
@@ -347,19 +347,84 @@ local function createMicrobeStage(name)
         Engine:createGameState(
         name,
         {
-            SwitchGameStateSystem(),
-            QuickSaveSystem(),
+            -- Systems handling input, the camera and the UI are
+            -- presentation systems. They run exactly once per frame, so
+            -- that key presses are neither dropped nor handled twice.
+            -- Being declared before the simulation systems, they run
+            -- before the frame's simulation steps.
+            --
+            -- These act on the game state as a whole, so they are left
+            -- undeclared and run on their own
+            { SwitchGameStateSystem(), presentation = true },
+            { QuickSaveSystem(), presentation = true },
             -- Microbe specific
-            MicrobeSystem(),
-            MicrobeCameraSystem(),
-            MicrobeAISystem(),
-            MicrobeControlSystem(),
-            HudSystem(),
+            -- Declaring what the Lua systems access lets native systems
+            -- run on worker threads in the meantime. Adding a component
+            -- counts as writing its type.
+            {
+                MicrobeSystem(),
+                reads = { CollisionComponent },
+                writes = {
+                    AgentAbsorberComponent,
+                    AgentEmitterComponent,
+                    MicrobeComponent,
+                    OgreSceneNodeComponent,
+                    RigidBodyComponent
+                }
+            },
+            {
+                MicrobeCameraSystem(),
+                writes = { OgreSceneNodeComponent },
+                presentation = true
+            },
+            {
+                MicrobeAISystem(),
+                reads = {
+                    AgentAbsorberComponent,
+                    AgentEmitterComponent,
+                    CollisionComponent,
+                    OgreSceneNodeComponent,
+                    RigidBodyComponent
+                },
+                writes = { MicrobeAIControllerComponent, MicrobeComponent }
+            },
+            {
+                MicrobeControlSystem(),
+                reads = { OgreCameraComponent },
+                writes = { MicrobeComponent },
+                presentation = true
+            },
+            {
+                HudSystem(),
+                reads = {
+                    AgentAbsorberComponent,
+                    AgentEmitterComponent,
+                    CollisionComponent,
+                    MicrobeComponent,
+                    OgreSceneNodeComponent,
+                    RigidBodyComponent
+                },
+                writes = { TextOverlayComponent },
+                presentation = true
+            },
             AgentLifetimeSystem(),
             AgentMovementSystem(),
             AgentEmitterSystem(),
             AgentAbsorberSystem(),
-            createSpawnSystem(),
+            {
+                createSpawnSystem(),
+                writes = {
+                    AgentAbsorberComponent,
+                    AgentEmitterComponent,
+                    CollisionComponent,
+                    MicrobeAIControllerComponent,
+                    MicrobeComponent,
+                    OgreSceneNodeComponent,
+                    RigidBodyComponent,
+                    SpawnedComponent,
+                    TimedAgentEmitterComponent
+                }
+            },
             -- Physics
             RigidBodyInputSystem(),
             UpdatePhysicsSystem(),
@@ -373,6 +438,11 @@ local function createMicrobeStage(name)
             OgreCameraSystem(),
             OgreLightSystem(),
             SkySystem(),
+            {
+                ProfilerOverlaySystem(),
+                writes = { TextOverlayComponent },
+                presentation = true
+            },
             TextOverlaySystem(),
             OgreViewportSystem(),
             OgreRemoveSceneNodeSystem(),
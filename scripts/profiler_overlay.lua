@@ -0,0 +1,53 @@
+-- Shows how long each system took in the last frame
+--
+-- Toggled with F3. Press F12 to write a Chrome trace of the recent frames
+-- to "profile.json", which can be loaded in Chrome's about:tracing page.
+class 'ProfilerOverlaySystem' (System)
+
+function ProfilerOverlaySystem:__init()
+    System.__init(self)
+    self.text = nil
+    self.visible = false
+    self.toggleDown = false
+    self.traceDown = false
+end
+
+
+function ProfilerOverlaySystem:update(milliseconds)
+    local toggleDown = Engine.keyboard:isKeyDown(Keyboard.KC_F3)
+    local traceDown = Engine.keyboard:isKeyDown(Keyboard.KC_F12)
+    if traceDown and not self.traceDown then
+        print("Writing profile.json")
+        Engine.profiler:writeChromeTrace("profile.json")
+    end
+    if toggleDown and not self.toggleDown then
+        self.visible = not self.visible
+    end
+    self.toggleDown = toggleDown
+    self.traceDown = traceDown
+    local entity = Entity("profiler.overlay")
+    local overlay = entity:getComponent(TextOverlayComponent.TYPE_ID)
+    if overlay == nil then
+        local LINE_HEIGHT = 18
+        overlay = TextOverlayComponent("profiler.overlay")
+        entity:addComponent(overlay)
+        overlay.properties.horizontalAlignment = TextOverlayComponent.Left
+        overlay.properties.verticalAlignment = TextOverlayComponent.Top
+        overlay.properties.width = 400
+        overlay.properties.height = 32 * LINE_HEIGHT
+        self.text = nil
+    end
+    local text = ""
+    if self.visible then
+        for _, time in ipairs(Engine.profiler:frameTimes()) do
+            text = text .. string.format("%-28s %6.2f ms\n", time.name, time.milliseconds)
+        end
+    end
+    -- Touching makes the TextOverlaySystem update the overlay, so only do
+    -- that when the text changes (which includes hiding it)
+    if text ~= self.text then
+        self.text = text
+        overlay.properties.text = text
+        overlay.properties:touch()
+    end
+end
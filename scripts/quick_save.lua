@@ -4,6 +4,7 @@ function QuickSaveSystem:__init()
     System.__init(self)
     self.saveDown = false
     self.loadDown = false
+    self.saving = false
 end
 
 
@@ -12,10 +13,26 @@ function QuickSaveSystem:update(milliseconds)
     local loadDown = Engine.keyboard:isKeyDown(Keyboard.KC_F10)
     if saveDown and not self.saveDown then
         print("Saving")
-        Engine:save("quick.sav")
+        -- Keeps the checkpoint in memory for quick loading and writes
+        -- it to disk so that it survives a restart
+        Engine:checkpoint("quick.sav")
+        self.saving = true
+    elseif self.saving and not Engine.saver:isSaving() then
+        -- The file is written in the background
+        local message = Engine.saver:lastError()
+        if message == "" then
+            print("Saved")
+        else
+            print("Saving failed: " .. message)
+        end
+        self.saving = false
     end
     if loadDown and not self.loadDown then
-        Engine:load("quick.sav")
+        if Engine.checkpoints:size() > 0 then
+            Engine:restoreCheckpoint()
+        else
+            Engine:load("quick.sav")
+        end
     end
     self.saveDown = saveDown
     self.loadDown = loadDown
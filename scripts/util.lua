@@ -18,6 +18,25 @@ function REGISTER_COMPONENT(name, cls)
 end
 
 
+-- Registers a tag type
+--
+-- Tags are components without data (see Entity:addTag). The returned table
+-- can be passed to EntityFilter like a component class.
+--
+-- @param name
+--  A unique string that identifies this tag type
+--
+-- @returns tag
+--  A table with the tag's TYPE_ID and TYPE_NAME
+function REGISTER_TAG(name)
+    local typeId = Engine.componentFactory:registerTagType(name)
+    return {
+        TYPE_ID = typeId,
+        TYPE_NAME = name
+    }
+end
+
+
 -- Gets a component from an entity, creating the component if it's not present
 --
 -- @param componentCls
@@ -1,13 +1,49 @@
 #include <OgreRoot.h>
 
+#include "engine/engine.h"
+#include "engine/telemetry.h"
 #include "game.h"
 
 #include <boost/thread.hpp>
+#include <iostream>
+#include <limits>
+#include <stdexcept>
+#include <string>
 
 #if OGRE_PLATFORM == OGRE_PLATFORM_WIN32
 #define WIN32_LEAN_AND_MEAN
 #include "windows.h"
 #endif
+
+#if OGRE_PLATFORM != OGRE_PLATFORM_WIN32
+static void
+printUsage(
+    const char* program
+) {
+    std::cerr
+        << "Usage: " << program
+        << " [--headless] [--frames <n>] [--telemetry <file>]"
+        << std::endl;
+}
+
+
+// Parses the frame count of --frames, which must be a plain number
+static unsigned int
+parseFrameCount(
+    const std::string& value
+) {
+    std::size_t end = 0;
+    unsigned long frames = std::stoul(value, &end);
+    if (
+        value[0] == '-' or
+        end != value.size() or
+        frames > std::numeric_limits<unsigned int>::max()
+    ) {
+        throw std::invalid_argument("Invalid frame count: " + value);
+    }
+    return static_cast<unsigned int>(frames);
+}
+#endif
  
 #ifdef __cplusplus
 extern "C" {
@@ -21,6 +57,53 @@ extern "C" {
     {
         using namespace thrive;
         Game& game = Game::instance();
+#if OGRE_PLATFORM != OGRE_PLATFORM_WIN32
+        // --headless runs without window, input and sound,
+        // --frames <n> quits after n frames,
+        // --telemetry <file> samples the entity manager every 60 frames
+        // and appends each sample to file (CSV, or JSON for *.json)
+        for (int i = 1; i < argc; ++i) {
+            std::string argument = argv[i];
+            if (argument == "--headless") {
+                game.engine().setHeadless(true);
+                continue;
+            }
+            if (argument != "--frames" and argument != "--telemetry") {
+                continue;
+            }
+            if (i + 1 >= argc) {
+                std::cerr << "Missing value for " << argument << std::endl;
+                printUsage(argv[0]);
+                return 1;
+            }
+            std::string value = argv[i + 1];
+            i += 1;
+            if (argument == "--frames") {
+                try {
+                    game.setFrameLimit(parseFrameCount(value));
+                }
+                catch (const std::logic_error&) {
+                    // std::invalid_argument or std::out_of_range
+                    std::cerr << "Invalid frame count: " << value << std::endl;
+                    printUsage(argv[0]);
+                    return 1;
+                }
+            }
+            else {
+                Telemetry& telemetry = game.engine().telemetry();
+                try {
+                    telemetry.setOutputFile(value);
+                }
+                catch (const std::runtime_error& e) {
+                    std::cerr << e.what() << std::endl;
+                    return 1;
+                }
+                if (telemetry.interval() == 0) {
+                    telemetry.setInterval(60);
+                }
+            }
+        }
+#endif
         game.run();
         return 0;
     }
@@ -0,0 +1,251 @@
+#include "benchmarks/benchmark.h"
+
+#include <algorithm>
+#include <assert.h>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <numeric>
+#include <stdexcept>
+
+using namespace thrive;
+using namespace thrive::benchmark;
+
+namespace {
+
+struct Benchmark {
+
+    Function function;
+
+    std::string name;
+
+    std::vector<std::size_t> sizes;
+
+};
+
+std::vector<Benchmark>&
+registeredBenchmarks() {
+    // Function local, so registration from other translation units' static
+    // initializers is independent of initialization order
+    static std::vector<Benchmark> benchmarks;
+    return benchmarks;
+}
+
+double
+runOnce(
+    const Function& function,
+    std::size_t size,
+    std::size_t iterations
+) {
+    State state(size, iterations);
+    function(state);
+    return state.elapsedNanoseconds();
+}
+
+std::size_t
+calibrateIterations(
+    const Function& function,
+    std::size_t size,
+    double minimumNanoseconds
+) {
+    std::size_t iterations = 1;
+    while (true) {
+        double elapsed = runOnce(function, size, iterations);
+        if (elapsed >= minimumNanoseconds) {
+            return iterations;
+        }
+        // Aim a bit higher than needed, but grow by at most ten times per
+        // step in case the first iterations were unusually fast
+        double perIteration = std::max(elapsed / iterations, 1.0);
+        double estimate = 1.2 * minimumNanoseconds / perIteration;
+        iterations = static_cast<std::size_t>(std::min(
+            std::ceil(estimate),
+            10.0 * iterations
+        ));
+    }
+}
+
+Result
+summarize(
+    const std::string& name,
+    std::size_t size,
+    std::size_t iterations,
+    std::vector<double> times
+) {
+    Result result;
+    result.name = name;
+    result.size = size;
+    result.iterations = iterations;
+    std::sort(times.begin(), times.end());
+    std::size_t count = times.size();
+    result.minimum = times.front();
+    result.maximum = times.back();
+    result.median = count % 2 ? times[count / 2] : (times[count / 2 - 1] + times[count / 2]) / 2.0;
+    result.mean = std::accumulate(times.begin(), times.end(), 0.0) / count;
+    double squares = 0.0;
+    for (double time : times) {
+        squares += (time - result.mean) * (time - result.mean);
+    }
+    result.standardDeviation = count > 1 ? std::sqrt(squares / (count - 1)) : 0.0;
+    return result;
+}
+
+}
+
+
+State::State(
+    std::size_t size,
+    std::size_t iterations
+) : m_iterations(iterations),
+    m_remaining(iterations),
+    m_size(size)
+{
+}
+
+
+double
+State::elapsedNanoseconds() const {
+    return std::chrono::duration<double, std::nano>(m_elapsed).count();
+}
+
+
+bool
+State::keepRunning() {
+    if (not m_started) {
+        m_started = true;
+        m_start = Clock::now();
+    }
+    if (m_remaining == 0) {
+        if (m_iterations > 0) {
+            // Stop the timer after the last iteration, once
+            this->pauseTiming();
+            m_iterations = 0;
+        }
+        return false;
+    }
+    m_remaining -= 1;
+    return true;
+}
+
+
+void
+State::pauseTiming() {
+    m_elapsed += Clock::now() - m_start;
+}
+
+
+void
+State::resumeTiming() {
+    m_start = Clock::now();
+}
+
+
+std::size_t
+State::size() const {
+    return m_size;
+}
+
+
+void
+thrive::benchmark::registerBenchmark(
+    std::string name,
+    Function function,
+    std::vector<std::size_t> sizes
+) {
+    Benchmark benchmark;
+    benchmark.function = std::move(function);
+    benchmark.name = std::move(name);
+    benchmark.sizes = std::move(sizes);
+    registeredBenchmarks().push_back(std::move(benchmark));
+}
+
+
+std::vector<Result>
+thrive::benchmark::runBenchmarks(
+    const Options& options,
+    std::ostream& output
+) {
+    assert(options.repetitions > 0 && "Benchmarks need at least one repetition");
+    std::vector<Result> results;
+    output
+        << std::left << std::setw(40) << "Benchmark"
+        << std::right << std::setw(8) << "Size"
+        << std::setw(12) << "Iterations"
+        << std::setw(16) << "Mean (ns)"
+        << std::setw(16) << "Median (ns)"
+        << std::setw(14) << "Stddev (%)"
+        << std::endl;
+    for (const Benchmark& benchmark : registeredBenchmarks()) {
+        if (benchmark.name.find(options.filter) == std::string::npos) {
+            continue;
+        }
+        for (std::size_t size : benchmark.sizes) {
+            std::size_t iterations = calibrateIterations(
+                benchmark.function,
+                size,
+                options.minimumTime * 1e6
+            );
+            std::vector<double> times;
+            for (unsigned int i = 0; i < options.repetitions; ++i) {
+                times.push_back(
+                    runOnce(benchmark.function, size, iterations) / iterations
+                );
+            }
+            Result result = summarize(
+                benchmark.name,
+                size,
+                iterations,
+                std::move(times)
+            );
+            output
+                << std::left << std::setw(40) << result.name
+                << std::right << std::setw(8) << result.size
+                << std::setw(12) << result.iterations
+                << std::fixed << std::setprecision(1)
+                << std::setw(16) << result.mean
+                << std::setw(16) << result.median
+                << std::setw(14) << 100.0 * result.standardDeviation / result.mean
+                << std::endl;
+            results.push_back(std::move(result));
+        }
+    }
+    if (not options.jsonFile.empty()) {
+        std::ofstream stream(options.jsonFile, std::ofstream::trunc);
+        if (not stream) {
+            throw std::runtime_error("Could not open " + options.jsonFile + " for writing the results");
+        }
+        writeJson(results, stream);
+    }
+    return results;
+}
+
+
+void
+thrive::benchmark::writeJson(
+    const std::vector<Result>& results,
+    std::ostream& stream
+) {
+    // Benchmark names are identifiers, so they don't need escaping
+    stream << "{\"benchmarks\":[";
+    bool first = true;
+    for (const Result& result : results) {
+        if (not first) {
+            stream << ",";
+        }
+        first = false;
+        stream
+            << "\n{\"name\":\"" << result.name << "\""
+            << ",\"size\":" << result.size
+            << ",\"iterations\":" << result.iterations
+            << std::setprecision(17)
+            << ",\"mean\":" << result.mean
+            << ",\"median\":" << result.median
+            << ",\"standardDeviation\":" << result.standardDeviation
+            << ",\"minimum\":" << result.minimum
+            << ",\"maximum\":" << result.maximum
+            << "}"
+        ;
+    }
+    stream << "\n],\"unit\":\"ns\"}\n";
+}
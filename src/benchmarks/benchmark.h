@@ -0,0 +1,255 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <iosfwd>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace thrive { namespace benchmark {
+
+/**
+* @brief Controls a single run of a benchmark
+*
+* A benchmark function loops over keepRunning() and does the measured work
+* in the loop's body:
+*
+* \code
+* THRIVE_BENCHMARK(MyBenchmark, 1000, 10000) {
+*     // Untimed setup
+*     while (state.keepRunning()) {
+*         // Timed work, scaled by state.size()
+*     }
+* }
+* \endcode
+*
+* Work in the loop that should not be measured (like resetting the setup
+* for the next iteration) can be excluded with pauseTiming() and
+* resumeTiming().
+*/
+class State {
+
+public:
+
+    /**
+    * @brief Constructor
+    *
+    * @param size
+    *   The problem size, see size()
+    * @param iterations
+    *   How often keepRunning() returns \c true
+    */
+    State(
+        std::size_t size,
+        std::size_t iterations
+    );
+
+    /**
+    * @brief The measured time of all iterations, in nanoseconds
+    */
+    double
+    elapsedNanoseconds() const;
+
+    /**
+    * @brief Whether to run another iteration
+    *
+    * Starts the timer on the first call and stops it after the last
+    * iteration.
+    */
+    bool
+    keepRunning();
+
+    /**
+    * @brief Stops the timer until resumeTiming() is called
+    */
+    void
+    pauseTiming();
+
+    /**
+    * @brief Restarts the timer after pauseTiming()
+    */
+    void
+    resumeTiming();
+
+    /**
+    * @brief The problem size, usually the number of entities
+    */
+    std::size_t
+    size() const;
+
+private:
+
+    using Clock = std::chrono::steady_clock;
+
+    Clock::duration m_elapsed = Clock::duration::zero();
+
+    std::size_t m_iterations;
+
+    std::size_t m_remaining;
+
+    std::size_t m_size;
+
+    Clock::time_point m_start;
+
+    bool m_started = false;
+
+};
+
+/**
+* @brief A benchmark function
+*/
+using Function = std::function<void(State&)>;
+
+/**
+* @brief Options for runBenchmarks()
+*/
+struct Options {
+
+    /**
+    * @brief Only run benchmarks whose name contains this string
+    */
+    std::string filter;
+
+    /**
+    * @brief If not empty, the results are also written to this file as JSON
+    */
+    std::string jsonFile;
+
+    /**
+    * @brief The minimum time a repetition should take, in milliseconds
+    *
+    * The number of iterations per repetition is increased until a single
+    * repetition takes at least this long.
+    */
+    double minimumTime = 100.0;
+
+    /**
+    * @brief How often each benchmark is repeated for the statistics
+    */
+    unsigned int repetitions = 10;
+
+};
+
+/**
+* @brief Statistics of a benchmark run at one size
+*
+* All times are per iteration, in nanoseconds.
+*/
+struct Result {
+
+    std::size_t iterations;
+
+    double maximum;
+
+    double mean;
+
+    double median;
+
+    double minimum;
+
+    std::string name;
+
+    std::size_t size;
+
+    double standardDeviation;
+
+};
+
+/**
+* @brief Registers a benchmark
+*
+* Use THRIVE_BENCHMARK instead of calling this directly.
+*
+* @param name
+*   The benchmark's name
+* @param function
+*   The benchmark function
+* @param sizes
+*   The problem sizes to run the benchmark with
+*/
+void
+registerBenchmark(
+    std::string name,
+    Function function,
+    std::vector<std::size_t> sizes
+);
+
+/**
+* @brief Runs all registered benchmarks
+*
+* Each benchmark is run once per size to determine the number of iterations
+* and to warm up, then Options::repetitions times for the statistics.
+* Progress and results are reported to \a output.
+*
+* @param options
+*   The benchmark options
+* @param output
+*   The stream to report to
+*
+* @return
+*   The results, in order of registration and size
+*
+* @throws std::runtime_error if the JSON file can't be written
+*/
+std::vector<Result>
+runBenchmarks(
+    const Options& options,
+    std::ostream& output
+);
+
+/**
+* @brief Writes results as JSON
+*
+* The output is an object with a \c "benchmarks" array, holding one object
+* per result with the same keys as Result. Times are in nanoseconds.
+*
+* @param results
+*   The results to write
+* @param stream
+*   The stream to write to
+*/
+void
+writeJson(
+    const std::vector<Result>& results,
+    std::ostream& stream
+);
+
+/**
+* @brief Registers a benchmark on construction
+*/
+struct Registration {
+
+    Registration(
+        std::string name,
+        Function function,
+        std::vector<std::size_t> sizes
+    ) {
+        registerBenchmark(
+            std::move(name),
+            std::move(function),
+            std::move(sizes)
+        );
+    }
+
+};
+
+}}
+
+/**
+* @brief Defines and registers a benchmark
+*
+* The function body receives a thrive::benchmark::State called \c state.
+*
+* @param name
+*   The benchmark's name, must be a valid identifier
+* @param ...
+*   The sizes to run the benchmark with
+*/
+#define THRIVE_BENCHMARK(name, ...) \
+    static void name(thrive::benchmark::State& state); \
+    static thrive::benchmark::Registration name##Registration( \
+        #name, name, {__VA_ARGS__} \
+    ); \
+    static void name(thrive::benchmark::State& state)
@@ -0,0 +1,50 @@
+#include "benchmarks/benchmark.h"
+
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+// Usage: RunBenchmarks [--filter <substring>] [--json <file>]
+//                      [--min-time <milliseconds>] [--repetitions <n>]
+int
+main(
+    int argc,
+    char* argv[]
+) {
+    using namespace thrive::benchmark;
+    Options options;
+    try {
+        for (int i = 1; i < argc; ++i) {
+            std::string argument = argv[i];
+            if (i + 1 >= argc) {
+                throw std::invalid_argument("Missing value for " + argument);
+            }
+            std::string value = argv[i + 1];
+            i += 1;
+            if (argument == "--filter") {
+                options.filter = value;
+            }
+            else if (argument == "--json") {
+                options.jsonFile = value;
+            }
+            else if (argument == "--min-time") {
+                options.minimumTime = std::stod(value);
+            }
+            else if (argument == "--repetitions") {
+                options.repetitions = std::stoul(value);
+                if (options.repetitions == 0) {
+                    throw std::invalid_argument("--repetitions must be positive");
+                }
+            }
+            else {
+                throw std::invalid_argument("Unknown argument " + argument);
+            }
+        }
+        runBenchmarks(options, std::cout);
+    }
+    catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
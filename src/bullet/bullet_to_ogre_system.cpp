@@ -1,13 +1,18 @@
 #include "bullet/bullet_to_ogre_system.h"
 
 #include "bullet/rigid_body_system.h"
+#include "engine/engine.h"
 #include "engine/game_state.h"
 #include "engine/entity_filter.h"
+#include "engine/thread_pool.h"
 #include "ogre/scene_node_system.h"
 #include "scripting/luabind.h"
 
 using namespace thrive;
 
+// Number of entities synchronized by one task of a parallel update
+static const std::size_t ENTITIES_PER_TASK = 256;
+
 
 luabind::scope
 BulletToOgreSystem::luaBindings() {
@@ -30,6 +35,8 @@ struct BulletToOgreSystem::Implementation {
 BulletToOgreSystem::BulletToOgreSystem()
   : m_impl(new Implementation())
 {
+    this->readsComponent(RigidBodyComponent::TYPE_ID);
+    this->writesComponent(OgreSceneNodeComponent::TYPE_ID);
 }
 
 
@@ -54,15 +61,19 @@ BulletToOgreSystem::shutdown() {
 
 void
 BulletToOgreSystem::update(int) {
-    for (auto& value : m_impl->m_entities) {
-        RigidBodyComponent* rigidBodyComponent = std::get<0>(value.second);
-        OgreSceneNodeComponent* sceneNodeComponent = std::get<1>(value.second);
-        auto& sceneNodeTransform = sceneNodeComponent->m_transform;
-        auto& rigidBodyProperties = rigidBodyComponent->m_dynamicProperties;
-        sceneNodeTransform.orientation = rigidBodyProperties.rotation;
-        sceneNodeTransform.position = rigidBodyProperties.position;
-        sceneNodeTransform.touch();
-    }
+    m_impl->m_entities.parallelForEach(
+        this->engine()->threadPool(),
+        ENTITIES_PER_TASK,
+        [](EntityId, const std::tuple<RigidBodyComponent*, OgreSceneNodeComponent*>& components) {
+            RigidBodyComponent* rigidBodyComponent = std::get<0>(components);
+            OgreSceneNodeComponent* sceneNodeComponent = std::get<1>(components);
+            auto& sceneNodeTransform = sceneNodeComponent->m_transform;
+            auto& rigidBodyProperties = rigidBodyComponent->m_dynamicProperties;
+            sceneNodeTransform.orientation = rigidBodyProperties.rotation;
+            sceneNodeTransform.position = rigidBodyProperties.position;
+            sceneNodeTransform.touch();
+        }
+    );
 }
 
 
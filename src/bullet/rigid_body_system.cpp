@@ -2,15 +2,20 @@
 
 #include "bullet/bullet_ogre_conversion.h"
 #include "engine/component_factory.h"
+#include "engine/engine.h"
 #include "engine/game_state.h"
 #include "engine/entity_filter.h"
 #include "scripting/luabind.h"
 #include "engine/serialization.h"
+#include "engine/thread_pool.h"
 
 #include <iostream>
 
 using namespace thrive;
 
+// Number of bodies read back by one task of a parallel update
+static const std::size_t BODIES_PER_TASK = 256;
+
 ////////////////////////////////////////////////////////////////////////////////
 // RigidBodyComponent
 ////////////////////////////////////////////////////////////////////////////////
@@ -127,6 +132,97 @@ RigidBodyComponent::load(
 }
 
 
+bool
+RigidBodyComponent::read(
+    StorageReader& reader
+) {
+    // Missing entries get the same defaults as in load()
+    StorageContainer shape;
+    m_properties.restitution = 0.0f;
+    m_properties.linearFactor = Ogre::Vector3(1,1,1);
+    m_properties.angularFactor = Ogre::Vector3(1,1,1);
+    m_properties.mass = 1.0f;
+    m_properties.friction = 0.0f;
+    m_properties.linearDamping = 0.0f;
+    m_properties.angularDamping = 0.0f;
+    m_properties.rollingFriction = 0.0f;
+    m_properties.hasContactResponse = true;
+    m_properties.kinematic = false;
+    m_dynamicProperties.position = Ogre::Vector3::ZERO;
+    m_dynamicProperties.rotation = Ogre::Quaternion::IDENTITY;
+    m_dynamicProperties.linearVelocity = Ogre::Vector3::ZERO;
+    m_dynamicProperties.angularVelocity = Ogre::Vector3::ZERO;
+    while (reader.next()) {
+        const std::string& key = reader.key();
+        // Static
+        if (key == "shape") {
+            shape = reader.get<StorageContainer>();
+        }
+        else if (key == "restitution") {
+            m_properties.restitution = reader.get<btScalar>();
+        }
+        else if (key == "linearFactor") {
+            m_properties.linearFactor = reader.get<Ogre::Vector3>();
+        }
+        else if (key == "angularFactor") {
+            m_properties.angularFactor = reader.get<Ogre::Vector3>();
+        }
+        else if (key == "mass") {
+            m_properties.mass = reader.get<btScalar>();
+        }
+        else if (key == "friction") {
+            m_properties.friction = reader.get<btScalar>();
+        }
+        else if (key == "linearDamping") {
+            m_properties.linearDamping = reader.get<btScalar>();
+        }
+        else if (key == "angularDamping") {
+            m_properties.angularDamping = reader.get<btScalar>();
+        }
+        else if (key == "rollingFriction") {
+            m_properties.rollingFriction = reader.get<btScalar>();
+        }
+        else if (key == "hasContactResponse") {
+            m_properties.hasContactResponse = reader.get<bool>();
+        }
+        else if (key == "kinematic") {
+            m_properties.kinematic = reader.get<bool>();
+        }
+        // Dynamic
+        else if (key == "position") {
+            m_dynamicProperties.position = reader.get<Ogre::Vector3>();
+        }
+        else if (key == "rotation") {
+            m_dynamicProperties.rotation = reader.get<Ogre::Quaternion>();
+        }
+        else if (key == "linearVelocity") {
+            m_dynamicProperties.linearVelocity = reader.get<Ogre::Vector3>();
+        }
+        else if (key == "angularVelocity") {
+            m_dynamicProperties.angularVelocity = reader.get<Ogre::Vector3>();
+        }
+    }
+    m_properties.shape = CollisionShape::load(shape);
+    m_properties.touch();
+    m_dynamicProperties.touch();
+    m_impulseQueue.clear();
+    m_torque = Ogre::Vector3::ZERO;
+    return true;
+}
+
+
+bool
+RigidBodyComponent::reload(
+    const StorageContainer& storage
+) {
+    this->load(storage);
+    m_dynamicProperties.touch();
+    m_impulseQueue.clear();
+    m_torque = Ogre::Vector3::ZERO;
+    return true;
+}
+
+
 void
 RigidBodyComponent::setWorldTransform(
     const btTransform& transform
@@ -158,6 +254,30 @@ RigidBodyComponent::storage() const {
     return storage;
 }
 
+
+void
+RigidBodyComponent::write(
+    StorageWriter& writer
+) const {
+    writer.set<EntityId>("owner", this->owner());
+    // Static
+    writer.set<StorageContainer>("shape", m_properties.shape->storage());
+    writer.set<Ogre::Vector3>("linearFactor", m_properties.linearFactor);
+    writer.set<Ogre::Vector3>("angularFactor", m_properties.angularFactor);
+    writer.set<btScalar>("mass", m_properties.mass);
+    writer.set<btScalar>("friction", m_properties.friction);
+    writer.set<btScalar>("linearDamping", m_properties.linearDamping);
+    writer.set<btScalar>("angularDamping", m_properties.angularDamping);
+    writer.set<btScalar>("rollingFriction", m_properties.rollingFriction);
+    writer.set<bool>("hasContactResponse", m_properties.hasContactResponse);
+    writer.set<bool>("kinematic", m_properties.kinematic);
+    // Dynamic
+    writer.set<Ogre::Vector3>("position", m_dynamicProperties.position);
+    writer.set<Ogre::Quaternion>("rotation", m_dynamicProperties.rotation);
+    writer.set<Ogre::Vector3>("linearVelocity", m_dynamicProperties.linearVelocity);
+    writer.set<Ogre::Vector3>("angularVelocity", m_dynamicProperties.angularVelocity);
+}
+
 REGISTER_COMPONENT(RigidBodyComponent)
 
 
@@ -348,6 +468,7 @@ struct RigidBodyOutputSystem::Implementation {
 RigidBodyOutputSystem::RigidBodyOutputSystem()
   : m_impl(new Implementation())
 {
+    this->writesComponent(RigidBodyComponent::TYPE_ID);
 }
 
 
@@ -372,21 +493,25 @@ RigidBodyOutputSystem::shutdown() {
 
 void
 RigidBodyOutputSystem::update(int) {
-    for (auto& value : m_impl->m_entities.entities()) {
-        RigidBodyComponent* rigidBodyComponent = std::get<0>(value.second);
-        btRigidBody* rigidBody = rigidBodyComponent->m_body;
-        auto& dynamicProperties = rigidBodyComponent->m_dynamicProperties;
-        // Position and orientation are handled by RigidBodyComponent::setWorldTransform
-        if (rigidBody->isActive()) {
-            dynamicProperties.linearVelocity = bulletToOgre(rigidBody->getLinearVelocity());
-            dynamicProperties.angularVelocity = bulletToOgre(rigidBody->getAngularVelocity());
-        }
-        else if (
-            not dynamicProperties.linearVelocity.isZeroLength()
-            or not dynamicProperties.angularVelocity.isZeroLength()
-        ) {
-            dynamicProperties.linearVelocity = Ogre::Vector3::ZERO;
-            dynamicProperties.angularVelocity = Ogre::Vector3::ZERO;
+    m_impl->m_entities.parallelForEach(
+        this->engine()->threadPool(),
+        BODIES_PER_TASK,
+        [](EntityId, const std::tuple<RigidBodyComponent*>& components) {
+            RigidBodyComponent* rigidBodyComponent = std::get<0>(components);
+            btRigidBody* rigidBody = rigidBodyComponent->m_body;
+            auto& dynamicProperties = rigidBodyComponent->m_dynamicProperties;
+            // Position and orientation are handled by RigidBodyComponent::setWorldTransform
+            if (rigidBody->isActive()) {
+                dynamicProperties.linearVelocity = bulletToOgre(rigidBody->getLinearVelocity());
+                dynamicProperties.angularVelocity = bulletToOgre(rigidBody->getAngularVelocity());
+            }
+            else if (
+                not dynamicProperties.linearVelocity.isZeroLength()
+                or not dynamicProperties.angularVelocity.isZeroLength()
+            ) {
+                dynamicProperties.linearVelocity = Ogre::Vector3::ZERO;
+                dynamicProperties.angularVelocity = Ogre::Vector3::ZERO;
+            }
         }
-    }
+    );
 }
@@ -223,6 +223,34 @@ public:
         const StorageContainer& storage
     ) override;
 
+    /**
+    * @brief Reads the component straight from a savegame
+    *
+    * Like reload(), drops pending impulses and torque.
+    *
+    * @param reader
+    *
+    * @return \c true
+    */
+    bool
+    read(
+        StorageReader& reader
+    ) override;
+
+    /**
+    * @brief Loads the component into the existing rigid body
+    *
+    * Drops pending impulses and torque.
+    *
+    * @param storage
+    *
+    * @return \c true
+    */
+    bool
+    reload(
+        const StorageContainer& storage
+    ) override;
+
     /**
     * @brief Reimplemented from btMotionState
     *
@@ -266,6 +294,16 @@ public:
     StorageContainer
     storage() const override;
 
+    /**
+    * @brief Writes the component straight to a savegame
+    *
+    * @param writer
+    */
+    void
+    write(
+        StorageWriter& writer
+    ) const override;
+
     /**
     * @brief Internal object, dont use this directly
     */
@@ -1,5 +1,6 @@
 #include "bullet/update_physics_system.h"
 
+#include "engine/engine.h"
 #include "engine/game_state.h"
 #include "scripting/luabind.h"
 
@@ -56,6 +57,13 @@ UpdatePhysicsSystem::update(
     int milliSeconds
 ) {
     assert(m_impl->m_world != nullptr && "UpdatePhysicsSystem not initialized");
-    m_impl->m_world->stepSimulation(milliSeconds/1000.f,10);
+    if (this->gameState()->engine().simulationTimestep() > 0) {
+        // The game state already updates us in fixed steps, so let Bullet
+        // do exactly one step of the same length instead of subdividing
+        m_impl->m_world->stepSimulation(milliSeconds/1000.f, 0);
+    }
+    else {
+        m_impl->m_world->stepSimulation(milliSeconds/1000.f,10);
+    }
 }
 
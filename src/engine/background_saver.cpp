@@ -0,0 +1,273 @@
+#include "engine/background_saver.h"
+
+#include "engine/compression.h"
+#include "scripting/luabind.h"
+
+#include <boost/thread.hpp>
+#include <cstdio>
+#include <deque>
+#include <stdexcept>
+
+#ifdef _WIN32
+#include <io.h>
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+using namespace thrive;
+
+namespace {
+
+struct Job {
+
+    std::string m_filename;
+
+    bool m_isCompressed;
+
+    std::string m_savegame;
+
+};
+
+}
+
+
+// Waits until the file's content is on the disk, not only in the
+// operating system's cache
+static bool
+syncFile(
+    std::FILE* file
+) {
+#ifdef _WIN32
+    return _commit(_fileno(file)) == 0;
+#else
+    return fsync(fileno(file)) == 0;
+#endif
+}
+
+
+// Replaces the target even if it exists, which std::rename doesn't on
+// Windows
+static bool
+replaceFile(
+    const std::string& source,
+    const std::string& target
+) {
+#ifdef _WIN32
+    return MoveFileExA(
+        source.c_str(),
+        target.c_str(),
+        MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH
+    ) != 0;
+#else
+    return std::rename(source.c_str(), target.c_str()) == 0;
+#endif
+}
+
+
+// Writes to a temporary file first, so that a crash while writing
+// doesn't destroy the previous savegame
+static void
+writeFile(
+    const std::string& filename,
+    const std::string& savegame
+) {
+    std::string temporaryFilename = filename + ".tmp";
+    std::FILE* file = std::fopen(temporaryFilename.c_str(), "wb");
+    if (not file) {
+        throw std::runtime_error("Could not open " + temporaryFilename + " for saving");
+    }
+    bool isWritten =
+        std::fwrite(savegame.data(), 1, savegame.size(), file) == savegame.size() and
+        std::fflush(file) == 0 and
+        syncFile(file);
+    isWritten = std::fclose(file) == 0 and isWritten;
+    if (not isWritten) {
+        std::remove(temporaryFilename.c_str());
+        throw std::runtime_error("Could not write savegame to " + temporaryFilename);
+    }
+    if (not replaceFile(temporaryFilename, filename)) {
+        std::remove(temporaryFilename.c_str());
+        throw std::runtime_error("Could not replace " + filename + " with the new savegame");
+    }
+}
+
+
+struct BackgroundSaver::Implementation {
+
+    ~Implementation() {
+        {
+            boost::lock_guard<boost::mutex> lock(m_mutex);
+            m_isStopping = true;
+        }
+        m_wakeUp.notify_all();
+        if (m_thread.joinable()) {
+            m_thread.join();
+        }
+    }
+
+    void
+    work() {
+        boost::unique_lock<boost::mutex> lock(m_mutex);
+        while (true) {
+            while (m_jobs.empty() and not m_isStopping) {
+                m_wakeUp.wait(lock);
+            }
+            if (m_jobs.empty()) {
+                // Stopping with all saves written
+                return;
+            }
+            Job job = std::move(m_jobs.front());
+            m_jobs.pop_front();
+            m_isWriting = true;
+            lock.unlock();
+            std::string error;
+            try {
+                if (job.m_isCompressed) {
+                    job.m_savegame = compressSavegame(job.m_savegame);
+                }
+                writeFile(job.m_filename, job.m_savegame);
+            }
+            catch (const std::exception& e) {
+                error = e.what();
+            }
+            lock.lock();
+            m_isWriting = false;
+            m_finishedCount += 1;
+            m_lastError = error;
+            m_lastFile = job.m_filename;
+            m_finished.notify_all();
+        }
+    }
+
+    bool m_compression = true;
+
+    boost::condition_variable m_finished;
+
+    std::size_t m_finishedCount = 0;
+
+    bool m_isStopping = false;
+
+    bool m_isWriting = false;
+
+    // Oldest first
+    std::deque<Job> m_jobs;
+
+    std::string m_lastError;
+
+    std::string m_lastFile;
+
+    mutable boost::mutex m_mutex;
+
+    boost::thread m_thread;
+
+    boost::condition_variable m_wakeUp;
+
+};
+
+
+luabind::scope
+BackgroundSaver::luaBindings() {
+    using namespace luabind;
+    return class_<BackgroundSaver>("BackgroundSaver")
+        .def("compression", &BackgroundSaver::compression)
+        .def("finishedCount", &BackgroundSaver::finishedCount)
+        .def("isSaving", &BackgroundSaver::isSaving)
+        .def("lastError", &BackgroundSaver::lastError)
+        .def("lastFile", &BackgroundSaver::lastFile)
+        .def("setCompression", &BackgroundSaver::setCompression)
+    ;
+}
+
+
+BackgroundSaver::BackgroundSaver()
+  : m_impl(new Implementation())
+{
+}
+
+
+BackgroundSaver::~BackgroundSaver() {}
+
+
+bool
+BackgroundSaver::compression() const {
+    boost::lock_guard<boost::mutex> lock(m_impl->m_mutex);
+    return m_impl->m_compression;
+}
+
+
+std::size_t
+BackgroundSaver::finishedCount() const {
+    boost::lock_guard<boost::mutex> lock(m_impl->m_mutex);
+    return m_impl->m_finishedCount;
+}
+
+
+bool
+BackgroundSaver::isSaving() const {
+    boost::lock_guard<boost::mutex> lock(m_impl->m_mutex);
+    return m_impl->m_isWriting or not m_impl->m_jobs.empty();
+}
+
+
+std::string
+BackgroundSaver::lastError() const {
+    boost::lock_guard<boost::mutex> lock(m_impl->m_mutex);
+    return m_impl->m_lastError;
+}
+
+
+std::string
+BackgroundSaver::lastFile() const {
+    boost::lock_guard<boost::mutex> lock(m_impl->m_mutex);
+    return m_impl->m_lastFile;
+}
+
+
+void
+BackgroundSaver::save(
+    const std::string& filename,
+    std::string savegame
+) {
+    {
+        boost::lock_guard<boost::mutex> lock(m_impl->m_mutex);
+        bool isReplaced = false;
+        for (Job& job : m_impl->m_jobs) {
+            if (job.m_filename == filename) {
+                job.m_isCompressed = m_impl->m_compression;
+                job.m_savegame = std::move(savegame);
+                isReplaced = true;
+                break;
+            }
+        }
+        if (not isReplaced) {
+            m_impl->m_jobs.push_back(Job{
+                filename,
+                m_impl->m_compression,
+                std::move(savegame)
+            });
+        }
+        if (not m_impl->m_thread.joinable()) {
+            m_impl->m_thread = boost::thread(&Implementation::work, m_impl.get());
+        }
+    }
+    m_impl->m_wakeUp.notify_all();
+}
+
+
+void
+BackgroundSaver::setCompression(
+    bool compression
+) {
+    boost::lock_guard<boost::mutex> lock(m_impl->m_mutex);
+    m_impl->m_compression = compression;
+}
+
+
+void
+BackgroundSaver::wait() {
+    boost::unique_lock<boost::mutex> lock(m_impl->m_mutex);
+    while (m_impl->m_isWriting or not m_impl->m_jobs.empty()) {
+        m_impl->m_finished.wait(lock);
+    }
+}
@@ -0,0 +1,148 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+namespace luabind {
+class scope;
+}
+
+namespace thrive {
+
+/**
+* @brief Writes serialized savegames to disk on a background thread
+*
+* Serializing a savegame needs the game states, so it happens on the main
+* thread. Writing the result to disk and waiting until it is actually
+* on the disk can take much longer, so that is left to the saver's
+* worker thread and the game keeps running in the meantime.
+*
+* Each savegame is written to a temporary file next to the target first,
+* which then replaces the target. An interrupted save leaves the previous
+* savegame intact.
+*
+* Saves are written in the order they were requested. A save for a file
+* that is still waiting to be written replaces the waiting one, the
+* older savegame would be overwritten right away anyway.
+*
+* Savegames are compressed on the worker thread as well, unless
+* compression is disabled with setCompression(). Engine::load() tells
+* compressed and uncompressed savegames apart by itself.
+*
+* The outcome of the most recently finished save can be polled with
+* isSaving(), lastError() and lastFile().
+*
+* @see Engine::save()
+*/
+class BackgroundSaver {
+
+public:
+
+    /**
+    * @brief Lua bindings
+    *
+    * Exposes:
+    * - BackgroundSaver::compression()
+    * - BackgroundSaver::finishedCount()
+    * - BackgroundSaver::isSaving()
+    * - BackgroundSaver::lastError()
+    * - BackgroundSaver::lastFile()
+    * - BackgroundSaver::setCompression()
+    *
+    * @return
+    */
+    static luabind::scope
+    luaBindings();
+
+    /**
+    * @brief Constructor
+    *
+    * The worker thread is started with the first save.
+    */
+    BackgroundSaver();
+
+    /**
+    * @brief Destructor
+    *
+    * Finishes all queued saves.
+    */
+    ~BackgroundSaver();
+
+    /**
+    * @brief Whether savegames are compressed
+    *
+    * @see compressSavegame()
+    */
+    bool
+    compression() const;
+
+    /**
+    * @brief The number of saves finished so far, successful or not
+    *
+    * Replaced saves are not counted.
+    */
+    std::size_t
+    finishedCount() const;
+
+    /**
+    * @brief Whether any save is waiting or being written
+    */
+    bool
+    isSaving() const;
+
+    /**
+    * @brief The error of the most recently finished save
+    *
+    * @return
+    *   The error message, empty if the save succeeded
+    */
+    std::string
+    lastError() const;
+
+    /**
+    * @brief The file of the most recently finished save
+    */
+    std::string
+    lastFile() const;
+
+    /**
+    * @brief Queues a savegame for writing
+    *
+    * @param filename
+    *   The file to write, it is replaced once the savegame is written
+    * @param savegame
+    *   The serialized savegame
+    */
+    void
+    save(
+        const std::string& filename,
+        std::string savegame
+    );
+
+    /**
+    * @brief Enables or disables compression
+    *
+    * Affects the savegames queued afterwards. Enabled by default.
+    *
+    * @param compression
+    */
+    void
+    setCompression(
+        bool compression
+    );
+
+    /**
+    * @brief Blocks until all queued saves are finished
+    */
+    void
+    wait();
+
+private:
+
+    struct Implementation;
+    std::unique_ptr<Implementation> m_impl;
+
+};
+
+}
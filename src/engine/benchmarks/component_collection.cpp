@@ -0,0 +1,83 @@
+#include "engine/component_collection.h"
+
+#include "benchmarks/benchmark.h"
+#include "engine/entity_manager.h"
+#include "engine/tests/test_component.h"
+#include "util/make_unique.h"
+
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+using namespace thrive;
+
+namespace {
+
+// As many callbacks as a component type typically has filters
+const int CALLBACK_COUNT = 4;
+
+}
+
+
+THRIVE_BENCHMARK(ComponentCollection_changeCallbacks, 1000, 10000, 100000) {
+    std::unique_ptr<EntityManager> entityManager;
+    std::vector<EntityId> entities(state.size());
+    std::size_t added = 0;
+    while (state.keepRunning()) {
+        state.pauseTiming();
+        entityManager.reset(new EntityManager());
+        auto& collection = entityManager->getComponentCollection(
+            TestComponent<0>::TYPE_ID
+        );
+        for (int i = 0; i < CALLBACK_COUNT; ++i) {
+            collection.registerChangeCallbacks(
+                [&added](EntityId, Component&) { added += 1; },
+                [](EntityId, Component&) {}
+            );
+        }
+        for (EntityId& entityId : entities) {
+            entityId = entityManager->generateNewId();
+        }
+        added = 0;
+        state.resumeTiming();
+        for (EntityId entityId : entities) {
+            entityManager->addComponent(entityId, make_unique<TestComponent<0>>());
+        }
+        if (added != CALLBACK_COUNT * state.size()) {
+            throw std::logic_error("Callbacks were not called");
+        }
+    }
+}
+
+
+THRIVE_BENCHMARK(ComponentCollection_batchCallbacks, 1000, 10000, 100000) {
+    std::unique_ptr<EntityManager> entityManager;
+    std::vector<EntityId> entities(state.size());
+    std::size_t added = 0;
+    while (state.keepRunning()) {
+        state.pauseTiming();
+        entityManager.reset(new EntityManager());
+        entityManager->setDeferChanges(true);
+        auto& collection = entityManager->getComponentCollection(
+            TestComponent<0>::TYPE_ID
+        );
+        for (int i = 0; i < CALLBACK_COUNT; ++i) {
+            collection.registerBatchCallbacks(
+                [&added](const std::vector<EntityId>& batch) { added += batch.size(); },
+                [](const std::vector<EntityId>&) {}
+            );
+        }
+        for (EntityId& entityId : entities) {
+            entityId = entityManager->generateNewId();
+        }
+        added = 0;
+        state.resumeTiming();
+        for (EntityId entityId : entities) {
+            entityManager->addComponent(entityId, make_unique<TestComponent<0>>());
+        }
+        entityManager->flushChanges();
+        if (added != CALLBACK_COUNT * state.size()) {
+            throw std::logic_error("Callbacks were not called");
+        }
+    }
+}
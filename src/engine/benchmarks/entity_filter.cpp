@@ -0,0 +1,118 @@
+#include "engine/entity_filter.h"
+
+#include "benchmarks/benchmark.h"
+#include "engine/entity_manager.h"
+#include "engine/tests/test_component.h"
+#include "util/make_unique.h"
+
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+using namespace thrive;
+using thrive::benchmark::State;
+
+namespace {
+
+// Adds \a count entities matching the filters below and half as many that
+// don't, so filters have something to skip
+std::vector<EntityId>
+populate(
+    EntityManager& entityManager,
+    std::size_t count
+) {
+    std::vector<EntityId> entities;
+    entities.reserve(count);
+    for (std::size_t i = 0; i < count; ++i) {
+        EntityId entityId = entityManager.generateNewId();
+        entityManager.addComponent(entityId, make_unique<TestComponent<0>>());
+        entityManager.addComponent(entityId, make_unique<TestComponent<1>>());
+        entities.push_back(entityId);
+        if (i % 2 == 0) {
+            entityManager.addComponent(
+                entityManager.generateNewId(),
+                make_unique<TestComponent<0>>()
+            );
+        }
+    }
+    return entities;
+}
+
+// Removes and re-adds one component of every tenth entity, with
+// \a filterCount filters watching
+void
+churn(
+    State& state,
+    bool deferChanges,
+    std::size_t filterCount
+) {
+    using Filter = EntityFilter<TestComponent<0>, TestComponent<1>>;
+    EntityManager entityManager;
+    entityManager.setDeferChanges(deferChanges);
+    std::vector<std::unique_ptr<Filter>> filters;
+    for (std::size_t i = 0; i < filterCount; ++i) {
+        filters.emplace_back(new Filter(true));
+        filters.back()->setEntityManager(&entityManager);
+    }
+    std::vector<EntityId> entities = populate(entityManager, state.size());
+    entityManager.processRemovals();
+    for (auto& filter : filters) {
+        filter->clearChanges();
+    }
+    while (state.keepRunning()) {
+        for (std::size_t i = 0; i < entities.size(); i += 10) {
+            entityManager.removeComponent(entities[i], TestComponent<1>::TYPE_ID);
+        }
+        entityManager.processRemovals();
+        for (std::size_t i = 0; i < entities.size(); i += 10) {
+            entityManager.addComponent(entities[i], make_unique<TestComponent<1>>());
+        }
+        entityManager.flushChanges();
+        for (auto& filter : filters) {
+            // Like a system processing its changes
+            filter->removedEntities();
+            filter->addedEntities();
+            filter->clearChanges();
+        }
+    }
+    for (auto& filter : filters) {
+        filter->setEntityManager(nullptr);
+    }
+}
+
+}
+
+
+THRIVE_BENCHMARK(EntityFilter_iterate, 1000, 10000, 100000) {
+    EntityManager entityManager;
+    EntityFilter<TestComponent<0>, TestComponent<1>> filter;
+    filter.setEntityManager(&entityManager);
+    populate(entityManager, state.size());
+    while (state.keepRunning()) {
+        std::size_t count = 0;
+        for (const auto& value : filter) {
+            count += std::get<1>(value.second)->typeId() == TestComponent<1>::TYPE_ID;
+        }
+        // Using the result keeps the loop from being optimized away
+        if (count != state.size()) {
+            throw std::logic_error("Filter is missing entities");
+        }
+    }
+    filter.setEntityManager(nullptr);
+}
+
+
+THRIVE_BENCHMARK(EntityFilter_churn, 1000, 10000, 100000) {
+    churn(state, false, 1);
+}
+
+
+THRIVE_BENCHMARK(EntityFilter_churnDeferred, 1000, 10000, 100000) {
+    churn(state, true, 1);
+}
+
+
+// Several systems watching the same components
+THRIVE_BENCHMARK(EntityFilter_churnShared, 1000, 10000, 100000) {
+    churn(state, false, 4);
+}
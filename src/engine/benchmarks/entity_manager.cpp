@@ -0,0 +1,113 @@
+#include "engine/entity_manager.h"
+
+#include "benchmarks/benchmark.h"
+#include "engine/entity_filter.h"
+#include "engine/prefab.h"
+#include "engine/tests/test_component.h"
+#include "util/make_unique.h"
+
+#include <memory>
+#include <vector>
+
+using namespace thrive;
+
+namespace {
+
+std::vector<EntityId>
+populate(
+    EntityManager& entityManager,
+    std::size_t count
+) {
+    std::vector<EntityId> entities;
+    entities.reserve(count);
+    for (std::size_t i = 0; i < count; ++i) {
+        EntityId entityId = entityManager.generateNewId();
+        entityManager.addComponent(entityId, make_unique<TestComponent<0>>());
+        entityManager.addComponent(entityId, make_unique<TestComponent<1>>());
+        entities.push_back(entityId);
+    }
+    return entities;
+}
+
+}
+
+
+THRIVE_BENCHMARK(EntityManager_addComponent, 1000, 10000, 100000) {
+    std::unique_ptr<EntityManager> entityManager;
+    std::vector<EntityId> entities(state.size());
+    while (state.keepRunning()) {
+        state.pauseTiming();
+        entityManager.reset(new EntityManager());
+        for (EntityId& entityId : entities) {
+            entityId = entityManager->generateNewId();
+        }
+        state.resumeTiming();
+        for (EntityId entityId : entities) {
+            entityManager->addComponent(entityId, make_unique<TestComponent<0>>());
+        }
+    }
+}
+
+
+// Assembles each entity one component at a time, as a baseline for
+// EntityManager_instantiate
+THRIVE_BENCHMARK(EntityManager_createEntities, 1000, 10000, 100000) {
+    std::unique_ptr<EntityManager> entityManager;
+    EntityFilter<TestComponent<0>, TestComponent<1>> filter;
+    while (state.keepRunning()) {
+        state.pauseTiming();
+        filter.setEntityManager(nullptr);
+        entityManager.reset(new EntityManager());
+        filter.setEntityManager(entityManager.get());
+        state.resumeTiming();
+        populate(*entityManager, state.size());
+    }
+    filter.setEntityManager(nullptr);
+}
+
+
+THRIVE_BENCHMARK(EntityManager_instantiate, 1000, 10000, 100000) {
+    std::unique_ptr<EntityManager> entityManager;
+    EntityFilter<TestComponent<0>, TestComponent<1>> filter;
+    Prefab prefab;
+    prefab.addComponent(make_unique<TestComponent<0>>());
+    prefab.addComponent(make_unique<TestComponent<1>>());
+    while (state.keepRunning()) {
+        state.pauseTiming();
+        filter.setEntityManager(nullptr);
+        entityManager.reset(new EntityManager());
+        filter.setEntityManager(entityManager.get());
+        state.resumeTiming();
+        entityManager->instantiate(prefab, state.size());
+    }
+    filter.setEntityManager(nullptr);
+}
+
+
+THRIVE_BENCHMARK(EntityManager_removeEntity, 1000, 10000, 100000) {
+    std::unique_ptr<EntityManager> entityManager;
+    std::vector<EntityId> entities;
+    while (state.keepRunning()) {
+        state.pauseTiming();
+        entityManager.reset(new EntityManager());
+        entities = populate(*entityManager, state.size());
+        state.resumeTiming();
+        for (EntityId entityId : entities) {
+            entityManager->removeEntity(entityId);
+        }
+    }
+}
+
+
+THRIVE_BENCHMARK(EntityManager_processRemovals, 1000, 10000, 100000) {
+    std::unique_ptr<EntityManager> entityManager;
+    while (state.keepRunning()) {
+        state.pauseTiming();
+        entityManager.reset(new EntityManager());
+        for (EntityId entityId : populate(*entityManager, state.size())) {
+            entityManager->removeEntity(entityId);
+        }
+        state.resumeTiming();
+        entityManager->processRemovals();
+    }
+}
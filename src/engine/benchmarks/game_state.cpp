@@ -0,0 +1,134 @@
+#include "engine/system_scheduler.h"
+
+#include "benchmarks/benchmark.h"
+#include "engine/entity_command_buffer.h"
+#include "engine/entity_filter.h"
+#include "engine/entity_manager.h"
+#include "engine/system.h"
+#include "engine/tests/test_component.h"
+#include "engine/thread_pool.h"
+#include "util/make_unique.h"
+
+#include <algorithm>
+#include <deque>
+#include <memory>
+#include <utility>
+
+using namespace thrive;
+
+// GameState can only be created by a fully set up Engine (with Ogre and
+// Bullet), so these benchmarks rebuild the ECS part of its update: the
+// scheduled systems, command buffer playback and processRemovals().
+
+namespace {
+
+using MovingEntities = EntityFilter<TestComponent<0>>;
+
+using SensingEntities = EntityFilter<TestComponent<1>, TestComponent<2>>;
+
+// Stands in for a typical system that iterates over a filter
+template<typename Filter>
+class IterateSystem : public System {
+
+public:
+
+    IterateSystem(
+        EntityManager& entityManager,
+        ComponentTypeId reads,
+        ComponentTypeId writes
+    ) {
+        this->readsComponent(reads);
+        this->writesComponent(writes);
+        m_filter.setEntityManager(&entityManager);
+    }
+
+    ~IterateSystem() {
+        m_filter.setEntityManager(nullptr);
+    }
+
+    void
+    update(int) override {
+        for (const auto& value : m_filter) {
+            m_checksum += value.first;
+        }
+    }
+
+    Filter m_filter;
+
+    EntityId m_checksum = 0;
+
+};
+
+// Destroys the oldest percent of entities and creates as many new ones
+// each update
+class ChurnSystem : public System {
+
+public:
+
+    ChurnSystem(
+        EntityManager& entityManager,
+        std::deque<EntityId> entities
+    ) : m_commandBuffer(entityManager),
+        m_entities(std::move(entities))
+    {
+        this->readsComponent(TestComponent<0>::TYPE_ID);
+    }
+
+    void
+    update(int) override {
+        std::size_t count = std::max<std::size_t>(m_entities.size() / 100, 1);
+        for (std::size_t i = 0; i < count; ++i) {
+            m_commandBuffer.removeEntity(m_entities.front());
+            m_entities.pop_front();
+            EntityId entityId = m_commandBuffer.createEntity();
+            m_commandBuffer.addComponent(entityId, make_unique<TestComponent<0>>());
+            m_commandBuffer.addComponent(entityId, make_unique<TestComponent<1>>());
+            m_commandBuffer.addComponent(entityId, make_unique<TestComponent<2>>());
+            m_entities.push_back(entityId);
+        }
+    }
+
+    EntityCommandBuffer m_commandBuffer;
+
+    std::deque<EntityId> m_entities;
+
+};
+
+}
+
+
+THRIVE_BENCHMARK(GameState_update, 1000, 10000, 100000) {
+    ThreadPool threadPool;
+    threadPool.start(ThreadPool::defaultWorkerCount());
+    EntityManager entityManager;
+    std::deque<EntityId> entities;
+    for (std::size_t i = 0; i < state.size(); ++i) {
+        EntityId entityId = entityManager.generateNewId();
+        entityManager.addComponent(entityId, make_unique<TestComponent<0>>());
+        entityManager.addComponent(entityId, make_unique<TestComponent<1>>());
+        entityManager.addComponent(entityId, make_unique<TestComponent<2>>());
+        entities.push_back(entityId);
+    }
+    {
+        // Movement and sensing don't conflict and run concurrently,
+        // churn runs after movement
+        IterateSystem<MovingEntities> movement(
+            entityManager,
+            TestComponent<3>::TYPE_ID,
+            TestComponent<0>::TYPE_ID
+        );
+        IterateSystem<SensingEntities> sensing(
+            entityManager,
+            TestComponent<1>::TYPE_ID,
+            TestComponent<2>::TYPE_ID
+        );
+        ChurnSystem churn(entityManager, std::move(entities));
+        SystemScheduler scheduler({&movement, &sensing, &churn});
+        while (state.keepRunning()) {
+            scheduler.update(10, threadPool);
+            churn.m_commandBuffer.playback();
+            entityManager.processRemovals();
+        }
+    }
+    threadPool.stop();
+}
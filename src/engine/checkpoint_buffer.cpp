@@ -0,0 +1,134 @@
+#include "engine/checkpoint_buffer.h"
+
+#include "engine/serialization.h"
+#include "scripting/luabind.h"
+
+#include <assert.h>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+using namespace thrive;
+
+
+luabind::scope
+CheckpointBuffer::luaBindings() {
+    using namespace luabind;
+    return class_<CheckpointBuffer>("CheckpointBuffer")
+        .def("capacity", &CheckpointBuffer::capacity)
+        .def("clear", &CheckpointBuffer::clear)
+        .def("setCapacity", &CheckpointBuffer::setCapacity)
+        .def("size", &CheckpointBuffer::size)
+    ;
+}
+
+
+CheckpointBuffer::CheckpointBuffer(
+    std::size_t capacity
+) : m_capacity(capacity)
+{
+    assert(capacity > 0 && "CheckpointBuffer needs room for at least one checkpoint");
+}
+
+
+std::size_t
+CheckpointBuffer::byteSize() const {
+    std::size_t bytes = 0;
+    for (const std::string& checkpoint : m_checkpoints) {
+        bytes += checkpoint.size();
+    }
+    return bytes;
+}
+
+
+std::size_t
+CheckpointBuffer::capacity() const {
+    return m_capacity;
+}
+
+
+void
+CheckpointBuffer::clear() {
+    m_checkpoints.clear();
+}
+
+
+StorageContainer
+CheckpointBuffer::get(
+    std::size_t age
+) const {
+    std::istringstream stream(m_checkpoints.at(age), std::istringstream::binary);
+    StorageContainer savegame;
+    stream >> savegame;
+    return savegame;
+}
+
+
+void
+CheckpointBuffer::push(
+    const StorageContainer& savegame
+) {
+    std::ostringstream stream(std::ostringstream::binary);
+    stream << savegame;
+    this->pushSerialized(stream.str());
+}
+
+
+void
+CheckpointBuffer::pushSerialized(
+    std::string savegame
+) {
+    m_checkpoints.push_front(std::move(savegame));
+    if (m_checkpoints.size() > m_capacity) {
+        m_checkpoints.pop_back();
+    }
+}
+
+
+const std::string&
+CheckpointBuffer::serialized(
+    std::size_t age
+) const {
+    return m_checkpoints.at(age);
+}
+
+
+void
+CheckpointBuffer::setCapacity(
+    std::size_t capacity
+) {
+    if (capacity == 0) {
+        throw std::invalid_argument("CheckpointBuffer needs room for at least one checkpoint");
+    }
+    m_capacity = capacity;
+    if (m_checkpoints.size() > m_capacity) {
+        m_checkpoints.resize(m_capacity);
+    }
+}
+
+
+std::size_t
+CheckpointBuffer::size() const {
+    return m_checkpoints.size();
+}
+
+
+void
+CheckpointBuffer::write(
+    const std::string& filename,
+    std::size_t age
+) const {
+    const std::string& checkpoint = m_checkpoints.at(age);
+    std::ofstream stream(
+        filename,
+        std::ofstream::trunc | std::ofstream::binary
+    );
+    if (not stream) {
+        throw std::runtime_error("Could not open " + filename + " for writing the checkpoint");
+    }
+    stream.write(checkpoint.data(), checkpoint.size());
+    stream.close();
+    if (not stream) {
+        throw std::runtime_error("Could not write checkpoint to " + filename);
+    }
+}
@@ -0,0 +1,170 @@
+#pragma once
+
+#include <cstddef>
+#include <deque>
+#include <string>
+
+namespace luabind {
+class scope;
+}
+
+namespace thrive {
+
+class StorageContainer;
+
+/**
+* @brief Keeps the most recent savegames in memory
+*
+* Each checkpoint is a savegame in its binary serialized form, so it takes
+* little memory and can be written to disk as is. When the buffer is full,
+* pushing a new checkpoint drops the oldest one.
+*
+* Checkpoints are addressed by their age: 0 is the most recent one, 1 the
+* one before, and so on.
+*
+* @see Engine::checkpoint()
+*/
+class CheckpointBuffer {
+
+public:
+
+    /**
+    * @brief Lua bindings
+    *
+    * Exposes:
+    * - CheckpointBuffer::capacity()
+    * - CheckpointBuffer::clear()
+    * - CheckpointBuffer::setCapacity()
+    * - CheckpointBuffer::size()
+    *
+    * @return
+    */
+    static luabind::scope
+    luaBindings();
+
+    /**
+    * @brief Constructor
+    *
+    * @param capacity
+    *   The maximum number of checkpoints, at least 1
+    */
+    explicit CheckpointBuffer(
+        std::size_t capacity = 4
+    );
+
+    /**
+    * @brief The memory taken by all checkpoints, in bytes
+    */
+    std::size_t
+    byteSize() const;
+
+    /**
+    * @brief The maximum number of checkpoints
+    */
+    std::size_t
+    capacity() const;
+
+    /**
+    * @brief Removes all checkpoints
+    */
+    void
+    clear();
+
+    /**
+    * @brief Deserializes a checkpoint
+    *
+    * @param age
+    *   The checkpoint's age, 0 is the most recent one
+    *
+    * @throws std::out_of_range if there is no checkpoint that old
+    */
+    StorageContainer
+    get(
+        std::size_t age = 0
+    ) const;
+
+    /**
+    * @brief Serializes a savegame into a new checkpoint
+    *
+    * @param savegame
+    *   The savegame to keep
+    */
+    void
+    push(
+        const StorageContainer& savegame
+    );
+
+    /**
+    * @brief Adds an already serialized savegame as a new checkpoint
+    *
+    * @param savegame
+    *   The savegame, as written by StorageWriter
+    */
+    void
+    pushSerialized(
+        std::string savegame
+    );
+
+    /**
+    * @brief The serialized savegame of a checkpoint
+    *
+    * Can be read with StorageReader without deserializing it first.
+    *
+    * @param age
+    *   The checkpoint's age, 0 is the most recent one
+    *
+    * @throws std::out_of_range if there is no checkpoint that old
+    */
+    const std::string&
+    serialized(
+        std::size_t age = 0
+    ) const;
+
+    /**
+    * @brief Sets the maximum number of checkpoints
+    *
+    * Drops the oldest checkpoints if there are more than \a capacity.
+    *
+    * @param capacity
+    *   The new capacity, at least 1
+    */
+    void
+    setCapacity(
+        std::size_t capacity
+    );
+
+    /**
+    * @brief The number of checkpoints
+    */
+    std::size_t
+    size() const;
+
+    /**
+    * @brief Writes a checkpoint to a savegame file
+    *
+    * The file can be loaded with Engine::load().
+    *
+    * @param filename
+    *   The file to write
+    * @param age
+    *   The checkpoint's age, 0 is the most recent one
+    *
+    * @throws std::out_of_range if there is no checkpoint that old
+    * @throws std::runtime_error if the file can't be written
+    */
+    void
+    write(
+        const std::string& filename,
+        std::size_t age = 0
+    ) const;
+
+private:
+
+    std::size_t m_capacity;
+
+    // Newest first
+    std::deque<std::string> m_checkpoints;
+
+};
+
+}
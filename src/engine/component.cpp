@@ -115,6 +115,22 @@ Component::load(
 }
 
 
+bool
+Component::read(
+    StorageReader&
+) {
+    return false;
+}
+
+
+bool
+Component::reload(
+    const StorageContainer&
+) {
+    return false;
+}
+
+
 void
 Component::setVolatile(
     bool isVolatile
@@ -131,3 +147,22 @@ Component::storage() const {
 }
 
 
+void
+Component::trackChanges(
+    DirtyList*
+) {
+}
+
+
+ComponentPool*
+Component::typePool() const {
+    return nullptr;
+}
+
+
+void
+Component::write(
+    StorageWriter& writer
+) const {
+    writer.writeEntries(this->storage());
+}
@@ -3,8 +3,10 @@
 */
 #pragma once
 
+#include "engine/component_pool.h"
 #include "engine/typedefs.h"
 
+#include <cstddef>
 #include <memory>
 #include <string>
 #include <unordered_map>
@@ -15,7 +17,10 @@ class scope;
 
 namespace thrive {
 
+class DirtyList;
 class StorageContainer;
+class StorageReader;
+class StorageWriter;
 
 /**
 * @brief Base class for components
@@ -81,6 +86,47 @@ public:
         return m_owner;
     }
 
+    /**
+    * @brief Reads the component straight from a savegame
+    *
+    * EntityManager::read() calls this for components written by write(),
+    * with \a reader in the component's container right after the owner.
+    * The component is either the entity's existing one or a new one loaded
+    * with only the owner. Overrides must read the container's remaining
+    * entries with StorageReader::next(), replace all serialized state and
+    * touch the properties that systems have to apply again, like reload().
+    *
+    * @param reader
+    *
+    * @return
+    *   \c false if nothing was read and the component has to be loaded from
+    *   a StorageContainer instead. The default reads nothing and returns
+    *   \c false.
+    */
+    virtual bool
+    read(
+        StorageReader& reader
+    );
+
+    /**
+    * @brief Loads a savegame's state into the existing component
+    *
+    * EntityManager::read() calls this instead of replacing the component
+    * when the savegame has a component of the same type for the same 
+    * entity. Overrides must replace all serialized state and touch the
+    * properties that systems have to apply again.
+    *
+    * @param storage
+    *
+    * @return
+    *   \c false if the component has to be replaced by a newly loaded one
+    *   instead. The default does nothing and returns \c false.
+    */
+    virtual bool
+    reload(
+        const StorageContainer& storage
+    );
+
     /**
     * @brief Sets the volatile flag
     *
@@ -116,18 +162,61 @@ public:
     virtual StorageContainer
     storage() const = 0;
 
+    /**
+    * @brief Starts or stops tracking the component's touchables
+    *
+    * Called by the ComponentCollection when the component is added, and
+    * with \c nullptr when it is removed. Override this to call
+    * Touchable::track() on the touchable properties that systems should
+    * find in the collection's DirtyList. The default does nothing.
+    *
+    * @param dirtyList
+    *   The collection's dirty list or \c nullptr
+    */
+    virtual void
+    trackChanges(
+        DirtyList* dirtyList
+    );
+
     /**
     * @brief The component's type id
     */
     virtual ComponentTypeId
     typeId() const = 0;
 
+    /**
+    * @brief The pool the component's type is allocated from
+    *
+    * Overridden by the COMPONENT macro.
+    *
+    * @return
+    *   The type's pool or \c nullptr if the type isn't pooled (e.g.
+    *   components defined in Lua)
+    */
+    virtual ComponentPool*
+    typePool() const;
+
     /**
     * @brief The component's type name
     */
     virtual std::string
     typeName() const = 0;
 
+    /**
+    * @brief Writes the component straight to a savegame
+    *
+    * Called by EntityManager::write() with \a writer in the component's
+    * container. Overrides must write the owner first, so that read() can
+    * be used, and otherwise the same entries as storage() without building
+    * it. The default writes the entries of storage().
+    *
+    * @param writer
+    */
+    virtual void
+    write(
+        StorageWriter& writer
+    ) const;
+
 protected:
 
 private:
@@ -153,6 +242,13 @@ private:
 *   variable.
 * - \c typeName: Overrides Component::typeName() and returns the name returned
 *   by \c TYPE_NAME.
+* - \c TYPE_POOL: Static function that returns the ComponentPool all 
+*   instances of the component are allocated from. Defined by 
+*   REGISTER_COMPONENT.
+* - \c typePool: Overrides Component::typePool() and returns the pool
+*   returned by \c TYPE_POOL.
+* - Class specific \c operator \c new and \c operator \c delete that 
+*   allocate from \c TYPE_POOL.
 *
 * @param name 
 *   The component's name
@@ -184,6 +280,26 @@ private:
             return TYPE_NAME(); \
         } \
         \
+        static thrive::ComponentPool& TYPE_POOL(); \
+        \
+        thrive::ComponentPool* typePool() const override { \
+            return &TYPE_POOL(); \
+        } \
+        \
+        static void* operator new(std::size_t size) { \
+            return TYPE_POOL().allocate(size); \
+        } \
+        \
+        static void* operator new(std::size_t, void* place) { \
+            return place; \
+        } \
+        \
+        static void operator delete(void* pointer, std::size_t size) { \
+            TYPE_POOL().deallocate(pointer, size); \
+        } \
+        \
+        static void operator delete(void*, void*) {} \
+        \
     private: \
 
 
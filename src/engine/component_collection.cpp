@@ -1,38 +1,198 @@
 #include "engine/component_collection.h"
 
+#include "engine/dirty_list.h"
 #include "util/contains.h"
 
+#include <algorithm>
+#include <tuple>
 #include <unordered_set>
 
 #include <iostream>
 
 using namespace thrive;
 
+namespace {
+
+struct PendingChange {
+
+    // The component the entity had before the first deferred change, kept 
+    // alive until the change has been reported
+    std::unique_ptr<Component> m_original;
+
+    bool m_wasPresent = false;
+
+};
+
+}
+
 struct ComponentCollection::Implementation {
 
     Implementation(
-        ComponentTypeId type
-    ) : m_type(type)
+        ComponentTypeId type,
+        std::size_t signatureBit,
+        bool isTag
+    ) : m_isTag(isTag),
+        m_signatureBit(signatureBit),
+        m_type(type)
     {
     }
 
-    std::unordered_map<
-        unsigned int, 
-        std::pair<ChangeCallback, ChangeCallback>
-    > m_changeCallbacks;
+    void
+    notifyAdded(
+        const std::vector<EntityId>& entityIds
+    ) {
+        for (auto& value : m_subscribers) {
+            Subscriber& subscriber = value.second;
+            // Tags have no component to pass
+            if (subscriber.m_onComponentAdded and not m_isTag) {
+                for (EntityId entityId : entityIds) {
+                    subscriber.m_onComponentAdded(entityId, *m_components.at(entityId));
+                }
+            }
+            if (subscriber.m_onComponentsAdded) {
+                subscriber.m_onComponentsAdded(entityIds);
+            }
+        }
+    }
+
+    void
+    notifyAdded(
+        EntityId entityId
+    ) {
+        // Local, a callback may add another component re-entrantly
+        std::vector<EntityId> entityIds(1, entityId);
+        this->notifyAdded(entityIds);
+    }
+
+    void
+    notifyRemoved(
+        EntityId entityId,
+        Component* component
+    ) {
+        std::vector<EntityId> entityIds(1, entityId);
+        for (auto& value : m_subscribers) {
+            Subscriber& subscriber = value.second;
+            if (subscriber.m_onComponentRemoved and component) {
+                subscriber.m_onComponentRemoved(entityId, *component);
+            }
+            if (subscriber.m_onComponentsRemoved) {
+                subscriber.m_onComponentsRemoved(entityIds);
+            }
+        }
+    }
+
+    void
+    notifyRemoved(
+        const std::vector<std::pair<EntityId, Component*>>& removed
+    ) {
+        if (removed.empty()) {
+            return;
+        }
+        std::vector<EntityId> entityIds;
+        entityIds.reserve(removed.size());
+        for (const auto& pair : removed) {
+            entityIds.push_back(pair.first);
+        }
+        for (auto& value : m_subscribers) {
+            Subscriber& subscriber = value.second;
+            if (subscriber.m_onComponentRemoved and not m_isTag) {
+                for (const auto& pair : removed) {
+                    subscriber.m_onComponentRemoved(pair.first, *pair.second);
+                }
+            }
+            if (subscriber.m_onComponentsRemoved) {
+                subscriber.m_onComponentsRemoved(entityIds);
+            }
+        }
+    }
+
+    void
+    countAdded(
+        Component* component,
+        std::size_t count
+    ) {
+        if (not m_pool and component) {
+            m_pool = component->typePool();
+        }
+        m_statistics.added += count;
+        m_statistics.peakCount = std::max(m_statistics.peakCount, m_components.size());
+    }
+
+    std::unique_ptr<Component>
+    detach(
+        ComponentMap::iterator iter
+    ) {
+        EntityId entityId = iter->first;
+        std::unique_ptr<Component> component = std::move(iter->second);
+        if (component) {
+            component->setOwner(NULL_ENTITY);
+            component->trackChanges(nullptr);
+        }
+        m_components.erase(entityId);
+        m_statistics.removed += 1;
+        return component;
+    }
+
+    void
+    recordRemoval(
+        EntityId entityId,
+        std::unique_ptr<Component> component
+    ) {
+        if (m_pendingChanges.count(entityId) == 0) {
+            PendingChange change;
+            change.m_original = std::move(component);
+            change.m_wasPresent = true;
+            m_pendingChanges.insert(std::make_pair(entityId, std::move(change)));
+        }
+        // Otherwise, the component has been added after the last flush 
+        // and nobody has been told about it yet. It can just go.
+    }
+
+    struct Subscriber {
+
+        ChangeCallback m_onComponentAdded;
+
+        ChangeCallback m_onComponentRemoved;
+
+        BatchCallback m_onComponentsAdded;
 
-    std::unordered_map<EntityId, std::unique_ptr<Component>> m_components;
+        BatchCallback m_onComponentsRemoved;
+
+    };
+
+    // Declared first so that it outlives the components it tracks
+    DirtyList m_dirtyList;
+
+    ComponentMap m_components;
+
+    bool m_deferChanges = false;
+
+    bool m_isTag = false;
 
     unsigned int m_nextChangeCallbackId = 0;
 
+    SparseEntityMap<PendingChange> m_pendingChanges;
+
+    // The pool of the first added component, if any
+    ComponentPool* m_pool = nullptr;
+
+    std::size_t m_signatureBit = 0;
+
+    // Only added, peakCount and removed are kept up to date
+    Statistics m_statistics;
+
+    std::unordered_map<unsigned int, Subscriber> m_subscribers;
+
     ComponentTypeId m_type = NULL_COMPONENT_TYPE;
 
 };
 
 
 ComponentCollection::ComponentCollection(
-    ComponentTypeId type
-) : m_impl(new Implementation(type))
+    ComponentTypeId type,
+    std::size_t signatureBit,
+    bool isTag
+) : m_impl(new Implementation(type, signatureBit, isTag))
 {
 }
 
@@ -53,49 +213,141 @@ ComponentCollection::addComponent(
     EntityId entityId,
     std::unique_ptr<Component> component
 ) {
+    assert(not m_impl->m_isTag && "Use addTag() for tags");
     bool isNew = true;
+    Component* rawComponent = component.get();
     // Check if we are overwriting an old component
-    if (m_impl->m_components.erase(entityId) > 0) {
+    auto iter = m_impl->m_components.find(entityId);
+    if (iter != m_impl->m_components.end()) {
         isNew = false;
-        for (auto& value : m_impl->m_changeCallbacks) {
-            value.second.second(entityId, *component);
+        std::unique_ptr<Component> oldComponent = std::move(iter->second);
+        oldComponent->setOwner(NULL_ENTITY);
+        oldComponent->trackChanges(nullptr);
+        m_impl->m_statistics.removed += 1;
+        // Replace in place, the entity keeps its slot in the dense array
+        iter->second = std::move(component);
+        if (m_impl->m_deferChanges) {
+            m_impl->recordRemoval(entityId, std::move(oldComponent));
+        }
+        else {
+            m_impl->notifyRemoved(entityId, oldComponent.get());
         }
     }
-    // Insert new component
-    Component* rawComponent = component.get();
-    m_impl->m_components.insert(std::make_pair(
-        entityId, 
-        std::move(component)
-    ));
-    for (auto& value : m_impl->m_changeCallbacks) {
-        value.second.first(entityId, *rawComponent);
+    else {
+        m_impl->m_components.insert(std::make_pair(
+            entityId, 
+            std::move(component)
+        ));
+        if (m_impl->m_deferChanges and m_impl->m_pendingChanges.count(entityId) == 0) {
+            m_impl->m_pendingChanges.insert(
+                std::make_pair(entityId, PendingChange())
+            );
+        }
+    }
+    if (not m_impl->m_deferChanges) {
+        m_impl->notifyAdded(entityId);
     }
     rawComponent->setOwner(entityId);
+    rawComponent->trackChanges(&m_impl->m_dirtyList);
+    m_impl->countAdded(rawComponent, 1);
     return isNew;
 }
 
 
+void
+ComponentCollection::addNewComponents(
+    std::vector<std::pair<EntityId, std::unique_ptr<Component>>> components
+) {
+    for (auto& pair : components) {
+        EntityId entityId = pair.first;
+        Component* rawComponent = pair.second.get();
+        assert(m_impl->m_components.count(entityId) == 0 && "Entity already has a component of this type");
+        m_impl->m_components.insert(std::make_pair(
+            entityId,
+            std::move(pair.second)
+        ));
+        if (m_impl->m_deferChanges and m_impl->m_pendingChanges.count(entityId) == 0) {
+            m_impl->m_pendingChanges.insert(
+                std::make_pair(entityId, PendingChange())
+            );
+        }
+        rawComponent->setOwner(entityId);
+        rawComponent->trackChanges(&m_impl->m_dirtyList);
+    }
+    if (not components.empty()) {
+        m_impl->countAdded(m_impl->m_components.at(components.front().first).get(), components.size());
+    }
+}
+
+
+bool
+ComponentCollection::addTag(
+    EntityId entityId
+) {
+    assert(m_impl->m_isTag && "Use addComponent() for components");
+    bool isNew = false;
+    std::tie(std::ignore, isNew) = m_impl->m_components.insert(
+        std::make_pair(entityId, nullptr)
+    );
+    if (not isNew) {
+        return false;
+    }
+    if (m_impl->m_deferChanges) {
+        if (m_impl->m_pendingChanges.count(entityId) == 0) {
+            m_impl->m_pendingChanges.insert(
+                std::make_pair(entityId, PendingChange())
+            );
+        }
+    }
+    else {
+        m_impl->notifyAdded(entityId);
+    }
+    m_impl->countAdded(nullptr, 1);
+    return true;
+}
+
+
 void
 ComponentCollection::clear() {
-    auto iter = m_impl->m_components.begin();
-    while (iter != m_impl->m_components.end()) {
-        EntityId entityId = iter->first;
-        std::unique_ptr<Component>& component = iter->second;
-        for (auto& value : m_impl->m_changeCallbacks) {
-            value.second.second(entityId, *component);
+    this->flushChanges();
+    std::vector<std::unique_ptr<Component>> components;
+    std::vector<std::pair<EntityId, Component*>> removed;
+    components.reserve(m_impl->m_components.size());
+    removed.reserve(m_impl->m_components.size());
+    for (auto& pair : m_impl->m_components) {
+        removed.emplace_back(pair.first, pair.second.get());
+        if (pair.second) {
+            pair.second->setOwner(NULL_ENTITY);
+            pair.second->trackChanges(nullptr);
         }
-        component->setOwner(NULL_ENTITY);
-        iter = m_impl->m_components.erase(iter);
+        components.push_back(std::move(pair.second));
     }
+    m_impl->m_statistics.removed += components.size();
+    m_impl->m_components.clear();
+    m_impl->notifyRemoved(removed);
 }
 
 
-const std::unordered_map<EntityId, std::unique_ptr<Component>>&
+const ComponentCollection::ComponentMap&
 ComponentCollection::components() const {
     return m_impl->m_components;
 }
 
 
+bool
+ComponentCollection::contains(
+    EntityId entityId
+) const {
+    return m_impl->m_components.count(entityId) > 0;
+}
+
+
+DirtyList&
+ComponentCollection::dirtyList() {
+    return m_impl->m_dirtyList;
+}
+
+
 bool
 ComponentCollection::empty() const {
     return m_impl->m_components.empty();
@@ -116,16 +368,76 @@ ComponentCollection::get(
 }
 
 
+bool
+ComponentCollection::isTag() const {
+    return m_impl->m_isTag;
+}
+
+
+void
+ComponentCollection::flushChanges() {
+    if (m_impl->m_pendingChanges.empty()) {
+        return;
+    }
+    // Take the changes, in case a callback triggers new ones
+    SparseEntityMap<PendingChange> changes;
+    std::swap(changes, m_impl->m_pendingChanges);
+    std::vector<EntityId> entityIds;
+    entityIds.reserve(changes.size());
+    for (const auto& pair : changes) {
+        entityIds.push_back(pair.first);
+    }
+    std::sort(entityIds.begin(), entityIds.end());
+    std::vector<std::pair<EntityId, Component*>> removed;
+    std::vector<EntityId> added;
+    for (EntityId entityId : entityIds) {
+        PendingChange& change = changes.at(entityId);
+        if (change.m_wasPresent) {
+            removed.emplace_back(entityId, change.m_original.get());
+        }
+        if (m_impl->m_components.count(entityId) > 0) {
+            added.push_back(entityId);
+        }
+    }
+    m_impl->notifyRemoved(removed);
+    if (not added.empty()) {
+        m_impl->notifyAdded(added);
+    }
+}
+
+
+void
+ComponentCollection::notifyNewComponents(
+    const std::vector<EntityId>& entityIds
+) {
+    if (not m_impl->m_deferChanges and not entityIds.empty()) {
+        m_impl->notifyAdded(entityIds);
+    }
+}
+
+
+unsigned int
+ComponentCollection::registerBatchCallbacks(
+    BatchCallback onComponentsAdded,
+    BatchCallback onComponentsRemoved
+) {
+    unsigned int id = m_impl->m_nextChangeCallbackId++;
+    Implementation::Subscriber& subscriber = m_impl->m_subscribers[id];
+    subscriber.m_onComponentsAdded = std::move(onComponentsAdded);
+    subscriber.m_onComponentsRemoved = std::move(onComponentsRemoved);
+    return id;
+}
+
+
 unsigned int
 ComponentCollection::registerChangeCallbacks(
     ChangeCallback onComponentAdded,
     ChangeCallback onComponentRemoved
 ) {
     unsigned int id = m_impl->m_nextChangeCallbackId++;
-    m_impl->m_changeCallbacks.insert(std::make_pair(
-        id,
-        std::make_pair(onComponentAdded, onComponentRemoved)
-    ));
+    Implementation::Subscriber& subscriber = m_impl->m_subscribers[id];
+    subscriber.m_onComponentAdded = std::move(onComponentAdded);
+    subscriber.m_onComponentRemoved = std::move(onComponentRemoved);
     return id;
 }
 
@@ -135,15 +447,71 @@ ComponentCollection::removeComponent(
     EntityId entityId
 ) {
     auto iter = m_impl->m_components.find(entityId);
-    if (iter != m_impl->m_components.end()) {
-        for (auto& value : m_impl->m_changeCallbacks) {
-            value.second.second(entityId, *iter->second);
+    if (iter == m_impl->m_components.end()) {
+        return false;
+    }
+    std::unique_ptr<Component> component = m_impl->detach(iter);
+    if (m_impl->m_deferChanges) {
+        m_impl->recordRemoval(entityId, std::move(component));
+    }
+    else {
+        m_impl->notifyRemoved(entityId, component.get());
+    }
+    return true;
+}
+
+
+void
+ComponentCollection::removeComponents(
+    const std::vector<EntityId>& entityIds
+) {
+    std::vector<std::unique_ptr<Component>> components;
+    std::vector<std::pair<EntityId, Component*>> removed;
+    for (EntityId entityId : entityIds) {
+        auto iter = m_impl->m_components.find(entityId);
+        if (iter == m_impl->m_components.end()) {
+            continue;
+        }
+        std::unique_ptr<Component> component = m_impl->detach(iter);
+        if (m_impl->m_deferChanges) {
+            m_impl->recordRemoval(entityId, std::move(component));
         }
-        iter->second->setOwner(NULL_ENTITY);
-        m_impl->m_components.erase(iter);
-        return true;
+        else {
+            removed.emplace_back(entityId, component.get());
+            components.push_back(std::move(component));
+        }
+    }
+    // Components stay alive until everyone has been notified
+    m_impl->notifyRemoved(removed);
+}
+
+
+void
+ComponentCollection::setDeferChanges(
+    bool deferChanges
+) {
+    m_impl->m_deferChanges = deferChanges;
+    if (not deferChanges) {
+        this->flushChanges();
+    }
+}
+
+
+std::size_t
+ComponentCollection::signatureBit() const {
+    return m_impl->m_signatureBit;
+}
+
+
+ComponentCollection::Statistics
+ComponentCollection::statistics() const {
+    Statistics statistics = m_impl->m_statistics;
+    statistics.count = m_impl->m_components.size();
+    statistics.type = m_impl->m_type;
+    if (m_impl->m_pool) {
+        statistics.bytesAllocated = m_impl->m_pool->capacity() * m_impl->m_pool->slotSize();
     }
-    return false;
+    return statistics;
 }
 
 
@@ -157,6 +525,6 @@ void
 ComponentCollection::unregisterChangeCallbacks(
     unsigned int id
 ) {
-    m_impl->m_changeCallbacks.erase(id);
+    m_impl->m_subscribers.erase(id);
 }
 
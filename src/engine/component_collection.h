@@ -1,12 +1,17 @@
 #pragma once
 
 #include "engine/component.h"
+#include "engine/sparse_entity_map.h"
 #include "engine/typedefs.h"
 
+#include <cstdint>
+#include <functional>
 #include <memory>
+#include <vector>
 
 namespace thrive {
 
+class DirtyList;
 class EntityManager;
 
 /**
@@ -19,6 +24,22 @@ class EntityManager;
 *
 * Component collections are pretty much read-only for anything but the 
 * EntityManager. Use the manager to actually add or remove components.
+*
+* The components are stored in a SparseEntityMap, so iterating over
+* components() walks a contiguous array instead of hash buckets.
+*
+* Change notifications can be deferred (see 
+* EntityManager::setDeferChanges()). In that case, the collection only 
+* records which entities have changed and reports the net changes with 
+* the next flush, sorted by entity id: first all removals, then all 
+* additions. A component that was added and removed again between two 
+* flushes is never reported. Overwritten or removed components are kept 
+* alive until their removal has been reported.
+*
+* Collections of tags (see TAG) hold no components at all. Their entries
+* are \c nullptr, get() always returns \c nullptr and change callbacks
+* are never called. Use contains() or the entity's signature to test for a
+* tag, and batch callbacks to be notified about tags.
 */
 class ComponentCollection {
 
@@ -29,6 +50,61 @@ public:
     */
     using ChangeCallback = std::function<void(EntityId, Component&)>;
 
+    /**
+    * @brief Callback for when several components have been added or removed
+    */
+    using BatchCallback = std::function<void(const std::vector<EntityId>&)>;
+
+    /**
+    * @brief Container type of the collection's components
+    */
+    using ComponentMap = SparseEntityMap<std::unique_ptr<Component>>;
+
+    /**
+    * @brief Population and memory figures of a collection
+    *
+    * @see statistics()
+    */
+    struct Statistics {
+
+        /**
+        * @brief Number of components added since the collection was created
+        *
+        * Replacing a component counts as one addition and one removal.
+        */
+        std::uint64_t added = 0;
+
+        /**
+        * @brief Memory reserved by the component type's ComponentPool
+        *
+        * The pool is shared by all game states. 0 if the type isn't pooled
+        * or no component has been added yet.
+        */
+        std::size_t bytesAllocated = 0;
+
+        /**
+        * @brief Current number of components
+        */
+        std::size_t count = 0;
+
+        /**
+        * @brief Highest number of components at any time
+        */
+        std::size_t peakCount = 0;
+
+        /**
+        * @brief Number of components removed since the collection was
+        * created
+        */
+        std::uint64_t removed = 0;
+
+        /**
+        * @brief The type id of the collection's components
+        */
+        ComponentTypeId type = NULL_COMPONENT_TYPE;
+
+    };
+
     /**
     * @brief Destructor
     */
@@ -51,10 +127,34 @@ public:
     /**
     * @brief Returns a reference to the internal component map
     *
+    * Iterating over the map yields (EntityId, std::unique_ptr<Component>)
+    * pairs in no particular order.
     */
-    const std::unordered_map<EntityId, std::unique_ptr<Component>>&
+    const ComponentMap&
     components() const;
 
+    /**
+    * @brief Checks whether an entity has a component (or tag) in this
+    *   collection
+    *
+    * @param entityId
+    *   The entity to check
+    */
+    bool
+    contains(
+        EntityId entityId
+    ) const;
+
+    /**
+    * @brief The dirty list of this collection's components
+    *
+    * Components added to the collection register their touchable
+    * properties with this list (see Component::trackChanges()), so systems
+    * can ask which components have changed since their last update.
+    */
+    DirtyList&
+    dirtyList();
+
     /**
     * @brief Checks whether this collection is empty
     *
@@ -78,9 +178,43 @@ public:
         EntityId entityId
     ) const;
 
+    /**
+    * @brief Whether this collection holds a tag type
+    *
+    * @see ComponentFactory::isTagType()
+    */
+    bool
+    isTag() const;
+
+    /**
+    * @brief Registers callbacks for batches of added or removed components
+    *
+    * Unlike change callbacks, batch callbacks are called once per batch of
+    * changes instead of once per component. Without deferred changes, a 
+    * batch can still contain a single entity only.
+    *
+    * @param onComponentsAdded
+    *   Called with the entities whose component has been added
+    * @param onComponentsRemoved
+    *   Called with the entities whose component has been removed
+    *
+    * @return 
+    *   An identifier with which you can remove the callbacks.
+    *
+    * @see unregisterChangeCallbacks
+    */
+    unsigned int
+    registerBatchCallbacks(
+        BatchCallback onComponentsAdded,
+        BatchCallback onComponentsRemoved
+    );
+
     /**
     * @brief Registers callbacks for when components are added or removed
     *
+    * The callbacks are not called for tags, which have no component to
+    * pass to them.
+    *
     * @param onComponentAdded
     *   Called when a component has been added
     * @param onComponentRemoved
@@ -97,6 +231,23 @@ public:
         ChangeCallback onComponentRemoved
     );
 
+    /**
+    * @brief The bit representing this collection in entity signatures
+    *
+    * @see EntityManager::signature()
+    */
+    std::size_t
+    signatureBit() const;
+
+    /**
+    * @brief Population and memory figures
+    *
+    * Cheap to call, all figures are kept up to date as components are
+    * added and removed. Not thread safe, call it between frames.
+    */
+    Statistics
+    statistics() const;
+
     /**
     * @brief The type id of the collection's components
     */
@@ -109,7 +260,7 @@ public:
     * If the id could not be found, does nothing.
     *
     * @param id
-    *   The id returned by registerChangeCallbacks
+    *   The id returned by registerChangeCallbacks or registerBatchCallbacks
     */
     void
     unregisterChangeCallbacks(
@@ -127,9 +278,13 @@ private:
     * @brief Constructor
     *
     * @param type The type id of the components held by this collection.
+    * @param signatureBit The collection's bit in entity signatures
+    * @param isTag Whether \a type is a tag type
     */
     ComponentCollection(
-        ComponentTypeId type
+        ComponentTypeId type,
+        std::size_t signatureBit,
+        bool isTag = false
     );
 
     /**
@@ -152,6 +307,57 @@ private:
         std::unique_ptr<Component> component
     );
 
+    /**
+    * @brief Adds components to entities that don't have one yet
+    *
+    * Unlike addComponent(), this doesn't notify the callbacks. Call
+    * notifyNewComponents() once all components are in place.
+    *
+    * @param components
+    *   The components and the entities they belong to
+    */
+    void
+    addNewComponents(
+        std::vector<std::pair<EntityId, std::unique_ptr<Component>>> components
+    );
+
+    /**
+    * @brief Tags an entity
+    *
+    * Also calls any batch callbacks registered for added components, unless
+    * the entity already has the tag.
+    *
+    * @param entityId
+    *   The entity to tag
+    *
+    * @return
+    *   \c true if the tag is new, \c false otherwise
+    */
+    bool
+    addTag(
+        EntityId entityId
+    );
+
+    /**
+    * @brief Reports deferred changes to the registered callbacks
+    */
+    void
+    flushChanges();
+
+    /**
+    * @brief Reports components added by addNewComponents()
+    *
+    * With deferred changes, the components have already been recorded
+    * for the next flush and this does nothing.
+    *
+    * @param entityIds
+    *   The entities whose components have been added
+    */
+    void
+    notifyNewComponents(
+        const std::vector<EntityId>& entityIds
+    );
+
     /**
     * @brief Removes a component
     *
@@ -169,6 +375,32 @@ private:
         EntityId entityId
     );
 
+    /**
+    * @brief Removes the components of several entities
+    *
+    * Change callbacks are called once per removed component, batch 
+    * callbacks once for all of them.
+    *
+    * @param entityIds
+    *   The entities whose components to remove
+    */
+    void
+    removeComponents(
+        const std::vector<EntityId>& entityIds
+    );
+
+    /**
+    * @brief Enables or disables deferred change notifications
+    *
+    * Disabling deferred changes flushes any pending changes.
+    *
+    * @param deferChanges
+    */
+    void
+    setDeferChanges(
+        bool deferChanges
+    );
+
     struct Implementation;
     std::unique_ptr<Implementation> m_impl;
     
@@ -4,6 +4,7 @@
 
 #include <luabind/class_info.hpp>
 #include <luabind/adopt_policy.hpp>
+#include <vector>
 
 using namespace thrive;
 
@@ -34,6 +35,25 @@ globalRegistry() {
 }
 
 
+// Indexed by type id
+static std::vector<bool>&
+tagTypes() {
+    static std::vector<bool> tags;
+    return tags;
+}
+
+
+static void
+markAsTag(
+    ComponentTypeId typeId
+) {
+    if (tagTypes().size() <= typeId) {
+        tagTypes().resize(typeId + 1, false);
+    }
+    tagTypes()[typeId] = true;
+}
+
+
 static ComponentTypeId
 ComponentFactory_registerComponentType(
     ComponentFactory* self,
@@ -70,6 +90,7 @@ ComponentFactory::luaBindings() {
     using namespace luabind;
     return class_<ComponentFactory>("ComponentFactory")
         .def("registerComponentType", &ComponentFactory_registerComponentType)
+        .def("registerTagType", &ComponentFactory::registerTagType)
     ;
 }
 
@@ -92,6 +113,27 @@ ComponentFactory::registerGlobalComponentType(
 }
 
 
+ComponentTypeId
+ComponentFactory::registerGlobalTagType(
+    const std::string& name
+) {
+    ComponentTypeId typeId = ComponentFactory::registerGlobalComponentType(
+        name,
+        nullptr
+    );
+    markAsTag(typeId);
+    return typeId;
+}
+
+
+bool
+ComponentFactory::isTagType(
+    ComponentTypeId typeId
+) {
+    return typeId < tagTypes().size() and tagTypes()[typeId];
+}
+
+
 ComponentFactory::ComponentFactory() 
   : m_impl(new Implementation())
 {
@@ -146,6 +188,10 @@ ComponentFactory::load(
             return nullptr;
         }
     }
+    if (not iter->second.second) {
+        // Tags have no loader
+        return nullptr;
+    }
     std::unique_ptr<Component> component = iter->second.second(storage);
     return component;
 }
@@ -169,6 +215,30 @@ ComponentFactory::registerComponentType(
 }
 
 
+ComponentTypeId
+ComponentFactory::registerTagType(
+    const std::string& name
+) {
+    ComponentTypeId typeId = this->registerComponentType(name, nullptr);
+    markAsTag(typeId);
+    return typeId;
+}
+
+
+std::vector<ComponentTypeId>
+ComponentFactory::typeIds() const {
+    std::vector<ComponentTypeId> typeIds;
+    typeIds.reserve(globalRegistry().size() + m_impl->m_registry.size());
+    for (const auto& item : globalRegistry()) {
+        typeIds.push_back(item.second.first);
+    }
+    for (const auto& item : m_impl->m_registry) {
+        typeIds.push_back(item.second.first);
+    }
+    return typeIds;
+}
+
+
 void
 ComponentFactory::unregisterComponentType(
     const std::string& name
@@ -3,6 +3,8 @@
 #include "engine/component.h"
 #include "util/make_unique.h"
 
+#include <vector>
+
 namespace luabind {
     class scope;
 }
@@ -34,6 +36,7 @@ public:
     * @brief Lua bindings
     *
     * - ComponentFactory::registerComponentType
+    * - ComponentFactory::registerTagType
     *
     */
     static luabind::scope
@@ -77,6 +80,42 @@ public:
         );
     }
 
+    /**
+    * @brief Registers a tag type for all factories
+    *
+    * @tparam T
+    *   The tag class, see TAG
+    *
+    * @return The tag's unique id
+    *
+    * @note
+    *   You should probably use the REGISTER_TAG macro instead of calling
+    *   this directly.
+    */
+    template<typename T>
+    static ComponentTypeId
+    registerGlobalTagType() {
+        return ComponentFactory::registerGlobalTagType(
+            T::TYPE_NAME()
+        );
+    }
+
+    /**
+    * @brief Whether a type id belongs to a tag
+    *
+    * Thread safe, as long as no types are registered concurrently.
+    *
+    * @param typeId
+    *   The type id to check
+    *
+    * @return
+    *   \c true if \a typeId has been registered as a tag with any factory
+    */
+    static bool
+    isTagType(
+        ComponentTypeId typeId
+    );
+
     /**
     * @brief Looks up a component type name and returns its id
     *
@@ -117,7 +156,7 @@ public:
     *   The component's storage container. May be empty.
     *
     * @return 
-    *   A new component
+    *   A new component, or \c nullptr if the type is unknown or a tag
     */
     std::unique_ptr<Component>
     load(
@@ -142,6 +181,31 @@ public:
         ComponentLoader loader
     );
 
+    /**
+    * @brief Registers a tag type with this factory
+    *
+    * @param name
+    *   The tag's name
+    *
+    * @return
+    *   The tag's unique id
+    */
+    ComponentTypeId
+    registerTagType(
+        const std::string& name
+    );
+
+    /**
+    * @brief The ids of all component and tag types known to this factory
+    *
+    * Includes the types registered for all factories.
+    *
+    * @return
+    *   The type ids, in no particular order
+    */
+    std::vector<ComponentTypeId>
+    typeIds() const;
+
     /**
     * @brief Unregisters a component type
     *
@@ -161,6 +225,11 @@ private:
         ComponentLoader loader
     );
 
+    static ComponentTypeId
+    registerGlobalTagType(
+        const std::string& name
+    );
+
     struct Implementation;
     std::unique_ptr<Implementation> m_impl;
 
@@ -170,8 +239,24 @@ private:
  * @brief Registers a component class with the ComponentFactory
  *
  * Use this in the component's source file.
+ *
+ * Also defines the class' ComponentPool. The pool is deliberately never 
+ * destroyed, so that components that outlive static destruction can still 
+ * be deleted safely.
  */
 #define REGISTER_COMPONENT(cls) \
+    thrive::ComponentPool& cls::TYPE_POOL() { \
+        static thrive::ComponentPool* pool = new thrive::ComponentPool(sizeof(cls)); \
+        return *pool; \
+    } \
     const ComponentTypeId cls::TYPE_ID = thrive::ComponentFactory::registerGlobalComponentType<cls>();
 
+/**
+ * @brief Registers a tag class with the ComponentFactory
+ *
+ * Use this in the tag's source file.
+ */
+#define REGISTER_TAG(cls) \
+    const thrive::ComponentTypeId cls::TYPE_ID = thrive::ComponentFactory::registerGlobalTagType<cls>();
+
 }
@@ -0,0 +1,148 @@
+#include "engine/component_pool.h"
+
+#include <algorithm>
+#include <boost/thread/locks.hpp>
+#include <boost/thread/mutex.hpp>
+#include <new>
+#include <vector>
+
+using namespace thrive;
+
+const std::size_t ComponentPool::ALIGNMENT;
+
+// Aim for chunks of roughly this many bytes
+static const std::size_t CHUNK_SIZE = 16 * 1024;
+
+// But never less than this many slots per chunk
+static const std::size_t MIN_SLOTS_PER_CHUNK = 16;
+
+namespace {
+
+struct FreeSlot {
+    FreeSlot* m_next;
+};
+
+}
+
+struct ComponentPool::Implementation {
+
+    Implementation(
+        std::size_t slotSize
+    ) : m_slotSize(
+            std::max(
+                (slotSize + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT,
+                sizeof(FreeSlot)
+            )
+        ),
+        m_slotsPerChunk(
+            std::max(CHUNK_SIZE / m_slotSize, MIN_SLOTS_PER_CHUNK)
+        )
+    {
+    }
+
+    ~Implementation() {
+        for (char* chunk : m_chunks) {
+            ::operator delete(chunk);
+        }
+    }
+
+    void
+    grow() {
+        // Slot sizes are multiples of ALIGNMENT, so every slot is aligned
+        // at least as well as memory from the global operator new
+        char* chunk = static_cast<char*>(
+            ::operator new(m_slotSize * m_slotsPerChunk)
+        );
+        m_chunks.push_back(chunk);
+        // Thread the new slots in reverse so they are handed out in
+        // address order
+        for (std::size_t i = m_slotsPerChunk; i > 0; --i) {
+            FreeSlot* slot = reinterpret_cast<FreeSlot*>(
+                chunk + (i - 1) * m_slotSize
+            );
+            slot->m_next = m_freeList;
+            m_freeList = slot;
+        }
+    }
+
+    std::vector<char*> m_chunks;
+
+    FreeSlot* m_freeList = nullptr;
+
+    mutable boost::mutex m_mutex;
+
+    const std::size_t m_slotSize;
+
+    const std::size_t m_slotsPerChunk;
+
+    std::size_t m_usedSlots = 0;
+
+};
+
+
+ComponentPool::ComponentPool(
+    std::size_t slotSize
+) : m_impl(new Implementation(slotSize))
+{
+}
+
+
+ComponentPool::~ComponentPool() {}
+
+
+void*
+ComponentPool::allocate(
+    std::size_t size
+) {
+    if (size > m_impl->m_slotSize) {
+        return ::operator new(size);
+    }
+    boost::lock_guard<boost::mutex> lock(m_impl->m_mutex);
+    if (not m_impl->m_freeList) {
+        m_impl->grow();
+    }
+    FreeSlot* slot = m_impl->m_freeList;
+    m_impl->m_freeList = slot->m_next;
+    m_impl->m_usedSlots += 1;
+    return slot;
+}
+
+
+std::size_t
+ComponentPool::capacity() const {
+    boost::lock_guard<boost::mutex> lock(m_impl->m_mutex);
+    return m_impl->m_chunks.size() * m_impl->m_slotsPerChunk;
+}
+
+
+void
+ComponentPool::deallocate(
+    void* pointer,
+    std::size_t size
+) {
+    if (not pointer) {
+        return;
+    }
+    if (size > m_impl->m_slotSize) {
+        ::operator delete(pointer);
+        return;
+    }
+    boost::lock_guard<boost::mutex> lock(m_impl->m_mutex);
+    FreeSlot* slot = static_cast<FreeSlot*>(pointer);
+    slot->m_next = m_impl->m_freeList;
+    m_impl->m_freeList = slot;
+    m_impl->m_usedSlots -= 1;
+}
+
+
+std::size_t
+ComponentPool::size() const {
+    boost::lock_guard<boost::mutex> lock(m_impl->m_mutex);
+    return m_impl->m_usedSlots;
+}
+
+
+std::size_t
+ComponentPool::slotSize() const {
+    return m_impl->m_slotSize;
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+
+namespace thrive {
+
+/**
+* @brief Fixed size allocator for components of one type
+*
+* Every component class declared with the COMPONENT macro allocates its
+* instances from its own pool (see Component::TYPE_POOL). The pool
+* requests memory from the system in chunks of several slots and keeps
+* released slots in a free list, so creating and destroying components
+* of the same type in quick succession does not hit the general purpose
+* allocator and instances of the same type stay close together in memory.
+*
+* Chunks are never returned to the system before the pool is destroyed.
+*
+* Allocation and deallocation are thread safe.
+*/
+class ComponentPool {
+
+public:
+
+    /**
+    * @brief Slot sizes are rounded up to a multiple of this
+    *
+    * Slots are aligned at least as well as memory returned by the
+    * global operator new.
+    */
+    static const std::size_t ALIGNMENT = 16;
+
+    /**
+    * @brief Constructor
+    *
+    * @param slotSize
+    *   The size of one object in bytes. Rounded up to ALIGNMENT.
+    */
+    explicit ComponentPool(
+        std::size_t slotSize
+    );
+
+    /**
+    * @brief Destructor
+    *
+    * Releases all chunks. Objects still living in the pool are not
+    * destroyed.
+    */
+    ~ComponentPool();
+
+    /**
+    * @brief Allocates memory for one object
+    *
+    * @param size
+    *   The requested size. If it is larger than the pool's slot size
+    *   (e.g. for a subclass of the pooled type), the memory is
+    *   allocated with the global operator new instead.
+    *
+    * @return
+    *   A pointer to uninitialized memory of at least \a size bytes
+    */
+    void*
+    allocate(
+        std::size_t size
+    );
+
+    /**
+    * @brief Total number of slots, used or free
+    */
+    std::size_t
+    capacity() const;
+
+    /**
+    * @brief Releases memory previously returned by allocate()
+    *
+    * @param pointer
+    *   The memory to release
+    * @param size
+    *   The size that was passed to allocate()
+    */
+    void
+    deallocate(
+        void* pointer,
+        std::size_t size
+    );
+
+    /**
+    * @brief The number of slots currently in use
+    */
+    std::size_t
+    size() const;
+
+    /**
+    * @brief The size of one slot in bytes
+    */
+    std::size_t
+    slotSize() const;
+
+private:
+
+    struct Implementation;
+    std::unique_ptr<Implementation> m_impl;
+
+};
+
+}
@@ -0,0 +1,328 @@
+#include "engine/compression.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <istream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace thrive;
+
+// Marks a compressed savegame
+static const uint64_t COMPRESSED_MAGIC = 0x534B4C425A4C454BULL;
+
+// Follows the magic number. Increase it whenever the block format
+// changes, savegames with other versions are rejected.
+static const uint8_t FORMAT_VERSION = 1;
+
+// Small enough for all match offsets to fit into 16 bits
+static const std::size_t BLOCK_SIZE = 1 << 16;
+
+static const unsigned int HASH_BITS = 14;
+
+static const std::size_t MAX_OFFSET = 0xFFFF;
+
+static const std::size_t MIN_MATCH = 4;
+
+// Lengths of at least this much continue after the token
+static const std::size_t TOKEN_LENGTH_LIMIT = 15;
+
+
+template<typename T>
+static void
+appendValue(
+    std::string& output,
+    T value
+) {
+    char bytes[sizeof(T)];
+    std::memcpy(bytes, &value, sizeof(T));
+    output.append(bytes, sizeof(T));
+}
+
+
+template<typename T>
+static T
+readValue(
+    std::istream& stream
+) {
+    char bytes[sizeof(T)];
+    stream.read(bytes, sizeof(T));
+    if (stream.gcount() != sizeof(T)) {
+        throw std::runtime_error("Compressed savegame is truncated");
+    }
+    T value;
+    std::memcpy(&value, bytes, sizeof(T));
+    return value;
+}
+
+
+static uint32_t
+read32(
+    const char* input
+) {
+    uint32_t value;
+    std::memcpy(&value, input, sizeof(value));
+    return value;
+}
+
+
+static std::size_t
+hashSequence(
+    uint32_t sequence
+) {
+    return (sequence * 2654435761u) >> (32 - HASH_BITS);
+}
+
+
+static void
+appendLength(
+    std::string& output,
+    std::size_t length
+) {
+    while (length >= 255) {
+        output.push_back(static_cast<char>(255));
+        length -= 255;
+    }
+    output.push_back(static_cast<char>(length));
+}
+
+
+// A sequence is a token, the literals and, unless it's the block's last
+// sequence, the match. The token's high nibble holds the number of
+// literals, the low nibble the match length beyond MIN_MATCH.
+static void
+appendSequence(
+    std::string& output,
+    const char* literals,
+    std::size_t literalLength,
+    std::size_t offset,
+    std::size_t matchLength
+) {
+    std::size_t matchExtra = offset ? matchLength - MIN_MATCH : 0;
+    std::size_t token =
+        std::min(literalLength, TOKEN_LENGTH_LIMIT) << 4 |
+        std::min(matchExtra, TOKEN_LENGTH_LIMIT);
+    output.push_back(static_cast<char>(token));
+    if (literalLength >= TOKEN_LENGTH_LIMIT) {
+        appendLength(output, literalLength - TOKEN_LENGTH_LIMIT);
+    }
+    output.append(literals, literalLength);
+    if (not offset) {
+        return;
+    }
+    output.push_back(static_cast<char>(offset & 0xFF));
+    output.push_back(static_cast<char>(offset >> 8));
+    if (matchExtra >= TOKEN_LENGTH_LIMIT) {
+        appendLength(output, matchExtra - TOKEN_LENGTH_LIMIT);
+    }
+}
+
+
+static void
+compressBlock(
+    const char* input,
+    std::size_t size,
+    std::vector<uint32_t>& table,
+    std::string& output
+) {
+    // Most recent position of each hashed sequence, plus one so that
+    // zero means none
+    table.assign(std::size_t(1) << HASH_BITS, 0);
+    std::size_t literalStart = 0;
+    std::size_t position = 0;
+    while (position + MIN_MATCH <= size) {
+        uint32_t sequence = read32(input + position);
+        uint32_t& entry = table[hashSequence(sequence)];
+        std::size_t candidate = entry;
+        entry = static_cast<uint32_t>(position + 1);
+        if (
+            candidate == 0 or
+            position - (candidate - 1) > MAX_OFFSET or
+            read32(input + candidate - 1) != sequence
+        ) {
+            position += 1;
+            continue;
+        }
+        std::size_t matchStart = candidate - 1;
+        std::size_t matchLength = MIN_MATCH;
+        while (
+            position + matchLength < size and
+            input[matchStart + matchLength] == input[position + matchLength]
+        ) {
+            matchLength += 1;
+        }
+        appendSequence(
+            output,
+            input + literalStart,
+            position - literalStart,
+            position - matchStart,
+            matchLength
+        );
+        position += matchLength;
+        literalStart = position;
+    }
+    appendSequence(output, input + literalStart, size - literalStart, 0, 0);
+}
+
+
+static void
+throwCorrupt() {
+    throw std::runtime_error("Compressed savegame is corrupt");
+}
+
+
+static std::size_t
+readLength(
+    const unsigned char*& input,
+    const unsigned char* end,
+    std::size_t length
+) {
+    if (length < TOKEN_LENGTH_LIMIT) {
+        return length;
+    }
+    unsigned char byte = 0;
+    do {
+        if (input == end) {
+            throwCorrupt();
+        }
+        byte = *input++;
+        length += byte;
+    } while (byte == 255);
+    return length;
+}
+
+
+static void
+decompressBlock(
+    const std::string& block,
+    std::size_t rawSize,
+    std::string& output
+) {
+    std::size_t start = output.size();
+    output.resize(start + rawSize);
+    char* out = &output[start];
+    std::size_t produced = 0;
+    const unsigned char* input = reinterpret_cast<const unsigned char*>(block.data());
+    const unsigned char* end = input + block.size();
+    while (input < end) {
+        unsigned char token = *input++;
+        std::size_t literalLength = readLength(input, end, token >> 4);
+        if (
+            literalLength > static_cast<std::size_t>(end - input) or
+            literalLength > rawSize - produced
+        ) {
+            throwCorrupt();
+        }
+        std::memcpy(out + produced, input, literalLength);
+        input += literalLength;
+        produced += literalLength;
+        if (input == end) {
+            // The last sequence has no match
+            break;
+        }
+        if (end - input < 2) {
+            throwCorrupt();
+        }
+        std::size_t offset = input[0] | std::size_t(input[1]) << 8;
+        input += 2;
+        std::size_t matchLength = readLength(input, end, token & 0xF) + MIN_MATCH;
+        if (offset == 0 or offset > produced or matchLength > rawSize - produced) {
+            throwCorrupt();
+        }
+        // Byte by byte, the match may overlap what it produces
+        for (std::size_t i = 0; i < matchLength; ++i) {
+            out[produced + i] = out[produced - offset + i];
+        }
+        produced += matchLength;
+    }
+    if (produced != rawSize) {
+        throwCorrupt();
+    }
+}
+
+
+std::string
+thrive::compressSavegame(
+    const std::string& savegame
+) {
+    std::string output;
+    output.reserve(savegame.size() / 2);
+    appendValue<uint64_t>(output, COMPRESSED_MAGIC);
+    appendValue<uint8_t>(output, FORMAT_VERSION);
+    std::vector<uint32_t> table;
+    std::string block;
+    for (std::size_t offset = 0; offset < savegame.size(); offset += BLOCK_SIZE) {
+        std::size_t rawSize = std::min(BLOCK_SIZE, savegame.size() - offset);
+        block.clear();
+        compressBlock(savegame.data() + offset, rawSize, table, block);
+        appendValue<uint32_t>(output, static_cast<uint32_t>(rawSize));
+        if (block.size() < rawSize) {
+            appendValue<uint32_t>(output, static_cast<uint32_t>(block.size()));
+            output.append(block);
+        }
+        else {
+            // Stored blocks have the same size as their content
+            appendValue<uint32_t>(output, static_cast<uint32_t>(rawSize));
+            output.append(savegame, offset, rawSize);
+        }
+    }
+    // A block without content ends the savegame
+    appendValue<uint32_t>(output, 0);
+    return output;
+}
+
+
+std::string
+thrive::decompressSavegame(
+    std::istream& stream
+) {
+    if (readValue<uint64_t>(stream) != COMPRESSED_MAGIC) {
+        throw std::runtime_error("Not a compressed savegame");
+    }
+    uint8_t version = readValue<uint8_t>(stream);
+    if (version != FORMAT_VERSION) {
+        throw std::runtime_error(
+            "Compressed savegame has unsupported format version " + std::to_string(version)
+        );
+    }
+    std::string savegame;
+    std::string block;
+    while (true) {
+        uint32_t rawSize = readValue<uint32_t>(stream);
+        if (rawSize == 0) {
+            break;
+        }
+        uint32_t storedSize = readValue<uint32_t>(stream);
+        if (rawSize > BLOCK_SIZE or storedSize > rawSize) {
+            throwCorrupt();
+        }
+        block.resize(storedSize);
+        stream.read(&block[0], storedSize);
+        if (stream.gcount() != storedSize) {
+            throw std::runtime_error("Compressed savegame is truncated");
+        }
+        if (storedSize == rawSize) {
+            savegame.append(block);
+        }
+        else {
+            decompressBlock(block, rawSize, savegame);
+        }
+    }
+    return savegame;
+}
+
+
+bool
+thrive::isCompressedSavegame(
+    std::istream& stream
+) {
+    std::istream::pos_type position = stream.tellg();
+    uint64_t header = 0;
+    stream.read(reinterpret_cast<char*>(&header), sizeof(header));
+    bool isCompressed = stream.gcount() == sizeof(header) and header == COMPRESSED_MAGIC;
+    stream.clear();
+    stream.seekg(position);
+    return isCompressed;
+}
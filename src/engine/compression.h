@@ -0,0 +1,59 @@
+#pragma once
+
+#include <iosfwd>
+#include <string>
+
+namespace thrive {
+
+/**
+* @brief Compresses a serialized savegame
+*
+* Savegames repeat the same keys, type ids and values all the time, so a
+* simple LZ77 codec shrinks them considerably at little cost. The result
+* starts with a header that isCompressedSavegame() recognizes and the
+* format version, followed by independently compressed blocks of 64 KiB.
+* Blocks that don't shrink are stored as they are.
+*
+* @param savegame
+*   The serialized savegame
+*
+* @return
+*   The compressed savegame
+*/
+std::string
+compressSavegame(
+    const std::string& savegame
+);
+
+/**
+* @brief Reads and decompresses a savegame written by compressSavegame()
+*
+* @param stream
+*   The stream to read from, positioned at the header
+*
+* @return
+*   The serialized savegame
+*
+* @throws std::runtime_error if the stream doesn't hold a complete and
+*   valid compressed savegame of the current format version
+*/
+std::string
+decompressSavegame(
+    std::istream& stream
+);
+
+/**
+* @brief Checks whether a stream holds a savegame written by compressSavegame()
+*
+* Leaves the stream's position where it was, so the stream must be
+* seekable.
+*
+* @param stream
+*   The stream to check
+*/
+bool
+isCompressedSavegame(
+    std::istream& stream
+);
+
+}
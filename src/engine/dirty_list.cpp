@@ -0,0 +1,103 @@
+#include "engine/dirty_list.h"
+
+#include "engine/touchable.h"
+
+#include <algorithm>
+#include <boost/thread.hpp>
+#include <unordered_set>
+#include <utility>
+
+using namespace thrive;
+
+
+DirtyList::DirtyList() {}
+
+
+DirtyList::~DirtyList() {}
+
+
+std::vector<Component*>
+DirtyList::changesSince(
+    std::uint64_t version
+) const {
+    std::vector<std::pair<std::uint64_t, Component*>> changes;
+    for (const Touchable* touchable : m_entries) {
+        if (touchable->m_version > version) {
+            changes.emplace_back(touchable->m_version, touchable->m_component);
+        }
+    }
+    // Touches of the same phase share a version, keep them in list order
+    std::stable_sort(
+        changes.begin(),
+        changes.end(),
+        [](
+            const std::pair<std::uint64_t, Component*>& lhs,
+            const std::pair<std::uint64_t, Component*>& rhs
+        ) {
+            return lhs.first < rhs.first;
+        }
+    );
+    std::vector<Component*> components;
+    components.reserve(changes.size());
+    std::unordered_set<Component*> seen;
+    for (const auto& change : changes) {
+        // Components with several touchables are only reported once
+        if (seen.insert(change.second).second) {
+            components.push_back(change.second);
+        }
+    }
+    return components;
+}
+
+
+void
+DirtyList::forget(
+    Touchable& touchable
+) {
+    boost::lock_guard<boost::mutex> lock(m_mutex);
+    std::size_t index = touchable.m_dirtyIndex;
+    if (index == Touchable::NOT_LISTED) {
+        return;
+    }
+    // Fill the gap with the last entry
+    m_entries[index] = m_entries.back();
+    m_entries[index]->m_dirtyIndex = index;
+    m_entries.pop_back();
+    touchable.m_dirtyIndex = Touchable::NOT_LISTED;
+}
+
+
+void
+DirtyList::prune(
+    std::uint64_t version
+) {
+    std::size_t kept = 0;
+    for (Touchable* touchable : m_entries) {
+        if (touchable->m_version > version) {
+            touchable->m_dirtyIndex = kept;
+            m_entries[kept] = touchable;
+            kept += 1;
+        }
+        else {
+            touchable->m_dirtyIndex = Touchable::NOT_LISTED;
+        }
+    }
+    m_entries.resize(kept);
+}
+
+
+void
+DirtyList::record(
+    Touchable& touchable
+) {
+    boost::lock_guard<boost::mutex> lock(m_mutex);
+    touchable.m_dirtyIndex = m_entries.size();
+    m_entries.push_back(&touchable);
+}
+
+
+std::size_t
+DirtyList::size() const {
+    boost::lock_guard<boost::mutex> lock(m_mutex);
+    return m_entries.size();
+}
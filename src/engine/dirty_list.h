@@ -0,0 +1,142 @@
+#pragma once
+
+#include <boost/thread/mutex.hpp>
+#include <cstdint>
+#include <vector>
+
+namespace thrive {
+
+class Component;
+class Touchable;
+
+/**
+* @brief Keeps track of recently touched Touchables
+*
+* Each ComponentCollection has a dirty list. Components register their
+* touchable properties with it when they are added to the collection (see
+* Component::trackChanges()). The first touch of a touchable appends it to
+* the list. Touching it again only stamps it with the current version,
+* the list reads the versions from the touchables themselves. A touchable
+* stays in the list until it is pruned.
+*
+* Instead of checking every component each frame, a system can remember
+* Touchable::currentVersion() and next time ask for the components that
+* have been touched since:
+*
+* \code
+* std::uint64_t version = Touchable::currentVersion();
+* for (Component* component : dirtyList.changesSince(m_lastVersion)) {
+*     // Apply the changes
+* }
+* dirtyList.prune(version);
+* m_lastVersion = version;
+* \endcode
+*
+* This only visits the changed components, and any number of systems can
+* observe the same changes as long as nobody prunes changes that another
+* system hasn't seen yet.
+*/
+class DirtyList {
+
+public:
+
+    /**
+    * @brief Constructor
+    */
+    DirtyList();
+
+    /**
+    * @brief Non-copyable
+    */
+    DirtyList(const DirtyList&) = delete;
+
+    /**
+    * @brief Destructor
+    */
+    ~DirtyList();
+
+    /**
+    * @brief Non-copyable
+    */
+    DirtyList&
+    operator=(const DirtyList&) = delete;
+
+    /**
+    * @brief The components touched after \a version
+    *
+    * Takes time proportional to the number of touchables in the list, not
+    * the number of tracked touchables. Must not run concurrently with
+    * touches of this list's touchables.
+    *
+    * @param version
+    *   The version to compare to, usually the Touchable::currentVersion()
+    *   from before the last call
+    *
+    * @return
+    *   The components whose touchables have a newer version, each only
+    *   once, earlier phases first and in list order within a phase
+    */
+    std::vector<Component*>
+    changesSince(
+        std::uint64_t version
+    ) const;
+
+    /**
+    * @brief Removes a touchable from the list
+    *
+    * Called by Touchable when it stops being tracked.
+    *
+    * @param touchable
+    *   The touchable to remove
+    */
+    void
+    forget(
+        Touchable& touchable
+    );
+
+    /**
+    * @brief Removes the touchables that haven't been touched after
+    *   \a version
+    *
+    * Their next touch appends them again. Must not run concurrently with
+    * touches of this list's touchables.
+    *
+    * @param version
+    *   The oldest version that any consumer of this list still needs
+    */
+    void
+    prune(
+        std::uint64_t version
+    );
+
+    /**
+    * @brief Appends a touchable to the list
+    *
+    * Called by Touchable::touch() when the touchable is not in the list
+    * yet. Thread safe.
+    *
+    * @param touchable
+    *   The touched touchable
+    */
+    void
+    record(
+        Touchable& touchable
+    );
+
+    /**
+    * @brief The number of touchables in the list
+    */
+    std::size_t
+    size() const;
+
+private:
+
+    // In no particular order
+    std::vector<Touchable*> m_entries;
+
+    // Guards appending, touches from different threads may append at once
+    mutable boost::mutex m_mutex;
+
+};
+
+}
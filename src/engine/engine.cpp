@@ -1,12 +1,18 @@
 #include "engine/engine.h"
 
+#include "engine/background_saver.h"
+#include "engine/checkpoint_buffer.h"
 #include "engine/component_collection.h"
 #include "engine/component_factory.h"
+#include "engine/compression.h"
 #include "engine/entity_manager.h"
 #include "engine/game_state.h"
+#include "engine/profiler.h"
 #include "engine/serialization.h"
 #include "engine/system.h"
 #include "engine/rng.h"
+#include "engine/telemetry.h"
+#include "engine/thread_pool.h"
 #include "game.h"
 
 // Bullet
@@ -43,8 +49,10 @@
 #include <ctime>
 #include <forward_list>
 #include <fstream>
+#include <functional>
 #include <iostream>
 #include <luabind/adopt_policy.hpp>
+#include <luabind/class_info.hpp>
 #include <OgreConfigFile.h>
 #include <OgreLogManager.h>
 #include <OgreOggSoundManager.h>
@@ -55,8 +63,11 @@
 #include <OISMouse.h>
 #include <random>
 #include <set>
+#include <sstream>
+#include <stdexcept>
 #include <stdlib.h>
 #include <unordered_map>
+#include <unordered_set>
 
 #include <iostream>
 
@@ -79,10 +90,12 @@ struct Engine::Implementation : public Ogre::WindowEventListener {
     }
 
     ~Implementation() {
-        Ogre::WindowEventUtilities::removeWindowEventListener(
-            m_graphics.renderWindow,
-            this
-        );
+        if (m_graphics.renderWindow) {
+            Ogre::WindowEventUtilities::removeWindowEventListener(
+                m_graphics.renderWindow,
+                this
+            );
+        }
     }
 
     void
@@ -98,51 +111,64 @@ struct Engine::Implementation : public Ogre::WindowEventListener {
         }
     }
 
+    void
+    createCheckpoint() {
+        m_serialization.checkpointRequested = false;
+        std::ostringstream stream(std::ostringstream::binary);
+        StorageWriter writer(stream);
+        this->writeSavegame(writer);
+        writer.finish();
+        std::string savegame = stream.str();
+        if (not m_serialization.checkpointFile.empty()) {
+            m_serialization.saver.save(m_serialization.checkpointFile, savegame);
+            m_serialization.checkpointFile = "";
+        }
+        m_serialization.checkpoints.pushSerialized(std::move(savegame));
+    }
+
     void
     loadSavegame() {
-        std::ifstream stream(
+        // The file may still be being written
+        m_serialization.saver.wait();
+        std::ifstream file(
             m_serialization.loadFile,
             std::ifstream::binary
         );
         m_serialization.loadFile = "";
-        stream.clear();
-        stream.exceptions(std::ofstream::failbit | std::ofstream::badbit);
-        StorageContainer savegame;
+        file.clear();
+        file.exceptions(std::ofstream::failbit | std::ofstream::badbit);
         try {
-            stream >> savegame;
-        }
-        catch(const std::ofstream::failure& e) {
-            std::cerr << "Error loading file: " << e.what() << std::endl;
-            throw;
-        }
-        // Load game states
-        GameState* previousGameState = m_currentGameState;
-        this->activateGameState(nullptr);
-        StorageContainer gameStates = savegame.get<StorageContainer>("gameStates");
-        for (const auto& pair : m_gameStates) {
-            if (gameStates.contains(pair.first)) {
-                // In case anything relies on the current game state
-                // during loading, temporarily switch it
-                m_currentGameState = pair.second.get();
-                pair.second->load(
-                    gameStates.get<StorageContainer>(pair.first)
+            if (isCompressedSavegame(file)) {
+                std::istringstream stream(
+                    decompressSavegame(file),
+                    std::istringstream::binary
                 );
+                stream.exceptions(std::ofstream::failbit | std::ofstream::badbit);
+                this->loadSavegame(stream);
             }
             else {
-                pair.second->entityManager().clear();
+                this->loadSavegame(file);
             }
         }
-        m_currentGameState = nullptr;
-        // Switch gamestate
-        std::string gameStateName = savegame.get<std::string>("currentGameState");
-        auto iter = m_gameStates.find(gameStateName);
-        if (iter != m_gameStates.end()) {
-            this->activateGameState(iter->second.get());
+        catch(const std::ofstream::failure& e) {
+            std::cerr << "Error loading file: " << e.what() << std::endl;
+            throw;
         }
-        else {
-            this->activateGameState(previousGameState);
-            // TODO: Log error
+    }
+
+    void
+    loadSavegame(
+        std::istream& stream
+    ) {
+        if (StorageReader::canRead(stream)) {
+            StorageReader reader(stream);
+            this->readSavegame(reader);
+            return;
         }
+        // Savegames from before streaming are read as a whole
+        StorageContainer savegame;
+        stream >> savegame;
+        this->restoreSavegame(savegame);
     }
 
     void
@@ -226,38 +252,117 @@ struct Engine::Implementation : public Ogre::WindowEventListener {
     }
 
     void
-    saveSavegame() {
-        StorageContainer savegame;
-        savegame.set("currentGameState", m_currentGameState->name());
-        StorageContainer gameStates;
+    readSavegame(
+        StorageReader& reader
+    ) {
+        GameState* previousGameState = m_currentGameState;
+        this->activateGameState(nullptr);
+        std::string gameStateName;
+        std::unordered_set<GameState*> loadedGameStates;
+        while (reader.next()) {
+            if (reader.key() == "currentGameState") {
+                gameStateName = reader.get<std::string>();
+            }
+            else if (reader.key() == "gameStates" and reader.isContainer()) {
+                // Load game states
+                reader.enter();
+                while (reader.next()) {
+                    auto iter = m_gameStates.find(reader.key());
+                    if (iter == m_gameStates.end() or not reader.isContainer()) {
+                        continue;
+                    }
+                    // In case anything relies on the current game state
+                    // during loading, temporarily switch it
+                    m_currentGameState = iter->second.get();
+                    reader.enter();
+                    iter->second->read(reader);
+                    loadedGameStates.insert(iter->second.get());
+                }
+            }
+        }
         for (const auto& pair : m_gameStates) {
-            gameStates.set(pair.first, pair.second->storage());
+            if (not loadedGameStates.count(pair.second.get())) {
+                pair.second->entityManager().clear();
+            }
+        }
+        m_currentGameState = nullptr;
+        // Switch gamestate
+        auto iter = m_gameStates.find(gameStateName);
+        if (iter != m_gameStates.end()) {
+            this->activateGameState(iter->second.get());
         }
-        savegame.set("gameStates", std::move(gameStates));
-        std::ofstream stream(
-            m_serialization.saveFile,
-            std::ofstream::trunc | std::ofstream::binary
+        else {
+            this->activateGameState(previousGameState);
+            // TODO: Log error
+        }
+    }
+
+    void
+    restoreCheckpoint() {
+        m_serialization.restoreRequested = false;
+        std::istringstream stream(
+            m_serialization.checkpoints.serialized(m_serialization.restoreAge),
+            std::istringstream::binary
         );
-        m_serialization.saveFile = "";
         stream.exceptions(std::ofstream::failbit | std::ofstream::badbit);
-        if (stream) {
-            try {
-                stream << savegame;
-                stream.flush();
-                stream.close();
+        this->loadSavegame(stream);
+    }
+
+    // Only for savegames from before StorageWriter, see loadSavegame()
+    void
+    restoreSavegame(
+        const StorageContainer& savegame
+    ) {
+        // Load game states
+        GameState* previousGameState = m_currentGameState;
+        this->activateGameState(nullptr);
+        StorageContainer gameStates = savegame.get<StorageContainer>("gameStates");
+        for (const auto& pair : m_gameStates) {
+            if (gameStates.contains(pair.first)) {
+                // In case anything relies on the current game state
+                // during loading, temporarily switch it
+                m_currentGameState = pair.second.get();
+                pair.second->load(
+                    gameStates.get<StorageContainer>(pair.first)
+                );
             }
-            catch (const std::ofstream::failure& e) {
-                std::cerr << "Error saving file: " << e.what() << std::endl;
-                throw;
+            else {
+                pair.second->entityManager().clear();
             }
         }
+        m_currentGameState = nullptr;
+        // Switch gamestate
+        std::string gameStateName = savegame.get<std::string>("currentGameState");
+        auto iter = m_gameStates.find(gameStateName);
+        if (iter != m_gameStates.end()) {
+            this->activateGameState(iter->second.get());
+        }
         else {
-            std::perror("Could not open file for saving");
+            this->activateGameState(previousGameState);
+            // TODO: Log error
         }
     }
 
+    void
+    saveSavegame() {
+        // Serializing needs the game states, but writing the file
+        // doesn't hold up the game
+        std::ostringstream stream(std::ostringstream::binary);
+        StorageWriter writer(stream);
+        this->writeSavegame(writer);
+        writer.finish();
+        m_serialization.saver.save(m_serialization.saveFile, stream.str());
+        m_serialization.saveFile = "";
+    }
+
     void
     setupGraphics() {
+        if (m_headless) {
+            // No plugins means no render system, so we can't create a
+            // window or load any resources. Scene managers work, though.
+            m_graphics.root.reset(new Ogre::Root("", "", ""));
+            return;
+        }
         m_graphics.root.reset(new Ogre::Root(PLUGINS_CFG));
         this->loadResources();
         this->loadOgreConfig();
@@ -278,6 +383,10 @@ struct Engine::Implementation : public Ogre::WindowEventListener {
 
     void
     setupInputManager() {
+        if (m_headless) {
+            // Keyboard and mouse stay uninitialized and report no input
+            return;
+        }
         const std::string HANDLE_NAME = "WINDOW";
         size_t windowHandle = 0;
         m_graphics.renderWindow->getCustomAttribute(HANDLE_NAME, &windowHandle);
@@ -315,6 +424,10 @@ struct Engine::Implementation : public Ogre::WindowEventListener {
 
     void
     setupSoundManager() {
+        if (m_headless) {
+            // The sound manager is an Ogre plugin, which we didn't load
+            return;
+        }
         static const std::string DEVICE_NAME = "";
         static const unsigned int MAX_SOURCES = 100;
         static const unsigned int QUEUE_LIST_SIZE = 100;
@@ -357,6 +470,20 @@ struct Engine::Implementation : public Ogre::WindowEventListener {
         }
     }
 
+    void
+    writeSavegame(
+        StorageWriter& writer
+    ) {
+        writer.set("currentGameState", m_currentGameState->name());
+        writer.beginContainer("gameStates");
+        for (const auto& pair : m_gameStates) {
+            writer.beginContainer(pair.first);
+            pair.second->write(writer);
+            writer.end();
+        }
+        writer.end();
+    }
+
     // Lua state must be one of the last to be destroyed, so keep it at top.
     // The reason for that is that some components keep luabind::object
     // instances around that rely on the lua state to still exist when they
@@ -372,6 +499,8 @@ struct Engine::Implementation : public Ogre::WindowEventListener {
 
     std::map<std::string, std::unique_ptr<GameState>> m_gameStates;
 
+    bool m_headless = false;
+
     RNG m_rng;
 
     struct Graphics {
@@ -394,16 +523,77 @@ struct Engine::Implementation : public Ogre::WindowEventListener {
 
     GameState* m_nextGameState = nullptr;
 
+    Profiler m_profiler;
+
     struct Serialization {
 
+        std::string checkpointFile;
+
+        bool checkpointRequested = false;
+
+        CheckpointBuffer checkpoints;
+
         std::string loadFile;
 
+        std::size_t restoreAge = 0;
+
+        bool restoreRequested = false;
+
         std::string saveFile;
 
+        BackgroundSaver saver;
+
     } m_serialization;
+
+    struct Simulation {
+
+        unsigned int maxSteps = 5;
+
+        int timestep = 0;
+
+    } m_simulation;
+
+    Telemetry m_telemetry;
+
+    ThreadPool m_threadPool;
 };
 
 
+// Applies a list of component classes (or type ids) to a system's
+// read or write declarations
+static void
+declareComponentAccess(
+    luabind::object luaComponents,
+    std::function<void(ComponentTypeId)> declare
+) {
+    if (luabind::type(luaComponents) != LUA_TTABLE) {
+        return;
+    }
+    for (luabind::iterator iter(luaComponents), end; iter != end; ++iter) {
+        luabind::object luaComponent = *iter;
+        if (luabind::type(luaComponent) == LUA_TNUMBER) {
+            declare(luabind::object_cast<ComponentTypeId>(luaComponent));
+        }
+        else {
+            declare(luabind::object_cast<ComponentTypeId>(luaComponent["TYPE_ID"]));
+        }
+    }
+}
+
+
+static std::string
+luaClassName(
+    luabind::object object
+) {
+    lua_State* L = object.interpreter();
+    object.push(L);
+    luabind::argument argument(luabind::from_stack(L, lua_gettop(L)));
+    std::string name = luabind::get_class_info(argument).name;
+    lua_pop(L, 1);
+    return name;
+}
+
+
 static GameState*
 Engine_createGameState(
     Engine* self,
@@ -413,11 +603,38 @@ Engine_createGameState(
 ) {
     std::vector<std::unique_ptr<System>> systems;
     for (luabind::iterator iter(luaSystems), end; iter != end; ++iter) {
+        // Either a system or a table like
+        // { system, reads = { ... }, writes = { ... }, presentation = true }
+        luabind::object entry = *iter;
+        luabind::object luaSystem = entry;
+        if (luabind::type(entry) == LUA_TTABLE) {
+            luaSystem = entry[1];
+        }
         System* system = luabind::object_cast<System*>(
-            *iter,
+            luaSystem,
             luabind::adopt(luabind::result)
         );
         systems.emplace_back(system);
+        system->setName(luaClassName(luaSystem));
+        if (luabind::type(entry) == LUA_TTABLE) {
+            declareComponentAccess(
+                entry["reads"],
+                [system](ComponentTypeId typeId) {
+                    system->readsComponent(typeId);
+                }
+            );
+            declareComponentAccess(
+                entry["writes"],
+                [system](ComponentTypeId typeId) {
+                    system->writesComponent(typeId);
+                }
+            );
+            if (luabind::type(entry["presentation"]) == LUA_TBOOLEAN) {
+                system->setPresentation(
+                    luabind::object_cast<bool>(entry["presentation"])
+                );
+            }
+        }
     }
     // We can't just capture the luaInitializer in the lambda here, because
     // luabind::object's call operator is not const
@@ -435,6 +652,22 @@ Engine_createGameState(
 }
 
 
+static void
+Engine_checkpoint(
+    Engine* self
+) {
+    self->checkpoint();
+}
+
+
+static void
+Engine_restoreCheckpoint(
+    Engine* self
+) {
+    self->restoreCheckpoint();
+}
+
+
 luabind::scope
 Engine::luaBindings() {
     using namespace luabind;
@@ -442,12 +675,22 @@ Engine::luaBindings() {
         .def("createGameState", Engine_createGameState)
         .def("currentGameState", &Engine::currentGameState)
         .def("getGameState", &Engine::getGameState)
+        .def("headless", &Engine::headless)
         .def("setCurrentGameState", &Engine::setCurrentGameState)
         .def("load", &Engine::load)
         .def("save", &Engine::save)
+        .def("checkpoint", Engine_checkpoint)
+        .def("checkpoint", &Engine::checkpoint)
+        .def("restoreCheckpoint", Engine_restoreCheckpoint)
+        .def("restoreCheckpoint", &Engine::restoreCheckpoint)
+        .def("setSimulationTimestep", &Engine::setSimulationTimestep)
+        .property("checkpoints", &Engine::checkpoints)
         .property("componentFactory", &Engine::componentFactory)
         .property("keyboard", &Engine::keyboard)
         .property("mouse", &Engine::mouse)
+        .property("profiler", &Engine::profiler)
+        .property("saver", &Engine::saver)
+        .property("telemetry", &Engine::telemetry)
     ;
 }
 
@@ -463,6 +706,21 @@ Engine::Engine()
 Engine::~Engine() { }
 
 
+void
+Engine::checkpoint(
+    const std::string& filename
+) {
+    m_impl->m_serialization.checkpointRequested = true;
+    m_impl->m_serialization.checkpointFile = filename;
+}
+
+
+CheckpointBuffer&
+Engine::checkpoints() {
+    return m_impl->m_serialization.checkpoints;
+}
+
+
 ComponentFactory&
 Engine::componentFactory() {
     return m_impl->m_componentFactory;
@@ -516,6 +774,12 @@ Engine::getGameState(
 }
 
 
+bool
+Engine::headless() const {
+    return m_impl->m_headless;
+}
+
+
 void
 Engine::init() {
     assert(m_impl->m_currentGameState == nullptr);
@@ -524,6 +788,7 @@ Engine::init() {
     m_impl->setupScripts();
     m_impl->setupGraphics();
     m_impl->setupInputManager();
+    m_impl->m_threadPool.start(ThreadPool::defaultWorkerCount());
     m_impl->loadScripts("../scripts");
     GameState* previousGameState = m_impl->m_currentGameState;
     for (const auto& pair : m_impl->m_gameStates) {
@@ -555,6 +820,13 @@ Engine::load(
     std::string filename
 ) {
     m_impl->m_serialization.loadFile = filename;
+    m_impl->m_serialization.restoreRequested = false;
+}
+
+
+unsigned int
+Engine::maxSimulationSteps() const {
+    return m_impl->m_simulation.maxSteps;
 }
 
 
@@ -570,6 +842,25 @@ Engine::ogreRoot() const {
 }
 
 
+Profiler&
+Engine::profiler() {
+    return m_impl->m_profiler;
+}
+
+
+void
+Engine::restoreCheckpoint(
+    std::size_t age
+) {
+    if (age >= m_impl->m_serialization.checkpoints.size()) {
+        throw std::out_of_range("No checkpoint of age " + std::to_string(age));
+    }
+    m_impl->m_serialization.loadFile = "";
+    m_impl->m_serialization.restoreAge = age;
+    m_impl->m_serialization.restoreRequested = true;
+}
+
+
 Ogre::RenderWindow*
 Engine::renderWindow() const {
     return m_impl->m_graphics.renderWindow;
@@ -584,6 +875,12 @@ Engine::save(
 }
 
 
+BackgroundSaver&
+Engine::saver() {
+    return m_impl->m_serialization.saver;
+}
+
+
 void
 Engine::setCurrentGameState(
     GameState* gameState
@@ -593,32 +890,92 @@ Engine::setCurrentGameState(
 }
 
 
+void
+Engine::setHeadless(
+    bool headless
+) {
+    assert(m_impl->m_graphics.root == nullptr && "Engine is already initialized");
+    m_impl->m_headless = headless;
+}
+
+
+void
+Engine::setMaxSimulationSteps(
+    unsigned int steps
+) {
+    assert(steps > 0 && "Need at least one simulation step per frame");
+    m_impl->m_simulation.maxSteps = steps;
+}
+
+
+void
+Engine::setSimulationTimestep(
+    int milliseconds
+) {
+    if (milliseconds < 0) {
+        throw std::invalid_argument("Simulation timestep must not be negative");
+    }
+    m_impl->m_simulation.timestep = milliseconds;
+}
+
+
 void
 Engine::shutdown() {
+    // The samples have been written as they were taken
+    m_impl->m_telemetry.closeOutputFile();
     for (const auto& pair : m_impl->m_gameStates) {
         const auto& gameState = pair.second;
         gameState->shutdown();
     }
+    m_impl->m_threadPool.stop();
+    m_impl->m_serialization.saver.wait();
     m_impl->shutdownInputManager();
-    m_impl->m_graphics.renderWindow->destroy();
+    if (m_impl->m_graphics.renderWindow) {
+        m_impl->m_graphics.renderWindow->destroy();
+        m_impl->m_graphics.renderWindow = nullptr;
+    }
     m_impl->m_graphics.root.reset();
 }
 
 
+int
+Engine::simulationTimestep() const {
+    return m_impl->m_simulation.timestep;
+}
+
+
 OgreOggSound::OgreOggSoundManager*
 Engine::soundManager() const {
     return OgreOggSound::OgreOggSoundManager::getSingletonPtr();
 }
 
 
+Telemetry&
+Engine::telemetry() {
+    return m_impl->m_telemetry;
+}
+
+
+ThreadPool&
+Engine::threadPool() {
+    return m_impl->m_threadPool;
+}
+
+
 void
 Engine::update(
     int milliseconds
 ) {
+    m_impl->m_profiler.beginFrame();
     if (not m_impl->m_serialization.saveFile.empty()) {
         m_impl->saveSavegame();
     }
-    Ogre::WindowEventUtilities::messagePump();
+    if (m_impl->m_serialization.checkpointRequested) {
+        m_impl->createCheckpoint();
+    }
+    if (not m_impl->m_headless) {
+        Ogre::WindowEventUtilities::messagePump();
+    }
     if (m_impl->quitRequested()) {
         Game::instance().quit();
     }
@@ -633,5 +990,14 @@ Engine::update(
     if (not m_impl->m_serialization.loadFile.empty()) {
         m_impl->loadSavegame();
     }
+    if (m_impl->m_serialization.restoreRequested) {
+        m_impl->restoreCheckpoint();
+    }
+    m_impl->m_telemetry.update(
+        m_impl->m_currentGameState->entityManager(),
+        m_impl->m_componentFactory,
+        m_impl->m_profiler.frame()
+    );
+    m_impl->m_profiler.endFrame();
 }
 
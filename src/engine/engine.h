@@ -30,14 +30,19 @@ namespace OIS {
 
 namespace thrive {
 
+class BackgroundSaver;
+class CheckpointBuffer;
 class ComponentFactory;
 class EntityManager;
 class Keyboard;
 class Mouse;
 class OgreViewportSystem;
+class Profiler;
 class CollisionSystem;
 class System;
 class RNG;
+class Telemetry;
+class ThreadPool;
 
 /**
 * @brief The heart of the game
@@ -57,12 +62,28 @@ public:
     * - Engine::createGameState()
     * - Engine::currentGameState()
     * - Engine::getGameState()
+    * - Engine::headless()
     * - Engine::setCurrentGameState()
     * - Engine::load()
     * - Engine::save()
+    * - Engine::checkpoint()
+    * - Engine::restoreCheckpoint()
+    * - Engine::setSimulationTimestep()
+    * - Engine::checkpoints() (as property)
     * - Engine::componentFactory() (as property)
     * - Engine::keyboard() (as property)
     * - Engine::mouse() (as property)
+    * - Engine::profiler() (as property)
+    * - Engine::saver() (as property)
+    * - Engine::telemetry() (as property)
+    *
+    * In Lua, each entry of createGameState's system list can also be a 
+    * table like <tt>{ system, reads = { ... }, writes = { ... } }</tt>,
+    * which declares the system's component accesses (see 
+    * System::readsComponent() and System::writesComponent()). The lists 
+    * contain component classes or their type ids. An entry 
+    * <tt>presentation = true</tt> marks the system as a presentation system
+    * (see System::setPresentation()).
     *
     * @return
     */
@@ -85,6 +106,30 @@ public:
     */
     ~Engine();
 
+    /**
+    * @brief Creates an in-memory checkpoint of all game states
+    *
+    * The checkpoint is taken at the beginning of the next frame and kept in
+    * checkpoints(). Unlike save(), this doesn't touch the disk unless
+    * \a filename is given.
+    *
+    * @param filename
+    *   If not empty, the checkpoint is also written to this file in the
+    *   background (see saver()), and can later be loaded with load()
+    */
+    void
+    checkpoint(
+        const std::string& filename = ""
+    );
+
+    /**
+    * @brief The in-memory checkpoints
+    *
+    * @see checkpoint()
+    */
+    CheckpointBuffer&
+    checkpoints();
+
     /**
     * @brief Returns the internal component factory
     *
@@ -148,6 +193,14 @@ public:
         const std::string& name
     ) const;
 
+    /**
+    * @brief Whether the engine runs without window, input and sound
+    *
+    * @see setHeadless()
+    */
+    bool
+    headless() const;
+
     /**
     * @brief Initializes the engine
     *
@@ -174,6 +227,9 @@ public:
     /**
     * @brief Loads a savegame
     *
+    * Compressed savegames (see BackgroundSaver::setCompression()) are
+    * detected by their header.
+    *
     * @param filename
     *   The file to load
     */
@@ -188,6 +244,14 @@ public:
     lua_State*
     luaState();
 
+    /**
+    * @brief The maximum number of simulation steps per frame
+    *
+    * @see setMaxSimulationSteps()
+    */
+    unsigned int
+    maxSimulationSteps() const;
+
     /**
     * @brief Returns the mouse interface
     *
@@ -201,9 +265,40 @@ public:
     Ogre::Root*
     ogreRoot() const;
 
+    /**
+    * @brief The engine's profiler
+    *
+    * Times each frame and each system update.
+    */
+    Profiler&
+    profiler();
+
+    /**
+    * @brief Restores all game states from an in-memory checkpoint
+    *
+    * The checkpoint is restored at the end of the current frame, without
+    * any file I/O. Each game state is restored in place: entities and 
+    * components that still exist are kept and reloaded, only the 
+    * difference is created or destroyed (see EntityManager::read()).
+    * Replaces a pending load() and vice versa.
+    *
+    * @param age
+    *   The checkpoint's age, 0 is the most recent one
+    *
+    * @throws std::out_of_range if there is no checkpoint that old
+    */
+    void
+    restoreCheckpoint(
+        std::size_t age = 0
+    );
+
     /**
     * @brief Creates a savegame
     *
+    * The game states are serialized at the beginning of the next frame,
+    * the file is compressed and written in the background by saver().
+    * Poll saver() to find out when the file is written or why that failed.
+    *
     * @param filename
     *   The file to save
     */
@@ -212,6 +307,12 @@ public:
         std::string filename
     );
 
+    /**
+    * @brief Writes the savegames of save() and checkpoint() to disk
+    */
+    BackgroundSaver&
+    saver();
+
     /**
     * @brief Sets the current game state
     *
@@ -228,6 +329,65 @@ public:
         GameState* gameState
     );
 
+    /**
+    * @brief Enables or disables headless mode
+    *
+    * A headless engine creates neither a render window nor an input or 
+    * sound manager. Ogre is started without plugins and resources, so game
+    * states still get a scene manager and their scene graphs, but nothing
+    * is rendered. The keyboard and mouse report no input at all. Systems 
+    * that can't do without these (see System::runsHeadless()) are left out
+    * of the game states.
+    *
+    * Must be called before init().
+    *
+    * @param headless
+    */
+    void
+    setHeadless(
+        bool headless
+    );
+
+    /**
+    * @brief Sets the maximum number of simulation steps per frame
+    *
+    * With a fixed simulation timestep, a slow frame has to be made up for 
+    * with several simulation steps. To keep a slow simulation from slowing 
+    * down the frames even more, at most \a steps simulation steps are done
+    * per frame. Any time beyond that is dropped, i.e. the simulation runs 
+    * slower than real time.
+    *
+    * @param steps
+    *   The maximum number of steps. Must be at least 1.
+    */
+    void
+    setMaxSimulationSteps(
+        unsigned int steps
+    );
+
+    /**
+    * @brief Sets the simulation timestep
+    *
+    * If the timestep is positive, the simulation systems of a game state 
+    * (see System::isPresentation()) are updated in steps of exactly 
+    * \a milliseconds, as often as necessary to keep up with the frames.
+    * Presentation systems are updated once per frame and can interpolate 
+    * between the last two simulation steps (see 
+    * GameState::interpolationFactor()). Presentation systems declared
+    * before the last simulation system run before the steps.
+    *
+    * If the timestep is 0, all systems are updated once per frame with the 
+    * frame's duration.
+    *
+    * @param milliseconds
+    *   The timestep in milliseconds or 0 for a variable timestep. The
+    *   default is 0.
+    */
+    void
+    setSimulationTimestep(
+        int milliseconds
+    );
+
     /**
     * @brief Shuts the engine down
     *
@@ -237,9 +397,35 @@ public:
     void
     shutdown();
 
+    /**
+    * @brief The simulation timestep in milliseconds
+    *
+    * @see setSimulationTimestep()
+    */
+    int
+    simulationTimestep() const;
+
     OgreOggSound::OgreOggSoundManager*
     soundManager() const;
 
+    /**
+    * @brief The engine's telemetry
+    *
+    * Samples the current game state's entity and component populations
+    * after each frame, if enabled.
+    */
+    Telemetry&
+    telemetry();
+
+    /**
+    * @brief The engine's thread pool
+    *
+    * The workers are started in Engine::init() and stopped in 
+    * Engine::shutdown().
+    */
+    ThreadPool&
+    threadPool();
+
     /**
     * @brief Renders a single frame
     *
@@ -52,11 +52,14 @@ Entity::luaBindings() {
         .def(constructor<const std::string&, GameState*>())
         .def(const_self == other<Entity>())
         .def("addComponent", &Entity_addComponent, adopt(_2))
+        .def("addTag", &Entity::addTag)
         .def("destroy", &Entity::destroy)
         .def("exists", &Entity::exists)
         .def("getComponent", &Entity::getComponent)
+        .def("hasTag", &Entity::hasTag)
         .def("isVolatile", &Entity::isVolatile)
         .def("removeComponent", &Entity::removeComponent)
+        .def("removeTag", &Entity::removeTag)
         .def("setVolatile", &Entity::setVolatile)
         .property("id", &Entity::id)
     ;
@@ -143,6 +146,14 @@ Entity::addComponent(
 }
 
 
+void
+Entity::addTag(
+    ComponentTypeId typeId
+) {
+    m_impl->m_entityManager->addTag(m_impl->m_id, typeId);
+}
+
+
 void
 Entity::destroy() {
     m_impl->m_entityManager->removeEntity(m_impl->m_id);
@@ -178,6 +189,14 @@ Entity::hasComponent(
 }
 
 
+bool
+Entity::hasTag(
+    ComponentTypeId typeId
+) const {
+    return m_impl->m_entityManager->hasTag(m_impl->m_id, typeId);
+}
+
+
 EntityId
 Entity::id() const {
     return m_impl->m_id;
@@ -201,6 +220,14 @@ Entity::removeComponent(
 }
 
 
+void
+Entity::removeTag(
+    ComponentTypeId typeId
+) {
+    m_impl->m_entityManager->removeTag(m_impl->m_id, typeId);
+}
+
+
 void
 Entity::setVolatile(
     bool isVolatile
@@ -38,8 +38,11 @@ public:
     *
     * Exposes the following \b functions:
     * - \c addComponent(Component): addComponent(std::unique_ptr<Component>)
+    * - \c addTag(number): addTag(ComponentTypeId)
     * - \c getComponent(number): getComponent(ComponentTypeId)
+    * - \c hasTag(number): hasTag(ComponentTypeId)
     * - \c removeComponent(number): removeComponent(ComponentTypeId)
+    * - \c removeTag(number): removeTag(ComponentTypeId)
     *
     * Exposes the following \b operators:
     * - \c ==: operator==(const Entity&)
@@ -144,14 +147,36 @@ public:
     * @brief Adds a component to this entity
     *
     * @param component
+    *
+    * @throws std::runtime_error if the entity has been destroyed
     */
     void
     addComponent(
         std::unique_ptr<Component> component
     );
 
+    /**
+    * @brief Tags this entity
+    *
+    * @param typeId
+    *   The tag's type id
+    *
+    * @throws std::runtime_error if the entity has been destroyed or
+    *   \a typeId is not a tag type
+    *
+    * @see EntityManager::addTag()
+    */
+    void
+    addTag(
+        ComponentTypeId typeId
+    );
+
     /**
     * @brief Removes all components of this entity
+    *
+    * After the next EntityManager::processRemovals(), this entity's id is
+    * stale. Its index may be reused for a new entity, but with a 
+    * different generation, so this Entity will never refer to it.
     */
     void
     destroy();
@@ -160,6 +185,7 @@ public:
     * @brief Checks if the entity has any components
     *
     * @return \c true if the entity has at least one component, \c false otherwise
+    *   or if the entity has been destroyed
     */
     bool
     exists() const;
@@ -198,6 +224,17 @@ public:
         ComponentTypeId typeId
     );
 
+    /**
+    * @brief Checks whether this entity has a tag
+    *
+    * @param typeId
+    *   The tag's type id
+    */
+    bool
+    hasTag(
+        ComponentTypeId typeId
+    ) const;
+
     /**
     * @brief The entity's id
     */
@@ -231,6 +268,19 @@ public:
         ComponentTypeId typeId
     );
 
+    /**
+    * @brief Removes a tag
+    *
+    * Like removeComponent(), this takes effect at the end of the frame.
+    *
+    * @param typeId
+    *   The tag's type id
+    */
+    void
+    removeTag(
+        ComponentTypeId typeId
+    );
+
     /**
     * @brief Sets the volatile flag
     *
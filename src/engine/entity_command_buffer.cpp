@@ -0,0 +1,226 @@
+#include "engine/entity_command_buffer.h"
+
+#include "engine/component.h"
+#include "engine/entity_manager.h"
+
+#include <algorithm>
+#include <assert.h>
+#include <iterator>
+
+using namespace thrive;
+
+const std::size_t EntityCommandBuffer::ID_BLOCK_SIZE;
+
+namespace {
+
+struct Command {
+
+    enum class Type {
+        AddComponent,
+        RemoveComponent,
+        RemoveEntity
+    };
+
+    Type m_type;
+
+    std::unique_ptr<Component> m_component;
+
+    EntityId m_entityId;
+
+    ComponentTypeId m_typeId;
+
+};
+
+}
+
+struct EntityCommandBuffer::Implementation {
+
+    Implementation(
+        EntityManager& entityManager
+    ) : m_entityManager(entityManager)
+    {
+    }
+
+    void
+    record(
+        Command::Type type,
+        EntityId entityId,
+        ComponentTypeId typeId,
+        std::unique_ptr<Component> component
+    ) {
+        Command command;
+        command.m_type = type;
+        command.m_component = std::move(component);
+        command.m_entityId = entityId;
+        command.m_typeId = typeId;
+        m_commands.push_back(std::move(command));
+    }
+
+    void
+    releaseReservedIds() {
+        for (EntityId entityId : m_reservedIds) {
+            m_entityManager.removeEntity(entityId);
+        }
+        m_reservedIds.clear();
+    }
+
+    std::vector<Command> m_commands;
+
+    EntityManager& m_entityManager;
+
+    // Handed out from the back
+    std::vector<EntityId> m_reservedIds;
+
+};
+
+
+EntityCommandBuffer::EntityCommandBuffer(
+    EntityManager& entityManager
+) : m_impl(new Implementation(entityManager))
+{
+}
+
+
+EntityCommandBuffer::~EntityCommandBuffer() {
+    m_impl->releaseReservedIds();
+}
+
+
+Component*
+EntityCommandBuffer::addComponent(
+    EntityId entityId,
+    std::unique_ptr<Component> component
+) {
+    Component* rawComponent = component.get();
+    ComponentTypeId typeId = component->typeId();
+    m_impl->record(
+        Command::Type::AddComponent,
+        entityId,
+        typeId,
+        std::move(component)
+    );
+    return rawComponent;
+}
+
+
+void
+EntityCommandBuffer::append(
+    EntityCommandBuffer& other
+) {
+    assert(&m_impl->m_entityManager == &other.m_impl->m_entityManager && "Command buffers belong to different entity managers");
+    auto& commands = other.m_impl->m_commands;
+    m_impl->m_commands.insert(
+        m_impl->m_commands.end(),
+        std::make_move_iterator(commands.begin()),
+        std::make_move_iterator(commands.end())
+    );
+    commands.clear();
+    auto& reservedIds = other.m_impl->m_reservedIds;
+    m_impl->m_reservedIds.insert(
+        m_impl->m_reservedIds.end(),
+        reservedIds.begin(),
+        reservedIds.end()
+    );
+    reservedIds.clear();
+}
+
+
+void
+EntityCommandBuffer::clear() {
+    m_impl->m_commands.clear();
+}
+
+
+EntityId
+EntityCommandBuffer::createEntity() {
+    std::vector<EntityId>& reservedIds = m_impl->m_reservedIds;
+    if (reservedIds.empty()) {
+        reservedIds = m_impl->m_entityManager.generateNewIds(ID_BLOCK_SIZE);
+        // Hand them out in the order they were generated
+        std::reverse(reservedIds.begin(), reservedIds.end());
+    }
+    EntityId entityId = reservedIds.back();
+    reservedIds.pop_back();
+    return entityId;
+}
+
+
+bool
+EntityCommandBuffer::empty() const {
+    return m_impl->m_commands.empty();
+}
+
+
+EntityManager&
+EntityCommandBuffer::entityManager() const {
+    return m_impl->m_entityManager;
+}
+
+
+void
+EntityCommandBuffer::playback() {
+    // Take the commands out first, in case playing them back records
+    // new ones (e.g. from a component's constructor or callbacks)
+    std::vector<Command> commands;
+    commands.swap(m_impl->m_commands);
+    EntityManager& entityManager = m_impl->m_entityManager;
+    for (Command& command : commands) {
+        // The entity may have been destroyed since the command was recorded
+        if (not entityManager.isCurrent(command.m_entityId)) {
+            continue;
+        }
+        switch (command.m_type) {
+            case Command::Type::AddComponent:
+                entityManager.addComponent(
+                    command.m_entityId,
+                    std::move(command.m_component)
+                );
+                break;
+            case Command::Type::RemoveComponent:
+                entityManager.removeComponent(
+                    command.m_entityId,
+                    command.m_typeId
+                );
+                break;
+            case Command::Type::RemoveEntity:
+                entityManager.removeEntity(command.m_entityId);
+                break;
+            default:
+                assert(false && "Unknown command type");
+        }
+    }
+    m_impl->releaseReservedIds();
+}
+
+
+void
+EntityCommandBuffer::removeComponent(
+    EntityId entityId,
+    ComponentTypeId typeId
+) {
+    m_impl->record(
+        Command::Type::RemoveComponent,
+        entityId,
+        typeId,
+        nullptr
+    );
+}
+
+
+void
+EntityCommandBuffer::removeEntity(
+    EntityId entityId
+) {
+    m_impl->record(
+        Command::Type::RemoveEntity,
+        entityId,
+        NULL_COMPONENT_TYPE,
+        nullptr
+    );
+}
+
+
+std::size_t
+EntityCommandBuffer::size() const {
+    return m_impl->m_commands.size();
+}
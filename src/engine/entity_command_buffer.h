@@ -0,0 +1,218 @@
+#pragma once
+
+#include "engine/typedefs.h"
+
+#include <memory>
+#include <vector>
+
+namespace thrive {
+
+class Component;
+class EntityManager;
+
+/**
+* @brief Records structural changes to apply to an entity manager later
+*
+* Systems updated on worker threads must not add components or remove
+* components and entities of types they haven't declared (see
+* System::writesComponent()), and adding components notifies entity filters
+* right away. Instead, such systems can record the changes in a command
+* buffer and let the main thread apply them after all systems have been
+* updated.
+*
+* Each system has its own command buffer (see System::commandBuffer()).
+* GameState::update() plays the buffers back in the order of the systems,
+* so the result does not depend on which thread updated which system.
+*
+* A command buffer itself is not thread safe. Only one thread may record
+* into it at a time. Work split over several threads can record into
+* separate buffers and append() them in a fixed order, see
+* EntityFilter::parallelForEach(). Recording takes no locks, except for
+* reserving a new block of ids every ID_BLOCK_SIZE calls of createEntity().
+*/
+class EntityCommandBuffer {
+
+public:
+
+    /**
+    * @brief The number of entity ids createEntity() reserves at once
+    */
+    static const std::size_t ID_BLOCK_SIZE = 32;
+
+    /**
+    * @brief Constructor
+    *
+    * @param entityManager
+    *   The entity manager to apply the commands to
+    */
+    explicit EntityCommandBuffer(
+        EntityManager& entityManager
+    );
+
+    /**
+    * @brief Non-copyable
+    */
+    EntityCommandBuffer(const EntityCommandBuffer&) = delete;
+
+    /**
+    * @brief Destructor
+    *
+    * Discards all commands that have not been played back and releases
+    * the unused reserved ids.
+    */
+    ~EntityCommandBuffer();
+
+    /**
+    * @brief Non-copyable
+    */
+    EntityCommandBuffer&
+    operator=(const EntityCommandBuffer&) = delete;
+
+    /**
+    * @brief Records adding a component
+    *
+    * @param entityId
+    *   The entity to add to
+    * @param component
+    *   The component to add
+    *
+    * @return
+    *   The component as a non-owning pointer. It is owned by the buffer
+    *   until playback and by the entity manager afterwards.
+    */
+    Component*
+    addComponent(
+        EntityId entityId,
+        std::unique_ptr<Component> component
+    );
+
+    /**
+    * @brief Convenience template overload
+    *
+    * @tparam C
+    *   The component's class
+    *
+    * @param entityId
+    *   The entity to add to
+    * @param component
+    *   The component to add
+    *
+    * @return
+    *   The component as a non-owning pointer
+    */
+    template<typename C>
+    C*
+    addComponent(
+        EntityId entityId,
+        std::unique_ptr<C> component
+    ) {
+        return static_cast<C*>(
+            this->addComponent(
+                entityId,
+                std::unique_ptr<Component>(std::move(component))
+            )
+        );
+    }
+
+    /**
+    * @brief Moves all commands of another buffer to the end of this one
+    *
+    * Also takes over the other buffer's unused reserved ids.
+    *
+    * @param other
+    *   The buffer to take the commands from. Must belong to the same
+    *   entity manager. Is empty afterwards.
+    */
+    void
+    append(
+        EntityCommandBuffer& other
+    );
+
+    /**
+    * @brief Discards all recorded commands
+    */
+    void
+    clear();
+
+    /**
+    * @brief Creates a new entity
+    *
+    * The id is taken from a block of ids reserved with 
+    * EntityManager::generateNewIds(), so it can be used in further 
+    * commands. The entity gets its components at playback.
+    *
+    * @return
+    *   The new entity's id
+    */
+    EntityId
+    createEntity();
+
+    /**
+    * @brief Whether there are no commands to play back
+    */
+    bool
+    empty() const;
+
+    /**
+    * @brief The entity manager the commands are applied to
+    */
+    EntityManager&
+    entityManager() const;
+
+    /**
+    * @brief Applies all recorded commands in the order they were recorded
+    *
+    * The buffer is empty afterwards. Unused reserved ids are released with
+    * EntityManager::removeEntity(), so that no ids are held on to across
+    * a restore of the entity manager. Call this from the main thread while
+    * no systems are being updated.
+    *
+    * Commands for entities that have been destroyed in the meantime are
+    * skipped.
+    */
+    void
+    playback();
+
+    /**
+    * @brief Records removing a component
+    *
+    * See EntityManager::removeComponent()
+    *
+    * @param entityId
+    *   The component's owner
+    * @param typeId
+    *   The component's type id
+    */
+    void
+    removeComponent(
+        EntityId entityId,
+        ComponentTypeId typeId
+    );
+
+    /**
+    * @brief Records removing an entity
+    *
+    * See EntityManager::removeEntity()
+    *
+    * @param entityId
+    *   The entity to remove
+    */
+    void
+    removeEntity(
+        EntityId entityId
+    );
+
+    /**
+    * @brief The number of recorded commands
+    */
+    std::size_t
+    size() const;
+
+private:
+
+    struct Implementation;
+    std::unique_ptr<Implementation> m_impl;
+
+};
+
+}
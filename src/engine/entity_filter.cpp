@@ -17,6 +17,45 @@ struct IsRequired<Optional<ComponentType>> {
 };
 
 
+// Tags are not components, see TAG
+template<typename ComponentType>
+struct IsTag {
+
+    static const bool value = not std::is_base_of<Component, ComponentType>::value;
+
+};
+
+
+template<typename RawType, bool isTag = IsTag<RawType>::value>
+struct ComponentGetter {
+
+    static RawType*
+    get(
+        const ComponentCollection& collection,
+        EntityId entityId
+    ) {
+        return static_cast<RawType*>(collection.get(entityId));
+    }
+
+};
+
+
+template<typename RawType>
+struct ComponentGetter<RawType, true> {
+
+    // Tags have no data, all tagged entities share one instance
+    static RawType*
+    get(
+        const ComponentCollection& collection,
+        EntityId entityId
+    ) {
+        static RawType instance;
+        return collection.contains(entityId) ? &instance : nullptr;
+    }
+
+};
+
+
 template<size_t index, typename... ComponentTypes>
 struct ComponentGroupBuilder {
 
@@ -24,21 +63,21 @@ struct ComponentGroupBuilder {
         typename ExtractComponentType<ComponentTypes>::PointerType...
     >;
 
-    static bool 
+    using Collections = std::array<ComponentCollection*, sizeof...(ComponentTypes)>;
+
+    static void 
     build(
-        EntityManager* entityManager,
+        const Collections& collections,
         EntityId entityId,
         ComponentGroup& group
     ) {
         using ComponentType = typename std::tuple_element<index, std::tuple<ComponentTypes...>>::type;
         using RawType = typename ExtractComponentType<ComponentType>::Type;
-        bool isRequired = IsRequired<ComponentType>::value;
-        RawType* component = entityManager->getComponent<RawType>(entityId);
-        if (isRequired and not component) {
-            return false;
-        }
-        std::get<index>(group) = component;
-        return ComponentGroupBuilder<index-1, ComponentTypes...>::build(entityManager, entityId, group);
+        std::get<index>(group) = ComponentGetter<RawType>::get(
+            *collections[index],
+            entityId
+        );
+        ComponentGroupBuilder<index-1, ComponentTypes...>::build(collections, entityId, group);
     }
         
 };
@@ -47,21 +86,18 @@ struct ComponentGroupBuilder {
 template<typename... ComponentTypes>
 struct ComponentGroupBuilder<0, ComponentTypes...> {
 
-    static bool 
+    static void 
     build(
-        EntityManager* entityManager,
+        const std::array<ComponentCollection*, sizeof...(ComponentTypes)>& collections,
         EntityId entityId,
         std::tuple<typename ExtractComponentType<ComponentTypes>::PointerType...>& group
     ) {
         using ComponentType = typename std::tuple_element<0, std::tuple<ComponentTypes...>>::type;
         using RawType = typename ExtractComponentType<ComponentType>::Type;
-        bool isRequired = IsRequired<ComponentType>::value;
-        RawType* component = entityManager->getComponent<RawType>(entityId);
-        if (isRequired and not component) {
-            return false;
-        }
-        std::get<0>(group) = component;
-        return true;
+        std::get<0>(group) = ComponentGetter<RawType>::get(
+            *collections[0],
+            entityId
+        );
     }
         
 };
@@ -101,70 +137,189 @@ struct EntityFilter<ComponentTypes...>::Implementation {
     {
     }
 
+    ~Implementation() {
+        this->setQuery(nullptr);
+    }
+
+    const EntityMap&
+    entities() const {
+        static const EntityMap NO_ENTITIES;
+        return m_query ? m_query->m_entities : NO_ENTITIES;
+    }
+
+    void
+    setQuery(
+        std::shared_ptr<Query> query
+    ) {
+        if (m_query and m_recordChanges) {
+            m_query->unsubscribe(*this);
+        }
+        m_addedEntities.clear();
+        m_removedEntities.clear();
+        m_query = std::move(query);
+        if (m_query and m_recordChanges) {
+            m_query->subscribe(*this);
+        }
+    }
+
     void
-    initEntities() {
-        for (EntityId id : m_entityManager->entities()) {
+    syncChanges() {
+        if (m_query) {
+            m_query->replayChanges(*this);
+        }
+    }
+
+    EntityMap m_addedEntities;
+
+    // Position in the query's change log up to which the changes have
+    // been applied to m_addedEntities and m_removedEntities
+    std::size_t m_changeCursor = 0;
+
+    std::shared_ptr<Query> m_query;
+
+    bool m_recordChanges;
+
+    std::unordered_set<EntityId> m_removedEntities;
+
+};
+
+
+template<typename... ComponentTypes>
+struct EntityFilter<ComponentTypes...>::Query : public EntityQuery {
+
+    enum class ChangeType {
+        Added,
+        // The last optional component was removed
+        Emptied,
+        // A required component was removed
+        Removed
+    };
+
+    struct Change {
+
+        ComponentGroup group;
+
+        EntityId entityId;
+
+        ChangeType type;
+
+    };
+
+    Query(
+        EntityManager& entityManager
+    ) : m_entityManager(entityManager)
+    {
+        detail::RegisterNextCallback<sizeof...(ComponentTypes)>::registerNextCallback(*this);
+        for (EntityId id : m_entityManager.entities()) {
             this->initEntity(id);
         }
     }
 
+    ~Query() {
+        for(auto& pair : m_registeredCallbacks) {
+            pair.first.get().unregisterChangeCallbacks(pair.second);
+        }
+    }
+
     void
     initEntity(
         EntityId id
     ) {
+        if (not this->matches(m_entityManager.signature(id))) {
+            return;
+        }
         ComponentGroup group;
-        bool isComplete = detail::ComponentGroupBuilder<sizeof...(ComponentTypes) - 1, ComponentTypes...>::build(
-            m_entityManager,
+        detail::ComponentGroupBuilder<sizeof...(ComponentTypes) - 1, ComponentTypes...>::build(
+            m_collections,
             id,
             group
         );
-        if (isComplete) {
-            m_entities[id] = group;
-            m_entities.insert(std::make_pair(id, group));
-            if (m_recordChanges) {
-                m_addedEntities[id] = group;
-            }
+        m_entities[id] = group;
+        this->recordChange(id, group, ChangeType::Added);
+    }
+
+    bool
+    matches(
+        const ComponentSignature& signature
+    ) const {
+        if ((signature & m_requiredSignature) != m_requiredSignature) {
+            return false;
         }
+        // Without required components, at least one optional component
+        // must be present
+        return m_requiredSignature.any() or (signature & m_optionalSignature).any();
     }
 
     void
-    onComponentAdded(
-        EntityId entityId
+    onComponentsAdded(
+        const std::vector<EntityId>& entityIds
     ) {
-        this->initEntity(entityId);
+        for (EntityId entityId : entityIds) {
+            this->initEntity(entityId);
+        }
     }
 
     template<int tupleIndex>
     void
-    onOptionalComponentRemoved(
-        EntityId entityId
+    onOptionalComponentsRemoved(
+        const std::vector<EntityId>& entityIds
     ) {
-        auto iter = m_entities.find(entityId);
-        if (iter != m_entities.end()) {
-            std::get<tupleIndex>(iter->second) = nullptr;
-            if (iter->second == ComponentGroup()) {
-                m_entities.erase(entityId);
-                if (m_recordChanges) {
-                    m_removedEntities.insert(entityId);
+        for (EntityId entityId : entityIds) {
+            auto iter = m_entities.find(entityId);
+            if (iter != m_entities.end()) {
+                std::get<tupleIndex>(iter->second) = nullptr;
+                if (iter->second == ComponentGroup()) {
+                    m_entities.erase(entityId);
+                    this->recordChange(entityId, ComponentGroup(), ChangeType::Emptied);
                 }
             }
         }
     }
 
     void
-    onRequiredComponentRemoved(
-        EntityId entityId
+    onRequiredComponentsRemoved(
+        const std::vector<EntityId>& entityIds
     ) {
-        
-        if (m_entities.erase(entityId) > 0 and m_recordChanges) {
-            if (m_addedEntities.erase(entityId) == 0) {
-                // If entityId already was in addedEntities, the entity
-                // was added, then removed in the same frame.
-                m_removedEntities.insert(entityId);
+        for (EntityId entityId : entityIds) {
+            if (m_entities.erase(entityId) > 0) {
+                this->recordChange(entityId, ComponentGroup(), ChangeType::Removed);
             }
         }
     }
 
+    void
+    recordChange(
+        EntityId entityId,
+        const ComponentGroup& group,
+        ChangeType type
+    ) {
+        if (m_subscribers.empty()) {
+            return;
+        }
+        std::size_t logEnd = m_logBegin + m_log.size();
+        bool allCurrent = std::all_of(
+            m_subscribers.begin(),
+            m_subscribers.end(),
+            [logEnd](const Implementation* subscriber) {
+                return subscriber->m_changeCursor == logEnd;
+            }
+        );
+        // A subscriber that never clears its changes would keep the log 
+        // growing, so catch everyone up once it's larger than the changes
+        // could be after replaying
+        if (not allCurrent and m_log.size() > 2 * m_entities.size() + 1024) {
+            for (Implementation* subscriber : m_subscribers) {
+                this->replayChanges(*subscriber);
+            }
+            allCurrent = true;
+        }
+        if (allCurrent) {
+            m_logBegin = logEnd;
+            m_log.clear();
+        }
+        m_log.push_back(Change{group, entityId, type});
+    }
+
     template<int tupleIndex>
     void
     registerCallback() {
@@ -174,25 +329,32 @@ struct EntityFilter<ComponentTypes...>::Implementation {
         >::type;
         using RawType = typename detail::ExtractComponentType<ComponentType>::Type;
         bool isRequired = detail::IsRequired<ComponentType>::value;
-        auto& collection = m_entityManager->getComponentCollection(
+        auto& collection = m_entityManager.getComponentCollection(
             RawType::TYPE_ID
         );
+        m_collections[tupleIndex] = &collection;
+        if (isRequired) {
+            m_requiredSignature.set(collection.signatureBit());
+        }
+        else {
+            m_optionalSignature.set(collection.signatureBit());
+        }
         // Callbacks
-        auto onAdded = [this] (EntityId id, Component&) {
-            this->onComponentAdded(id);
+        auto onAdded = [this] (const std::vector<EntityId>& ids) {
+            this->onComponentsAdded(ids);
         };
-        ComponentCollection::ChangeCallback onRemoved;
+        ComponentCollection::BatchCallback onRemoved;
         if (isRequired) {
-            onRemoved = [this] (EntityId id, Component&) {
-                this->onRequiredComponentRemoved(id);
+            onRemoved = [this] (const std::vector<EntityId>& ids) {
+                this->onRequiredComponentsRemoved(ids);
             };
         }
         else {
-            onRemoved = [this] (EntityId id, Component&) {
-                this->onOptionalComponentRemoved<tupleIndex>(id);
+            onRemoved = [this] (const std::vector<EntityId>& ids) {
+                this->onOptionalComponentsRemoved<tupleIndex>(ids);
             };
         }
-        unsigned int id = collection.registerChangeCallbacks(
+        unsigned int id = collection.registerBatchCallbacks(
             onAdded,
             onRemoved
         );
@@ -203,27 +365,83 @@ struct EntityFilter<ComponentTypes...>::Implementation {
     }
 
     void
-    unregisterCallbacks() {
-        for(auto& pair : m_registeredCallbacks) {
-            pair.first.get().unregisterChangeCallbacks(pair.second);
+    replayChanges(
+        Implementation& subscriber
+    ) const {
+        for (
+            std::size_t index = subscriber.m_changeCursor - m_logBegin;
+            index < m_log.size();
+            ++index
+        ) {
+            const Change& change = m_log[index];
+            if (change.type == ChangeType::Added) {
+                subscriber.m_addedEntities[change.entityId] = change.group;
+            }
+            else if (change.type == ChangeType::Removed) {
+                if (subscriber.m_addedEntities.erase(change.entityId) == 0) {
+                    // If the entity already was in addedEntities, it was 
+                    // added, then removed before the changes were cleared
+                    subscriber.m_removedEntities.insert(change.entityId);
+                }
+            }
+            else {
+                subscriber.m_removedEntities.insert(change.entityId);
+            }
         }
-        m_registeredCallbacks.clear();
+        subscriber.m_changeCursor = m_logBegin + m_log.size();
     }
 
-    EntityMap m_addedEntities;
+    void
+    skipChanges(
+        Implementation& subscriber
+    ) const {
+        subscriber.m_changeCursor = m_logBegin + m_log.size();
+    }
+
+    void
+    subscribe(
+        Implementation& subscriber
+    ) {
+        // Entities that are already there count as added
+        for (const auto& value : m_entities) {
+            subscriber.m_addedEntities[value.first] = value.second;
+        }
+        this->skipChanges(subscriber);
+        m_subscribers.push_back(&subscriber);
+    }
+
+    void
+    unsubscribe(
+        Implementation& subscriber
+    ) {
+        m_subscribers.erase(
+            std::remove(m_subscribers.begin(), m_subscribers.end(), &subscriber),
+            m_subscribers.end()
+        );
+    }
+
+    std::array<ComponentCollection*, sizeof...(ComponentTypes)> m_collections {{}};
 
     EntityMap m_entities;
 
-    EntityManager* m_entityManager = nullptr;
+    EntityManager& m_entityManager;
 
-    bool m_recordChanges;
+    std::vector<Change> m_log;
+
+    // Position of the first change in m_log since the query was created
+    std::size_t m_logBegin = 0;
+
+    ComponentSignature m_optionalSignature;
 
     std::forward_list<std::pair<
         std::reference_wrapper<ComponentCollection>, 
         unsigned int
     >> m_registeredCallbacks;
 
-    std::unordered_set<EntityId> m_removedEntities;
+    ComponentSignature m_requiredSignature;
+
+    // Filters that record changes
+    std::vector<Implementation*> m_subscribers;
 
 };
 
@@ -239,6 +457,7 @@ template<typename... ComponentTypes>
 typename EntityFilter<ComponentTypes...>::EntityMap&
 EntityFilter<ComponentTypes...>::addedEntities() {
     assert(m_impl->m_recordChanges && "Added entities are not recorded by this filter");
+    m_impl->syncChanges();
     return m_impl->m_addedEntities;
 }
 
@@ -246,13 +465,16 @@ EntityFilter<ComponentTypes...>::addedEntities() {
 template<typename... ComponentTypes>
 typename EntityFilter<ComponentTypes...>::EntityMap::const_iterator
 EntityFilter<ComponentTypes...>::begin() const {
-    return m_impl->m_entities.cbegin();
+    return m_impl->entities().cbegin();
 }
 
 
 template<typename... ComponentTypes>
 void
 EntityFilter<ComponentTypes...>::clearChanges() {
+    if (m_impl->m_query) {
+        m_impl->m_query->skipChanges(*m_impl);
+    }
     m_impl->m_addedEntities.clear();
     m_impl->m_removedEntities.clear();
 }
@@ -263,21 +485,80 @@ bool
 EntityFilter<ComponentTypes...>::containsEntity(
     EntityId id
 ) const {
-    return m_impl->m_entities.find(id) != m_impl->m_entities.end();
+    const EntityMap& entities = m_impl->entities();
+    return entities.find(id) != entities.end();
 }
 
 
 template<typename... ComponentTypes>
 typename EntityFilter<ComponentTypes...>::EntityMap::const_iterator
 EntityFilter<ComponentTypes...>::end() const {
-    return m_impl->m_entities.cend();
+    return m_impl->entities().cend();
 }
 
 
 template<typename... ComponentTypes>
 const typename EntityFilter<ComponentTypes...>::EntityMap&
 EntityFilter<ComponentTypes...>::entities() const {
-    return m_impl->m_entities;
+    return m_impl->entities();
+}
+
+
+template<typename... ComponentTypes>
+template<typename Function>
+void
+EntityFilter<ComponentTypes...>::parallelForEach(
+    ThreadPool& threadPool,
+    std::size_t chunkSize,
+    Function function
+) const {
+    const EntityMap& entities = m_impl->entities();
+    threadPool.parallelFor(
+        entities.size(),
+        chunkSize,
+        [&entities, &function](std::size_t begin, std::size_t end) {
+            auto iter = entities.cbegin() + begin;
+            auto last = entities.cbegin() + end;
+            for (; iter != last; ++iter) {
+                function(iter->first, iter->second);
+            }
+        }
+    );
+}
+
+
+template<typename... ComponentTypes>
+template<typename Function>
+void
+EntityFilter<ComponentTypes...>::parallelForEach(
+    ThreadPool& threadPool,
+    std::size_t chunkSize,
+    EntityCommandBuffer& commandBuffer,
+    Function function
+) const {
+    const EntityMap& entities = m_impl->entities();
+    chunkSize = std::max<std::size_t>(chunkSize, 1);
+    std::size_t chunkCount = (entities.size() + chunkSize - 1) / chunkSize;
+    std::vector<std::unique_ptr<EntityCommandBuffer>> chunkBuffers(chunkCount);
+    for (auto& chunkBuffer : chunkBuffers) {
+        chunkBuffer.reset(new EntityCommandBuffer(commandBuffer.entityManager()));
+    }
+    threadPool.parallelFor(
+        entities.size(),
+        chunkSize,
+        [&entities, &function, &chunkBuffers, chunkSize](std::size_t begin, std::size_t end) {
+            // Chunks start at multiples of the chunk size
+            EntityCommandBuffer& chunkBuffer = *chunkBuffers[begin / chunkSize];
+            auto iter = entities.cbegin() + begin;
+            auto last = entities.cbegin() + end;
+            for (; iter != last; ++iter) {
+                function(iter->first, iter->second, chunkBuffer);
+            }
+        }
+    );
+    for (auto& chunkBuffer : chunkBuffers) {
+        commandBuffer.append(*chunkBuffer);
+    }
 }
 
 
@@ -285,6 +566,7 @@ template<typename... ComponentTypes>
 std::unordered_set<EntityId>&
 EntityFilter<ComponentTypes...>::removedEntities() {
     assert(m_impl->m_recordChanges && "Removed entities are not recorded by this filter");
+    m_impl->syncChanges();
     return m_impl->m_removedEntities;
 }
 
@@ -294,15 +576,16 @@ void
 EntityFilter<ComponentTypes...>::setEntityManager(
     EntityManager* entityManager
 ) {
-    m_impl->unregisterCallbacks();
-    m_impl->m_entities.clear();
-    m_impl->m_addedEntities.clear();
-    m_impl->m_removedEntities.clear();
-    m_impl->m_entityManager = entityManager;
+    std::shared_ptr<Query> query;
     if (entityManager) {
-        detail::RegisterNextCallback<sizeof...(ComponentTypes)>::registerNextCallback(*m_impl);
-        m_impl->initEntities();
+        query = std::static_pointer_cast<Query>(entityManager->getOrCreateQuery(
+            typeid(Query),
+            [entityManager] () {
+                return std::make_shared<Query>(*entityManager);
+            }
+        ));
     }
+    m_impl->setQuery(std::move(query));
 }
 
 } // namespace thrive
@@ -1,13 +1,22 @@
 #pragma once
 
 #include "engine/entity_manager.h"
+#include "engine/entity_command_buffer.h"
 #include "engine/component_collection.h"
+#include "engine/sparse_entity_map.h"
+#include "engine/thread_pool.h"
 
+#include <algorithm>
+#include <array>
 #include <assert.h>
 #include <forward_list>
 #include <functional>
+#include <memory>
 #include <tuple>
-#include <unordered_map>
+#include <type_traits>
+#include <typeinfo>
+#include <unordered_set>
+#include <vector>
 
 #include <iostream>
 
@@ -50,6 +59,22 @@ struct ExtractComponentType<Optional<ComponentType>> {
 * An entity filter helps a system in finding the entities that have exactly
 * the right components to be relevant for the system. 
 *
+* When the filter is attached to an entity manager, it computes masks of its
+* required and optional component types. Whether an entity matches is then
+* decided with a single test against the entity's ComponentSignature.
+*
+* Filters of the same type attached to the same entity manager share their
+* matching entities: the first one creates a query in the manager's query
+* cache (see EntityManager::getOrCreateQuery()), which registers the
+* collection callbacks and keeps the entities up to date. Later filters
+* just subscribe to it. Filters that record changes read them from the
+* query's change log, each at its own position, so that clearChanges()
+* only affects the calling filter.
+*
+* Tags (see TAG) can be used like component classes. Their pointers in
+* the ComponentGroup point to a shared instance without any data, they
+* only tell whether an optional tag is there.
+*
 * @tparam ComponentTypes
 *   The component classes to watch for. You can wrap a class with the 
 *   Optional template if you want to know if it's there, but it's not
@@ -110,8 +135,13 @@ public:
 
     /**
     * @brief Typedef for the filter's list of relevant entities
+    *
+    * The (EntityId, ComponentGroup) pairs are packed into a contiguous 
+    * array, so iterating over a filter is a linear scan. Lookup by 
+    * entity id is still O(1). The order of the entries is unspecified 
+    * and changes when entities are removed.
     */
-    using EntityMap = std::unordered_map<EntityId, ComponentGroup>;
+    using EntityMap = SparseEntityMap<ComponentGroup>;
 
     /**
     * @brief Constructor
@@ -201,6 +231,89 @@ public:
     const EntityMap&
     entities() const;
 
+    /**
+    * @brief Calls a function for each relevant entity, spread over a 
+    *   thread pool
+    *
+    * The entities are handed out in chunks of \a chunkSize, see 
+    * ThreadPool::parallelFor(). Returns once all entities have been 
+    * processed.
+    *
+    * \a function may be called concurrently for different entities. It 
+    * must only touch the components of the entity it is called for and 
+    * must not add or remove components or entities.
+    *
+    * Usage example:
+    * \code
+    * m_entities.parallelForEach(
+    *     this->engine()->threadPool(),
+    *     256,
+    *     [](EntityId, const ComponentGroup& components) {
+    *         MyComponent* myComponent = std::get<0>(components);
+    *         // Do something with myComponent
+    *     }
+    * );
+    * \endcode
+    *
+    * @param threadPool
+    *   The pool to run on
+    * @param chunkSize
+    *   The number of entities processed in one go. Larger chunks have 
+    *   less overhead, smaller chunks balance better.
+    * @param function
+    *   Called with each entity's id and component group
+    */
+    template<typename Function>
+    void
+    parallelForEach(
+        ThreadPool& threadPool,
+        std::size_t chunkSize,
+        Function function
+    ) const;
+
+    /**
+    * @brief Calls a function for each relevant entity, spread over a 
+    *   thread pool, and collects the structural changes it records
+    *
+    * Like the overload above, but each chunk gets its own 
+    * EntityCommandBuffer for \a function to record into, so workers can
+    * create and remove entities without sharing a buffer or taking locks.
+    * Once all chunks are done, their buffers are appended to 
+    * \a commandBuffer in chunk order, so the result doesn't depend on 
+    * which worker processed which chunk.
+    *
+    * Usage example:
+    * \code
+    * m_entities.parallelForEach(
+    *     this->engine()->threadPool(),
+    *     256,
+    *     this->commandBuffer(),
+    *     [](EntityId entityId, const ComponentGroup&, EntityCommandBuffer& commandBuffer) {
+    *         commandBuffer.removeEntity(entityId);
+    *     }
+    * );
+    * \endcode
+    *
+    * @param threadPool
+    *   The pool to run on
+    * @param chunkSize
+    *   The number of entities processed in one go
+    * @param commandBuffer
+    *   The buffer to append the chunks' commands to, usually the system's
+    *   (see System::commandBuffer())
+    * @param function
+    *   Called with each entity's id, component group and its chunk's
+    *   command buffer
+    */
+    template<typename Function>
+    void
+    parallelForEach(
+        ThreadPool& threadPool,
+        std::size_t chunkSize,
+        EntityCommandBuffer& commandBuffer,
+        Function function
+    ) const;
+
     /**
     * @brief Returns the entities removed from this filter
     *
@@ -227,6 +340,8 @@ private:
 
     struct Implementation;
     std::unique_ptr<Implementation> m_impl;
+
+    struct Query;
 };
 
 template<>
@@ -2,51 +2,581 @@
 
 #include "engine/component_collection.h"
 #include "engine/component_factory.h"
+#include "engine/prefab.h"
 #include "engine/serialization.h"
+#include "engine/sparse_entity_map.h"
 
 #include <atomic>
 #include <boost/thread.hpp>
+#include <deque>
+#include <sstream>
+#include <stdexcept>
 #include <unordered_map>
 #include <unordered_set>
+#include <vector>
 
 #include <iostream>
 
 
 using namespace thrive;
 
+// Recycled indices are only handed out again once this many are waiting,
+// so that each index' generation wraps around as late as possible
+static const size_t MIN_FREE_INDICES = 1024;
+
+REGISTER_TAG(VolatileTag)
+
 struct EntityManager::Implementation {
 
+    // State of a read(), which restores in place
+    struct InPlaceRestore {
+
+        // Generation of each index before the restore
+        std::vector<uint16_t> m_previousGenerations;
+
+        // The components and tags found in the savegame, as signature bits
+        SparseEntityMap<ComponentSignature> m_restored;
+
+    };
+
+    void
+    adoptId(
+        EntityId id
+    ) {
+        EntityId index = entityIndex(id);
+        if (index == NULL_ENTITY) {
+            throw std::runtime_error("Invalid entity id in savegame");
+        }
+        if (index >= m_nextIndex) {
+            if (m_hasNextIndex) {
+                throw std::runtime_error("Invalid entity id in savegame");
+            }
+            // The id allocation comes later, restoreNextIndex() checks 
+            // that it covers this id
+            m_nextIndex = index + 1;
+            m_generations.resize(m_nextIndex, 0);
+        }
+        m_generations[index] = entityGeneration(id);
+    }
+
     ComponentCollection&
     getComponentCollection(
         ComponentTypeId typeId
     ) {
         std::unique_ptr<ComponentCollection>& collection = m_collections[typeId];
         if (not collection) {
-            collection.reset(new ComponentCollection(typeId));
+            std::size_t signatureBit = m_collectionsByBit.size();
+            if (signatureBit >= MAX_COMPONENT_TYPES) {
+                m_collections.erase(typeId);
+                throw std::runtime_error("Too many component types");
+            }
+            collection.reset(new ComponentCollection(
+                typeId,
+                signatureBit,
+                ComponentFactory::isTagType(typeId)
+            ));
+            collection->setDeferChanges(m_deferChanges);
+            m_collectionsByBit.push_back(collection.get());
+            m_removalBatches.emplace_back();
         }
         return *collection;
     }
 
+    void
+    setSignatureBit(
+        EntityId entityId,
+        std::size_t signatureBit
+    ) {
+        boost::unique_lock<boost::shared_mutex> lock(m_entitiesMutex);
+        m_entities[entityId].set(signatureBit);
+    }
+
+    // Must hold m_idMutex
+    EntityId
+    generateNewId() {
+        EntityId index = NULL_ENTITY;
+        bool indexSpaceExhausted = m_nextIndex > ENTITY_INDEX_MASK;
+        if (
+            m_freeIndices.size() > MIN_FREE_INDICES or
+            (indexSpaceExhausted and not m_freeIndices.empty())
+        ) {
+            index = m_freeIndices.front();
+            m_freeIndices.pop_front();
+        }
+        else if (not indexSpaceExhausted) {
+            index = m_nextIndex++;
+            m_generations.push_back(0);
+        }
+        else {
+            throw std::runtime_error("Out of entity ids");
+        }
+        return makeEntityId(index, m_generations[index]);
+    }
+
+    void
+    flushRemovalBatches() {
+        for (std::size_t bit = 0; bit < m_removalBatches.size(); ++bit) {
+            std::vector<EntityId>& batch = m_removalBatches[bit];
+            if (not batch.empty()) {
+                m_collectionsByBit[bit]->removeComponents(batch);
+                batch.clear();
+            }
+        }
+    }
+
+    bool
+    isCurrent(
+        EntityId id
+    ) const {
+        EntityId index = entityIndex(id);
+        boost::lock_guard<boost::mutex> lock(m_idMutex);
+        return 
+            index != NULL_ENTITY and 
+            index < m_nextIndex and 
+            m_generations[index] == entityGeneration(id)
+        ;
+    }
+
+    // An entity has at most one name, naming it again drops the old one
+    void
+    nameId(
+        const std::string& name,
+        EntityId id
+    ) {
+        auto nameIter = m_idNames.find(id);
+        if (nameIter != m_idNames.end()) {
+            m_namedIds.erase(nameIter->second);
+        }
+        auto idIter = m_namedIds.find(name);
+        if (idIter != m_namedIds.end()) {
+            m_idNames.erase(idIter->second);
+        }
+        m_namedIds[name] = id;
+        m_idNames[id] = name;
+    }
+
+    void
+    releaseId(
+        EntityId id
+    ) {
+        EntityId index = entityIndex(id);
+        {
+            boost::lock_guard<boost::mutex> lock(m_idMutex);
+            m_generations[index] = (m_generations[index] + 1) & ENTITY_GENERATION_MASK;
+            m_freeIndices.push_back(index);
+        }
+        auto iter = m_idNames.find(id);
+        if (iter != m_idNames.end()) {
+            m_namedIds.erase(iter->second);
+            m_idNames.erase(iter);
+        }
+    }
+
+    void
+    resetIds() {
+        m_freeIndices.clear();
+        m_generations.assign(1, 0);
+        m_hasNextIndex = false;
+        m_nextIndex = NULL_ENTITY + 1;
+    }
+
+    // The entries may come in any order, trees written with operator <<
+    // are not ordered like EntityManager::write(). Components and tags are
+    // restored right away, everything that refers to entities by id only
+    // once all of them are known. Whatever the savegame doesn't have is
+    // removed at the end.
+    void
+    read(
+        EntityManager& entityManager,
+        StorageReader& reader,
+        const ComponentFactory& factory,
+        std::vector<uint16_t> previousGenerations
+    ) {
+        InPlaceRestore restore;
+        restore.m_previousGenerations = std::move(previousGenerations);
+        std::vector<EntityId> freeIds;
+        std::vector<std::pair<std::string, EntityId>> namedIds;
+        std::vector<std::pair<EntityId, ComponentTypeId>> componentsToRemove;
+        std::vector<EntityId> entitiesToRemove;
+        while (reader.next()) {
+            std::string key = reader.key();
+            if (key == "nextIndex") {
+                this->restoreNextIndex(reader.get<EntityId>());
+            }
+            else if (key == "freeIds" and reader.isList()) {
+                reader.enter();
+                while (reader.nextElement()) {
+                    freeIds.push_back(reader.readContainer().get<EntityId>("id"));
+                }
+            }
+            else if (key == "namedIds" and reader.isList()) {
+                reader.enter();
+                while (reader.nextElement()) {
+                    StorageContainer entry = reader.readContainer();
+                    namedIds.emplace_back(
+                        entry.get<std::string>("name"),
+                        entry.get<EntityId>("entityId")
+                    );
+                }
+            }
+            else if (key == "collections" and reader.isContainer()) {
+                reader.enter();
+                while (reader.next()) {
+                    if (not reader.isList()) {
+                        continue;
+                    }
+                    std::string typeName = reader.key();
+                    reader.enter();
+                    while (reader.nextElement()) {
+                        this->readComponent(entityManager, factory, typeName, reader, restore);
+                    }
+                }
+            }
+            else if (key == "tags" and reader.isContainer()) {
+                reader.enter();
+                while (reader.next()) {
+                    ComponentTypeId typeId = this->tagTypeId(factory, reader.key());
+                    if (typeId == NULL_COMPONENT_TYPE or not reader.isList()) {
+                        continue;
+                    }
+                    reader.enter();
+                    while (reader.nextElement()) {
+                        EntityId entityId = reader.readContainer().get<EntityId>("id");
+                        this->adoptRestoredId(entityId, restore);
+                        entityManager.addTag(entityId, typeId);
+                        restore.m_restored[entityId].set(
+                            this->getComponentCollection(typeId).signatureBit()
+                        );
+                    }
+                }
+            }
+            else if (key == "componentsToRemove" and reader.isList()) {
+                reader.enter();
+                while (reader.nextElement()) {
+                    StorageContainer entry = reader.readContainer();
+                    std::string typeName = entry.get<std::string>("componentTypeName");
+                    componentsToRemove.emplace_back(
+                        entry.get<EntityId>("entityId"),
+                        factory.getTypeId(typeName)
+                    );
+                }
+            }
+            else if (key == "entitiesToRemove" and reader.isList()) {
+                reader.enter();
+                while (reader.nextElement()) {
+                    entitiesToRemove.push_back(reader.readContainer().get<EntityId>("id"));
+                }
+            }
+        }
+        this->removeUnrestored(restore);
+        if (not m_hasNextIndex) {
+            throw std::runtime_error("Savegame has no entity ids");
+        }
+        for (EntityId id : freeIds) {
+            this->restoreFreeId(id);
+        }
+        for (const auto& pair : namedIds) {
+            this->adoptId(pair.second);
+            this->nameId(pair.first, pair.second);
+        }
+        for (const auto& pair : componentsToRemove) {
+            entityManager.removeComponent(pair.first, pair.second);
+        }
+        for (EntityId entityId : entitiesToRemove) {
+            entityManager.removeEntity(entityId);
+        }
+    }
+
+    // EntityManager::write() puts the owner first, so that the component
+    // can read the rest with Component::read(). Otherwise, the entries
+    // are collected and loaded like a StorageContainer.
+    void
+    readComponent(
+        EntityManager& entityManager,
+        const ComponentFactory& factory,
+        const std::string& typeName,
+        StorageReader& reader,
+        InPlaceRestore& restore
+    ) {
+        StorageContainer storage;
+        bool hasEntry = reader.next();
+        if (
+            hasEntry and
+            reader.key() == "owner" and
+            not reader.isContainer() and
+            not reader.isList()
+        ) {
+            EntityId owner = reader.get<EntityId>();
+            if (owner != NULL_ENTITY) {
+                this->readOwnedComponent(entityManager, factory, typeName, owner, reader, restore);
+                return;
+            }
+            hasEntry = reader.next();
+        }
+        while (hasEntry) {
+            reader.readEntry(storage);
+            hasEntry = reader.next();
+        }
+        this->readComponent(entityManager, factory, typeName, storage, restore);
+    }
+
+    // The reader is positioned right after the owner
+    void
+    readOwnedComponent(
+        EntityManager& entityManager,
+        const ComponentFactory& factory,
+        const std::string& typeName,
+        EntityId owner,
+        StorageReader& reader,
+        InPlaceRestore& restore
+    ) {
+        this->adoptRestoredId(owner, restore);
+        ComponentTypeId typeId = factory.getTypeId(typeName);
+        auto iter = m_collections.find(typeId);
+        Component* component = nullptr;
+        if (iter != m_collections.end()) {
+            component = iter->second->get(owner);
+        }
+        if (component and component->read(reader)) {
+            restore.m_restored[owner].set(iter->second->signatureBit());
+            return;
+        }
+        StorageContainer storage;
+        storage.set<EntityId>("owner", owner);
+        std::unique_ptr<Component> newComponent;
+        if (not component) {
+            newComponent = factory.load(typeName, storage);
+        }
+        if (newComponent) {
+            if (not newComponent->read(reader)) {
+                // Loaded again with all entries, but not created again
+                while (reader.next()) {
+                    reader.readEntry(storage);
+                }
+                newComponent->load(storage);
+            }
+            entityManager.addComponent(owner, std::move(newComponent));
+            restore.m_restored[owner].set(
+                this->getComponentCollection(typeId).signatureBit()
+            );
+            return;
+        }
+        while (reader.next()) {
+            reader.readEntry(storage);
+        }
+        this->readComponent(entityManager, factory, typeName, storage, restore);
+    }
+
+    // Reuses the existing component if it can be reloaded, replaces it
+    // or adds a new one otherwise
+    void
+    readComponent(
+        EntityManager& entityManager,
+        const ComponentFactory& factory,
+        const std::string& typeName,
+        const StorageContainer& storage,
+        InPlaceRestore& restore
+    ) {
+        EntityId owner = storage.get<EntityId>("owner", NULL_ENTITY);
+        if (owner != NULL_ENTITY) {
+            this->adoptRestoredId(owner, restore);
+            auto iter = m_collections.find(factory.getTypeId(typeName));
+            if (iter != m_collections.end()) {
+                Component* component = iter->second->get(owner);
+                if (component and component->reload(storage)) {
+                    restore.m_restored[owner].set(iter->second->signatureBit());
+                    return;
+                }
+            }
+        }
+        Component* component = this->restoreComponent(entityManager, factory, typeName, storage);
+        if (component) {
+            restore.m_restored[component->owner()].set(
+                this->getComponentCollection(component->typeId()).signatureBit()
+            );
+        }
+    }
+
+    // The sparse maps hold one generation per index. If the savegame
+    // gives an index to another generation than before, the previous 
+    // entity is removed and reported right away, before the new one is 
+    // added. This reports other pending changes of its collections early.
+    void
+    adoptRestoredId(
+        EntityId id,
+        InPlaceRestore& restore
+    ) {
+        this->adoptId(id);
+        EntityId index = entityIndex(id);
+        std::vector<uint16_t>& previousGenerations = restore.m_previousGenerations;
+        if (
+            index >= previousGenerations.size() or 
+            previousGenerations[index] == entityGeneration(id)
+        ) {
+            return;
+        }
+        EntityId previousId = makeEntityId(index, previousGenerations[index]);
+        previousGenerations[index] = entityGeneration(id);
+        auto iter = m_entities.find(previousId);
+        if (iter == m_entities.end()) {
+            return;
+        }
+        ComponentSignature signature = iter->second;
+        m_entities.erase(previousId);
+        std::vector<EntityId> entityIds(1, previousId);
+        for (std::size_t bit = 0; bit < m_collectionsByBit.size(); ++bit) {
+            if (signature.test(bit)) {
+                m_collectionsByBit[bit]->removeComponents(entityIds);
+                m_collectionsByBit[bit]->flushChanges();
+            }
+        }
+    }
+
+    void
+    removeUnrestored(
+        const InPlaceRestore& restore
+    ) {
+        std::vector<EntityId> emptiedEntities;
+        for (auto& pair : m_entities) {
+            ComponentSignature stale = pair.second;
+            auto iter = restore.m_restored.find(pair.first);
+            if (iter != restore.m_restored.end()) {
+                stale &= ~iter->second;
+            }
+            if (stale.none()) {
+                continue;
+            }
+            for (std::size_t bit = 0; bit < m_collectionsByBit.size(); ++bit) {
+                if (stale.test(bit)) {
+                    m_removalBatches[bit].push_back(pair.first);
+                }
+            }
+            pair.second &= ~stale;
+            if (pair.second.none()) {
+                emptiedEntities.push_back(pair.first);
+            }
+        }
+        this->flushRemovalBatches();
+        for (EntityId entityId : emptiedEntities) {
+            m_entities.erase(entityId);
+        }
+    }
+
+    Component*
+    restoreComponent(
+        EntityManager& entityManager,
+        const ComponentFactory& factory,
+        const std::string& typeName,
+        const StorageContainer& storage
+    ) {
+        auto component = factory.load(typeName, storage);
+        if (not component) {
+            std::cerr << "Unknown component type: " << typeName << std::endl;
+            return nullptr;
+        }
+        EntityId owner = component->owner();
+        if (owner == NULL_ENTITY) {
+            std::cerr << "Component with no entity: " << typeName << std::endl;
+            return nullptr;
+        }
+        this->adoptId(owner);
+        return entityManager.addComponent(owner, std::move(component));
+    }
+
+    void
+    restoreFreeId(
+        EntityId id
+    ) {
+        this->adoptId(id);
+        m_freeIndices.push_back(entityIndex(id));
+    }
+
+    void
+    restoreNextIndex(
+        EntityId nextIndex
+    ) {
+        if (nextIndex == NULL_ENTITY or nextIndex > ENTITY_INDEX_MASK + 1) {
+            throw std::runtime_error("Savegame has too many entities");
+        }
+        if (nextIndex < m_nextIndex) {
+            // Some entity read earlier has an index beyond it
+            throw std::runtime_error("Invalid entity id in savegame");
+        }
+        m_hasNextIndex = true;
+        m_nextIndex = nextIndex;
+        m_generations.resize(nextIndex, 0);
+    }
+
+    ComponentTypeId
+    tagTypeId(
+        const ComponentFactory& factory,
+        const std::string& typeName
+    ) const {
+        ComponentTypeId typeId = factory.getTypeId(typeName);
+        if (not ComponentFactory::isTagType(typeId)) {
+            std::cerr << "Unknown tag: " << typeName << std::endl;
+            return NULL_COMPONENT_TYPE;
+        }
+        return typeId;
+    }
+
     std::unordered_map<
         ComponentTypeId, 
         std::unique_ptr<ComponentCollection>
     > m_collections;
 
+    // Indexed by signature bit
+    std::vector<ComponentCollection*> m_collectionsByBit;
+
     std::list<std::pair<EntityId, ComponentTypeId>> m_componentsToRemove;
 
-    EntityId m_currentId = NULL_ENTITY + 1;
+    bool m_deferChanges = false;
 
-    std::unordered_map<EntityId, uint16_t> m_entities;
+    SparseEntityMap<ComponentSignature> m_entities;
 
     std::list<EntityId> m_entitiesToRemove;
 
+    std::deque<EntityId> m_freeIndices;
+
+    // False while reading a savegame whose id allocation hasn't been read
+    // yet, see adoptId()
+    bool m_hasNextIndex = true;
+
+    // Current generation of each index, index 0 is NULL_ENTITY
+    std::vector<uint16_t> m_generations = std::vector<uint16_t>(1, 0);
+
+    mutable boost::mutex m_idMutex;
+
+    // Reverse of m_namedIds
+    std::unordered_map<EntityId, std::string> m_idNames;
+
     std::unordered_map<std::string, EntityId> m_namedIds;
 
-    std::unordered_set<EntityId> m_volatileEntities;
+    EntityId m_nextIndex = NULL_ENTITY + 1;
+
+    std::unordered_map<std::type_index, std::weak_ptr<EntityQuery>> m_queries;
+
+    // Entities to remove from each collection, indexed by signature bit
+    std::vector<std::vector<EntityId>> m_removalBatches;
+
+    // Guards the removal queues
+    boost::mutex m_removalMutex;
+
+    // Guards m_entities. Only held while the signatures are read or
+    // changed, never while callbacks run.
+    mutable boost::shared_mutex m_entitiesMutex;
+
+    // Serializes adding components and tags from concurrently updated
+    // systems, including the callbacks that triggers. Recursive, because
+    // callbacks may add components themselves.
+    boost::recursive_mutex m_structureMutex;
 
 };
 
 
+EntityQuery::~EntityQuery() {}
+
+
 EntityManager::EntityManager() 
   : m_impl(new Implementation())
 {
@@ -60,21 +590,44 @@ EntityManager::addComponent(
     EntityId entityId,
     std::unique_ptr<Component> component
 ) {
-    assert(entityId != NULL_ENTITY);
+    if (not m_impl->isCurrent(entityId)) {
+        throw std::runtime_error("Can't add a component to a destroyed or invalid entity");
+    }
     ComponentTypeId typeId = component->typeId();
+    // Systems updated concurrently may add components of different types,
+    // which still share the signatures and possibly entity filters
+    boost::lock_guard<boost::recursive_mutex> lock(m_impl->m_structureMutex);
     auto& componentCollection = m_impl->getComponentCollection(typeId);
     Component* rawComponent = component.get();
-    bool isNew = componentCollection.addComponent(
+    // Update the signature first, so that it is already up to date when
+    // the collection's callbacks run
+    m_impl->setSignatureBit(entityId, componentCollection.signatureBit());
+    componentCollection.addComponent(
         entityId, 
         std::move(component)
     );
-    if (isNew) {
-        m_impl->m_entities[entityId] += 1;
-    }
     return rawComponent;
 }
 
 
+bool
+EntityManager::addTag(
+    EntityId entityId,
+    ComponentTypeId typeId
+) {
+    if (not m_impl->isCurrent(entityId)) {
+        throw std::runtime_error("Can't add a tag to a destroyed or invalid entity");
+    }
+    boost::lock_guard<boost::recursive_mutex> lock(m_impl->m_structureMutex);
+    auto& collection = m_impl->getComponentCollection(typeId);
+    if (not collection.isTag()) {
+        throw std::runtime_error("Not a tag type");
+    }
+    m_impl->setSignatureBit(entityId, collection.signatureBit());
+    return collection.addTag(entityId);
+}
+
+
 void
 EntityManager::clear() {
     for (auto& pair : m_impl->m_collections) {
@@ -83,13 +636,35 @@ EntityManager::clear() {
     m_impl->m_componentsToRemove.clear();
     m_impl->m_entities.clear();
     m_impl->m_entitiesToRemove.clear();
+    m_impl->m_idNames.clear();
     m_impl->m_namedIds.clear();
-    m_impl->m_volatileEntities.clear();
+}
+
+
+std::vector<ComponentCollection::Statistics>
+EntityManager::componentStatistics() const {
+    std::vector<ComponentCollection::Statistics> statistics;
+    statistics.reserve(m_impl->m_collectionsByBit.size());
+    for (const ComponentCollection* collection : m_impl->m_collectionsByBit) {
+        statistics.push_back(collection->statistics());
+    }
+    return statistics;
+}
+
+
+void
+EntityManager::createCollections(
+    const ComponentFactory& factory
+) {
+    for (ComponentTypeId typeId : factory.typeIds()) {
+        m_impl->getComponentCollection(typeId);
+    }
 }
 
 
 std::unordered_set<EntityId>
 EntityManager::entities() {
+    boost::shared_lock<boost::shared_mutex> lock(m_impl->m_entitiesMutex);
     std::unordered_set<EntityId> entities;
     for (const auto& pair : m_impl->m_entities) {
         entities.insert(pair.first);
@@ -98,17 +673,48 @@ EntityManager::entities() {
 }
 
 
+std::size_t
+EntityManager::entityCount() const {
+    boost::shared_lock<boost::shared_mutex> lock(m_impl->m_entitiesMutex);
+    return m_impl->m_entities.size();
+}
+
+
 bool
 EntityManager::exists(
     EntityId entityId
 ) const {
-    return m_impl->m_entities.find(entityId) != m_impl->m_entities.end();
+    boost::shared_lock<boost::shared_mutex> lock(m_impl->m_entitiesMutex);
+    return m_impl->m_entities.count(entityId) > 0;
+}
+
+
+void
+EntityManager::flushChanges() {
+    for (ComponentCollection* collection : m_impl->m_collectionsByBit) {
+        collection->flushChanges();
+    }
 }
 
 
 EntityId
 EntityManager::generateNewId() {
-    return m_impl->m_currentId++;
+    boost::lock_guard<boost::mutex> lock(m_impl->m_idMutex);
+    return m_impl->generateNewId();
+}
+
+
+std::vector<EntityId>
+EntityManager::generateNewIds(
+    std::size_t count
+) {
+    std::vector<EntityId> entityIds;
+    entityIds.reserve(count);
+    boost::lock_guard<boost::mutex> lock(m_impl->m_idMutex);
+    for (std::size_t i = 0; i < count; ++i) {
+        entityIds.push_back(m_impl->generateNewId());
+    }
+    return entityIds;
 }
 
 
@@ -117,8 +723,14 @@ EntityManager::getComponent(
     EntityId entityId,
     ComponentTypeId typeId
 ) {
-    auto& componentCollection = m_impl->getComponentCollection(typeId);
-    return componentCollection[entityId];
+    // Don't create missing collections, this may be called from 
+    // concurrently running systems. Without that, the collections only 
+    // change between updates and need no lock.
+    auto iter = m_impl->m_collections.find(typeId);
+    if (iter == m_impl->m_collections.end()) {
+        return nullptr;
+    }
+    return (*iter->second)[entityId];
 }
 
 
@@ -140,17 +752,117 @@ EntityManager::getNamedId(
     }
     else {
         EntityId newId = this->generateNewId();
-        m_impl->m_namedIds.insert(iter, std::make_pair(name, newId));
+        m_impl->nameId(name, newId);
         return newId;
     }
 }
 
 
+std::shared_ptr<EntityQuery>
+EntityManager::getOrCreateQuery(
+    std::type_index key,
+    const std::function<std::shared_ptr<EntityQuery>()>& create
+) {
+    auto iter = m_impl->m_queries.find(key);
+    if (iter != m_impl->m_queries.end()) {
+        std::shared_ptr<EntityQuery> query = iter->second.lock();
+        if (query) {
+            return query;
+        }
+    }
+    std::shared_ptr<EntityQuery> query = create();
+    m_impl->m_queries[key] = query;
+    return query;
+}
+
+
+std::vector<EntityId>
+EntityManager::instantiate(
+    const Prefab& prefab,
+    std::size_t count,
+    const std::function<void(EntityId)>& initializer
+) {
+    std::vector<EntityId> entityIds;
+    if (count == 0) {
+        return entityIds;
+    }
+    // The first clone of each prototype tells us its collection
+    std::vector<std::unique_ptr<Component>> firstComponents = prefab.createComponents();
+    std::unordered_set<ComponentTypeId> typeIds;
+    for (const auto& component : firstComponents) {
+        if (not typeIds.insert(component->typeId()).second) {
+            throw std::runtime_error("Prefab contains several components of the same type");
+        }
+    }
+    entityIds = this->generateNewIds(count);
+    // Keeps concurrently running systems from adding components before
+    // the new entities are complete
+    boost::lock_guard<boost::recursive_mutex> lock(m_impl->m_structureMutex);
+    std::vector<ComponentCollection*> collections;
+    collections.reserve(firstComponents.size());
+    for (std::size_t index = 0; index < firstComponents.size(); ++index) {
+        auto& collection = m_impl->getComponentCollection(
+            firstComponents[index]->typeId()
+        );
+        std::vector<std::pair<EntityId, std::unique_ptr<Component>>> components;
+        components.reserve(count);
+        components.emplace_back(entityIds.front(), std::move(firstComponents[index]));
+        for (std::size_t i = 1; i < count; ++i) {
+            components.emplace_back(entityIds[i], prefab.createComponent(index));
+        }
+        {
+            boost::unique_lock<boost::shared_mutex> entitiesLock(m_impl->m_entitiesMutex);
+            for (EntityId entityId : entityIds) {
+                m_impl->m_entities[entityId].set(collection.signatureBit());
+            }
+        }
+        collection.addNewComponents(std::move(components));
+        collections.push_back(&collection);
+    }
+    if (initializer) {
+        for (EntityId entityId : entityIds) {
+            initializer(entityId);
+        }
+    }
+    // One notification per collection, for all new entities
+    for (ComponentCollection* collection : collections) {
+        collection->notifyNewComponents(entityIds);
+    }
+    return entityIds;
+}
+
+
+bool
+EntityManager::hasTag(
+    EntityId entityId,
+    ComponentTypeId typeId
+) const {
+    auto collectionIter = m_impl->m_collections.find(typeId);
+    if (collectionIter == m_impl->m_collections.end()) {
+        return false;
+    }
+    boost::shared_lock<boost::shared_mutex> lock(m_impl->m_entitiesMutex);
+    auto iter = m_impl->m_entities.find(entityId);
+    return
+        iter != m_impl->m_entities.end() and
+        iter->second.test(collectionIter->second->signatureBit())
+    ;
+}
+
+
+bool
+EntityManager::isCurrent(
+    EntityId entityId
+) const {
+    return m_impl->isCurrent(entityId);
+}
+
+
 bool
 EntityManager::isVolatile(
     EntityId id
 ) const {
-    return m_impl->m_volatileEntities.count(id) > 0;
+    return this->hasTag(id, VolatileTag::TYPE_ID);
 }
 
 
@@ -168,37 +880,97 @@ EntityManager::nonEmptyCollections() const {
 
 void
 EntityManager::processRemovals() {
+    // Components
+    std::vector<EntityId> emptiedEntities;
     for (const auto& pair : m_impl->m_componentsToRemove) {
         EntityId entityId = pair.first;
         ComponentTypeId typeId = pair.second;
-        auto& componentCollection = m_impl->getComponentCollection(typeId);
-        bool removed = componentCollection.removeComponent(entityId);
-        if (removed) {
-            auto iter = m_impl->m_entities.find(entityId);
-            iter->second -= 1;
-            if (iter->second == 0) {
-                m_impl->m_entities.erase(iter);
-            }
-            else {
-                assert(iter->second > 0 && "Removed component from non-existent entity");
-            }
+        auto iter = m_impl->m_entities.find(entityId);
+        auto collectionIter = m_impl->m_collections.find(typeId);
+        if (
+            iter == m_impl->m_entities.end() or 
+            collectionIter == m_impl->m_collections.end()
+        ) {
+            continue;
+        }
+        std::size_t signatureBit = collectionIter->second->signatureBit();
+        if (not iter->second.test(signatureBit)) {
+            continue;
+        }
+        // Clear the bit right away, so that the signature is already up 
+        // to date when the collection's callbacks run
+        iter->second.reset(signatureBit);
+        m_impl->m_removalBatches[signatureBit].push_back(entityId);
+        if (iter->second.none()) {
+            emptiedEntities.push_back(entityId);
         }
     }
     m_impl->m_componentsToRemove.clear();
+    m_impl->flushRemovalBatches();
+    for (EntityId entityId : emptiedEntities) {
+        m_impl->m_entities.erase(entityId);
+    }
+    // Entities
+    for (EntityId entityId : m_impl->m_entitiesToRemove) {
+        auto iter = m_impl->m_entities.find(entityId);
+        if (iter == m_impl->m_entities.end()) {
+            continue;
+        }
+        // Only visit the collections the entity has components in
+        const ComponentSignature& signature = iter->second;
+        for (std::size_t bit = 0; bit < m_impl->m_collectionsByBit.size(); ++bit) {
+            if (signature.test(bit)) {
+                m_impl->m_removalBatches[bit].push_back(entityId);
+            }
+        }
+        m_impl->m_entities.erase(entityId);
+    }
+    m_impl->flushRemovalBatches();
+    // Report deferred changes before any ids are recycled
+    this->flushChanges();
     for (EntityId entityId : m_impl->m_entitiesToRemove) {
-        for (const auto& pair : m_impl->m_collections) {
-            pair.second->removeComponent(entityId);
+        // Skips duplicates and entities destroyed in an earlier frame
+        if (m_impl->isCurrent(entityId)) {
+            m_impl->releaseId(entityId);
         }
     }
     m_impl->m_entitiesToRemove.clear();
 }
 
 
+void
+EntityManager::read(
+    StorageReader& reader,
+    const ComponentFactory& factory
+) {
+    // Report what happened so far before anything is restored
+    this->flushChanges();
+    m_impl->m_componentsToRemove.clear();
+    m_impl->m_entitiesToRemove.clear();
+    m_impl->m_idNames.clear();
+    m_impl->m_namedIds.clear();
+    std::vector<uint16_t> previousGenerations = m_impl->m_generations;
+    m_impl->resetIds();
+    // Notify filters once about all restored components
+    bool deferChanges = m_impl->m_deferChanges;
+    this->setDeferChanges(true);
+    try {
+        m_impl->read(*this, reader, factory, std::move(previousGenerations));
+    }
+    catch (...) {
+        this->setDeferChanges(deferChanges);
+        throw;
+    }
+    this->setDeferChanges(deferChanges);
+}
+
+
 void
 EntityManager::removeComponent(
     EntityId entityId,
     ComponentTypeId typeId
 ) {
+    boost::lock_guard<boost::mutex> lock(m_impl->m_removalMutex);
     m_impl->m_componentsToRemove.emplace_back(entityId, typeId);
 }
 
@@ -206,24 +978,75 @@ void
 EntityManager::removeEntity(
     EntityId entityId
 ) {
+    boost::lock_guard<boost::mutex> lock(m_impl->m_removalMutex);
     m_impl->m_entitiesToRemove.push_back(entityId);
 }
 
 
+bool
+EntityManager::removeTag(
+    EntityId entityId,
+    ComponentTypeId typeId
+) {
+    {
+        boost::shared_lock<boost::shared_mutex> lock(m_impl->m_entitiesMutex);
+        auto collectionIter = m_impl->m_collections.find(typeId);
+        auto iter = m_impl->m_entities.find(entityId);
+        if (
+            iter == m_impl->m_entities.end() or
+            collectionIter == m_impl->m_collections.end()
+        ) {
+            return false;
+        }
+        const ComponentCollection& collection = *collectionIter->second;
+        if (not collection.isTag()) {
+            throw std::runtime_error("Not a tag type");
+        }
+        if (not iter->second.test(collection.signatureBit())) {
+            return false;
+        }
+    }
+    // Like components, tags are removed in processRemovals() so that
+    // entity filters don't change while systems iterate over them
+    this->removeComponent(entityId, typeId);
+    return true;
+}
+
+
 void
 EntityManager::restore(
     const StorageContainer& storage,
     const ComponentFactory& factory
 ) {
     this->clear();
-    // Current Id
-    m_impl->m_currentId = storage.get<EntityId>("currentId");
+    m_impl->resetIds();
+    // Notify filters once about all restored components
+    bool deferChanges = m_impl->m_deferChanges;
+    this->setDeferChanges(true);
+    // Id allocation
+    EntityId nextIndex = NULL_ENTITY + 1;
+    if (storage.contains("nextIndex")) {
+        nextIndex = storage.get<EntityId>("nextIndex");
+    }
+    else {
+        // Savegames from before generational ids: all ids are 
+        // indices of the first generation
+        nextIndex = storage.get<EntityId>("currentId");
+    }
+    m_impl->restoreNextIndex(nextIndex);
+    if (storage.contains("freeIds")) {
+        StorageList freeIds = storage.get<StorageList>("freeIds");
+        for (const auto& entry : freeIds) {
+            m_impl->restoreFreeId(entry.get<EntityId>("id"));
+        }
+    }
     // Named entities
     StorageList namedIds = storage.get<StorageList>("namedIds");
     for (const auto& entry : namedIds) {
         std::string name = entry.get<std::string>("name");
         EntityId id = entry.get<EntityId>("entityId");
-        m_impl->m_namedIds[name] = id;
+        m_impl->adoptId(id);
+        m_impl->nameId(name, id);
     }
     // Collections
     StorageContainer collections = storage.get<StorageContainer>("collections");
@@ -231,12 +1054,23 @@ EntityManager::restore(
     for (const std::string& typeName : typeNames) {
         StorageList componentList = collections.get<StorageList>(typeName);
         for (const StorageContainer& componentStorage : componentList) {
-            auto component = factory.load(typeName, componentStorage);
-            EntityId owner = component->owner();
-            if (owner == NULL_ENTITY) {
-                std::cerr << "Component with no entity: " << typeName << std::endl;
+            m_impl->restoreComponent(*this, factory, typeName, componentStorage);
+        }
+    }
+    // Tags, savegames from before tags have none
+    if (storage.contains("tags")) {
+        StorageContainer tags = storage.get<StorageContainer>("tags");
+        for (const std::string& typeName : tags.keys()) {
+            ComponentTypeId typeId = m_impl->tagTypeId(factory, typeName);
+            if (typeId == NULL_COMPONENT_TYPE) {
+                continue;
+            }
+            StorageList tagList = tags.get<StorageList>(typeName);
+            for (const StorageContainer& entry : tagList) {
+                EntityId entityId = entry.get<EntityId>("id");
+                m_impl->adoptId(entityId);
+                this->addTag(entityId, typeId);
             }
-            this->addComponent(owner, std::move(component));
         }
     }
     // Components to remove
@@ -253,6 +1087,31 @@ EntityManager::restore(
         EntityId entityId = entry.get<EntityId>("id");
         this->removeEntity(entityId);
     }
+    this->setDeferChanges(deferChanges);
+}
+
+
+ComponentSignature
+EntityManager::signature(
+    EntityId entityId
+) const {
+    boost::shared_lock<boost::shared_mutex> lock(m_impl->m_entitiesMutex);
+    auto iter = m_impl->m_entities.find(entityId);
+    if (iter == m_impl->m_entities.end()) {
+        return ComponentSignature();
+    }
+    return iter->second;
+}
+
+
+void
+EntityManager::setDeferChanges(
+    bool deferChanges
+) {
+    m_impl->m_deferChanges = deferChanges;
+    for (ComponentCollection* collection : m_impl->m_collectionsByBit) {
+        collection->setDeferChanges(deferChanges);
+    }
 }
 
 
@@ -262,10 +1121,10 @@ EntityManager::setVolatile(
     bool isVolatile
 ) {
     if (isVolatile) {
-        m_impl->m_volatileEntities.insert(id);
+        this->addTag<VolatileTag>(id);
     }
     else {
-        m_impl->m_volatileEntities.erase(id);
+        this->removeTag<VolatileTag>(id);
     }
 }
 
@@ -274,62 +1133,121 @@ StorageContainer
 EntityManager::storage(
     const ComponentFactory& factory
 ) const {
+    std::stringstream stream(std::stringstream::in | std::stringstream::out | std::stringstream::binary);
+    StorageWriter writer(stream);
+    this->write(writer, factory);
+    writer.finish();
     StorageContainer storage;
-    // Current Id
-    storage.set("currentId", m_impl->m_currentId);
+    stream >> storage;
+    return storage;
+}
+
+
+void
+EntityManager::write(
+    StorageWriter& writer,
+    const ComponentFactory& factory
+) const {
+    // Id allocation
+    writer.set("nextIndex", m_impl->m_nextIndex);
+    writer.beginList("freeIds");
+    for (EntityId index : m_impl->m_freeIndices) {
+        writer.beginElement();
+        writer.set("id", makeEntityId(index, m_impl->m_generations[index]));
+        writer.end();
+    }
+    writer.end();
+    // Named entities
+    writer.beginList("namedIds");
+    for (const auto& item : m_impl->m_namedIds) {
+        writer.beginElement();
+        writer.set("name", item.first);
+        writer.set("entityId", item.second);
+        writer.end();
+    }
+    writer.end();
+    // Checked for every component, so look the tag's collection up once
+    auto volatileIter = m_impl->m_collections.find(VolatileTag::TYPE_ID);
+    bool hasVolatileEntities =
+        volatileIter != m_impl->m_collections.end() and
+        not volatileIter->second->empty()
+    ;
+    std::size_t volatileBit =
+        hasVolatileEntities ? volatileIter->second->signatureBit() : 0;
+    auto isVolatile = [this, hasVolatileEntities, volatileBit](EntityId entityId) {
+        if (not hasVolatileEntities) {
+            return false;
+        }
+        auto iter = m_impl->m_entities.find(entityId);
+        return iter != m_impl->m_entities.end() and iter->second.test(volatileBit);
+    };
     // Collections
-    StorageContainer collections;
+    writer.beginContainer("collections");
     for (const auto& item : m_impl->m_collections) {
-        const auto& components = item.second->components();
-        StorageList componentList;
-        componentList.reserve(components.size());
-        for (const auto& pair : components) {
+        if (item.second->isTag()) {
+            continue;
+        }
+        bool isEmpty = true;
+        for (const auto& pair : item.second->components()) {
             EntityId entityId = pair.first;
             const std::unique_ptr<Component>& component = pair.second;
-            if (component->isVolatile() or 
-                m_impl->m_volatileEntities.count(entityId) > 0
-            ) {
+            if (component->isVolatile() or isVolatile(entityId)) {
                 continue;
             }
-            componentList.append(component->storage());
+            if (isEmpty) {
+                writer.beginList(factory.getTypeName(item.first));
+                isEmpty = false;
+            }
+            writer.beginElement();
+            component->write(writer);
+            writer.end();
         }
-        if (not componentList.empty()) {
-            std::string typeName = factory.getTypeName(item.first);
-            collections.set(typeName, std::move(componentList));
+        if (not isEmpty) {
+            writer.end();
         }
     }
-    storage.set("collections", std::move(collections));
+    writer.end();
+    // Tags
+    writer.beginContainer("tags");
+    for (const auto& item : m_impl->m_collections) {
+        if (not item.second->isTag() or item.first == VolatileTag::TYPE_ID) {
+            continue;
+        }
+        bool isEmpty = true;
+        for (const auto& pair : item.second->components()) {
+            if (isVolatile(pair.first)) {
+                continue;
+            }
+            if (isEmpty) {
+                writer.beginList(factory.getTypeName(item.first));
+                isEmpty = false;
+            }
+            writer.beginElement();
+            writer.set("id", pair.first);
+            writer.end();
+        }
+        if (not isEmpty) {
+            writer.end();
+        }
+    }
+    writer.end();
     // Components to remove
-    StorageList componentsToRemove;
-    componentsToRemove.reserve(m_impl->m_componentsToRemove.size());
+    writer.beginList("componentsToRemove");
     for (const auto& pair : m_impl->m_componentsToRemove) {
-        StorageContainer pairStorage;
-        pairStorage.set("entityId", pair.first);
-        std::string typeName = factory.getTypeName(pair.second);
-        pairStorage.set("componentTypeName", typeName);
-        componentsToRemove.append(std::move(pairStorage));
+        writer.beginElement();
+        writer.set("entityId", pair.first);
+        writer.set("componentTypeName", factory.getTypeName(pair.second));
+        writer.end();
     }
-    storage.set("componentsToRemove", std::move(componentsToRemove));
+    writer.end();
     // Entities to remove
-    StorageList entitiesToRemove;
-    entitiesToRemove.reserve(m_impl->m_entitiesToRemove.size());
+    writer.beginList("entitiesToRemove");
     for (EntityId entityId : m_impl->m_entitiesToRemove) {
-        StorageContainer idStorage;
-        idStorage.set("id", entityId);
-        entitiesToRemove.append(std::move(idStorage));
+        writer.beginElement();
+        writer.set("id", entityId);
+        writer.end();
     }
-    storage.set("entitiesToRemove", std::move(entitiesToRemove));
-    // Named entities
-    StorageList namedIds;
-    namedIds.reserve(m_impl->m_namedIds.size());
-    for (const auto& item : m_impl->m_namedIds) {
-        StorageContainer itemStorage;
-        itemStorage.set("name", item.first);
-        itemStorage.set("entityId", item.second);
-        namedIds.append(std::move(itemStorage));
-    }
-    storage.set("namedIds", std::move(namedIds));
-    return storage;
+    writer.end();
 }
 
 
@@ -1,23 +1,58 @@
 #pragma once
 
+#include "engine/component_collection.h"
+#include "engine/tag.h"
 #include "engine/typedefs.h"
 #include "util/make_unique.h"
 
+#include <functional>
 #include <memory>
+#include <typeindex>
 #include <unordered_set>
+#include <vector>
 
 namespace thrive {
 
 class Component;
-class ComponentCollection;
 class ComponentFactory;
+class Prefab;
 class StorageContainer;
+class StorageReader;
+class StorageWriter;
+
+/**
+* @brief Base class for state shared by entity filters
+*
+* @see EntityManager::getOrCreateQuery()
+*/
+class EntityQuery {
+
+public:
+
+    /**
+    * @brief Destructor
+    */
+    virtual ~EntityQuery() = 0;
+
+};
+
+/**
+* @brief Built-in tag of entities that are not serialized into a savegame
+*
+* @see EntityManager::setVolatile()
+*/
+class VolatileTag {
+    TAG(VolatileTag)
+};
 
 /**
 * @brief Manages entities and their components
 *
 * The entity manager holds a collection of Component objects, sorted by type
 * and entity.
+*
+* Tags (see TAG) are handled like components without data. An entity with
+* only tags still exists.
 */
 class EntityManager {
 
@@ -44,8 +79,15 @@ public:
     * @return
     *   The component as a non-owning pointer
     *
+    * @throws std::runtime_error if \a entityId has been destroyed or was
+    *   not generated by this manager
+    *
     * @note:
     *   Use the templated version to receive the proper type back
+    *
+    * @note
+    *   Systems updated concurrently may add components of the types they
+    *   declared as written (see System::writesComponent()).
     */
     Component*
     addComponent(
@@ -82,6 +124,48 @@ public:
         );
     }
 
+    /**
+    * @brief Adds a tag
+    *
+    * The tag takes effect immediately, like addComponent().
+    *
+    * @param entityId
+    *   The entity to tag
+    * @param typeId
+    *   The tag's type id, see ComponentFactory::isTagType()
+    *
+    * @return
+    *   \c true if the tag is new, \c false if the entity already had it
+    *
+    * @throws std::runtime_error if \a entityId has been destroyed or was
+    *   not generated by this manager
+    */
+    bool
+    addTag(
+        EntityId entityId,
+        ComponentTypeId typeId
+    );
+
+    /**
+    * @brief Adds a tag
+    *
+    * @tparam T
+    *   The tag's class, declared with TAG
+    *
+    * @param entityId
+    *   The entity to tag
+    *
+    * @return
+    *   \c true if the tag is new, \c false if the entity already had it
+    */
+    template<typename T>
+    bool
+    addTag(
+        EntityId entityId
+    ) {
+        return this->addTag(entityId, T::TYPE_ID);
+    }
+
     /**
     * @brief Removes all components
     *
@@ -90,22 +174,95 @@ public:
     void
     clear();
 
+    /**
+    * @brief Population and memory figures of all component types
+    *
+    * Not thread safe, call it between frames.
+    *
+    * @return
+    *   One entry per component collection, in order of their creation
+    */
+    std::vector<ComponentCollection::Statistics>
+    componentStatistics() const;
+
+    /**
+    * @brief Creates the collections of all types known to a factory
+    *
+    * Lookups from concurrently updated systems (getComponent(), exists(),
+    * hasTag() and so on) don't lock the collections, so they must not be 
+    * created while systems are updated. GameState::init() calls this 
+    * after all scripts have registered their types.
+    *
+    * @param factory
+    *   The factory with the registered types
+    *
+    * @throws std::runtime_error if there are too many component types
+    */
+    void
+    createCollections(
+        const ComponentFactory& factory
+    );
+
     /**
     * @brief Returns a set of entity ids that have at least one components
     */
     std::unordered_set<EntityId>
     entities();
 
+    /**
+    * @brief The number of entities with at least one component
+    */
+    std::size_t
+    entityCount() const;
+
+    /**
+    * @brief Reports all deferred component changes to their callbacks
+    *
+    * Called automatically by processRemovals(), but can be used as an 
+    * explicit sync point.
+    *
+    * @see setDeferChanges()
+    */
+    void
+    flushChanges();
+
     /**
     * @brief Generates a new, unique entity id
     *
-    * This function is safe.
+    * An entity id consists of an index and a generation (see entityIndex()
+    * and entityGeneration()). The indices of destroyed entities are 
+    * recycled with an incremented generation, so an id held on to after
+    * its entity has been destroyed is never confused with a new entity.
+    *
+    * This function is thread safe.
     *
     * @return A new entity id
+    *
+    * @throws std::runtime_error if all indices are in use
     */
     EntityId
     generateNewId();
 
+    /**
+    * @brief Generates several new, unique entity ids at once
+    *
+    * Like generateNewId(), but takes the lock only once. Used by 
+    * EntityCommandBuffer to reserve ids in blocks.
+    *
+    * This function is thread safe.
+    *
+    * @param count
+    *   The number of ids to generate
+    *
+    * @return The new entity ids
+    *
+    * @throws std::runtime_error if all indices are in use
+    */
+    std::vector<EntityId>
+    generateNewIds(
+        std::size_t count
+    );
+
     /**
     * @brief Retrieves a component
     *
@@ -116,7 +273,11 @@ public:
     *
     * @return 
     *   A non-owning pointer to the component or \c nullptr if no such 
-    *   component exists
+    *   component exists or \a entityId is stale
+    *
+    * @note
+    *   This never creates a component collection and takes no lock, so 
+    *   it is cheap and safe to call from concurrently updated systems.
     */
     Component*
     getComponent(
@@ -158,6 +319,9 @@ public:
     /**
     * @brief Returns a component collection
     *
+    * Creates the collection if necessary, which is not thread safe (see
+    * createCollections()).
+    *
     * @param typeId
     *   The component type the collection is holding
     *
@@ -218,13 +382,41 @@ public:
         return component;
     }
 
+    /**
+    * @brief Returns a query from the query cache
+    *
+    * Entity filters watching the same components share one query, which
+    * holds the matching entities and is the only one registered with the
+    * component collections (see EntityFilter).
+    *
+    * The cache only holds weak references. A query is destroyed when the
+    * last filter using it is detached.
+    *
+    * Not thread safe. Filters are usually attached while initializing the
+    * systems.
+    *
+    * @param key
+    *   Identifies the query
+    * @param create
+    *   Creates the query if the cache has none for \a key
+    *
+    * @return
+    *   The cached or newly created query
+    */
+    std::shared_ptr<EntityQuery>
+    getOrCreateQuery(
+        std::type_index key,
+        const std::function<std::shared_ptr<EntityQuery>()>& create
+    );
+
     /**
     * @brief Checks whether an entity exists
     *
     * @param entityId
     *   The id to check for
     *
-    * @return \c true if the entity has at least one component, false otherwise
+    * @return \c true if the entity has at least one component, false 
+    *   otherwise or if \a entityId is stale
     */
     bool
     exists(
@@ -239,10 +431,87 @@ public:
     std::unordered_set<ComponentTypeId>
     nonEmptyCollections() const;
 
+    /**
+    * @brief Creates several entities from a prefab
+    *
+    * Each new entity receives a clone of every prototype in \a prefab.
+    * Change notifications are deferred until all entities have been
+    * created and initialized, so entity filters learn about all of them
+    * in one batch (or with the next flush, if changes are deferred
+    * anyway).
+    *
+    * @param prefab
+    *   The prefab to clone
+    * @param count
+    *   The number of entities to create
+    * @param initializer
+    *   Called for each new entity after its components have been added
+    *   and before any filter is notified. May be empty.
+    *
+    * @return
+    *   The new entities, in the order they were created
+    */
+    std::vector<EntityId>
+    instantiate(
+        const Prefab& prefab,
+        std::size_t count,
+        const std::function<void(EntityId)>& initializer = nullptr
+    );
+
+    /**
+    * @brief Checks whether an entity has a tag
+    *
+    * This function is thread safe.
+    *
+    * @param entityId
+    *   The entity to check
+    * @param typeId
+    *   The tag's type id
+    */
+    bool
+    hasTag(
+        EntityId entityId,
+        ComponentTypeId typeId
+    ) const;
+
+    /**
+    * @brief Checks whether an entity has a tag
+    *
+    * @tparam T
+    *   The tag's class, declared with TAG
+    *
+    * @param entityId
+    *   The entity to check
+    */
+    template<typename T>
+    bool
+    hasTag(
+        EntityId entityId
+    ) const {
+        return this->hasTag(entityId, T::TYPE_ID);
+    }
+
+    /**
+    * @brief Whether an entity id has not been released yet
+    *
+    * Unlike exists(), this is also \c true for a new id that has no
+    * components yet.
+    *
+    * @param entityId
+    *   The id to check
+    *
+    * @return \c false if the entity has been destroyed
+    */
+    bool
+    isCurrent(
+        EntityId entityId
+    ) const;
+
     /**
     * @brief Returns the volatile flag for an entity
     *
-    * Volatile entities are not serialized into a savegame
+    * Volatile entities are not serialized into a savegame. The flag is the
+    * VolatileTag.
     *
     * @param id
     *
@@ -254,11 +523,42 @@ public:
     ) const;
 
     /**
-    * @brief Removes all components queued for removal
+    * @brief Removes all components and tags queued for removal
     */
     void
     processRemovals();
 
+    /**
+    * @brief Restores the entity manager from a savegame stream
+    *
+    * Reads the entries of the reader's current container, as written by
+    * write() or by serializing storage() with operator <<, and leaves it.
+    * The entries may come in any order. Components are loaded one at a 
+    * time, the savegame is never held in memory as a whole. Components
+    * that override Component::read() read their entries straight from the
+    * stream.
+    *
+    * The restore happens in place. Components that exist both now and in
+    * the savegame are kept and reloaded (see Component::read() and 
+    * Component::reload()), only
+    * the difference is added or removed. Entity filters therefore only 
+    * learn about the entities and components that actually changed.
+    * Pending removals are replaced by those of the savegame.
+    *
+    * @param reader
+    *   The reader, positioned in the container write() wrote to
+    * @param factory
+    *   The component factory to use
+    *
+    * @throws std::runtime_error if the container has no entity id 
+    *   allocation
+    */
+    void
+    read(
+        StorageReader& reader,
+        const ComponentFactory& factory
+    );
+
     /**
     * @brief Removes a component
     *
@@ -267,6 +567,8 @@ public:
     * To allow self-removing components such as script handles, the component
     * is only removed with the next call to EntityManager::processRemovals().
     *
+    * This function is thread safe.
+    *
     * @param entityId
     *   The component's owner
     * @param typeId
@@ -285,6 +587,10 @@ public:
     *
     * To allow self-removing components such as script handles, the component
     * is only removed with the next call to EntityManager::processRemovals().
+    * At that point, the entity's id becomes stale and its index is 
+    * eventually recycled. Its name, if any, is forgotten.
+    *
+    * This function is thread safe.
     *
     * @param entityId
     *   The entity to remove
@@ -294,9 +600,54 @@ public:
         EntityId entityId
     );
 
+    /**
+    * @brief Removes a tag
+    *
+    * Like components, the tag is only queued for removal and removed with
+    * the next call to processRemovals(). If the entity has nothing left
+    * then, it stops existing, but its id stays valid until it is removed
+    * with removeEntity().
+    *
+    * @param entityId
+    *   The tagged entity
+    * @param typeId
+    *   The tag's type id
+    *
+    * @return
+    *   \c true if the entity has the tag, \c false otherwise
+    */
+    bool
+    removeTag(
+        EntityId entityId,
+        ComponentTypeId typeId
+    );
+
+    /**
+    * @brief Removes a tag
+    *
+    * @tparam T
+    *   The tag's class, declared with TAG
+    *
+    * @param entityId
+    *   The tagged entity
+    *
+    * @return
+    *   \c true if the entity had the tag, \c false otherwise
+    */
+    template<typename T>
+    bool
+    removeTag(
+        EntityId entityId
+    ) {
+        return this->removeTag(entityId, T::TYPE_ID);
+    }
+
     /**
     * @brief Restores the entity manager from a storage container
     *
+    * Unlike read(), this clears the entity manager first and recreates
+    * all components.
+    *
     * @param storage
     *   The storage container to restore from
     * @param factory
@@ -308,9 +659,31 @@ public:
         const ComponentFactory& factory
     );
 
+    /**
+    * @brief Enables or disables deferred change notifications
+    *
+    * With deferred changes, adding or removing components takes effect
+    * immediately, but the component collections only notify their 
+    * callbacks (mainly entity filters) with the next flushChanges(),
+    * in sorted batches. This saves a lot of work when many components are
+    * added at once, but means that filters lag behind until the next 
+    * flush, which happens at least once per frame in processRemovals().
+    *
+    * Disabling deferred changes flushes any pending changes.
+    *
+    * @param deferChanges
+    */
+    void
+    setDeferChanges(
+        bool deferChanges
+    );
+
     /**
     * @brief Sets the volatile flag for an entity
     *
+    * Adds or removes the VolatileTag. Like any tag, it is only removed
+    * by the next processRemovals().
+    *
     * @param id
     * @param isVolatile
     */
@@ -320,9 +693,33 @@ public:
         bool isVolatile
     );
 
+    /**
+    * @brief Returns the component signature of an entity
+    *
+    * Bit \c n of the signature is set if the entity has a component in 
+    * the collection whose ComponentCollection::signatureBit() is \c n.
+    *
+    * The signature is updated before any callbacks of the affected 
+    * collection are called.
+    *
+    * @param entityId
+    *   The entity to query
+    *
+    * @return 
+    *   The entity's signature, or an empty signature if the entity has
+    *   no components
+    */
+    ComponentSignature
+    signature(
+        EntityId entityId
+    ) const;
+
     /**
     * @brief Serializes the current non-volatile components into a storage container
     *
+    * Builds the whole savegame in memory, prefer write() for saving to
+    * a file.
+    *
     * @param factory
     *   The component factory to use for type name lookup
     *
@@ -333,6 +730,23 @@ public:
         const ComponentFactory& factory
     ) const;
 
+    /**
+    * @brief Writes the current non-volatile components to a savegame stream
+    *
+    * Writes into the writer's current container, one component at a time
+    * with Component::write().
+    *
+    * @param writer
+    *   The writer to write to
+    * @param factory
+    *   The component factory to use for type name lookup
+    */
+    void
+    write(
+        StorageWriter& writer,
+        const ComponentFactory& factory
+    ) const;
+
 private:
 
     struct Implementation;
@@ -1,10 +1,14 @@
 #include "engine/game_state.h"
 
 #include "engine/engine.h"
+#include "engine/entity_command_buffer.h"
 #include "engine/entity_manager.h"
 #include "engine/serialization.h"
 #include "engine/system.h"
+#include "engine/system_scheduler.h"
+#include "engine/touchable.h"
 
+#include <algorithm>
 #include <btBulletDynamicsCommon.h>
 #include <OgreRoot.h>
 
@@ -24,6 +28,34 @@ struct GameState::Implementation {
     {
     }
 
+    struct Phase {
+
+        std::unique_ptr<SystemScheduler> scheduler;
+
+        std::vector<System*> systems;
+
+    };
+
+    void
+    runPhase(
+        Phase& phase,
+        int milliseconds
+    ) {
+        // All touches during this phase share one version
+        Touchable::advanceVersion();
+        phase.scheduler->update(
+            milliseconds,
+            m_engine.threadPool()
+        );
+        for (System* system : phase.systems) {
+            // Lua systems might not have called System.init
+            if (system->gameState()) {
+                system->commandBuffer().playback();
+            }
+        }
+        m_entityManager.processRemovals();
+    }
+
     void
     setupPhysics() {
         m_physics.collisionConfiguration.reset(new btDefaultCollisionConfiguration());
@@ -52,12 +84,19 @@ struct GameState::Implementation {
         );
     }
 
+    // Presentation systems declared before the last simulation system,
+    // such as input handling. They run before the simulation steps, so
+    // that each frame keeps the declared order.
+    Phase m_earlyPresentation;
+
     Engine& m_engine;
 
     EntityManager m_entityManager;
 
     Initializer m_initializer;
 
+    float m_interpolationFactor = 1.0f;
+
     std::string m_name;
 
     Ogre::SceneManager* m_sceneManager = nullptr;
@@ -76,6 +115,16 @@ struct GameState::Implementation {
 
     } m_physics;
 
+    // Presentation systems declared after the last simulation system
+    Phase m_presentation;
+
+    Phase m_simulation;
+
+    // Milliseconds of game time not simulated yet
+    int m_simulationLag = 0;
+
+    unsigned long long m_simulationStepCount = 0;
+
     std::vector<std::unique_ptr<System>> m_systems;
 
 };
@@ -141,9 +190,62 @@ void
 GameState::init() {
     m_impl->setupPhysics();
     m_impl->setupSceneManager();
-    for (const auto& system : m_impl->m_systems) {
+    if (m_impl->m_engine.headless()) {
+        auto& systems = m_impl->m_systems;
+        systems.erase(
+            std::remove_if(
+                systems.begin(),
+                systems.end(),
+                [](const std::unique_ptr<System>& system) {
+                    return not system->runsHeadless();
+                }
+            ),
+            systems.end()
+        );
+    }
+    std::size_t simulationEnd = 0;
+    for (std::size_t i = 0; i < m_impl->m_systems.size(); ++i) {
+        if (not m_impl->m_systems[i]->isPresentation()) {
+            simulationEnd = i + 1;
+        }
+    }
+    for (std::size_t i = 0; i < m_impl->m_systems.size(); ++i) {
+        System* system = m_impl->m_systems[i].get();
         system->init(this);
+        if (not system->isPresentation()) {
+            m_impl->m_simulation.systems.push_back(system);
+        }
+        else if (i < simulationEnd) {
+            m_impl->m_earlyPresentation.systems.push_back(system);
+        }
+        else {
+            m_impl->m_presentation.systems.push_back(system);
+        }
     }
+    // Create the collections of all registered types up front, so that 
+    // the entity manager's lookups need no lock while systems run
+    // concurrently
+    m_impl->m_entityManager.createCollections(
+        m_impl->m_engine.componentFactory()
+    );
+    m_impl->m_earlyPresentation.scheduler.reset(
+        new SystemScheduler(
+            m_impl->m_earlyPresentation.systems,
+            &m_impl->m_engine.profiler()
+        )
+    );
+    m_impl->m_simulation.scheduler.reset(
+        new SystemScheduler(
+            m_impl->m_simulation.systems,
+            &m_impl->m_engine.profiler()
+        )
+    );
+    m_impl->m_presentation.scheduler.reset(
+        new SystemScheduler(
+            m_impl->m_presentation.systems,
+            &m_impl->m_engine.profiler()
+        )
+    );
     m_impl->m_initializer();
 }
 
@@ -176,6 +278,45 @@ GameState::load(
 }
 
 
+void
+GameState::read(
+    StorageReader& reader
+) {
+    bool hasEntities = false;
+    while (reader.next()) {
+        if (reader.key() != "entities" or not reader.isContainer()) {
+            continue;
+        }
+        reader.enter();
+        hasEntities = true;
+        try {
+            m_impl->m_entityManager.read(
+                reader,
+                m_impl->m_engine.componentFactory()
+            );
+        }
+        catch (const luabind::error& e) {
+            luabind::object error_msg(luabind::from_stack(
+                e.state(),
+                -1
+            ));
+            // TODO: Log error
+            std::cerr << error_msg << std::endl;
+            throw;
+        }
+    }
+    if (not hasEntities) {
+        m_impl->m_entityManager.clear();
+    }
+}
+
+
+float
+GameState::interpolationFactor() const {
+    return m_impl->m_interpolationFactor;
+}
+
+
 std::string
 GameState::name() const {
     return m_impl->m_name;
@@ -194,8 +335,17 @@ GameState::sceneManager() const {
 }
 
 
+unsigned long long
+GameState::simulationStepCount() const {
+    return m_impl->m_simulationStepCount;
+}
+
+
 void
 GameState::shutdown() {
+    m_impl->m_earlyPresentation.scheduler.reset();
+    m_impl->m_presentation.scheduler.reset();
+    m_impl->m_simulation.scheduler.reset();
     for (const auto& system : m_impl->m_systems) {
         system->shutdown();
     }
@@ -233,10 +383,54 @@ void
 GameState::update(
     int milliseconds
 ) {
-    for(auto& system : m_impl->m_systems) {
-        if (system->enabled()) {
-            system->update(milliseconds);
+    m_impl->runPhase(m_impl->m_earlyPresentation, milliseconds);
+    int timestep = m_impl->m_engine.simulationTimestep();
+    if (timestep > 0) {
+        // Drop the time we can't catch up with in this frame
+        int maxLag = timestep * static_cast<int>(
+            m_impl->m_engine.maxSimulationSteps()
+        );
+        m_impl->m_simulationLag = std::min(
+            m_impl->m_simulationLag + milliseconds,
+            maxLag
+        );
+        while (m_impl->m_simulationLag >= timestep) {
+            m_impl->runPhase(m_impl->m_simulation, timestep);
+            m_impl->m_simulationLag -= timestep;
+            m_impl->m_simulationStepCount += 1;
         }
+        m_impl->m_interpolationFactor = 
+            static_cast<float>(m_impl->m_simulationLag) / timestep;
+    }
+    else {
+        m_impl->runPhase(m_impl->m_simulation, milliseconds);
+        m_impl->m_simulationLag = 0;
+        m_impl->m_simulationStepCount += 1;
+        m_impl->m_interpolationFactor = 1.0f;
+    }
+    m_impl->runPhase(m_impl->m_presentation, milliseconds);
+}
+
+
+void
+GameState::write(
+    StorageWriter& writer
+) const {
+    writer.beginContainer("entities");
+    try {
+        m_impl->m_entityManager.write(
+            writer,
+            m_impl->m_engine.componentFactory()
+        );
+    }
+    catch (const luabind::error& e) {
+        luabind::object error_msg(luabind::from_stack(
+            e.state(),
+            -1
+        ));
+        // TODO: Log error
+        std::cerr << error_msg << std::endl;
+        throw;
     }
-    m_impl->m_entityManager.processRemovals();
+    writer.end();
 }
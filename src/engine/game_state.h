@@ -18,6 +18,8 @@ namespace thrive {
 class Engine;
 class EntityManager;
 class StorageContainer;
+class StorageReader;
+class StorageWriter;
 class System;
 
 /**
@@ -105,6 +107,22 @@ public:
     const EntityManager&
     entityManager() const;
 
+    /**
+    * @brief How far the current frame is between the last two simulation steps
+    *
+    * With a fixed simulation timestep (see Engine::setSimulationTimestep()),
+    * frames usually fall between two simulation steps. Presentation systems 
+    * should show their entities at
+    * <tt>previous + (latest - previous) * interpolationFactor()</tt>, where
+    * \a previous and \a latest are the states after the last two simulation
+    * steps.
+    *
+    * @return
+    *   A value in <tt>[0, 1)</tt>. Always 1 with a variable timestep.
+    */
+    float
+    interpolationFactor() const;
+
     /**
     * @brief The game state's name
     *
@@ -125,6 +143,15 @@ public:
     Ogre::SceneManager*
     sceneManager() const;
 
+    /**
+    * @brief The number of simulation steps done so far
+    *
+    * Presentation systems can compare this to the value of the last frame
+    * to find out whether the simulation has advanced since.
+    */
+    unsigned long long
+    simulationStepCount() const;
+
     template<typename S>
     S*
     findSystem() {
@@ -181,7 +208,9 @@ private:
     /**
     * @brief Called by the engine to initialize the game state
     *
-    * Initializes all the systems in turn
+    * Initializes all the systems in turn. If the engine is headless, 
+    * systems that can't run headless are removed first (see 
+    * System::runsHeadless()).
     */
     void
     init();
@@ -201,6 +230,22 @@ private:
         const StorageContainer& storage
     );
 
+    /**
+    * @brief Called by the engine during streamed loading of a savegame
+    *
+    * Reads the entries of the reader's current container and leaves it.
+    * The entities are restored in place, see EntityManager::read().
+    *
+    * @param reader
+    *   The reader, positioned in the container GameState::write() wrote to
+    *
+    * @see GameState::write()
+    */
+    void
+    read(
+        StorageReader& reader
+    );
+
     /**
     * @brief Called by the engine to shut the game state down
     *
@@ -222,7 +267,16 @@ private:
     /**
     * @brief Called by the engine to update the game state
     *
-    * Updates all the systems in turn
+    * Updates the simulation systems, either once with \a milliseconds or 
+    * as many fixed simulation steps as have accumulated (see 
+    * Engine::setSimulationTimestep()). Presentation systems are updated
+    * once (see System::isPresentation()). Those declared before the last
+    * simulation system, such as input handling, are updated before the
+    * simulation, the others afterwards.
+    *
+    * Each update goes through a SystemScheduler, which runs independent
+    * systems concurrently. Afterwards, the systems' command buffers are
+    * played back in order and removals are processed.
     *
     * @param milliseconds
     *   The number of milliseconds of game time elapsed since the
@@ -233,6 +287,21 @@ private:
         int milliseconds
     );
 
+    /**
+    * @brief Called by the engine during streamed savegame creation
+    *
+    * Writes into the writer's current container.
+    *
+    * @param writer
+    *   The writer to write to
+    *
+    * @see GameState::read()
+    */
+    void
+    write(
+        StorageWriter& writer
+    ) const;
+
     struct Implementation;
     std::unique_ptr<Implementation> m_impl;
 
@@ -0,0 +1,35 @@
+#include "engine/json_util.h"
+
+#include <ostream>
+
+using namespace thrive;
+
+
+void
+thrive::writeJsonString(
+    std::ostream& stream,
+    const std::string& string
+) {
+    static const char* HEX_DIGITS = "0123456789abcdef";
+    stream << '"';
+    for (char c : string) {
+        switch (c) {
+            case '"':
+                stream << "\\\"";
+                break;
+            case '\\':
+                stream << "\\\\";
+                break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    stream << "\\u00"
+                        << HEX_DIGITS[(c >> 4) & 0xf]
+                        << HEX_DIGITS[c & 0xf];
+                }
+                else {
+                    stream << c;
+                }
+        }
+    }
+    stream << '"';
+}
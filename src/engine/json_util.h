@@ -0,0 +1,24 @@
+#pragma once
+
+#include <iosfwd>
+#include <string>
+
+namespace thrive {
+
+/**
+* @brief Writes a string as a quoted JSON string
+*
+* Escapes quotes, backslashes and control characters.
+*
+* @param stream
+*   The stream to write to
+* @param string
+*   The string to write
+*/
+void
+writeJsonString(
+    std::ostream& stream,
+    const std::string& string
+);
+
+}
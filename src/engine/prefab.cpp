@@ -0,0 +1,147 @@
+#include "engine/prefab.h"
+
+#include "engine/component_factory.h"
+#include "engine/engine.h"
+#include "engine/entity.h"
+#include "engine/entity_manager.h"
+#include "engine/game_state.h"
+#include "engine/serialization.h"
+#include "game.h"
+#include "scripting/luabind.h"
+
+#include <stdexcept>
+#include <unordered_map>
+
+using namespace thrive;
+
+
+static std::unordered_map<std::string, Prefab>&
+prefabRegistry() {
+    static std::unordered_map<std::string, Prefab> registry;
+    return registry;
+}
+
+
+static void
+Prefab_addComponent(
+    Prefab* self,
+    const Component* prototype
+) {
+    self->addComponent(
+        *prototype,
+        Game::instance().engine().componentFactory()
+    );
+}
+
+
+static void
+Prefab_instantiate(
+    const Prefab* self,
+    std::size_t count,
+    luabind::object initializer
+) {
+    EntityManager& entityManager = Game::instance().engine().currentGameState()->entityManager();
+    std::function<void(EntityId)> callback;
+    if (initializer) {
+        callback = [&initializer](EntityId entityId) {
+            initializer(Entity(entityId));
+        };
+    }
+    entityManager.instantiate(*self, count, callback);
+}
+
+
+static void
+Prefab_instantiateWithoutInitializer(
+    const Prefab* self,
+    std::size_t count
+) {
+    Prefab_instantiate(self, count, luabind::object());
+}
+
+
+luabind::scope
+Prefab::luaBindings() {
+    using namespace luabind;
+    return class_<Prefab>("Prefab")
+        .scope [
+            def("get", &Prefab::get),
+            def("registerPrefab", &Prefab::registerPrefab)
+        ]
+        .def(constructor<>())
+        .def("addComponent", &Prefab_addComponent)
+        .def("instantiate", &Prefab_instantiate)
+        .def("instantiate", &Prefab_instantiateWithoutInitializer)
+        .def("size", &Prefab::size)
+    ;
+}
+
+
+const Prefab&
+Prefab::get(
+    const std::string& name
+) {
+    auto iter = prefabRegistry().find(name);
+    if (iter == prefabRegistry().end()) {
+        throw std::runtime_error("Unknown prefab: " + name);
+    }
+    return iter->second;
+}
+
+
+void
+Prefab::registerPrefab(
+    const std::string& name,
+    const Prefab& prefab
+) {
+    prefabRegistry()[name] = prefab;
+}
+
+
+void
+Prefab::addComponent(
+    const Component& prototype,
+    const ComponentFactory& factory
+) {
+    std::string typeName = prototype.typeName();
+    if (factory.getTypeId(typeName) == NULL_COMPONENT_TYPE) {
+        throw std::runtime_error("Unknown component type in prefab: " + typeName);
+    }
+    StorageContainer storage = prototype.storage();
+    this->addPrototype([&factory, typeName, storage]() {
+        return factory.load(typeName, storage);
+    });
+}
+
+
+void
+Prefab::addPrototype(
+    Prototype prototype
+) {
+    m_prototypes.push_back(std::move(prototype));
+}
+
+
+std::unique_ptr<Component>
+Prefab::createComponent(
+    std::size_t index
+) const {
+    return m_prototypes.at(index)();
+}
+
+
+std::vector<std::unique_ptr<Component>>
+Prefab::createComponents() const {
+    std::vector<std::unique_ptr<Component>> components;
+    components.reserve(m_prototypes.size());
+    for (const Prototype& prototype : m_prototypes) {
+        components.push_back(prototype());
+    }
+    return components;
+}
+
+
+std::size_t
+Prefab::size() const {
+    return m_prototypes.size();
+}
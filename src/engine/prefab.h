@@ -0,0 +1,186 @@
+#pragma once
+
+#include "engine/component.h"
+#include "util/make_unique.h"
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace luabind {
+class scope;
+}
+
+namespace thrive {
+
+class ComponentFactory;
+
+/**
+* @brief A template for entities that share the same set of components
+*
+* A prefab holds one prototype per component. EntityManager::instantiate()
+* clones the prototypes for each new entity, adds them all at once and
+* notifies the entity filters with a single batch. This is much cheaper
+* than assembling many identical entities one component at a time.
+*
+* Prototypes added from C++ are cloned with the component's copy
+* constructor. Prototypes added from Lua are snapshots of the component's
+* storage(), loaded through the ComponentFactory for each clone. Either
+* way, the clones are allocated from the component type's pool.
+*
+* Prefabs can be registered under a name, so that they only need to be
+* built once.
+*
+* \code
+* Prefab particle;
+* particle.addComponent(make_unique<OgreSceneNodeComponent>());
+* particle.addComponent(make_unique<AgentComponent>());
+* entityManager.instantiate(particle, 100, [](EntityId entityId) {
+*     // Set up each particle
+* });
+* \endcode
+*/
+class Prefab {
+
+public:
+
+    /**
+    * @brief Creates a new clone of a prototype
+    */
+    using Prototype = std::function<std::unique_ptr<Component>()>;
+
+    /**
+    * @brief Lua bindings
+    *
+    * Exposes:
+    * - Prefab()
+    * - Prefab::addComponent(const Component&, const ComponentFactory&) as
+    *   \c addComponent(component), using the global engine's factory
+    * - \c instantiate(count, initializer): See EntityManager::instantiate().
+    *   Instantiates into the current game state and calls the optional
+    *   \a initializer with an Entity for each new entity.
+    * - Prefab::registerPrefab()
+    * - Prefab::get()
+    * - Prefab::size()
+    *
+    * @return
+    */
+    static luabind::scope
+    luaBindings();
+
+    /**
+    * @brief Retrieves a registered prefab
+    *
+    * @param name
+    *   The name the prefab has been registered under
+    *
+    * @throws std::runtime_error if no prefab is registered as \a name
+    */
+    static const Prefab&
+    get(
+        const std::string& name
+    );
+
+    /**
+    * @brief Registers a prefab under a name
+    *
+    * Replaces any prefab registered under the same name. Not thread safe,
+    * register prefabs during setup.
+    *
+    * @param name
+    *   The prefab's name
+    * @param prefab
+    *   The prefab to register, copied into the registry
+    */
+    static void
+    registerPrefab(
+        const std::string& name,
+        const Prefab& prefab
+    );
+
+    /**
+    * @brief Adds a prototype that is cloned by copy construction
+    *
+    * @tparam C
+    *   The component's class, must be copy constructible
+    *
+    * @param prototype
+    *   The prototype. The prefab takes ownership, further changes to it
+    *   affect all clones created afterwards.
+    */
+    template<typename C>
+    void
+    addComponent(
+        std::unique_ptr<C> prototype
+    ) {
+        std::shared_ptr<const C> shared(std::move(prototype));
+        this->addPrototype([shared]() {
+            return std::unique_ptr<Component>(make_unique<C>(*shared));
+        });
+    }
+
+    /**
+    * @brief Adds a prototype that is cloned through its storage
+    *
+    * Works for any component type the \a factory knows about, including
+    * those defined in Lua.
+    *
+    * @param prototype
+    *   The prototype. Only its current state is remembered.
+    * @param factory
+    *   The factory to load the clones with. Must outlive the prefab.
+    *
+    * @throws std::runtime_error if \a factory doesn't know the
+    *   prototype's type
+    */
+    void
+    addComponent(
+        const Component& prototype,
+        const ComponentFactory& factory
+    );
+
+    /**
+    * @brief Adds a custom prototype
+    *
+    * @param prototype
+    *   Returns a new component for each call
+    */
+    void
+    addPrototype(
+        Prototype prototype
+    );
+
+    /**
+    * @brief Clones one prototype
+    *
+    * @param index
+    *   The prototype's index, in the order they were added
+    */
+    std::unique_ptr<Component>
+    createComponent(
+        std::size_t index
+    ) const;
+
+    /**
+    * @brief Clones all prototypes once
+    *
+    * @return
+    *   One new component per prototype, in the order they were added
+    */
+    std::vector<std::unique_ptr<Component>>
+    createComponents() const;
+
+    /**
+    * @brief The number of prototypes
+    */
+    std::size_t
+    size() const;
+
+private:
+
+    std::vector<Prototype> m_prototypes;
+
+};
+
+}
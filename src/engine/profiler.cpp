@@ -0,0 +1,413 @@
+#include "engine/profiler.h"
+
+#include "engine/json_util.h"
+#include "scripting/luabind.h"
+
+#include <algorithm>
+#include <assert.h>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <stdexcept>
+#include <unordered_map>
+
+using namespace thrive;
+
+namespace {
+
+// Marks a slot whose sample is being written
+const std::uint64_t WRITING = std::numeric_limits<std::uint64_t>::max();
+
+// Marks a name without samples in the current frame
+const std::uint64_t NO_SAMPLE = std::numeric_limits<std::uint64_t>::max();
+
+const std::uint64_t NO_FRAME = std::numeric_limits<std::uint64_t>::max();
+
+// The fields are atomic, because a reader may copy them while a worker
+// overwrites them. m_sequence tells the reader whether that happened.
+struct Slot {
+
+    std::atomic<std::int64_t> m_begin{0};
+
+    std::atomic<std::int64_t> m_end{0};
+
+    std::atomic<std::uint64_t> m_frame{0};
+
+    std::atomic<Profiler::NameId> m_name{0};
+
+    // Index of the sample in this slot plus one, 0 while unused and WRITING
+    // while a sample is written. Readers compare it before and after
+    // copying the sample, so they skip samples that are overwritten in
+    // the meantime.
+    std::atomic<std::uint64_t> m_sequence{0};
+
+    std::atomic<std::uint32_t> m_thread{0};
+
+};
+
+// Sums up the samples of a name during the current frame
+struct NameTotal {
+
+    // Index of the name's first sample in this frame
+    std::atomic<std::uint64_t> m_firstSample{NO_SAMPLE};
+
+    std::atomic<std::int64_t> m_microseconds{0};
+
+};
+
+std::atomic<std::uint32_t> nextThreadIndex{0};
+
+std::uint32_t
+currentThreadIndex() {
+    static thread_local std::uint32_t threadIndex = nextThreadIndex++;
+    return threadIndex;
+}
+
+}
+
+struct Profiler::Implementation {
+
+    using Clock = std::chrono::steady_clock;
+
+    Implementation(
+        std::size_t capacity
+    ) : m_slots(capacity)
+    {
+    }
+
+    struct Budget {
+
+        std::string filename;
+
+        std::int64_t microseconds = 0;
+
+    } m_budget;
+
+    std::atomic<bool> m_enabled{true};
+
+    Clock::time_point m_epoch = Clock::now();
+
+    std::atomic<std::uint64_t> m_frame{0};
+
+    std::int64_t m_frameBegin = 0;
+
+    NameId m_frameName = 0;
+
+    // The totals of the last completed frame, see endFrame()
+    std::vector<std::pair<std::string, double>> m_frameTimes;
+
+    std::uint64_t m_frameTimesFrame = NO_FRAME;
+
+    std::unordered_map<std::string, NameId> m_nameIds;
+
+    // Indexed by name id. A deque, so that registering names doesn't move
+    // the atomics.
+    std::deque<NameTotal> m_nameTotals;
+
+    std::vector<std::string> m_names;
+
+    std::atomic<std::uint64_t> m_nextSample{0};
+
+    std::vector<Slot> m_slots;
+
+};
+
+
+// Returns the times of the last completed frame as an array of
+// { name = ..., milliseconds = ... } tables
+static luabind::object
+Profiler_frameTimes(
+    Profiler* self,
+    lua_State* L
+) {
+    luabind::object times = luabind::newtable(L);
+    if (self->frame() == 0) {
+        return times;
+    }
+    int index = 1;
+    for (const auto& pair : self->frameTimes(self->frame() - 1)) {
+        luabind::object entry = luabind::newtable(L);
+        entry["name"] = pair.first;
+        entry["milliseconds"] = pair.second;
+        times[index] = entry;
+        index += 1;
+    }
+    return times;
+}
+
+
+static void
+Profiler_writeChromeTrace(
+    Profiler* self,
+    const std::string& filename
+) {
+    self->writeChromeTrace(filename);
+}
+
+
+luabind::scope
+Profiler::luaBindings() {
+    using namespace luabind;
+    return class_<Profiler>("Profiler")
+        .def("enabled", &Profiler::enabled)
+        .def("frameTimes", Profiler_frameTimes)
+        .def("setEnabled", &Profiler::setEnabled)
+        .def("setFrameBudget", &Profiler::setFrameBudget)
+        .def("writeChromeTrace", Profiler_writeChromeTrace)
+    ;
+}
+
+
+Profiler::Profiler(
+    std::size_t capacity
+) : m_impl(new Implementation(capacity))
+{
+    assert(capacity > 0 && "Profiler needs room for at least one sample");
+    m_impl->m_frameName = this->registerName("Frame");
+}
+
+
+Profiler::~Profiler() {}
+
+
+void
+Profiler::beginFrame() {
+    for (NameTotal& total : m_impl->m_nameTotals) {
+        total.m_firstSample.store(NO_SAMPLE, std::memory_order_relaxed);
+        total.m_microseconds.store(0, std::memory_order_relaxed);
+    }
+    m_impl->m_frame += 1;
+    m_impl->m_frameBegin = this->now();
+}
+
+
+bool
+Profiler::enabled() const {
+    return m_impl->m_enabled;
+}
+
+
+void
+Profiler::endFrame() {
+    std::int64_t end = this->now();
+    this->record(m_impl->m_frameName, m_impl->m_frameBegin, end);
+    // Sum up the frame once, instead of scanning all samples whenever the
+    // frame's times are requested
+    std::vector<std::pair<std::uint64_t, NameId>> names;
+    for (NameId nameId = 0; nameId < m_impl->m_nameTotals.size(); ++nameId) {
+        std::uint64_t firstSample = m_impl->m_nameTotals[nameId].m_firstSample.load(std::memory_order_relaxed);
+        if (firstSample != NO_SAMPLE) {
+            names.emplace_back(firstSample, nameId);
+        }
+    }
+    std::sort(names.begin(), names.end());
+    m_impl->m_frameTimes.clear();
+    for (const auto& pair : names) {
+        std::int64_t microseconds = m_impl->m_nameTotals[pair.second].m_microseconds.load(std::memory_order_relaxed);
+        m_impl->m_frameTimes.emplace_back(this->name(pair.second), microseconds / 1000.0);
+    }
+    m_impl->m_frameTimesFrame = m_impl->m_frame;
+    auto& budget = m_impl->m_budget;
+    if (budget.microseconds > 0 and end - m_impl->m_frameBegin > budget.microseconds) {
+        budget.microseconds = 0;
+        try {
+            this->writeChromeTrace(budget.filename);
+            std::cerr << "Frame " << this->frame() << " exceeded its budget, trace written to " << budget.filename << std::endl;
+        }
+        catch (const std::runtime_error& e) {
+            std::cerr << e.what() << std::endl;
+        }
+    }
+}
+
+
+std::uint64_t
+Profiler::frame() const {
+    return m_impl->m_frame;
+}
+
+
+std::vector<std::pair<std::string, double>>
+Profiler::frameTimes(
+    std::uint64_t frame
+) const {
+    if (frame == m_impl->m_frameTimesFrame) {
+        return m_impl->m_frameTimes;
+    }
+    std::vector<std::pair<std::string, double>> times;
+    std::unordered_map<NameId, std::size_t> indices;
+    for (const Sample& sample : this->samples()) {
+        if (sample.frame != frame) {
+            continue;
+        }
+        auto iter = indices.find(sample.name);
+        if (iter == indices.end()) {
+            iter = indices.emplace(sample.name, times.size()).first;
+            times.emplace_back(this->name(sample.name), 0.0);
+        }
+        times[iter->second].second += (sample.end - sample.begin) / 1000.0;
+    }
+    return times;
+}
+
+
+const std::string&
+Profiler::name(
+    NameId nameId
+) const {
+    return m_impl->m_names.at(nameId);
+}
+
+
+std::int64_t
+Profiler::now() const {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        Implementation::Clock::now() - m_impl->m_epoch
+    ).count();
+}
+
+
+void
+Profiler::record(
+    NameId name,
+    std::int64_t begin,
+    std::int64_t end
+) {
+    if (not m_impl->m_enabled) {
+        return;
+    }
+    assert(name < m_impl->m_nameTotals.size() && "Unregistered sample name");
+    std::uint64_t index = m_impl->m_nextSample++;
+    NameTotal& total = m_impl->m_nameTotals[name];
+    total.m_microseconds.fetch_add(end - begin, std::memory_order_relaxed);
+    std::uint64_t firstSample = total.m_firstSample.load(std::memory_order_relaxed);
+    while (index < firstSample and not total.m_firstSample.compare_exchange_weak(
+        firstSample,
+        index,
+        std::memory_order_relaxed
+    )) {}
+    Slot& slot = m_impl->m_slots[index % m_impl->m_slots.size()];
+    // Claim the slot. Only a worker that is a whole buffer ahead or behind
+    // can compete for it, so this practically never spins.
+    std::uint64_t sequence = slot.m_sequence.load(std::memory_order_relaxed);
+    while (true) {
+        if (sequence == WRITING) {
+            sequence = slot.m_sequence.load(std::memory_order_relaxed);
+        }
+        else if (sequence > index + 1) {
+            // A newer sample is already there
+            return;
+        }
+        else if (slot.m_sequence.compare_exchange_weak(sequence, WRITING, std::memory_order_relaxed)) {
+            break;
+        }
+    }
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.m_begin.store(begin, std::memory_order_relaxed);
+    slot.m_end.store(end, std::memory_order_relaxed);
+    slot.m_frame.store(m_impl->m_frame, std::memory_order_relaxed);
+    slot.m_name.store(name, std::memory_order_relaxed);
+    slot.m_thread.store(currentThreadIndex(), std::memory_order_relaxed);
+    slot.m_sequence.store(index + 1, std::memory_order_release);
+}
+
+
+Profiler::NameId
+Profiler::registerName(
+    const std::string& name
+) {
+    auto iter = m_impl->m_nameIds.find(name);
+    if (iter != m_impl->m_nameIds.end()) {
+        return iter->second;
+    }
+    NameId nameId = static_cast<NameId>(m_impl->m_names.size());
+    m_impl->m_names.push_back(name);
+    m_impl->m_nameTotals.emplace_back();
+    m_impl->m_nameIds.emplace(name, nameId);
+    return nameId;
+}
+
+
+std::vector<Profiler::Sample>
+Profiler::samples() const {
+    std::uint64_t end = m_impl->m_nextSample;
+    std::uint64_t capacity = m_impl->m_slots.size();
+    std::uint64_t begin = end > capacity ? end - capacity : 0;
+    std::vector<Sample> samples;
+    samples.reserve(end - begin);
+    for (std::uint64_t index = begin; index < end; ++index) {
+        const Slot& slot = m_impl->m_slots[index % capacity];
+        if (slot.m_sequence.load(std::memory_order_acquire) != index + 1) {
+            continue;
+        }
+        Sample sample;
+        sample.begin = slot.m_begin.load(std::memory_order_relaxed);
+        sample.end = slot.m_end.load(std::memory_order_relaxed);
+        sample.frame = slot.m_frame.load(std::memory_order_relaxed);
+        sample.name = slot.m_name.load(std::memory_order_relaxed);
+        sample.thread = slot.m_thread.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.m_sequence.load(std::memory_order_relaxed) == index + 1) {
+            samples.push_back(sample);
+        }
+    }
+    return samples;
+}
+
+
+void
+Profiler::setEnabled(
+    bool enabled
+) {
+    m_impl->m_enabled = enabled;
+}
+
+
+void
+Profiler::setFrameBudget(
+    int milliseconds,
+    const std::string& filename
+) {
+    m_impl->m_budget.filename = filename;
+    m_impl->m_budget.microseconds = static_cast<std::int64_t>(milliseconds) * 1000;
+}
+
+
+void
+Profiler::writeChromeTrace(
+    std::ostream& stream
+) const {
+    stream << "{\"traceEvents\":[";
+    bool first = true;
+    for (const Sample& sample : this->samples()) {
+        if (not first) {
+            stream << ",";
+        }
+        first = false;
+        stream << "\n{\"name\":";
+        writeJsonString(stream, this->name(sample.name));
+        stream
+            << ",\"ph\":\"X\",\"pid\":0"
+            << ",\"tid\":" << sample.thread
+            << ",\"ts\":" << sample.begin
+            << ",\"dur\":" << (sample.end - sample.begin)
+            << ",\"args\":{\"frame\":" << sample.frame << "}}"
+        ;
+    }
+    stream << "\n],\"displayTimeUnit\":\"ms\"}\n";
+}
+
+
+void
+Profiler::writeChromeTrace(
+    const std::string& filename
+) const {
+    std::ofstream stream(filename, std::ofstream::trunc);
+    if (not stream) {
+        throw std::runtime_error("Could not open " + filename + " for writing the trace");
+    }
+    this->writeChromeTrace(stream);
+}
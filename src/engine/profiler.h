@@ -0,0 +1,289 @@
+#pragma once
+
+#include <cstdint>
+#include <iosfwd>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace luabind {
+class scope;
+}
+
+namespace thrive {
+
+/**
+* @brief Collects timings of systems and frames
+*
+* Timings are recorded as samples into a ring buffer of fixed size.
+* Recording is lock-free, so systems running on worker threads can record
+* their samples without waiting for each other. When the buffer is full,
+* the oldest samples are overwritten.
+*
+* Samples can be read (samples(), writeChromeTrace()) while other threads
+* are recording. Samples that are overwritten while they are read are
+* skipped. endFrame() sums up each frame's samples by name, so the times
+* of the last frame (frameTimes()) are available without going through
+* the whole buffer.
+*
+* The engine owns one profiler (see Engine::profiler()), which is fed by
+* each game state's SystemScheduler and Engine::update().
+*/
+class Profiler {
+
+public:
+
+    /**
+    * @brief Identifies a sample's name, see registerName()
+    */
+    using NameId = std::uint32_t;
+
+    /**
+    * @brief A single timed section
+    */
+    struct Sample {
+
+        /**
+        * @brief Start time in microseconds, see now()
+        */
+        std::int64_t begin;
+
+        /**
+        * @brief End time in microseconds, see now()
+        */
+        std::int64_t end;
+
+        /**
+        * @brief The frame during which the sample was recorded
+        */
+        std::uint64_t frame;
+
+        /**
+        * @brief What was timed
+        */
+        NameId name;
+
+        /**
+        * @brief The recording thread, numbered in order of first recording
+        */
+        std::uint32_t thread;
+
+    };
+
+    /**
+    * @brief Lua bindings
+    *
+    * Exposes:
+    * - Profiler::frameTimes() (for the last completed frame, as an array of
+    *   <tt>{ name = ..., milliseconds = ... }</tt> tables)
+    * - Profiler::enabled()
+    * - Profiler::setEnabled()
+    * - Profiler::setFrameBudget()
+    * - Profiler::writeChromeTrace() (with a filename)
+    *
+    * @return
+    */
+    static luabind::scope
+    luaBindings();
+
+    /**
+    * @brief Constructor
+    *
+    * @param capacity
+    *   The number of samples to keep
+    */
+    explicit Profiler(
+        std::size_t capacity = 1 << 16
+    );
+
+    /**
+    * @brief Non-copyable
+    */
+    Profiler(const Profiler&) = delete;
+
+    /**
+    * @brief Destructor
+    */
+    ~Profiler();
+
+    /**
+    * @brief Non-copyable
+    */
+    Profiler&
+    operator=(const Profiler&) = delete;
+
+    /**
+    * @brief Starts a new frame
+    *
+    * Call this from the main thread before updating the systems.
+    */
+    void
+    beginFrame();
+
+    /**
+    * @brief Whether samples are recorded
+    */
+    bool
+    enabled() const;
+
+    /**
+    * @brief Finishes the current frame
+    *
+    * Records a sample for the whole frame and sums up the frame's samples
+    * for frameTimes(). If the frame took longer than the frame budget,
+    * writes a Chrome trace (see setFrameBudget()).
+    */
+    void
+    endFrame();
+
+    /**
+    * @brief The current frame's number
+    *
+    * Starts with 0 and is incremented by each beginFrame().
+    */
+    std::uint64_t
+    frame() const;
+
+    /**
+    * @brief The summed durations of all samples of a frame, by name
+    *
+    * Cheap for the most recently completed frame. Older frames are summed
+    * up from the samples still in the buffer.
+    *
+    * @param frame
+    *   The frame to sum up
+    *
+    * @return
+    *   Pairs of name and milliseconds, in order of the names' first sample
+    */
+    std::vector<std::pair<std::string, double>>
+    frameTimes(
+        std::uint64_t frame
+    ) const;
+
+    /**
+    * @brief The name registered for \a nameId
+    */
+    const std::string&
+    name(
+        NameId nameId
+    ) const;
+
+    /**
+    * @brief The current time in microseconds
+    *
+    * Measured with a monotonic high resolution clock, relative to the
+    * profiler's construction.
+    */
+    std::int64_t
+    now() const;
+
+    /**
+    * @brief Records a sample
+    *
+    * Thread safe and lock-free. Does nothing while the profiler is
+    * disabled.
+    *
+    * @param name
+    *   What was timed
+    * @param begin
+    *   The start time, see now()
+    * @param end
+    *   The end time, see now()
+    */
+    void
+    record(
+        NameId name,
+        std::int64_t begin,
+        std::int64_t end
+    );
+
+    /**
+    * @brief Registers a sample name
+    *
+    * Not thread safe. Register names up front, e.g. when setting up a
+    * game state.
+    *
+    * @param name
+    *   The name to register
+    *
+    * @return
+    *   The name's id. Registering the same name again returns the same id.
+    */
+    NameId
+    registerName(
+        const std::string& name
+    );
+
+    /**
+    * @brief The recorded samples that haven't been overwritten yet
+    *
+    * @return
+    *   The samples, oldest first
+    */
+    std::vector<Sample>
+    samples() const;
+
+    /**
+    * @brief Enables or disables recording
+    *
+    * @param enabled
+    */
+    void
+    setEnabled(
+        bool enabled
+    );
+
+    /**
+    * @brief Sets a time budget for frames
+    *
+    * The first frame that exceeds the budget is written to \a filename as a
+    * Chrome trace, along with all other samples still in the buffer. Writing
+    * a trace disarms the budget, so a series of slow frames doesn't slow
+    * the game down even more. Call setFrameBudget() again to rearm it.
+    *
+    * @param milliseconds
+    *   The budget. 0 disables it.
+    * @param filename
+    *   The file to write the trace to
+    */
+    void
+    setFrameBudget(
+        int milliseconds,
+        const std::string& filename
+    );
+
+    /**
+    * @brief Writes all samples in the Chrome trace event format
+    *
+    * The output can be loaded in Chrome's \c about:tracing page.
+    *
+    * @param stream
+    *   The stream to write to
+    */
+    void
+    writeChromeTrace(
+        std::ostream& stream
+    ) const;
+
+    /**
+    * @brief Writes all samples in the Chrome trace event format to a file
+    *
+    * @param filename
+    *   The file to write to
+    *
+    * @throws std::runtime_error if the file can't be opened
+    */
+    void
+    writeChromeTrace(
+        const std::string& filename
+    ) const;
+
+private:
+
+    struct Implementation;
+    std::unique_ptr<Implementation> m_impl;
+
+};
+
+}
@@ -1,12 +1,17 @@
 #include "engine/script_bindings.h"
 
+#include "engine/background_saver.h"
+#include "engine/checkpoint_buffer.h"
 #include "engine/component.h"
 #include "engine/component_factory.h"
 #include "engine/engine.h"
 #include "engine/entity.h"
 #include "engine/game_state.h"
+#include "engine/prefab.h"
+#include "engine/profiler.h"
 #include "engine/serialization.h"
 #include "engine/system.h"
+#include "engine/telemetry.h"
 #include "engine/touchable.h"
 #include "engine/rng.h"
 #include "scripting/luabind.h"
@@ -17,13 +22,18 @@ thrive::EngineBindings::luaBindings() {
     return (
         StorageContainer::luaBindings(),
         StorageList::luaBindings(),
+        CheckpointBuffer::luaBindings(),
+        BackgroundSaver::luaBindings(),
         System::luaBindings(),
         Component::luaBindings(),
         ComponentFactory::luaBindings(),
         Entity::luaBindings(),
         Touchable::luaBindings(),
         GameState::luaBindings(),
+        Prefab::luaBindings(),
         Engine::luaBindings(),
+        Profiler::luaBindings(),
+        Telemetry::luaBindings(),
         RNG::luaBindings()
     );
 }
@@ -5,6 +5,8 @@
 #include <boost/lexical_cast.hpp>
 #include <boost/variant.hpp>
 #include <cfloat>
+#include <cstring>
+#include <limits>
 #include <luabind/iterator_policy.hpp>
 #include <stdexcept>
 #include <unordered_map>
@@ -31,7 +33,10 @@ using Variant = boost::variant<
     double,
     std::string,
     StorageContainer,
-    StorageList
+    StorageList,
+    Ogre::Plane,
+    Ogre::Quaternion,
+    Ogre::Vector3
 >;
 
 struct StoredValue {
@@ -39,6 +44,13 @@ struct StoredValue {
     Variant value;
 };
 
+// Key ids are positions in the key table of a StorageWriter or
+// StorageReader, only valid in the savegame they were read from or
+// written to
+using KeyId = uint32_t;
+
+static const KeyId NO_KEY = std::numeric_limits<KeyId>::max();
+
 /**
 * @brief Information about a storable type
 *
@@ -139,9 +151,9 @@ TYPE_INFO(StorageList, StorageList, 240)
 
 // Compound types
 TYPE_INFO(Ogre::Degree, float, 272)
-TYPE_INFO(Ogre::Plane, StorageContainer, 288)
-TYPE_INFO(Ogre::Vector3, StorageContainer, 304)
-TYPE_INFO(Ogre::Quaternion, StorageContainer, 320)
+TYPE_INFO(Ogre::Plane, Ogre::Plane, 288)
+TYPE_INFO(Ogre::Vector3, Ogre::Vector3, 304)
+TYPE_INFO(Ogre::Quaternion, Ogre::Quaternion, 320)
 TYPE_INFO(Ogre::ColourValue, uint32_t, 336)
 } // namespace
 
@@ -188,12 +200,19 @@ toLua(
 
 struct StorageContainer::Implementation {
 
+    std::unordered_map<std::string, StoredValue>::const_iterator
+    find(
+        const std::string& key
+    ) const {
+        return m_content.find(key);
+    }
+
     template<typename T>
     bool
     rawContains(
         const std::string& key
     ) const {
-        auto iter = m_content.find(key);
+        auto iter = this->find(key);
         return (
             iter != m_content.end() and
             iter->second.typeId == TypeInfo<T>::Id
@@ -206,7 +225,7 @@ struct StorageContainer::Implementation {
         const std::string& key,
         const typename TypeInfo<T>::StoredType& defaultValue = typename TypeInfo<T>::StoredType()
     ) const {
-        auto iter = m_content.find(key);
+        auto iter = this->find(key);
         if (iter == m_content.end()) {
             return defaultValue;
         }
@@ -361,7 +380,7 @@ bool
 StorageContainer::contains(
     const std::string& key
 ) const {
-    return m_impl->m_content.find(key) != m_impl->m_content.cend();
+    return m_impl->find(key) != m_impl->m_content.cend();
 }
 
 
@@ -370,7 +389,7 @@ StorageContainer::luaGet(
     const std::string& key,
     luabind::object defaultValue
 ) const {
-    auto iter = m_impl->m_content.find(key);
+    auto iter = m_impl->find(key);
     if (iter == m_impl->m_content.end()) {
         return defaultValue;
     }
@@ -426,6 +445,10 @@ NATIVE_TYPE(double)
 NATIVE_TYPE(std::string)
 NATIVE_TYPE(StorageContainer)
 NATIVE_TYPE(StorageList)
+// Compound types
+NATIVE_TYPE(Ogre::Plane)
+NATIVE_TYPE(Ogre::Vector3)
+NATIVE_TYPE(Ogre::Quaternion)
 
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -448,95 +471,6 @@ TypeInfo<Ogre::Degree>::convertToStoredType(
 }
 
 
-////////////////////////////////////////////////////////////////////////////////
-// Ogre::Plane
-////////////////////////////////////////////////////////////////////////////////
-
-Ogre::Plane
-TypeInfo<Ogre::Plane>::convertFromStoredType(
-    const StorageContainer& storage
-) {
-    Ogre::Vector3 normal = storage.get<Ogre::Vector3>("normal");
-    Ogre::Real d = storage.get<Ogre::Real>("d");
-    Ogre::Plane plane(normal, -d); // See the constructor definition in OgrePlane.cpp for the minus sign
-    return plane;
-}
-
-
-StorageContainer
-TypeInfo<Ogre::Plane>::convertToStoredType(
-    const Ogre::Plane& value
-) {
-    StorageContainer storage;
-    storage.set<Ogre::Vector3>("normal", value.normal);
-    storage.set<Ogre::Real>("d", value.d);
-    return storage;
-}
-
-
-
-////////////////////////////////////////////////////////////////////////////////
-// Ogre::Vector3
-////////////////////////////////////////////////////////////////////////////////
-
-Ogre::Vector3
-TypeInfo<Ogre::Vector3>::convertFromStoredType(
-    const StorageContainer& storage
-) {
-    std::array<Ogre::Real, 3> elements {{
-        storage.get<Ogre::Real>("x"),
-        storage.get<Ogre::Real>("y"),
-        storage.get<Ogre::Real>("z")
-    }};
-    return Ogre::Vector3(elements.data());
-}
-
-
-StorageContainer
-TypeInfo<Ogre::Vector3>::convertToStoredType(
-    const Ogre::Vector3& value
-) {
-    StorageContainer storage;
-    storage.set<Ogre::Real>("x", value.x);
-    storage.set<Ogre::Real>("y", value.y);
-    storage.set<Ogre::Real>("z", value.z);
-    return storage;
-}
-
-
-
-////////////////////////////////////////////////////////////////////////////////
-// Ogre::Quaternion
-////////////////////////////////////////////////////////////////////////////////
-
-Ogre::Quaternion
-TypeInfo<Ogre::Quaternion>::convertFromStoredType(
-    const StorageContainer& storage
-) {
-    std::array<Ogre::Real, 4> elements {{
-        storage.get<Ogre::Real>("w"),
-        storage.get<Ogre::Real>("x"),
-        storage.get<Ogre::Real>("y"),
-        storage.get<Ogre::Real>("z")
-    }};
-    return Ogre::Quaternion(elements.data());
-}
-
-
-StorageContainer
-TypeInfo<Ogre::Quaternion>::convertToStoredType(
-    const Ogre::Quaternion& value
-) {
-    StorageContainer storage;
-    storage.set<Ogre::Real>("w", value.w);
-    storage.set<Ogre::Real>("x", value.x);
-    storage.set<Ogre::Real>("y", value.y);
-    storage.set<Ogre::Real>("z", value.z);
-    return storage;
-}
-
-
-
 ////////////////////////////////////////////////////////////////////////////////
 // Ogre::ColourValue
 ////////////////////////////////////////////////////////////////////////////////
@@ -760,10 +694,10 @@ struct TypeHandler<std::string> {
         std::istream& stream
     ) {
         uint64_t size = TypeHandler<uint64_t>::deserialize(stream);
-        std::vector<char> buffer(size, '\0');
-        stream.read(&buffer[0], size);
+        std::string string(size, '\0');
+        stream.read(&string[0], size);
         assert(not stream.fail());
-        return std::string(buffer.begin(), buffer.end());
+        return string;
     }
 
     static void
@@ -780,82 +714,157 @@ struct TypeHandler<std::string> {
 
 
 ////////////////////////////////////////////////////////////////////////////////
-// Float
+// Floating point
 ////////////////////////////////////////////////////////////////////////////////
 
-template<>
-struct TypeHandler<float> {
+static_assert(
+    std::numeric_limits<float>::is_iec559 and std::numeric_limits<double>::is_iec559,
+    "Floating point numbers are serialized as raw IEEE 754 values"
+);
+
+template<typename T, typename Bits>
+struct FloatingPointTypeHandler {
 
-    static float
+    static_assert(sizeof(T) == sizeof(Bits), "Bits must have the size of T");
+
+    static T
     deserialize(
         std::istream& stream
     ) {
-        std::string asString = TypeHandler<std::string>::deserialize(stream);
-        return boost::lexical_cast<float>(asString);
+        Bits bits = TypeHandler<Bits>::deserialize(stream);
+        T value = 0;
+        std::memcpy(&value, &bits, sizeof(T));
+        return value;
     }
 
     static void
     serialize(
         std::ostream& stream,
-        const float& value
+        T value
     ) {
-        std::string asString = boost::lexical_cast<std::string>(value);
-        TypeHandler<std::string>::serialize(stream, asString);
+        Bits bits = 0;
+        std::memcpy(&bits, &value, sizeof(T));
+        TypeHandler<Bits>::serialize(stream, bits);
     }
 
 };
 
+template<> struct TypeHandler<float> : public FloatingPointTypeHandler<float, uint32_t> {};
+template<> struct TypeHandler<double> : public FloatingPointTypeHandler<double, uint64_t> {};
+
 
 ////////////////////////////////////////////////////////////////////////////////
-// Double
+// Ogre::Plane
 ////////////////////////////////////////////////////////////////////////////////
 
 template<>
-struct TypeHandler<double> {
+struct TypeHandler<Ogre::Plane> {
 
-    static double
+    static Ogre::Plane
     deserialize(
         std::istream& stream
     ) {
-        std::string asString = TypeHandler<std::string>::deserialize(stream);
-        return boost::lexical_cast<double>(asString);
+        Ogre::Plane plane;
+        plane.normal.x = TypeHandler<Ogre::Real>::deserialize(stream);
+        plane.normal.y = TypeHandler<Ogre::Real>::deserialize(stream);
+        plane.normal.z = TypeHandler<Ogre::Real>::deserialize(stream);
+        plane.d = TypeHandler<Ogre::Real>::deserialize(stream);
+        return plane;
     }
 
     static void
     serialize(
         std::ostream& stream,
-        const double& value
+        const Ogre::Plane& plane
     ) {
-        std::string asString = boost::lexical_cast<std::string>(value);
-        TypeHandler<std::string>::serialize(stream, asString);
+        TypeHandler<Ogre::Real>::serialize(stream, plane.normal.x);
+        TypeHandler<Ogre::Real>::serialize(stream, plane.normal.y);
+        TypeHandler<Ogre::Real>::serialize(stream, plane.normal.z);
+        TypeHandler<Ogre::Real>::serialize(stream, plane.d);
     }
 
 };
 
 
 ////////////////////////////////////////////////////////////////////////////////
-// StorageContainer
+// Ogre::Vector3
 ////////////////////////////////////////////////////////////////////////////////
 
 template<>
-struct TypeHandler<StorageContainer> {
+struct TypeHandler<Ogre::Vector3> {
 
-    static StorageContainer
+    static Ogre::Vector3
     deserialize(
         std::istream& stream
     ) {
-        StorageContainer value;
-        stream >> value;
-        return value;
+        Ogre::Real x = TypeHandler<Ogre::Real>::deserialize(stream);
+        Ogre::Real y = TypeHandler<Ogre::Real>::deserialize(stream);
+        Ogre::Real z = TypeHandler<Ogre::Real>::deserialize(stream);
+        return Ogre::Vector3(x, y, z);
     }
 
+    static void
+    serialize(
+        std::ostream& stream,
+        const Ogre::Vector3& vector
+    ) {
+        TypeHandler<Ogre::Real>::serialize(stream, vector.x);
+        TypeHandler<Ogre::Real>::serialize(stream, vector.y);
+        TypeHandler<Ogre::Real>::serialize(stream, vector.z);
+    }
+
+};
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Ogre::Quaternion
+////////////////////////////////////////////////////////////////////////////////
+
+template<>
+struct TypeHandler<Ogre::Quaternion> {
+
+    static Ogre::Quaternion
+    deserialize(
+        std::istream& stream
+    ) {
+        Ogre::Real w = TypeHandler<Ogre::Real>::deserialize(stream);
+        Ogre::Real x = TypeHandler<Ogre::Real>::deserialize(stream);
+        Ogre::Real y = TypeHandler<Ogre::Real>::deserialize(stream);
+        Ogre::Real z = TypeHandler<Ogre::Real>::deserialize(stream);
+        return Ogre::Quaternion(w, x, y, z);
+    }
 
     static void
     serialize(
         std::ostream& stream,
-        const StorageContainer& value
+        const Ogre::Quaternion& quaternion
+    ) {
+        TypeHandler<Ogre::Real>::serialize(stream, quaternion.w);
+        TypeHandler<Ogre::Real>::serialize(stream, quaternion.x);
+        TypeHandler<Ogre::Real>::serialize(stream, quaternion.y);
+        TypeHandler<Ogre::Real>::serialize(stream, quaternion.z);
+    }
+
+};
+
+
+////////////////////////////////////////////////////////////////////////////////
+// StorageContainer
+////////////////////////////////////////////////////////////////////////////////
+
+// Nested containers and lists are written by StorageWriter, these handlers
+// only read savegames from before it
+
+template<>
+struct TypeHandler<StorageContainer> {
+
+    static StorageContainer
+    deserialize(
+        std::istream& stream
     ) {
-        stream << value;
+        StorageContainer value;
+        stream >> value;
+        return value;
     }
 
 };
@@ -881,51 +890,145 @@ struct TypeHandler<StorageList> {
         return list;
     }
 
+};
+
 
-    static void
-    serialize(
-        std::ostream& stream,
-        const StorageList& list
-    ) {
-        uint64_t size = list.size();
-        TypeHandler<uint64_t>::serialize(stream, size);
-        for (const auto& storageContainer : list) {
-            TypeHandler<StorageContainer>::serialize(stream, storageContainer);
-        }
-    }
+////////////////////////////////////////////////////////////////////////////////
+// Legacy encodings
+////////////////////////////////////////////////////////////////////////////////
+
+// Savegames used to store floating point numbers as strings and Ogre
+// vectors, quaternions and planes as nested StorageContainers. These
+// encodings are still read under the type's id, the compact encodings
+// have their own ids (see COMPACT_ENCODING).
+
+template<typename T>
+struct LegacyTypeHandler {
+
+    static typename TypeInfo<T>::StoredType
+    deserialize(
+        std::istream& stream
+    );
 
 };
 
 
-struct SerializationVisitor : public boost::static_visitor<> {
+template<>
+float
+LegacyTypeHandler<float>::deserialize(
+    std::istream& stream
+) {
+    std::string asString = TypeHandler<std::string>::deserialize(stream);
+    return boost::lexical_cast<float>(asString);
+}
 
-    SerializationVisitor(
-        std::ostream& stream
-    ) : m_stream(stream)
-    {
-    }
 
-    template<typename T>
-    void
-    operator () (
-        const T& value
-    ) const {
-        TypeHandler<T>::serialize(m_stream, value);
-    }
+template<>
+double
+LegacyTypeHandler<double>::deserialize(
+    std::istream& stream
+) {
+    std::string asString = TypeHandler<std::string>::deserialize(stream);
+    return boost::lexical_cast<double>(asString);
+}
+
+
+template<>
+float
+LegacyTypeHandler<Ogre::Degree>::deserialize(
+    std::istream& stream
+) {
+    return LegacyTypeHandler<float>::deserialize(stream);
+}
+
+
+template<>
+Ogre::Plane
+LegacyTypeHandler<Ogre::Plane>::deserialize(
+    std::istream& stream
+) {
+    StorageContainer storage = TypeHandler<StorageContainer>::deserialize(stream);
+    Ogre::Vector3 normal = storage.get<Ogre::Vector3>("normal");
+    Ogre::Real d = storage.get<Ogre::Real>("d");
+    return Ogre::Plane(normal, -d); // See the constructor definition in OgrePlane.cpp for the minus sign
+}
+
+
+template<>
+Ogre::Vector3
+LegacyTypeHandler<Ogre::Vector3>::deserialize(
+    std::istream& stream
+) {
+    StorageContainer storage = TypeHandler<StorageContainer>::deserialize(stream);
+    return Ogre::Vector3(
+        storage.get<Ogre::Real>("x"),
+        storage.get<Ogre::Real>("y"),
+        storage.get<Ogre::Real>("z")
+    );
+}
+
+
+template<>
+Ogre::Quaternion
+LegacyTypeHandler<Ogre::Quaternion>::deserialize(
+    std::istream& stream
+) {
+    StorageContainer storage = TypeHandler<StorageContainer>::deserialize(stream);
+    return Ogre::Quaternion(
+        storage.get<Ogre::Real>("w"),
+        storage.get<Ogre::Real>("x"),
+        storage.get<Ogre::Real>("y"),
+        storage.get<Ogre::Real>("z")
+    );
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Type ids
+////////////////////////////////////////////////////////////////////////////////
+
+// Set in the serialized type id of values in a compact encoding. All type
+// ids are multiples of 16, so the bit never clashes with a type id.
+static const TypeId COMPACT_ENCODING = 1;
+
+template<typename StoredType>
+struct HasCompactEncoding {
+
+    static const bool value = false;
 
-    std::ostream& m_stream;
 };
 
+#define HAS_COMPACT_ENCODING(storedType) \
+    template<> \
+    struct HasCompactEncoding<storedType> { \
+        static const bool value = true; \
+    };
+
+HAS_COMPACT_ENCODING(float)
+HAS_COMPACT_ENCODING(double)
+HAS_COMPACT_ENCODING(Ogre::Plane)
+HAS_COMPACT_ENCODING(Ogre::Vector3)
+HAS_COMPACT_ENCODING(Ogre::Quaternion)
+
+
 #define DESERIALIZE_CASE(typeName) \
     case TypeInfo<typeName>::Id: \
         return TypeHandler<TypeInfo<typeName>::StoredType>::deserialize(stream)
 
+#define DESERIALIZE_COMPACT_CASE(typeName) \
+    case TypeInfo<typeName>::Id | COMPACT_ENCODING: \
+        return TypeHandler<TypeInfo<typeName>::StoredType>::deserialize(stream)
+
+#define DESERIALIZE_LEGACY_CASE(typeName) \
+    case TypeInfo<typeName>::Id: \
+        return LegacyTypeHandler<typeName>::deserialize(stream)
+
 static Variant
 deserialize(
-    TypeId typeId,
+    TypeId encodingId,
     std::istream& stream
 ) {
-    switch (typeId) {
+    switch (encodingId) {
         DESERIALIZE_CASE(bool);
         DESERIALIZE_CASE(char);
         DESERIALIZE_CASE(int8_t);
@@ -936,17 +1039,24 @@ deserialize(
         DESERIALIZE_CASE(uint16_t);
         DESERIALIZE_CASE(uint32_t);
         DESERIALIZE_CASE(uint64_t);
-        DESERIALIZE_CASE(float);
-        DESERIALIZE_CASE(double);
+        DESERIALIZE_COMPACT_CASE(float);
+        DESERIALIZE_COMPACT_CASE(double);
         DESERIALIZE_CASE(std::string);
         DESERIALIZE_CASE(StorageContainer);
         DESERIALIZE_CASE(StorageList);
         // Compound types
-        DESERIALIZE_CASE(Ogre::Degree);
-        DESERIALIZE_CASE(Ogre::Plane);
-        DESERIALIZE_CASE(Ogre::Vector3);
-        DESERIALIZE_CASE(Ogre::Quaternion);
+        DESERIALIZE_COMPACT_CASE(Ogre::Degree);
+        DESERIALIZE_COMPACT_CASE(Ogre::Plane);
+        DESERIALIZE_COMPACT_CASE(Ogre::Vector3);
+        DESERIALIZE_COMPACT_CASE(Ogre::Quaternion);
         DESERIALIZE_CASE(Ogre::ColourValue);
+        // Legacy encodings
+        DESERIALIZE_LEGACY_CASE(float);
+        DESERIALIZE_LEGACY_CASE(double);
+        DESERIALIZE_LEGACY_CASE(Ogre::Degree);
+        DESERIALIZE_LEGACY_CASE(Ogre::Plane);
+        DESERIALIZE_LEGACY_CASE(Ogre::Vector3);
+        DESERIALIZE_LEGACY_CASE(Ogre::Quaternion);
         default:
             assert(false && "Unknown type id. Did you add a new STORABLE_TYPE, but forgot the DESERIALIZE_CASE?");
     }
@@ -954,6 +1064,9 @@ deserialize(
 }
 
 
+// Marks a savegame written by StorageWriter
+static const uint64_t STREAM_MAGIC = 0x4D4145525453454BULL;
+
 } // namespace
 
 std::ostream&
@@ -961,14 +1074,9 @@ thrive::operator << (
     std::ostream& stream,
     const StorageContainer& storage
 ) {
-    SerializationVisitor visitor(stream);
-    const auto& content = storage.m_impl->m_content;
-    TypeHandler<uint64_t>::serialize(stream, content.size());
-    for (const auto& pair : content) {
-        TypeHandler<std::string>::serialize(stream, pair.first);    
-        TypeHandler<TypeId>::serialize(stream, pair.second.typeId);    
-        boost::apply_visitor(visitor, pair.second.value);
-    }
+    StorageWriter writer(stream);
+    writer.writeEntries(storage);
+    writer.finish();
     return stream;
 }
 
@@ -978,20 +1086,605 @@ thrive::operator >> (
     std::istream& stream,
     StorageContainer& storage
 ) {
-    uint64_t size = TypeHandler<uint64_t>::deserialize(stream);
     storage.m_impl->m_content.clear();
+    uint64_t header = TypeHandler<uint64_t>::deserialize(stream);
+    if (header == STREAM_MAGIC) {
+        StorageReader reader(stream, false);
+        storage = reader.readContainer();
+        return stream;
+    }
+    // Older savegames store the number of entries and each key in place
+    uint64_t size = header;
     for (size_t i = 0; i < size; ++i) {
         std::string key = TypeHandler<std::string>::deserialize(stream);
-        TypeId typeId = TypeHandler<TypeId>::deserialize(stream);
+        TypeId encodingId = TypeHandler<TypeId>::deserialize(stream);
+        TypeId typeId = encodingId & ~COMPACT_ENCODING;
         storage.m_impl->m_content[key] = StoredValue {
             typeId,
-            deserialize(typeId, stream)
+            deserialize(encodingId, stream)
         };
     }
     return stream;
 }
 
 
+////////////////////////////////////////////////////////////////////////////////
+// StorageWriter
+////////////////////////////////////////////////////////////////////////////////
+
+// Written instead of a key id when a key is used for the first time,
+// followed by the key itself
+static const KeyId NEW_KEY = std::numeric_limits<KeyId>::max();
+
+// Written instead of a key id at the end of a container
+static const KeyId END_OF_CONTAINER = NEW_KEY - 1;
+
+// Written before each element of a list and at its end
+static const uint8_t LIST_ELEMENT = 1;
+static const uint8_t END_OF_LIST = 0;
+
+namespace {
+
+enum class Frame {
+    Container,
+    List
+};
+
+}
+
+struct StorageWriter::Implementation {
+
+    struct ValueWriter : public boost::static_visitor<> {
+
+        ValueWriter(
+            Implementation& writer,
+            TypeId typeId
+        ) : m_writer(writer),
+            m_typeId(typeId)
+        {
+        }
+
+        template<typename T>
+        void
+        operator () (
+            const T& value
+        ) const {
+            m_writer.writeScalar(m_typeId, value);
+        }
+
+        void
+        operator () (
+            const StorageContainer& container
+        ) const {
+            m_writer.writeContainer(container);
+        }
+
+        void
+        operator () (
+            const StorageList& list
+        ) const {
+            m_writer.writeList(list);
+        }
+
+        Implementation& m_writer;
+
+        TypeId m_typeId;
+
+    };
+
+    Implementation(
+        std::ostream& stream
+    ) : m_stream(stream)
+    {
+    }
+
+    void
+    beginNested(
+        const std::string& key,
+        TypeId typeId
+    ) {
+        assert(not m_frames.empty() and m_frames.back() == Frame::Container && "Can only add values to a container");
+        this->writeKey(key);
+        TypeHandler<TypeId>::serialize(m_stream, typeId);
+    }
+
+    void
+    writeContainer(
+        const StorageContainer& container
+    ) {
+        TypeHandler<TypeId>::serialize(m_stream, TypeInfo<StorageContainer>::Id);
+        this->writeEntries(container);
+        TypeHandler<KeyId>::serialize(m_stream, END_OF_CONTAINER);
+    }
+
+    void
+    writeEntries(
+        const StorageContainer& container
+    ) {
+        for (const auto& pair : container.m_impl->m_content) {
+            this->writeKey(pair.first);
+            ValueWriter valueWriter(*this, pair.second.typeId);
+            boost::apply_visitor(valueWriter, pair.second.value);
+        }
+    }
+
+    void
+    writeKey(
+        const std::string& key
+    ) {
+        auto iter = m_keyIds.find(key);
+        if (iter == m_keyIds.end()) {
+            KeyId keyId = m_keyIds.size();
+            m_keyIds.insert(std::make_pair(key, keyId));
+            TypeHandler<KeyId>::serialize(m_stream, NEW_KEY);
+            TypeHandler<std::string>::serialize(m_stream, key);
+        }
+        else {
+            TypeHandler<KeyId>::serialize(m_stream, iter->second);
+        }
+    }
+
+    void
+    writeList(
+        const StorageList& list
+    ) {
+        TypeHandler<TypeId>::serialize(m_stream, TypeInfo<StorageList>::Id);
+        for (const StorageContainer& element : list) {
+            TypeHandler<uint8_t>::serialize(m_stream, LIST_ELEMENT);
+            this->writeEntries(element);
+            TypeHandler<KeyId>::serialize(m_stream, END_OF_CONTAINER);
+        }
+        TypeHandler<uint8_t>::serialize(m_stream, END_OF_LIST);
+    }
+
+    template<typename T>
+    void
+    writeScalar(
+        TypeId typeId,
+        const T& value
+    ) {
+        TypeId encodingId = typeId;
+        if (HasCompactEncoding<T>::value) {
+            encodingId |= COMPACT_ENCODING;
+        }
+        TypeHandler<TypeId>::serialize(m_stream, encodingId);
+        TypeHandler<T>::serialize(m_stream, value);
+    }
+
+    std::vector<Frame> m_frames;
+
+    // Keys written so far
+    std::unordered_map<std::string, KeyId> m_keyIds;
+
+    std::ostream& m_stream;
+
+};
+
+
+StorageWriter::StorageWriter(
+    std::ostream& stream
+) : m_impl(new Implementation(stream))
+{
+    TypeHandler<uint64_t>::serialize(stream, STREAM_MAGIC);
+    m_impl->m_frames.push_back(Frame::Container);
+}
+
+
+StorageWriter::~StorageWriter() {}
+
+
+void
+StorageWriter::beginContainer(
+    const std::string& key
+) {
+    m_impl->beginNested(key, TypeInfo<StorageContainer>::Id);
+    m_impl->m_frames.push_back(Frame::Container);
+}
+
+
+void
+StorageWriter::beginElement() {
+    assert(not m_impl->m_frames.empty() and m_impl->m_frames.back() == Frame::List && "Can only add elements to a list");
+    TypeHandler<uint8_t>::serialize(m_impl->m_stream, LIST_ELEMENT);
+    m_impl->m_frames.push_back(Frame::Container);
+}
+
+
+void
+StorageWriter::beginList(
+    const std::string& key
+) {
+    m_impl->beginNested(key, TypeInfo<StorageList>::Id);
+    m_impl->m_frames.push_back(Frame::List);
+}
+
+
+void
+StorageWriter::end() {
+    assert(not m_impl->m_frames.empty() && "Nothing to end");
+    if (m_impl->m_frames.back() == Frame::Container) {
+        TypeHandler<KeyId>::serialize(m_impl->m_stream, END_OF_CONTAINER);
+    }
+    else {
+        TypeHandler<uint8_t>::serialize(m_impl->m_stream, END_OF_LIST);
+    }
+    m_impl->m_frames.pop_back();
+}
+
+
+void
+StorageWriter::finish() {
+    while (not m_impl->m_frames.empty()) {
+        this->end();
+    }
+}
+
+
+void
+StorageWriter::writeEntries(
+    const StorageContainer& container
+) {
+    assert(not m_impl->m_frames.empty() and m_impl->m_frames.back() == Frame::Container && "Can only add values to a container");
+    m_impl->writeEntries(container);
+}
+
+
+#define WRITER_SET(type) \
+    template<> \
+    void \
+    StorageWriter::set<type>( \
+        const std::string& key, \
+        const type& value \
+    ) { \
+        assert(not m_impl->m_frames.empty() and m_impl->m_frames.back() == Frame::Container && "Can only add values to a container"); \
+        m_impl->writeKey(key); \
+        m_impl->writeScalar( \
+            TypeInfo<type>::Id, \
+            TypeInfo<type>::convertToStoredType(value) \
+        ); \
+    }
+
+WRITER_SET(bool)
+WRITER_SET(char)
+WRITER_SET(int8_t)
+WRITER_SET(int16_t)
+WRITER_SET(int32_t)
+WRITER_SET(int64_t)
+WRITER_SET(uint8_t)
+WRITER_SET(uint16_t)
+WRITER_SET(uint32_t)
+WRITER_SET(uint64_t)
+WRITER_SET(float)
+WRITER_SET(double)
+WRITER_SET(std::string)
+// Compound types
+WRITER_SET(Ogre::Degree)
+WRITER_SET(Ogre::Plane)
+WRITER_SET(Ogre::Vector3)
+WRITER_SET(Ogre::Quaternion)
+WRITER_SET(Ogre::ColourValue)
+
+
+template<>
+void
+StorageWriter::set<StorageContainer>(
+    const std::string& key,
+    const StorageContainer& value
+) {
+    assert(not m_impl->m_frames.empty() and m_impl->m_frames.back() == Frame::Container && "Can only add values to a container");
+    m_impl->writeKey(key);
+    m_impl->writeContainer(value);
+}
+
+
+template<>
+void
+StorageWriter::set<StorageList>(
+    const std::string& key,
+    const StorageList& value
+) {
+    assert(not m_impl->m_frames.empty() and m_impl->m_frames.back() == Frame::Container && "Can only add values to a container");
+    m_impl->writeKey(key);
+    m_impl->writeList(value);
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+// StorageReader
+////////////////////////////////////////////////////////////////////////////////
+
+struct StorageReader::Implementation {
+
+    Implementation(
+        std::istream& stream
+    ) : m_stream(stream)
+    {
+    }
+
+    void
+    checkValue(
+        TypeId typeId
+    ) const {
+        if (m_value.typeId != typeId) {
+            throw std::runtime_error("Savegame entry has an unexpected type: " + m_keys.at(m_key));
+        }
+    }
+
+    // Returns NO_KEY at the end of the container
+    KeyId
+    readKey() {
+        KeyId keyId = TypeHandler<KeyId>::deserialize(m_stream);
+        if (keyId == END_OF_CONTAINER) {
+            return NO_KEY;
+        }
+        else if (keyId == NEW_KEY) {
+            m_keys.push_back(TypeHandler<std::string>::deserialize(m_stream));
+            return m_keys.size() - 1;
+        }
+        else if (keyId >= m_keys.size()) {
+            throw std::runtime_error("Savegame refers to an unknown key");
+        }
+        else {
+            return keyId;
+        }
+    }
+
+    void
+    readEntries(
+        StorageContainer& container
+    ) {
+        for (KeyId key = this->readKey(); key != NO_KEY; key = this->readKey()) {
+            TypeId encodingId = TypeHandler<TypeId>::deserialize(m_stream);
+            container.m_impl->m_content[m_keys[key]] = this->readValue(encodingId);
+        }
+    }
+
+    StorageList
+    readList() {
+        StorageList list;
+        while (TypeHandler<uint8_t>::deserialize(m_stream) == LIST_ELEMENT) {
+            StorageContainer element;
+            this->readEntries(element);
+            list.append(std::move(element));
+        }
+        return list;
+    }
+
+    StoredValue
+    readValue(
+        TypeId encodingId
+    ) {
+        TypeId typeId = encodingId & ~COMPACT_ENCODING;
+        if (typeId == TypeInfo<StorageContainer>::Id) {
+            StorageContainer container;
+            this->readEntries(container);
+            return StoredValue{typeId, std::move(container)};
+        }
+        else if (typeId == TypeInfo<StorageList>::Id) {
+            return StoredValue{typeId, this->readList()};
+        }
+        else {
+            return StoredValue{typeId, deserialize(encodingId, m_stream)};
+        }
+    }
+
+    // Reads or skips the current entry's container or list, if it hasn't
+    // been entered
+    void
+    skipNested() {
+        if (not m_nestedPending) {
+            return;
+        }
+        m_nestedPending = false;
+        if (m_value.typeId == TypeInfo<StorageContainer>::Id) {
+            StorageContainer skipped;
+            this->readEntries(skipped);
+        }
+        else {
+            this->readList();
+        }
+    }
+
+    std::vector<Frame> m_frames;
+
+    KeyId m_key = NO_KEY;
+
+    // Keys read so far, indexed by key id
+    std::vector<std::string> m_keys;
+
+    // Whether the current entry is a container or list that has been
+    // neither entered nor read
+    bool m_nestedPending = false;
+
+    std::istream& m_stream;
+
+    // The current entry's value, if it is neither a container nor a list
+    StoredValue m_value;
+
+};
+
+
+bool
+StorageReader::canRead(
+    std::istream& stream
+) {
+    std::istream::pos_type position = stream.tellg();
+    uint64_t header = 0;
+    stream.read(reinterpret_cast<char*>(&header), sizeof(header));
+    bool isStreamed = stream.gcount() == sizeof(header) and header == STREAM_MAGIC;
+    stream.clear();
+    stream.seekg(position);
+    return isStreamed;
+}
+
+
+StorageReader::StorageReader(
+    std::istream& stream
+) : StorageReader(stream, true)
+{
+}
 
 
+StorageReader::StorageReader(
+    std::istream& stream,
+    bool readHeader
+) : m_impl(new Implementation(stream))
+{
+    if (readHeader and TypeHandler<uint64_t>::deserialize(stream) != STREAM_MAGIC) {
+        throw std::runtime_error("Not a savegame written by StorageWriter");
+    }
+    m_impl->m_frames.push_back(Frame::Container);
+}
+
 
+StorageReader::~StorageReader() {}
+
+
+void
+StorageReader::enter() {
+    assert(m_impl->m_nestedPending && "Current entry is neither a container nor a list");
+    m_impl->m_nestedPending = false;
+    if (m_impl->m_value.typeId == TypeInfo<StorageContainer>::Id) {
+        m_impl->m_frames.push_back(Frame::Container);
+    }
+    else {
+        m_impl->m_frames.push_back(Frame::List);
+    }
+}
+
+
+bool
+StorageReader::isContainer() const {
+    return m_impl->m_nestedPending and m_impl->m_value.typeId == TypeInfo<StorageContainer>::Id;
+}
+
+
+bool
+StorageReader::isList() const {
+    return m_impl->m_nestedPending and m_impl->m_value.typeId == TypeInfo<StorageList>::Id;
+}
+
+
+const std::string&
+StorageReader::key() const {
+    return m_impl->m_keys.at(m_impl->m_key);
+}
+
+
+bool
+StorageReader::next() {
+    assert(not m_impl->m_frames.empty() and m_impl->m_frames.back() == Frame::Container && "Not in a container");
+    m_impl->skipNested();
+    m_impl->m_key = m_impl->readKey();
+    if (m_impl->m_key == NO_KEY) {
+        m_impl->m_frames.pop_back();
+        return false;
+    }
+    TypeId encodingId = TypeHandler<TypeId>::deserialize(m_impl->m_stream);
+    TypeId typeId = encodingId & ~COMPACT_ENCODING;
+    if (
+        typeId == TypeInfo<StorageContainer>::Id or
+        typeId == TypeInfo<StorageList>::Id
+    ) {
+        m_impl->m_value.typeId = typeId;
+        m_impl->m_nestedPending = true;
+    }
+    else {
+        m_impl->m_value = m_impl->readValue(encodingId);
+    }
+    return true;
+}
+
+
+bool
+StorageReader::nextElement() {
+    assert(not m_impl->m_frames.empty() and m_impl->m_frames.back() == Frame::List && "Not in a list");
+    if (TypeHandler<uint8_t>::deserialize(m_impl->m_stream) == END_OF_LIST) {
+        m_impl->m_frames.pop_back();
+        return false;
+    }
+    m_impl->m_frames.push_back(Frame::Container);
+    return true;
+}
+
+
+StorageContainer
+StorageReader::readContainer() {
+    assert(not m_impl->m_frames.empty() and m_impl->m_frames.back() == Frame::Container && "Not in a container");
+    m_impl->skipNested();
+    StorageContainer container;
+    m_impl->readEntries(container);
+    m_impl->m_frames.pop_back();
+    return container;
+}
+
+
+void
+StorageReader::readEntry(
+    StorageContainer& container
+) {
+    // Reading a nested value may add keys
+    std::string key = this->key();
+    if (m_impl->m_nestedPending) {
+        m_impl->m_nestedPending = false;
+        container.m_impl->m_content[key] = m_impl->readValue(m_impl->m_value.typeId);
+    }
+    else {
+        assert(m_impl->m_value.typeId != TypeInfo<StorageContainer>::Id and m_impl->m_value.typeId != TypeInfo<StorageList>::Id && "Current entry has been entered");
+        container.m_impl->m_content[key] = m_impl->m_value;
+    }
+}
+
+
+#define READER_GET(type) \
+    template<> \
+    type \
+    StorageReader::get<type>() { \
+        m_impl->checkValue(TypeInfo<type>::Id); \
+        using StoredType = TypeInfo<type>::StoredType; \
+        return TypeInfo<type>::convertFromStoredType( \
+            boost::get<StoredType>(m_impl->m_value.value) \
+        ); \
+    }
+
+READER_GET(bool)
+READER_GET(char)
+READER_GET(int8_t)
+READER_GET(int16_t)
+READER_GET(int32_t)
+READER_GET(int64_t)
+READER_GET(uint8_t)
+READER_GET(uint16_t)
+READER_GET(uint32_t)
+READER_GET(uint64_t)
+READER_GET(float)
+READER_GET(double)
+READER_GET(std::string)
+// Compound types
+READER_GET(Ogre::Degree)
+READER_GET(Ogre::Plane)
+READER_GET(Ogre::Vector3)
+READER_GET(Ogre::Quaternion)
+READER_GET(Ogre::ColourValue)
+
+
+template<>
+StorageContainer
+StorageReader::get<StorageContainer>() {
+    if (not this->isContainer()) {
+        throw std::runtime_error("Savegame entry is not a container: " + this->key());
+    }
+    this->enter();
+    return this->readContainer();
+}
+
+
+template<>
+StorageList
+StorageReader::get<StorageList>() {
+    if (not this->isList()) {
+        throw std::runtime_error("Savegame entry is not a list: " + this->key());
+    }
+    m_impl->m_nestedPending = false;
+    return m_impl->readList();
+}
@@ -29,6 +29,8 @@ namespace Ogre {
 
 namespace thrive {
 
+class StorageReader;
+class StorageWriter;
 
 /**
 * @brief A key-value storage for serialization
@@ -205,6 +207,9 @@ public:
 
 private:
 
+    friend class StorageReader;
+    friend class StorageWriter;
+
     struct Implementation;
     std::unique_ptr<Implementation> m_impl;
 };
@@ -212,6 +217,8 @@ private:
 /**
 * @brief Output stream operator for StorageContainer
 *
+* Writes \a storage with a StorageWriter.
+*
 * @param stream
 * @param storage
 *
@@ -226,6 +233,10 @@ operator << (
 /**
 * @brief Input stream operator for StorageContainer
 *
+* Reads what StorageWriter wrote, but also the older savegames with the
+* keys in place, and the older encodings of floating point numbers (as
+* strings) and Ogre types (as nested containers).
+*
 * @param stream
 * @param storage
 *
@@ -330,6 +341,311 @@ public:
 
 };
 
+/**
+* @brief Writes a savegame straight to a stream
+*
+* Unlike serializing a StorageContainer, this doesn't need the whole
+* savegame in memory. The writer is always positioned in a container,
+* starting with the outermost one. Values are written with set(), nested
+* containers and lists are opened with beginContainer() and beginList()
+* and closed with end(). Components write themselves with 
+* Component::write(), which only builds a StorageContainer for types that
+* don't override it.
+*
+* Each key is written once, when it is first used. The writer keeps its
+* own table of the keys written so far. Containers and lists are
+* terminated instead of prefixed with their size. Floating point numbers
+* are written as raw IEEE 754 values, Ogre vectors, quaternions and
+* planes as packed records of them.
+*
+* Usage example:
+* \code
+* StorageWriter writer(stream);
+* writer.set<std::string>("name", "thrive");
+* writer.beginList("entities");
+* for (EntityId entityId : entityIds) {
+*     writer.beginElement();
+*     writer.set("id", entityId);
+*     writer.end();
+* }
+* writer.end();
+* writer.finish();
+* \endcode
+*
+* @see StorageReader
+*/
+class StorageWriter {
+
+public:
+
+    /**
+    * @brief Constructor
+    *
+    * Writes the header and opens the outermost container.
+    *
+    * @param stream
+    *   The stream to write to, should be binary and buffered
+    */
+    explicit StorageWriter(
+        std::ostream& stream
+    );
+
+    /**
+    * @brief Destructor
+    *
+    * Does not finish the savegame, see finish().
+    */
+    ~StorageWriter();
+
+    /**
+    * @brief Opens a nested container in the current container
+    *
+    * @param key
+    *   The nested container's key
+    */
+    void
+    beginContainer(
+        const std::string& key
+    );
+
+    /**
+    * @brief Opens a container as the next element of the current list
+    */
+    void
+    beginElement();
+
+    /**
+    * @brief Opens a list in the current container
+    *
+    * @param key
+    *   The list's key
+    */
+    void
+    beginList(
+        const std::string& key
+    );
+
+    /**
+    * @brief Closes the innermost open container or list
+    */
+    void
+    end();
+
+    /**
+    * @brief Closes all open containers and lists
+    *
+    * The savegame is incomplete until this is called.
+    */
+    void
+    finish();
+
+    /**
+    * @brief Writes a value into the current container
+    *
+    * Containers and lists are written as a whole.
+    *
+    * @tparam T
+    *   The value's type, any storable type
+    * @param key
+    *   The value's key
+    * @param value
+    *   The value to write
+    */
+    template<typename T>
+    void
+    set(
+        const std::string& key,
+        const T& value
+    );
+
+    /**
+    * @brief Writes all entries of a container into the current container
+    *
+    * @param container
+    *   The container to copy the entries from
+    */
+    void
+    writeEntries(
+        const StorageContainer& container
+    );
+
+private:
+
+    struct Implementation;
+    std::unique_ptr<Implementation> m_impl;
+
+};
+
+/**
+* @brief Reads a savegame written by StorageWriter, one entry at a time
+*
+* The reader is always positioned in a container, starting with the
+* outermost one. next() advances to the container's next entry, whose key
+* and value are then available with key() and get(). Nested containers
+* and lists are only read when they are entered with enter(), or read as
+* a whole with get(). Otherwise, next() skips them.
+*
+* Usage example:
+* \code
+* StorageReader reader(stream);
+* while (reader.next()) {
+*     if (reader.key() == "name") {
+*         std::string name = reader.get<std::string>();
+*     }
+*     else if (reader.key() == "entities" and reader.isList()) {
+*         reader.enter();
+*         while (reader.nextElement()) {
+*             StorageContainer entity = reader.readContainer();
+*         }
+*     }
+* }
+* \endcode
+*
+* @see StorageWriter
+*/
+class StorageReader {
+
+public:
+
+    /**
+    * @brief Checks whether a stream holds a savegame written by StorageWriter
+    *
+    * Leaves the stream's position where it was, so the stream must be
+    * seekable.
+    *
+    * @param stream
+    *   The stream to check
+    */
+    static bool
+    canRead(
+        std::istream& stream
+    );
+
+    /**
+    * @brief Constructor
+    *
+    * Reads the header and positions the reader in the outermost container.
+    *
+    * @param stream
+    *   The stream to read from
+    *
+    * @throws std::runtime_error if the stream doesn't start with a savegame
+    *   written by StorageWriter
+    */
+    explicit StorageReader(
+        std::istream& stream
+    );
+
+    /**
+    * @brief Destructor
+    */
+    ~StorageReader();
+
+    /**
+    * @brief Enters the current entry's container or list
+    *
+    * Afterwards, iterate over the container with next() or over the list
+    * with nextElement().
+    */
+    void
+    enter();
+
+    /**
+    * @brief Reads the current entry's value
+    *
+    * For containers and lists, the whole value is read.
+    *
+    * @tparam T
+    *   The value's type, any storable type
+    *
+    * @throws std::runtime_error if the value is not a \a T
+    */
+    template<typename T>
+    T
+    get();
+
+    /**
+    * @brief Whether the current entry is a container that can be entered
+    */
+    bool
+    isContainer() const;
+
+    /**
+    * @brief Whether the current entry is a list that can be entered
+    */
+    bool
+    isList() const;
+
+    /**
+    * @brief The current entry's key
+    */
+    const std::string&
+    key() const;
+
+    /**
+    * @brief Advances to the next entry of the current container
+    *
+    * @return
+    *   \c false if the container has no more entries. The reader is then
+    *   back in the enclosing container or list.
+    */
+    bool
+    next();
+
+    /**
+    * @brief Advances to the next element of the current list
+    *
+    * The element is entered, iterate over it with next() or read it with
+    * readContainer().
+    *
+    * @return
+    *   \c false if the list has no more elements. The reader is then back
+    *   in the enclosing container.
+    */
+    bool
+    nextElement();
+
+    /**
+    * @brief Reads the rest of the current container and leaves it
+    *
+    * @return
+    *   The container's remaining entries
+    */
+    StorageContainer
+    readContainer();
+
+    /**
+    * @brief Copies the current entry into a container
+    *
+    * Containers and lists are read as a whole. The entry must not have
+    * been entered.
+    *
+    * @param container
+    *   The container to set the entry's key in
+    */
+    void
+    readEntry(
+        StorageContainer& container
+    );
+
+private:
+
+    friend std::istream&
+    operator >> (
+        std::istream& stream,
+        StorageContainer& storage
+    );
+
+    StorageReader(
+        std::istream& stream,
+        bool readHeader
+    );
+
+    struct Implementation;
+    std::unique_ptr<Implementation> m_impl;
+
+};
+
 /**
 * @brief Macro for declaring a new storable type
 *
@@ -356,6 +672,17 @@ public:
     StorageContainer::set<typeName>( \
         const std::string& key, \
         typeName value \
+    ); \
+    \
+    template<> \
+    typeName \
+    StorageReader::get<typeName>(); \
+    \
+    template<> \
+    void \
+    StorageWriter::set<typeName>( \
+        const std::string& key, \
+        const typeName& value \
     );
 
 // Native types
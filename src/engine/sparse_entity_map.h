@@ -0,0 +1,412 @@
+#pragma once
+
+#include "engine/typedefs.h"
+
+#include <cassert>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace thrive {
+
+/**
+* @brief Maps entity ids to values using a sparse set
+*
+* The values are kept in a packed (dense) array of (EntityId, Value) pairs,
+* so iterating over them is cache friendly. A second, sparse array maps
+* each entity id to its position in the dense array, which makes lookups
+* O(1) without any hashing.
+*
+* The sparse array is addressed by the entity's index (see entityIndex()).
+* Lookups compare the full id, so a stale id whose index has been recycled
+* is not found. The sparse array is split into pages that are only 
+* allocated when an index in their range is actually inserted, and 
+* released again when they become empty.
+*
+* Removing an element moves the last element into its place, so erasing
+* invalidates iterators and references to the last element and does not
+* preserve insertion order.
+*
+* @tparam Value
+*   The mapped type
+*/
+template<typename Value>
+class SparseEntityMap {
+
+public:
+
+    /**
+    * @brief The element type of the dense array
+    */
+    using value_type = std::pair<EntityId, Value>;
+
+    /**
+    * @brief The underlying dense storage
+    */
+    using Storage = std::vector<value_type>;
+
+    /**
+    * @brief Iterator over the dense storage
+    *
+    * @warning
+    *   Do not change the entity id of an element through this iterator.
+    */
+    using iterator = typename Storage::iterator;
+
+    /**
+    * @brief Const iterator over the dense storage
+    */
+    using const_iterator = typename Storage::const_iterator;
+
+    /**
+    * @brief Number of entity ids covered by one page of the sparse array
+    */
+    static const size_t PAGE_SIZE = 1024;
+
+    /**
+    * @brief Retrieves the value of an entity
+    *
+    * Inserts a default constructed value if the entity is not present yet.
+    *
+    * @param id
+    *   The entity to look up
+    *
+    * @return
+    *   A reference to the entity's value
+    */
+    Value&
+    operator[] (
+        EntityId id
+    ) {
+        auto iter = this->find(id);
+        if (iter != m_dense.end()) {
+            return iter->second;
+        }
+        return this->insert(value_type(id, Value())).first->second;
+    }
+
+    /**
+    * @brief Retrieves the value of an entity
+    *
+    * @param id
+    *   The entity to look up
+    *
+    * @return
+    *   A reference to the entity's value
+    *
+    * @throws std::out_of_range if \a id is not present
+    */
+    Value&
+    at(
+        EntityId id
+    ) {
+        auto iter = this->find(id);
+        if (iter == m_dense.end()) {
+            throw std::out_of_range("Entity not found in SparseEntityMap");
+        }
+        return iter->second;
+    }
+
+    /**
+    * @brief Const overload of SparseEntityMap::at
+    */
+    const Value&
+    at(
+        EntityId id
+    ) const {
+        auto iter = this->find(id);
+        if (iter == m_dense.end()) {
+            throw std::out_of_range("Entity not found in SparseEntityMap");
+        }
+        return iter->second;
+    }
+
+    /**
+    * @brief Iterator to the first element of the dense storage
+    */
+    iterator
+    begin() {
+        return m_dense.begin();
+    }
+
+    /**
+    * @brief Const iterator to the first element of the dense storage
+    */
+    const_iterator
+    begin() const {
+        return m_dense.begin();
+    }
+
+    /**
+    * @brief Const iterator to the first element of the dense storage
+    */
+    const_iterator
+    cbegin() const {
+        return m_dense.cbegin();
+    }
+
+    /**
+    * @brief Const iterator past the last element of the dense storage
+    */
+    const_iterator
+    cend() const {
+        return m_dense.cend();
+    }
+
+    /**
+    * @brief Removes all elements and releases all pages
+    */
+    void
+    clear() {
+        m_dense.clear();
+        m_pages.clear();
+        m_pageUsage.clear();
+    }
+
+    /**
+    * @brief Checks for an entity
+    *
+    * @param id
+    *   The entity to check for
+    *
+    * @return
+    *   \c 1 if the entity is present, \c 0 otherwise
+    */
+    size_t
+    count(
+        EntityId id
+    ) const {
+        return this->position(id) == NO_POSITION ? 0 : 1;
+    }
+
+    /**
+    * @brief Whether this map is empty
+    */
+    bool
+    empty() const {
+        return m_dense.empty();
+    }
+
+    /**
+    * @brief Iterator past the last element of the dense storage
+    */
+    iterator
+    end() {
+        return m_dense.end();
+    }
+
+    /**
+    * @brief Const iterator past the last element of the dense storage
+    */
+    const_iterator
+    end() const {
+        return m_dense.end();
+    }
+
+    /**
+    * @brief Removes an entity
+    *
+    * The last element of the dense storage is moved into the removed
+    * element's place.
+    *
+    * @param id
+    *   The entity to remove
+    *
+    * @return
+    *   \c 1 if the entity was removed, \c 0 if it was not present
+    */
+    size_t
+    erase(
+        EntityId id
+    ) {
+        size_t index = this->position(id);
+        if (index == NO_POSITION) {
+            return 0;
+        }
+        size_t last = m_dense.size() - 1;
+        if (index != last) {
+            m_dense[index] = std::move(m_dense[last]);
+            this->setPosition(m_dense[index].first, index);
+        }
+        m_dense.pop_back();
+        this->releasePosition(id);
+        return 1;
+    }
+
+    /**
+    * @brief Finds an entity
+    *
+    * @param id
+    *   The entity to look for
+    *
+    * @return
+    *   An iterator to the entity's element or end() if not found
+    */
+    iterator
+    find(
+        EntityId id
+    ) {
+        size_t index = this->position(id);
+        if (index == NO_POSITION) {
+            return m_dense.end();
+        }
+        return m_dense.begin() + index;
+    }
+
+    /**
+    * @brief Const overload of SparseEntityMap::find
+    */
+    const_iterator
+    find(
+        EntityId id
+    ) const {
+        size_t index = this->position(id);
+        if (index == NO_POSITION) {
+            return m_dense.end();
+        }
+        return m_dense.begin() + index;
+    }
+
+    /**
+    * @brief Inserts an element if its entity is not present yet
+    *
+    * An element with a different generation of the same index must not
+    * be present.
+    *
+    * @param value
+    *   The element to insert
+    *
+    * @return
+    *   An iterator to the entity's element and \c true if the element
+    *   was inserted, \c false if the entity was already present.
+    */
+    std::pair<iterator, bool>
+    insert(
+        value_type value
+    ) {
+        EntityId id = value.first;
+        size_t index = this->position(id);
+        if (index != NO_POSITION) {
+            return std::make_pair(m_dense.begin() + index, false);
+        }
+        m_dense.push_back(std::move(value));
+        this->acquirePosition(id, m_dense.size() - 1);
+        return std::make_pair(m_dense.end() - 1, true);
+    }
+
+    /**
+    * @brief Reserves space in the dense storage
+    *
+    * @param size
+    *   The number of elements to reserve space for
+    */
+    void
+    reserve(
+        size_t size
+    ) {
+        m_dense.reserve(size);
+    }
+
+    /**
+    * @brief The number of elements
+    */
+    size_t
+    size() const {
+        return m_dense.size();
+    }
+
+private:
+
+    using Position = uint32_t;
+
+    static const Position NO_POSITION_ENTRY = std::numeric_limits<Position>::max();
+
+    static const size_t NO_POSITION = static_cast<size_t>(-1);
+
+    static size_t
+    sparseIndex(
+        EntityId id
+    ) {
+        return entityIndex(id);
+    }
+
+    void
+    acquirePosition(
+        EntityId id,
+        size_t index
+    ) {
+        size_t sparse = sparseIndex(id);
+        size_t page = sparse / PAGE_SIZE;
+        if (page >= m_pages.size()) {
+            m_pages.resize(page + 1);
+            m_pageUsage.resize(page + 1, 0);
+        }
+        if (m_pages[page].empty()) {
+            m_pages[page].assign(PAGE_SIZE, NO_POSITION_ENTRY);
+        }
+        assert(
+            m_pages[page][sparse % PAGE_SIZE] == NO_POSITION_ENTRY &&
+            "Index is still in use by another generation"
+        );
+        m_pages[page][sparse % PAGE_SIZE] = static_cast<Position>(index);
+        m_pageUsage[page] += 1;
+    }
+
+    size_t
+    position(
+        EntityId id
+    ) const {
+        size_t sparse = sparseIndex(id);
+        size_t page = sparse / PAGE_SIZE;
+        if (page >= m_pages.size() or m_pages[page].empty()) {
+            return NO_POSITION;
+        }
+        Position index = m_pages[page][sparse % PAGE_SIZE];
+        if (index == NO_POSITION_ENTRY or m_dense[index].first != id) {
+            return NO_POSITION;
+        }
+        return index;
+    }
+
+    void
+    releasePosition(
+        EntityId id
+    ) {
+        size_t sparse = sparseIndex(id);
+        size_t page = sparse / PAGE_SIZE;
+        m_pages[page][sparse % PAGE_SIZE] = NO_POSITION_ENTRY;
+        m_pageUsage[page] -= 1;
+        if (m_pageUsage[page] == 0) {
+            // Give the page's memory back
+            std::vector<Position>().swap(m_pages[page]);
+        }
+    }
+
+    void
+    setPosition(
+        EntityId id,
+        size_t index
+    ) {
+        size_t sparse = sparseIndex(id);
+        m_pages[sparse / PAGE_SIZE][sparse % PAGE_SIZE] = static_cast<Position>(index);
+    }
+
+    Storage m_dense;
+
+    std::vector<uint16_t> m_pageUsage;
+
+    std::vector<std::vector<Position>> m_pages;
+
+};
+
+template<typename Value>
+const size_t SparseEntityMap<Value>::PAGE_SIZE;
+
+template<typename Value>
+const typename SparseEntityMap<Value>::Position SparseEntityMap<Value>::NO_POSITION_ENTRY;
+
+template<typename Value>
+const size_t SparseEntityMap<Value>::NO_POSITION;
+
+}
@@ -1,6 +1,7 @@
 #include "engine/system.h"
 
 #include "engine/engine.h"
+#include "engine/entity_command_buffer.h"
 #include "engine/game_state.h"
 #include "scripting/luabind.h"
 
@@ -16,6 +17,11 @@ using namespace thrive;
 */
 struct SystemWrapper : System, luabind::wrap_base {
 
+    SystemWrapper() {
+        // Lua can only be run from the main thread
+        this->setMainThreadOnly(true);
+    }
+
     void
     init(
         GameState* gameState
@@ -69,22 +75,53 @@ System::luaBindings() {
         .def(constructor<>())
         .def("enabled", &System::enabled)
         .def("init", &System::init, &SystemWrapper::default_init)
+        .def("readsComponent", &System::readsComponent)
         .def("setEnabled", &System::setEnabled)
         .def("shutdown", &System::shutdown, &SystemWrapper::default_shutdown)
         .def("update", &System::update, &SystemWrapper::default_update)
+        .def("writesComponent", &System::writesComponent)
     ;
 }
 
 
 struct System::Implementation {
 
+    std::unique_ptr<EntityCommandBuffer> m_commandBuffer;
+
     bool m_enabled = true;
 
     GameState* m_gameState = nullptr;
 
+    bool m_mainThreadOnly = false;
+
+    std::string m_name = "System";
+
+    bool m_presentation = false;
+
+    std::set<ComponentTypeId> m_readComponents;
+
+    bool m_runsHeadless = true;
+
+    std::set<ComponentTypeId> m_writtenComponents;
+
 };
 
 
+// Whether any element of a is also in b
+static bool
+intersects(
+    const std::set<ComponentTypeId>& a,
+    const std::set<ComponentTypeId>& b
+) {
+    for (ComponentTypeId typeId : a) {
+        if (b.count(typeId) > 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+
 System::System()
   : m_impl(new Implementation())
 {
@@ -100,6 +137,30 @@ System::activate() {
 }
 
 
+EntityCommandBuffer&
+System::commandBuffer() {
+    assert(m_impl->m_commandBuffer && "System is not initialized");
+    return *m_impl->m_commandBuffer;
+}
+
+
+bool
+System::conflictsWith(
+    const System& other
+) const {
+    if (not this->hasDeclaredAccess() or not other.hasDeclaredAccess()) {
+        return true;
+    }
+    const auto& ours = *m_impl;
+    const auto& theirs = *other.m_impl;
+    return 
+        intersects(ours.m_writtenComponents, theirs.m_writtenComponents) or
+        intersects(ours.m_writtenComponents, theirs.m_readComponents) or
+        intersects(ours.m_readComponents, theirs.m_writtenComponents)
+    ;
+}
+
+
 void
 System::deactivate() {
     // Nothing
@@ -140,12 +201,62 @@ System::gameState() const {
 }
 
 
+bool
+System::hasDeclaredAccess() const {
+    return 
+        not m_impl->m_readComponents.empty() or
+        not m_impl->m_writtenComponents.empty()
+    ;
+}
+
+
 void
 System::init(
     GameState* gameState
 ) {
     assert(m_impl->m_gameState == nullptr && "Cannot initialize system that is already attached to a GameState");
     m_impl->m_gameState = gameState;
+    m_impl->m_commandBuffer.reset(
+        new EntityCommandBuffer(gameState->entityManager())
+    );
+}
+
+
+bool
+System::isPresentation() const {
+    return m_impl->m_presentation;
+}
+
+
+bool
+System::mainThreadOnly() const {
+    return m_impl->m_mainThreadOnly;
+}
+
+
+const std::string&
+System::name() const {
+    return m_impl->m_name;
+}
+
+
+const std::set<ComponentTypeId>&
+System::readComponents() const {
+    return m_impl->m_readComponents;
+}
+
+
+void
+System::readsComponent(
+    ComponentTypeId typeId
+) {
+    m_impl->m_readComponents.insert(typeId);
+}
+
+
+bool
+System::runsHeadless() const {
+    return m_impl->m_runsHeadless;
 }
 
 
@@ -158,8 +269,55 @@ System::setEnabled(
 
 
 
+void
+System::setMainThreadOnly(
+    bool mainThreadOnly
+) {
+    m_impl->m_mainThreadOnly = mainThreadOnly;
+}
+
+
+void
+System::setName(
+    std::string name
+) {
+    m_impl->m_name = std::move(name);
+}
+
+
+void
+System::setPresentation(
+    bool presentation
+) {
+    m_impl->m_presentation = presentation;
+}
+
+
+void
+System::setRunsHeadless(
+    bool runsHeadless
+) {
+    m_impl->m_runsHeadless = runsHeadless;
+}
+
+
 void
 System::shutdown() {
+    m_impl->m_commandBuffer.reset();
     m_impl->m_gameState = nullptr;
 }
 
+
+void
+System::writesComponent(
+    ComponentTypeId typeId
+) {
+    m_impl->m_writtenComponents.insert(typeId);
+}
+
+
+const std::set<ComponentTypeId>&
+System::writtenComponents() const {
+    return m_impl->m_writtenComponents;
+}
+
@@ -1,6 +1,10 @@
 #pragma once
 
+#include "engine/typedefs.h"
+
 #include <memory>
+#include <set>
+#include <string>
 
 namespace luabind {
 class scope;
@@ -9,6 +13,7 @@ class scope;
 namespace thrive {
 
 class Engine;
+class EntityCommandBuffer;
 class EntityManager;
 class GameState;
 
@@ -18,6 +23,12 @@ class GameState;
 * Systems can operate on entities and their components, but they can also 
 * handle tasks that don't require components at all, such as issuing a render
 * call to the graphics engine.
+*
+* Systems can declare which component types they read and write. A system
+* that has declared its accesses may be updated concurrently with other 
+* systems it doesn't conflict with (see SystemScheduler). Systems without 
+* any declarations are updated on the main thread, after all systems before 
+* them and before all systems after them.
 */
 class System {
 
@@ -27,8 +38,10 @@ public:
     * @brief Lua bindings
     *
     * Exposes:
-    * - System::active
-    * - System::setActive
+    * - System::enabled
+    * - System::readsComponent
+    * - System::setEnabled
+    * - System::writesComponent
     *
     * @return 
     */
@@ -54,6 +67,34 @@ public:
     virtual void
     activate();
 
+    /**
+    * @brief The system's command buffer
+    *
+    * Use this to create and destroy entities or to add and remove 
+    * components from a worker thread. The commands are played back by 
+    * GameState::update() after all systems have been updated, in the 
+    * order of the systems.
+    *
+    * Only valid while the system is initialized.
+    */
+    EntityCommandBuffer&
+    commandBuffer();
+
+    /**
+    * @brief Whether this system has to be updated before or after \a other
+    *
+    * Two systems conflict if either of them hasn't declared its component 
+    * accesses or if one of them writes a component type that the other
+    * reads or writes.
+    *
+    * @param other
+    *   The system to check against
+    */
+    bool
+    conflictsWith(
+        const System& other
+    ) const;
+
     /**
     * @brief Called by GameState::deactivate()
     *
@@ -92,6 +133,12 @@ public:
     EntityManager*
     entityManager() const;
 
+    /**
+    * @brief Whether the system has declared any component accesses
+    */
+    bool
+    hasDeclaredAccess() const;
+
     /**
     * @brief Returns the system's game state
     *
@@ -113,6 +160,69 @@ public:
         GameState* gameState
     );
 
+    /**
+    * @brief Whether this system presents the simulation's state
+    *
+    * Presentation systems (rendering, sound, UI) are updated once per
+    * rendered frame with the frame's duration. All other systems are
+    * simulation systems, which are updated in fixed time steps if the
+    * engine has a simulation timestep (see Engine::setSimulationTimestep()).
+    *
+    * Presentation systems declared before the last simulation system are
+    * updated before the simulation systems, the others afterwards.
+    */
+    bool
+    isPresentation() const;
+
+    /**
+    * @brief Whether this system must be updated on the main thread
+    *
+    * Systems implemented in Lua and systems calling into libraries that 
+    * are not thread safe (such as Ogre) are pinned to the main thread.
+    */
+    bool
+    mainThreadOnly() const;
+
+    /**
+    * @brief The system's name, used for profiling
+    *
+    * Engine::createGameState() names each system after its (Lua) class.
+    * Defaults to "System".
+    */
+    const std::string&
+    name() const;
+
+    /**
+    * @brief The component types this system has declared as read
+    */
+    const std::set<ComponentTypeId>&
+    readComponents() const;
+
+    /**
+    * @brief Declares that this system reads components of a type
+    *
+    * Call this before the system's game state is initialized, usually 
+    * in the constructor or in init().
+    *
+    * @param typeId
+    *   The component type
+    */
+    void
+    readsComponent(
+        ComponentTypeId typeId
+    );
+
+    /**
+    * @brief Whether this system can run in a headless engine
+    *
+    * Systems that need a render window, rendering resources or a sound
+    * device return \c false. Game states of a headless engine (see
+    * Engine::setHeadless()) leave such systems out entirely. They are 
+    * neither initialized, activated nor updated.
+    */
+    bool
+    runsHeadless() const;
+
     /**
     * @brief Sets the enabled status of this system
     *
@@ -125,6 +235,44 @@ public:
         bool enabled
     );
 
+    /**
+    * @brief Sets the system's name
+    *
+    * @param name
+    *
+    * @see name()
+    */
+    void
+    setName(
+        std::string name
+    );
+
+    /**
+    * @brief Sets whether this system is a presentation system
+    *
+    * Call this before the system's game state is initialized.
+    *
+    * @param presentation
+    *
+    * @see isPresentation()
+    */
+    void
+    setPresentation(
+        bool presentation
+    );
+
+    /**
+    * @brief Sets whether this system can run in a headless engine
+    *
+    * @param runsHeadless
+    *
+    * @see runsHeadless()
+    */
+    void
+    setRunsHeadless(
+        bool runsHeadless
+    );
+
     /**
     * @brief Shuts the system down
     *
@@ -146,12 +294,50 @@ public:
     * @note
     *   If you need to know the time since the last call to \a this system's
     *   update() function, you'll have to measure it yourself.
+    *
+    * @note
+    *   If the system has declared its component accesses and is not 
+    *   main thread only, this may be called from a worker thread.
     */
     virtual void
     update(
         int milliSeconds
     ) = 0;
 
+    /**
+    * @brief Declares that this system writes components of a type
+    *
+    * Adding and removing components counts as writing them. Call this 
+    * before the system's game state is initialized, usually in the 
+    * constructor or in init().
+    *
+    * @param typeId
+    *   The component type
+    */
+    void
+    writesComponent(
+        ComponentTypeId typeId
+    );
+
+    /**
+    * @brief The component types this system has declared as written
+    */
+    const std::set<ComponentTypeId>&
+    writtenComponents() const;
+
+protected:
+
+    /**
+    * @brief Pins this system to the main thread
+    *
+    * @param mainThreadOnly
+    *   Whether the system must be updated on the main thread
+    */
+    void
+    setMainThreadOnly(
+        bool mainThreadOnly
+    );
+
 private:
 
     struct Implementation;
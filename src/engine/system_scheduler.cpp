@@ -0,0 +1,104 @@
+#include "engine/system_scheduler.h"
+
+#include "engine/profiler.h"
+#include "engine/system.h"
+#include "engine/task_graph.h"
+#include "engine/thread_pool.h"
+
+using namespace thrive;
+
+struct SystemScheduler::Implementation {
+
+    void
+    updateSystem(
+        std::size_t index,
+        int milliseconds
+    ) {
+        System* system = m_systems[index];
+        if (not system->enabled()) {
+            return;
+        }
+        if (not m_profiler) {
+            system->update(milliseconds);
+            return;
+        }
+        std::int64_t begin = m_profiler->now();
+        system->update(milliseconds);
+        m_profiler->record(m_profilerNames[index], begin, m_profiler->now());
+    }
+
+    TaskGraph m_graph;
+
+    bool m_hasWorkerSystems = false;
+
+    int m_milliseconds = 0;
+
+    Profiler* m_profiler = nullptr;
+
+    std::vector<Profiler::NameId> m_profilerNames;
+
+    std::vector<System*> m_systems;
+
+};
+
+
+SystemScheduler::SystemScheduler(
+    std::vector<System*> systems,
+    Profiler* profiler
+) : m_impl(new Implementation())
+{
+    Implementation* impl = m_impl.get();
+    m_impl->m_profiler = profiler;
+    for (std::size_t i = 0; i < systems.size(); ++i) {
+        System* system = systems[i];
+        bool workerSystem = 
+            system->hasDeclaredAccess() and 
+            not system->mainThreadOnly()
+        ;
+        m_impl->m_graph.addTask(
+            [impl, i]() {
+                impl->updateSystem(i, impl->m_milliseconds);
+            },
+            not workerSystem
+        );
+        if (profiler) {
+            m_impl->m_profilerNames.push_back(
+                profiler->registerName(system->name())
+            );
+        }
+        for (std::size_t j = 0; j < i; ++j) {
+            if (systems[j]->conflictsWith(*system)) {
+                m_impl->m_graph.addDependency(j, i);
+            }
+        }
+        m_impl->m_hasWorkerSystems = m_impl->m_hasWorkerSystems or workerSystem;
+    }
+    m_impl->m_systems = std::move(systems);
+}
+
+
+SystemScheduler::~SystemScheduler() {}
+
+
+const std::vector<std::size_t>&
+SystemScheduler::dependencies(
+    std::size_t index
+) const {
+    return m_impl->m_graph.dependencies(index);
+}
+
+
+void
+SystemScheduler::update(
+    int milliseconds,
+    ThreadPool& threadPool
+) {
+    if (not m_impl->m_hasWorkerSystems or threadPool.workerCount() == 0) {
+        for (std::size_t i = 0; i < m_impl->m_systems.size(); ++i) {
+            m_impl->updateSystem(i, milliseconds);
+        }
+        return;
+    }
+    m_impl->m_milliseconds = milliseconds;
+    m_impl->m_graph.run(threadPool);
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+namespace thrive {
+
+class Profiler;
+class System;
+class ThreadPool;
+
+/**
+* @brief Updates a game state's systems, running independent ones concurrently
+*
+* On construction, the scheduler builds a dependency graph from the systems'
+* declared component accesses. A system depends on every system before it
+* (in declaration order) that it conflicts with (see System::conflictsWith()).
+* Systems without declarations conflict with everything, so they act as
+* barriers and the ordering between them is the same as without a scheduler.
+*
+* The graph is executed as a TaskGraph: each system is started as soon as 
+* all its dependencies have finished. Systems that are main thread only 
+* (including all systems implemented in Lua) and systems without 
+* declarations run on the calling thread, all others on the thread pool.
+*
+* The graph is not rebuilt when systems change their declarations later.
+*
+* If the scheduler has a Profiler, each system update is recorded as a 
+* sample named after the system (see System::name()).
+*/
+class SystemScheduler {
+
+public:
+
+    /**
+    * @brief Constructor
+    *
+    * @param systems
+    *   The systems to schedule, in update order. The scheduler does not
+    *   take ownership.
+    * @param profiler
+    *   The profiler to record the systems' update times with. May be 
+    *   \c null. Must outlive the scheduler.
+    */
+    explicit SystemScheduler(
+        std::vector<System*> systems,
+        Profiler* profiler = nullptr
+    );
+
+    /**
+    * @brief Destructor
+    */
+    ~SystemScheduler();
+
+    /**
+    * @brief The systems that a system has to wait for
+    *
+    * @param index
+    *   The system's position in the list passed to the constructor
+    *
+    * @return
+    *   The positions of the systems \a index depends on, in ascending
+    *   order
+    */
+    const std::vector<std::size_t>&
+    dependencies(
+        std::size_t index
+    ) const;
+
+    /**
+    * @brief Updates all enabled systems
+    *
+    * Returns once all systems have been updated. If a system throws, the
+    * systems not started yet are skipped and the first exception is
+    * rethrown after the running systems have finished.
+    *
+    * @param milliseconds
+    *   Passed on to System::update()
+    * @param threadPool
+    *   The pool to run worker systems on. If it has no workers, all systems
+    *   are updated in turn on the calling thread.
+    */
+    void
+    update(
+        int milliseconds,
+        ThreadPool& threadPool
+    );
+
+private:
+
+    struct Implementation;
+    std::unique_ptr<Implementation> m_impl;
+
+};
+
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "engine/typedefs.h"
+
+#include <string>
+
+/**
+* @brief Declares a tag type
+*
+* A tag is a component type without data. Tagging an entity allocates
+* nothing, the tag is only a bit in the entity's ComponentSignature and an
+* entry in the tag's ComponentCollection (see ComponentCollection::isTag()).
+* Tags are added and removed with EntityManager::addTag() and
+* EntityManager::removeTag(). They can be used in EntityFilter (also
+* wrapped in Optional) and ScriptEntityFilter like any other component
+* type.
+*
+* This macro creates the following members:
+* - \c TYPE_ID: The tag's type id, defined by REGISTER_TAG.
+* - \c TYPE_NAME: Static function that returns \a name as a string.
+*
+* @param name
+*   The tag's name
+*
+* Example:
+* \code
+* // In the header
+* class SpawnedTag {
+*     TAG(SpawnedTag)
+* };
+*
+* // In the source file
+* REGISTER_TAG(SpawnedTag)
+*
+* // Tagging an entity
+* entityManager.addTag<SpawnedTag>(entityId);
+*
+* // Filtering for spawned microbes
+* EntityFilter<MicrobeComponent, SpawnedTag> m_entities;
+* \endcode
+*/
+#define TAG(name) \
+    public: \
+        \
+        static const thrive::ComponentTypeId TYPE_ID; \
+        \
+        static const std::string& TYPE_NAME() { \
+            static std::string string(#name); \
+            return string; \
+        } \
+        \
+    private: \
+
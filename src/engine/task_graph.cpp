@@ -0,0 +1,197 @@
+#include "engine/task_graph.h"
+
+#include "engine/thread_pool.h"
+
+#include <assert.h>
+#include <atomic>
+#include <boost/thread.hpp>
+#include <exception>
+#include <set>
+
+using namespace thrive;
+
+struct TaskGraph::Implementation {
+
+    struct Node {
+
+        bool m_callingThreadOnly;
+
+        std::vector<TaskId> m_dependencies;
+
+        std::vector<TaskId> m_dependents;
+
+        Task m_task;
+
+    };
+
+    // Must be called with m_mutex locked
+    void
+    finish(
+        TaskId taskId
+    ) {
+        for (TaskId dependent : m_nodes[taskId].m_dependents) {
+            m_waitingFor[dependent] -= 1;
+            if (m_waitingFor[dependent] == 0) {
+                this->start(dependent);
+            }
+        }
+        m_unfinished -= 1;
+        m_changed.notify_all();
+    }
+
+    void
+    execute(
+        TaskId taskId
+    ) {
+        std::exception_ptr error;
+        if (not m_failed) {
+            try {
+                m_nodes[taskId].m_task();
+            }
+            catch (...) {
+                error = std::current_exception();
+            }
+        }
+        boost::lock_guard<boost::mutex> lock(m_mutex);
+        if (error and not m_failed) {
+            m_error = error;
+            m_failed = true;
+        }
+        this->finish(taskId);
+    }
+
+    // Must be called with m_mutex locked
+    void
+    start(
+        TaskId taskId
+    ) {
+        if (m_nodes[taskId].m_callingThreadOnly) {
+            m_callingThreadQueue.insert(taskId);
+        }
+        else {
+            m_threadPool->submit([this, taskId]() {
+                this->execute(taskId);
+            });
+        }
+    }
+
+    // Ordered, so that pinned tasks run in the order they were added
+    // wherever the dependencies allow it
+    std::set<TaskId> m_callingThreadQueue;
+
+    boost::condition_variable m_changed;
+
+    std::exception_ptr m_error;
+
+    std::atomic<bool> m_failed{false};
+
+    boost::mutex m_mutex;
+
+    std::vector<Node> m_nodes;
+
+    ThreadPool* m_threadPool = nullptr;
+
+    std::size_t m_unfinished = 0;
+
+    std::vector<std::size_t> m_waitingFor;
+
+};
+
+
+TaskGraph::TaskGraph()
+  : m_impl(new Implementation())
+{
+}
+
+
+TaskGraph::~TaskGraph() {}
+
+
+void
+TaskGraph::addDependency(
+    TaskId before,
+    TaskId after
+) {
+    assert(before < after && "Tasks can only depend on earlier tasks");
+    assert(after < m_impl->m_nodes.size() && "Unknown task");
+    m_impl->m_nodes[after].m_dependencies.push_back(before);
+    m_impl->m_nodes[before].m_dependents.push_back(after);
+}
+
+
+TaskGraph::TaskId
+TaskGraph::addTask(
+    Task task,
+    bool callingThreadOnly
+) {
+    Implementation::Node node;
+    node.m_callingThreadOnly = callingThreadOnly;
+    node.m_task = std::move(task);
+    m_impl->m_nodes.push_back(std::move(node));
+    return m_impl->m_nodes.size() - 1;
+}
+
+
+const std::vector<TaskGraph::TaskId>&
+TaskGraph::dependencies(
+    TaskId taskId
+) const {
+    return m_impl->m_nodes.at(taskId).m_dependencies;
+}
+
+
+void
+TaskGraph::run(
+    ThreadPool& threadPool
+) {
+    if (threadPool.workerCount() == 0) {
+        for (auto& node : m_impl->m_nodes) {
+            node.m_task();
+        }
+        return;
+    }
+    boost::unique_lock<boost::mutex> lock(m_impl->m_mutex);
+    m_impl->m_error = nullptr;
+    m_impl->m_failed = false;
+    m_impl->m_threadPool = &threadPool;
+    m_impl->m_unfinished = m_impl->m_nodes.size();
+    m_impl->m_waitingFor.resize(m_impl->m_nodes.size());
+    for (TaskId taskId = 0; taskId < m_impl->m_nodes.size(); ++taskId) {
+        m_impl->m_waitingFor[taskId] = m_impl->m_nodes[taskId].m_dependencies.size();
+    }
+    for (TaskId taskId = 0; taskId < m_impl->m_nodes.size(); ++taskId) {
+        if (m_impl->m_waitingFor[taskId] == 0) {
+            m_impl->start(taskId);
+        }
+    }
+    auto& queue = m_impl->m_callingThreadQueue;
+    while (m_impl->m_unfinished > 0) {
+        if (not queue.empty()) {
+            TaskId taskId = *queue.begin();
+            queue.erase(queue.begin());
+            lock.unlock();
+            m_impl->execute(taskId);
+            lock.lock();
+            continue;
+        }
+        lock.unlock();
+        bool helped = threadPool.runPendingTask();
+        lock.lock();
+        if (not helped and queue.empty() and m_impl->m_unfinished > 0) {
+            m_impl->m_changed.wait(lock);
+        }
+    }
+    m_impl->m_threadPool = nullptr;
+    std::exception_ptr error = m_impl->m_error;
+    m_impl->m_error = nullptr;
+    lock.unlock();
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+
+std::size_t
+TaskGraph::size() const {
+    return m_impl->m_nodes.size();
+}
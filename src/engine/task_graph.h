@@ -0,0 +1,149 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace thrive {
+
+class ThreadPool;
+
+/**
+* @brief A set of tasks with dependencies between them
+*
+* Build the graph once with addTask() and addDependency(), then execute it
+* as often as needed with run(). Each run starts a task as soon as all the
+* tasks it depends on have finished.
+*
+* Tasks can be pinned to the thread calling run(), e.g. because they call
+* into Lua or Ogre. All other tasks are executed by the thread pool. While
+* the calling thread has no pinned task to execute, it helps the pool's
+* workers.
+*
+* Dependencies can only point from earlier to later tasks, so the graph
+* never has cycles and the order in which the tasks were added is always
+* a valid serial order.
+*
+* Usage example:
+* \code
+* TaskGraph graph;
+* auto load = graph.addTask(loadData);
+* auto left = graph.addTask(processLeftHalf);
+* auto right = graph.addTask(processRightHalf);
+* auto upload = graph.addTask(uploadResults, true);
+* graph.addDependency(load, left);
+* graph.addDependency(load, right);
+* graph.addDependency(left, upload);
+* graph.addDependency(right, upload);
+* graph.run(engine.threadPool());
+* \endcode
+*/
+class TaskGraph {
+
+public:
+
+    /**
+    * @brief A task in the graph
+    *
+    * Unlike ThreadPool::Task, a graph task may throw.
+    */
+    using Task = std::function<void()>;
+
+    /**
+    * @brief Identifies a task within its graph
+    */
+    using TaskId = std::size_t;
+
+    /**
+    * @brief Constructor
+    */
+    TaskGraph();
+
+    /**
+    * @brief Destructor
+    */
+    ~TaskGraph();
+
+    /**
+    * @brief Makes a task wait for another one
+    *
+    * @param before
+    *   The task that has to finish first
+    * @param after
+    *   The task that has to wait. Must have been added after \a before.
+    */
+    void
+    addDependency(
+        TaskId before,
+        TaskId after
+    );
+
+    /**
+    * @brief Adds a task
+    *
+    * @param task
+    *   The function to execute
+    * @param callingThreadOnly
+    *   If \c true, the task is always executed by the thread calling
+    *   run()
+    *
+    * @return
+    *   The new task's id
+    */
+    TaskId
+    addTask(
+        Task task,
+        bool callingThreadOnly = false
+    );
+
+    /**
+    * @brief The tasks that a task waits for
+    *
+    * @param taskId
+    *   The task to query
+    *
+    * @return
+    *   The ids of the tasks \a taskId depends on, in the order the
+    *   dependencies were added
+    */
+    const std::vector<TaskId>&
+    dependencies(
+        TaskId taskId
+    ) const;
+
+    /**
+    * @brief Executes all tasks
+    *
+    * Returns once all tasks have finished. If the pool has no workers, the
+    * tasks are executed in the order they were added.
+    *
+    * Must not be called again while the graph is running.
+    *
+    * @param threadPool
+    *   The pool to execute the tasks that are not pinned to the calling
+    *   thread
+    *
+    * @throws
+    *   The first exception thrown by a task. Tasks that have not been
+    *   started yet are skipped.
+    */
+    void
+    run(
+        ThreadPool& threadPool
+    );
+
+    /**
+    * @brief The number of tasks
+    */
+    std::size_t
+    size() const;
+
+private:
+
+    struct Implementation;
+    std::unique_ptr<Implementation> m_impl;
+
+};
+
+}
@@ -0,0 +1,460 @@
+#include "engine/telemetry.h"
+
+#include "engine/component_factory.h"
+#include "engine/engine.h"
+#include "engine/entity_manager.h"
+#include "engine/game_state.h"
+#include "engine/json_util.h"
+#include "engine/profiler.h"
+#include "game.h"
+#include "scripting/luabind.h"
+
+#include <boost/thread.hpp>
+#include <chrono>
+#include <fstream>
+#include <map>
+#include <stdexcept>
+#include <unordered_map>
+
+using namespace thrive;
+
+const std::size_t Telemetry::MAX_SAMPLES;
+
+namespace {
+
+struct Totals {
+
+    std::uint64_t added = 0;
+
+    std::uint64_t removed = 0;
+
+};
+
+bool
+endsWith(
+    const std::string& string,
+    const std::string& suffix
+) {
+    return string.size() >= suffix.size() and
+        string.compare(string.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+
+void
+writeCsvHeader(
+    std::ostream& stream
+) {
+    stream << "frame,milliseconds,name,count,peakCount,addedPerFrame,removedPerFrame,bytesAllocated\n";
+}
+
+
+void
+writeCsvSample(
+    std::ostream& stream,
+    const Telemetry::Sample& sample
+) {
+    stream
+        << sample.frame << "," << sample.milliseconds
+        << ",Entities," << sample.entityCount << ",,,,\n"
+    ;
+    for (const Telemetry::ComponentSample& component : sample.components) {
+        stream
+            << sample.frame << "," << sample.milliseconds
+            << "," << component.name
+            << "," << component.count
+            << "," << component.peakCount
+            << "," << component.addedPerFrame
+            << "," << component.removedPerFrame
+            << "," << component.bytesAllocated
+            << "\n"
+        ;
+    }
+    for (const auto& gauge : sample.gauges) {
+        stream
+            << sample.frame << "," << sample.milliseconds
+            << "," << gauge.first << "," << gauge.second << ",,,,\n"
+        ;
+    }
+}
+
+
+void
+writeJsonHeader(
+    std::ostream& stream
+) {
+    stream << "{\"samples\":[";
+}
+
+
+void
+writeJsonSample(
+    std::ostream& stream,
+    const Telemetry::Sample& sample,
+    bool isFirst
+) {
+    if (not isFirst) {
+        stream << ",";
+    }
+    stream
+        << "\n{\"frame\":" << sample.frame
+        << ",\"milliseconds\":" << sample.milliseconds
+        << ",\"entities\":" << sample.entityCount
+        << ",\"components\":["
+    ;
+    bool first = true;
+    for (const Telemetry::ComponentSample& component : sample.components) {
+        if (not first) {
+            stream << ",";
+        }
+        first = false;
+        stream << "{\"name\":";
+        writeJsonString(stream, component.name);
+        stream
+            << ",\"count\":" << component.count
+            << ",\"peakCount\":" << component.peakCount
+            << ",\"addedPerFrame\":" << component.addedPerFrame
+            << ",\"removedPerFrame\":" << component.removedPerFrame
+            << ",\"bytesAllocated\":" << component.bytesAllocated
+            << "}"
+        ;
+    }
+    stream << "],\"gauges\":{";
+    first = true;
+    for (const auto& gauge : sample.gauges) {
+        if (not first) {
+            stream << ",";
+        }
+        first = false;
+        writeJsonString(stream, gauge.first);
+        stream << ":" << gauge.second;
+    }
+    stream << "}}";
+}
+
+
+void
+writeJsonFooter(
+    std::ostream& stream
+) {
+    stream << "\n]}\n";
+}
+
+}
+
+
+struct Telemetry::Implementation {
+
+    // Appends a sample to the output file, if there is one
+    void
+    writeSample(
+        const Sample& sample
+    ) {
+        if (not m_output.is_open()) {
+            return;
+        }
+        if (m_outputIsJson) {
+            writeJsonSample(m_output, sample, m_outputSamples == 0);
+        }
+        else {
+            writeCsvSample(m_output, sample);
+        }
+        m_outputSamples += 1;
+        m_output.flush();
+    }
+
+    std::chrono::steady_clock::time_point m_begin = std::chrono::steady_clock::now();
+
+    std::map<std::string, double> m_gauges;
+
+    boost::mutex m_gaugesMutex;
+
+    unsigned int m_interval = 0;
+
+    // Rates are relative to this entity manager's previous totals
+    const EntityManager* m_lastEntityManager = nullptr;
+
+    std::uint64_t m_lastFrame = 0;
+
+    std::unordered_map<ComponentTypeId, Totals> m_lastTotals;
+
+    std::ofstream m_output;
+
+    std::string m_outputFile;
+
+    bool m_outputIsJson = false;
+
+    // Samples written to m_output so far
+    std::size_t m_outputSamples = 0;
+
+    std::vector<Sample> m_samples;
+
+};
+
+
+static luabind::object
+Telemetry_latest(
+    const Telemetry* self,
+    lua_State* L
+) {
+    if (self->samples().empty()) {
+        return luabind::object();
+    }
+    const Telemetry::Sample& sample = self->samples().back();
+    luabind::object result = luabind::newtable(L);
+    result["frame"] = sample.frame;
+    result["entities"] = sample.entityCount;
+    luabind::object components = luabind::newtable(L);
+    int index = 1;
+    for (const Telemetry::ComponentSample& componentSample : sample.components) {
+        luabind::object entry = luabind::newtable(L);
+        entry["name"] = componentSample.name;
+        entry["count"] = componentSample.count;
+        entry["peakCount"] = componentSample.peakCount;
+        entry["addedPerFrame"] = componentSample.addedPerFrame;
+        entry["removedPerFrame"] = componentSample.removedPerFrame;
+        entry["bytesAllocated"] = componentSample.bytesAllocated;
+        components[index] = entry;
+        index += 1;
+    }
+    result["components"] = components;
+    luabind::object gauges = luabind::newtable(L);
+    for (const auto& gauge : sample.gauges) {
+        gauges[gauge.first] = gauge.second;
+    }
+    result["gauges"] = gauges;
+    return result;
+}
+
+
+static void
+Telemetry_sample(
+    Telemetry* self
+) {
+    Engine& engine = Game::instance().engine();
+    self->sample(
+        engine.currentGameState()->entityManager(),
+        engine.componentFactory(),
+        engine.profiler().frame()
+    );
+}
+
+
+static void
+Telemetry_write(
+    const Telemetry* self,
+    const std::string& filename
+) {
+    self->write(filename);
+}
+
+
+luabind::scope
+Telemetry::luaBindings() {
+    using namespace luabind;
+    return class_<Telemetry>("Telemetry")
+        .def("interval", &Telemetry::interval)
+        .def("latest", &Telemetry_latest)
+        .def("sample", &Telemetry_sample)
+        .def("setGauge", &Telemetry::setGauge)
+        .def("setInterval", &Telemetry::setInterval)
+        .def("setOutputFile", &Telemetry::setOutputFile)
+        .def("write", &Telemetry_write)
+    ;
+}
+
+
+Telemetry::Telemetry()
+  : m_impl(new Implementation())
+{
+}
+
+
+Telemetry::~Telemetry() {
+    this->closeOutputFile();
+}
+
+
+void
+Telemetry::closeOutputFile() {
+    if (not m_impl->m_output.is_open()) {
+        return;
+    }
+    if (m_impl->m_outputIsJson) {
+        writeJsonFooter(m_impl->m_output);
+    }
+    m_impl->m_output.close();
+    m_impl->m_outputFile.clear();
+}
+
+
+unsigned int
+Telemetry::interval() const {
+    return m_impl->m_interval;
+}
+
+
+const std::string&
+Telemetry::outputFile() const {
+    return m_impl->m_outputFile;
+}
+
+
+void
+Telemetry::sample(
+    const EntityManager& entityManager,
+    const ComponentFactory& factory,
+    std::uint64_t frame
+) {
+    if (&entityManager != m_impl->m_lastEntityManager) {
+        m_impl->m_lastEntityManager = &entityManager;
+        m_impl->m_lastTotals.clear();
+    }
+    double frames = frame > m_impl->m_lastFrame ?
+        static_cast<double>(frame - m_impl->m_lastFrame) : 1.0;
+    Sample sample;
+    sample.frame = frame;
+    sample.milliseconds = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - m_impl->m_begin
+    ).count();
+    sample.entityCount = entityManager.entityCount();
+    for (const ComponentCollection::Statistics& statistics : entityManager.componentStatistics()) {
+        ComponentSample componentSample;
+        componentSample.name = factory.getTypeName(statistics.type);
+        if (componentSample.name.empty()) {
+            componentSample.name = "Component" + std::to_string(statistics.type);
+        }
+        componentSample.count = statistics.count;
+        componentSample.peakCount = statistics.peakCount;
+        componentSample.bytesAllocated = statistics.bytesAllocated;
+        Totals& totals = m_impl->m_lastTotals[statistics.type];
+        if (statistics.added < totals.added or statistics.removed < totals.removed) {
+            // A new entity manager at the same address
+            totals = Totals();
+        }
+        componentSample.addedPerFrame = (statistics.added - totals.added) / frames;
+        componentSample.removedPerFrame = (statistics.removed - totals.removed) / frames;
+        totals.added = statistics.added;
+        totals.removed = statistics.removed;
+        sample.components.push_back(std::move(componentSample));
+    }
+    {
+        boost::lock_guard<boost::mutex> lock(m_impl->m_gaugesMutex);
+        sample.gauges.assign(m_impl->m_gauges.begin(), m_impl->m_gauges.end());
+    }
+    m_impl->m_lastFrame = frame;
+    m_impl->writeSample(sample);
+    if (m_impl->m_samples.size() >= MAX_SAMPLES) {
+        m_impl->m_samples.erase(m_impl->m_samples.begin());
+    }
+    m_impl->m_samples.push_back(std::move(sample));
+}
+
+
+const std::vector<Telemetry::Sample>&
+Telemetry::samples() const {
+    return m_impl->m_samples;
+}
+
+
+void
+Telemetry::setGauge(
+    const std::string& name,
+    double value
+) {
+    boost::lock_guard<boost::mutex> lock(m_impl->m_gaugesMutex);
+    m_impl->m_gauges[name] = value;
+}
+
+
+void
+Telemetry::setInterval(
+    unsigned int frames
+) {
+    m_impl->m_interval = frames;
+}
+
+
+void
+Telemetry::setOutputFile(
+    const std::string& filename
+) {
+    this->closeOutputFile();
+    if (filename.empty()) {
+        return;
+    }
+    m_impl->m_output.open(filename, std::ofstream::trunc);
+    if (not m_impl->m_output) {
+        m_impl->m_output.close();
+        throw std::runtime_error("Could not open " + filename + " for writing the telemetry");
+    }
+    m_impl->m_outputFile = filename;
+    m_impl->m_outputIsJson = endsWith(filename, ".json");
+    m_impl->m_outputSamples = 0;
+    if (m_impl->m_outputIsJson) {
+        writeJsonHeader(m_impl->m_output);
+    }
+    else {
+        writeCsvHeader(m_impl->m_output);
+    }
+    for (const Sample& sample : m_impl->m_samples) {
+        m_impl->writeSample(sample);
+    }
+    m_impl->m_output.flush();
+}
+
+
+void
+Telemetry::update(
+    const EntityManager& entityManager,
+    const ComponentFactory& factory,
+    std::uint64_t frame
+) {
+    if (m_impl->m_interval == 0) {
+        return;
+    }
+    if (m_impl->m_samples.empty() or frame >= m_impl->m_lastFrame + m_impl->m_interval) {
+        this->sample(entityManager, factory, frame);
+    }
+}
+
+
+void
+Telemetry::write(
+    const std::string& filename
+) const {
+    std::ofstream stream(filename, std::ofstream::trunc);
+    if (not stream) {
+        throw std::runtime_error("Could not open " + filename + " for writing the telemetry");
+    }
+    if (endsWith(filename, ".json")) {
+        this->writeJson(stream);
+    }
+    else {
+        this->writeCsv(stream);
+    }
+}
+
+
+void
+Telemetry::writeCsv(
+    std::ostream& stream
+) const {
+    writeCsvHeader(stream);
+    for (const Sample& sample : m_impl->m_samples) {
+        writeCsvSample(stream, sample);
+    }
+}
+
+
+void
+Telemetry::writeJson(
+    std::ostream& stream
+) const {
+    writeJsonHeader(stream);
+    bool first = true;
+    for (const Sample& sample : m_impl->m_samples) {
+        writeJsonSample(stream, sample, first);
+        first = false;
+    }
+    writeJsonFooter(stream);
+}
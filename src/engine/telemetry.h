@@ -0,0 +1,321 @@
+#pragma once
+
+#include "engine/component_collection.h"
+
+#include <cstdint>
+#include <iosfwd>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace luabind {
+class scope;
+}
+
+namespace thrive {
+
+class ComponentFactory;
+class EntityManager;
+
+/**
+* @brief Samples entity and component populations over time
+*
+* Every few frames (see setInterval()), the telemetry takes a Sample of
+* the current game state's EntityManager: the number of entities and, per
+* component type, the current and peak number of components, how many
+* have been added and removed per frame since the last sample, and how
+* much memory the type's ComponentPool has reserved.
+*
+* Systems can add their own figures as gauges (see setGauge()), e.g. the
+* size of an internal map that should shrink again when entities are
+* destroyed.
+*
+* Each sample is appended to the output file (see setOutputFile()) as CSV
+* or JSON as soon as it is taken, and the file is flushed, so a crash 
+* only loses the samples that haven't been taken yet. Only the latest 
+* MAX_SAMPLES samples are kept in memory, for samples() and write().
+*
+* The engine owns one telemetry object (see Engine::telemetry()).
+*/
+class Telemetry {
+
+public:
+
+    /**
+    * @brief The number of samples kept in memory
+    */
+    static const std::size_t MAX_SAMPLES = 1024;
+
+    /**
+    * @brief Figures of one component type at the time of a sample
+    */
+    struct ComponentSample {
+
+        /**
+        * @brief Components added per frame since the previous sample
+        */
+        double addedPerFrame = 0.0;
+
+        /**
+        * @brief Memory reserved by the type's pool
+        */
+        std::size_t bytesAllocated = 0;
+
+        /**
+        * @brief Current number of components
+        */
+        std::size_t count = 0;
+
+        /**
+        * @brief The component type's name
+        */
+        std::string name;
+
+        /**
+        * @brief Highest number of components so far
+        */
+        std::size_t peakCount = 0;
+
+        /**
+        * @brief Components removed per frame since the previous sample
+        */
+        double removedPerFrame = 0.0;
+
+    };
+
+    /**
+    * @brief A snapshot of the entity manager and all gauges
+    */
+    struct Sample {
+
+        /**
+        * @brief One entry per component type
+        */
+        std::vector<ComponentSample> components;
+
+        /**
+        * @brief Number of entities with at least one component
+        */
+        std::size_t entityCount = 0;
+
+        /**
+        * @brief The frame the sample was taken in
+        */
+        std::uint64_t frame = 0;
+
+        /**
+        * @brief Gauge names and values, sorted by name
+        */
+        std::vector<std::pair<std::string, double>> gauges;
+
+        /**
+        * @brief Milliseconds since the telemetry was created
+        */
+        std::int64_t milliseconds = 0;
+
+    };
+
+    /**
+    * @brief Lua bindings
+    *
+    * Exposes:
+    * - Telemetry::interval()
+    * - Telemetry::setGauge()
+    * - Telemetry::setInterval()
+    * - Telemetry::setOutputFile()
+    * - \c latest(): The most recent sample as a table like
+    *   <tt>{ frame = ..., entities = ..., components = { { name = ...,
+    *   count = ..., peakCount = ..., addedPerFrame = ...,
+    *   removedPerFrame = ..., bytesAllocated = ... }, ... }, gauges = {
+    *   name = value, ... } }</tt>, or \c nil if there is no sample yet
+    * - \c sample(): Takes a sample of the current game state right away
+    * - \c write(filename)
+    *
+    * @return
+    */
+    static luabind::scope
+    luaBindings();
+
+    /**
+    * @brief Constructor
+    */
+    Telemetry();
+
+    /**
+    * @brief Non-copyable
+    */
+    Telemetry(const Telemetry&) = delete;
+
+    /**
+    * @brief Destructor
+    *
+    * Closes the output file.
+    */
+    ~Telemetry();
+
+    /**
+    * @brief Non-copyable
+    */
+    Telemetry&
+    operator=(const Telemetry&) = delete;
+
+    /**
+    * @brief Finishes and closes the output file
+    *
+    * Called by the engine when it shuts down. Afterwards, samples are no 
+    * longer written to a file until setOutputFile() is called again.
+    */
+    void
+    closeOutputFile();
+
+    /**
+    * @brief Frames between two samples, 0 if sampling is disabled
+    */
+    unsigned int
+    interval() const;
+
+    /**
+    * @brief The file the samples are written to as they are taken
+    */
+    const std::string&
+    outputFile() const;
+
+    /**
+    * @brief Takes a sample
+    *
+    * @param entityManager
+    *   The entity manager to sample
+    * @param factory
+    *   For looking up component type names
+    * @param frame
+    *   The current frame number
+    */
+    void
+    sample(
+        const EntityManager& entityManager,
+        const ComponentFactory& factory,
+        std::uint64_t frame
+    );
+
+    /**
+    * @brief The latest samples, oldest first
+    *
+    * At most MAX_SAMPLES, older ones are only in the output file.
+    */
+    const std::vector<Sample>&
+    samples() const;
+
+    /**
+    * @brief Sets a custom figure that is recorded with each sample
+    *
+    * Thread safe, so systems can report their figures from their
+    * update().
+    *
+    * @param name
+    *   The gauge's name, e.g. <tt>"SoundSourceSystem.sounds"</tt>
+    * @param value
+    *   The current value
+    */
+    void
+    setGauge(
+        const std::string& name,
+        double value
+    );
+
+    /**
+    * @brief Sets the number of frames between two samples
+    *
+    * @param frames
+    *   The interval. 0 disables sampling, which is the default.
+    */
+    void
+    setInterval(
+        unsigned int frames
+    );
+
+    /**
+    * @brief Sets the file to write the samples to as they are taken
+    *
+    * Closes the previous output file. The new file is created right away
+    * and starts with the samples still in memory. Files ending in 
+    * \c .json are written as JSON, all others as CSV.
+    *
+    * @param filename
+    *   The file. If empty, nothing is written.
+    *
+    * @throws std::runtime_error if the file can't be opened
+    */
+    void
+    setOutputFile(
+        const std::string& filename
+    );
+
+    /**
+    * @brief Takes a sample if the interval has passed
+    *
+    * Called by the engine after each frame.
+    *
+    * @param entityManager
+    *   The entity manager to sample
+    * @param factory
+    *   For looking up component type names
+    * @param frame
+    *   The current frame number
+    */
+    void
+    update(
+        const EntityManager& entityManager,
+        const ComponentFactory& factory,
+        std::uint64_t frame
+    );
+
+    /**
+    * @brief Writes the samples in memory to a file
+    *
+    * @param filename
+    *   The file to write to. Files ending in \c .json are written as
+    *   JSON, all others as CSV.
+    *
+    * @throws std::runtime_error if the file can't be opened
+    */
+    void
+    write(
+        const std::string& filename
+    ) const;
+
+    /**
+    * @brief Writes the samples in memory as CSV
+    *
+    * Writes one line per sample and component type, with the columns
+    * <tt>frame, milliseconds, name, count, peakCount, addedPerFrame,
+    * removedPerFrame, bytesAllocated</tt>. The entity count is written
+    * as a component type named \c Entities, gauges as component types
+    * whose count is the gauge's value.
+    *
+    * @param stream
+    *   The stream to write to
+    */
+    void
+    writeCsv(
+        std::ostream& stream
+    ) const;
+
+    /**
+    * @brief Writes the samples in memory as JSON
+    *
+    * @param stream
+    *   The stream to write to
+    */
+    void
+    writeJson(
+        std::ostream& stream
+    ) const;
+
+private:
+
+    struct Implementation;
+    std::unique_ptr<Implementation> m_impl;
+
+};
+
+}
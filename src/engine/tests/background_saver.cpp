@@ -0,0 +1,140 @@
+#include "engine/background_saver.h"
+
+#include "engine/compression.h"
+
+#include <cstdio>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <iterator>
+#include <string>
+
+#ifndef _WIN32
+#include <sys/stat.h>
+#endif
+
+using namespace thrive;
+
+
+static std::string
+readFile(
+    const std::string& filename
+) {
+    std::ifstream stream(filename, std::ifstream::binary);
+    if (isCompressedSavegame(stream)) {
+        return decompressSavegame(stream);
+    }
+    return std::string(
+        std::istreambuf_iterator<char>(stream),
+        std::istreambuf_iterator<char>()
+    );
+}
+
+
+TEST(BackgroundSaver, Save) {
+    BackgroundSaver saver;
+    EXPECT_FALSE(saver.isSaving());
+    std::string filename = testing::TempDir() + "background_saver_test.sav";
+    std::string savegame("save\0game", 9);
+    saver.save(filename, savegame);
+    saver.wait();
+    EXPECT_FALSE(saver.isSaving());
+    EXPECT_EQ(1u, saver.finishedCount());
+    EXPECT_EQ(filename, saver.lastFile());
+    EXPECT_EQ("", saver.lastError());
+    EXPECT_EQ(savegame, readFile(filename));
+    std::remove(filename.c_str());
+}
+
+
+TEST(BackgroundSaver, Compression) {
+    BackgroundSaver saver;
+    EXPECT_TRUE(saver.compression());
+    std::string filename = testing::TempDir() + "background_saver_test.sav";
+    std::string savegame;
+    for (int i = 0; i < 1000; ++i) {
+        savegame += "currentGameState";
+    }
+    saver.save(filename, savegame);
+    saver.wait();
+    {
+        std::ifstream stream(filename, std::ifstream::binary);
+        EXPECT_TRUE(isCompressedSavegame(stream));
+        EXPECT_EQ(savegame, decompressSavegame(stream));
+    }
+    saver.setCompression(false);
+    saver.save(filename, savegame);
+    saver.wait();
+    {
+        std::ifstream stream(filename, std::ifstream::binary);
+        EXPECT_FALSE(isCompressedSavegame(stream));
+    }
+    EXPECT_EQ(savegame, readFile(filename));
+    std::remove(filename.c_str());
+}
+
+
+#ifndef _WIN32
+TEST(BackgroundSaver, Coalesce) {
+    BackgroundSaver saver;
+    saver.setCompression(false);
+    // The worker blocks on opening the pipe until it is read from
+    std::string blockingFilename = testing::TempDir() + "background_saver_blocking.sav";
+    std::string pipeName = blockingFilename + ".tmp";
+    std::remove(pipeName.c_str());
+    ASSERT_EQ(0, mkfifo(pipeName.c_str(), 0600));
+    saver.save(blockingFilename, "blocking");
+    std::string filename = testing::TempDir() + "background_saver_test.sav";
+    for (int i = 0; i < 100; ++i) {
+        saver.save(filename, std::to_string(i));
+    }
+    {
+        std::ifstream pipe(pipeName, std::ifstream::binary);
+        EXPECT_EQ("blocking", std::string(
+            std::istreambuf_iterator<char>(pipe),
+            std::istreambuf_iterator<char>()
+        ));
+    }
+    saver.wait();
+    // Waiting saves for the same file were replaced
+    EXPECT_EQ(2u, saver.finishedCount());
+    EXPECT_EQ("99", readFile(filename));
+    std::remove(filename.c_str());
+    std::remove(blockingFilename.c_str());
+    std::remove(pipeName.c_str());
+}
+#endif
+
+
+TEST(BackgroundSaver, Destructor) {
+    std::string filename = testing::TempDir() + "background_saver_test.sav";
+    {
+        BackgroundSaver saver;
+        saver.save(filename, "savegame");
+        // Destroying the saver finishes the queued saves
+    }
+    EXPECT_EQ("savegame", readFile(filename));
+    std::remove(filename.c_str());
+}
+
+
+TEST(BackgroundSaver, Error) {
+    BackgroundSaver saver;
+    std::string filename = testing::TempDir() + "no/such/directory/background_saver_test.sav";
+    saver.save(filename, "savegame");
+    saver.wait();
+    EXPECT_EQ(filename, saver.lastFile());
+    EXPECT_NE("", saver.lastError());
+}
+
+
+TEST(BackgroundSaver, TemporaryFile) {
+    BackgroundSaver saver;
+    std::string filename = testing::TempDir() + "background_saver_test.sav";
+    saver.save(filename, "savegame");
+    saver.wait();
+    // The temporary file has replaced the savegame
+    std::ifstream temporaryFile(filename + ".tmp");
+    EXPECT_FALSE(temporaryFile.is_open());
+    EXPECT_EQ("savegame", readFile(filename));
+    std::remove(filename.c_str());
+}
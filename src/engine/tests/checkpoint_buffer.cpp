@@ -0,0 +1,74 @@
+#include "engine/checkpoint_buffer.h"
+
+#include "engine/serialization.h"
+
+#include <cstdio>
+#include <gtest/gtest.h>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+using namespace thrive;
+
+
+static StorageContainer
+savegame(
+    int value
+) {
+    StorageContainer storage;
+    storage.set("value", value);
+    return storage;
+}
+
+
+TEST(CheckpointBuffer, Ring) {
+    CheckpointBuffer checkpoints(2);
+    EXPECT_THROW(checkpoints.get(), std::out_of_range);
+    checkpoints.push(savegame(1));
+    checkpoints.push(savegame(2));
+    checkpoints.push(savegame(3));
+    // The oldest checkpoint was dropped
+    ASSERT_EQ(2u, checkpoints.size());
+    EXPECT_EQ(3, checkpoints.get().get<int>("value"));
+    EXPECT_EQ(2, checkpoints.get(1).get<int>("value"));
+    EXPECT_THROW(checkpoints.get(2), std::out_of_range);
+    EXPECT_LT(0u, checkpoints.byteSize());
+    checkpoints.setCapacity(1);
+    ASSERT_EQ(1u, checkpoints.size());
+    EXPECT_EQ(3, checkpoints.get().get<int>("value"));
+    EXPECT_THROW(checkpoints.setCapacity(0), std::invalid_argument);
+    checkpoints.clear();
+    EXPECT_EQ(0u, checkpoints.size());
+}
+
+
+TEST(CheckpointBuffer, PushSerialized) {
+    CheckpointBuffer checkpoints;
+    std::ostringstream stream(std::ostringstream::binary);
+    StorageWriter writer(stream);
+    writer.set("value", 7);
+    writer.finish();
+    checkpoints.pushSerialized(stream.str());
+    EXPECT_EQ(7, checkpoints.get().get<int>("value"));
+    EXPECT_EQ(stream.str(), checkpoints.serialized());
+    EXPECT_THROW(checkpoints.serialized(1), std::out_of_range);
+}
+
+
+TEST(CheckpointBuffer, Write) {
+    CheckpointBuffer checkpoints;
+    StorageContainer nested;
+    nested.set("name", std::string("nested"));
+    StorageContainer original = savegame(42);
+    original.set("nested", nested);
+    checkpoints.push(original);
+    std::string filename = testing::TempDir() + "checkpoint_buffer_test.sav";
+    checkpoints.write(filename);
+    // Written checkpoints are regular savegames
+    std::ifstream stream(filename, std::ifstream::binary);
+    StorageContainer loaded;
+    stream >> loaded;
+    EXPECT_EQ(42, loaded.get<int>("value"));
+    EXPECT_EQ("nested", loaded.get<StorageContainer>("nested").get<std::string>("name"));
+    std::remove(filename.c_str());
+}
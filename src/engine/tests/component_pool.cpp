@@ -0,0 +1,60 @@
+#include "engine/component_pool.h"
+
+#include <gtest/gtest.h>
+#include <set>
+#include <vector>
+
+using namespace thrive;
+
+
+TEST(ComponentPool, ReusesSlots) {
+    ComponentPool pool(24);
+    EXPECT_EQ(0u, pool.size());
+    EXPECT_EQ(0u, pool.capacity());
+    void* first = pool.allocate(24);
+    EXPECT_EQ(1u, pool.size());
+    EXPECT_LE(1u, pool.capacity());
+    pool.deallocate(first, 24);
+    EXPECT_EQ(0u, pool.size());
+    // The most recently released slot is handed out first
+    void* second = pool.allocate(24);
+    EXPECT_EQ(first, second);
+    pool.deallocate(second, 24);
+}
+
+
+TEST(ComponentPool, DistinctAlignedSlots) {
+    ComponentPool pool(20);
+    EXPECT_EQ(0u, pool.slotSize() % ComponentPool::ALIGNMENT);
+    std::vector<void*> pointers;
+    std::set<void*> unique;
+    for (int i = 0; i < 1000; ++i) {
+        void* pointer = pool.allocate(20);
+        pointers.push_back(pointer);
+        unique.insert(pointer);
+    }
+    EXPECT_EQ(pointers.size(), unique.size());
+    EXPECT_EQ(1000u, pool.size());
+    EXPECT_LE(1000u, pool.capacity());
+    size_t capacity = pool.capacity();
+    for (void* pointer : pointers) {
+        pool.deallocate(pointer, 20);
+    }
+    EXPECT_EQ(0u, pool.size());
+    // Allocating again does not need new chunks
+    for (int i = 0; i < 1000; ++i) {
+        pool.allocate(20);
+    }
+    EXPECT_EQ(capacity, pool.capacity());
+}
+
+
+TEST(ComponentPool, OversizedFallsBack) {
+    ComponentPool pool(16);
+    void* pointer = pool.allocate(1000);
+    EXPECT_TRUE(pointer != nullptr);
+    EXPECT_EQ(0u, pool.size());
+    pool.deallocate(pointer, 1000);
+    EXPECT_EQ(0u, pool.size());
+}
+
@@ -0,0 +1,91 @@
+#include "engine/compression.h"
+
+#include <gtest/gtest.h>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+using namespace thrive;
+
+
+static std::string
+roundTrip(
+    const std::string& savegame
+) {
+    std::istringstream stream(compressSavegame(savegame), std::istringstream::binary);
+    EXPECT_TRUE(isCompressedSavegame(stream));
+    return decompressSavegame(stream);
+}
+
+
+TEST(Compression, RoundTrip) {
+    std::string repetitive;
+    for (int i = 0; i < 20000; ++i) {
+        repetitive += "entityId";
+        repetitive += static_cast<char>(i % 7);
+    }
+    std::string compressed = compressSavegame(repetitive);
+    EXPECT_LT(compressed.size(), repetitive.size() / 10);
+    // Several blocks
+    EXPECT_EQ(repetitive, roundTrip(repetitive));
+    EXPECT_EQ("", roundTrip(""));
+    EXPECT_EQ("abc", roundTrip("abc"));
+    // Overlapping matches
+    EXPECT_EQ(std::string(1000, 'a'), roundTrip(std::string(1000, 'a')));
+}
+
+
+TEST(Compression, Incompressible) {
+    std::mt19937 generator(42);
+    std::string noise;
+    for (int i = 0; i < 100000; ++i) {
+        noise += static_cast<char>(generator());
+    }
+    std::string compressed = compressSavegame(noise);
+    // Stored blocks only add their sizes
+    EXPECT_GE(noise.size() + 64, compressed.size());
+    EXPECT_EQ(noise, roundTrip(noise));
+}
+
+
+TEST(Compression, Detect) {
+    std::istringstream plain(std::string("not compressed"), std::istringstream::binary);
+    EXPECT_FALSE(isCompressedSavegame(plain));
+    // The position is unchanged
+    EXPECT_EQ(0u, plain.tellg());
+    EXPECT_THROW(decompressSavegame(plain), std::runtime_error);
+}
+
+
+TEST(Compression, Version) {
+    std::string compressed = compressSavegame("savegame");
+    // The version follows the magic number
+    compressed[8] = static_cast<char>(compressed[8] + 1);
+    std::istringstream stream(compressed, std::istringstream::binary);
+    EXPECT_TRUE(isCompressedSavegame(stream));
+    EXPECT_THROW(decompressSavegame(stream), std::runtime_error);
+}
+
+
+TEST(Compression, Corrupt) {
+    std::string savegame;
+    for (int i = 0; i < 1000; ++i) {
+        savegame += "gameStates";
+    }
+    std::string compressed = compressSavegame(savegame);
+    std::string truncated = compressed.substr(0, compressed.size() - 8);
+    std::istringstream truncatedStream(truncated, std::istringstream::binary);
+    EXPECT_THROW(decompressSavegame(truncatedStream), std::runtime_error);
+    // Damaged bytes are either detected or decoded within bounds
+    for (std::size_t i = 16; i < compressed.size() - 4; ++i) {
+        std::string damaged = compressed;
+        damaged[i] = static_cast<char>(0xFF);
+        std::istringstream stream(damaged, std::istringstream::binary);
+        try {
+            decompressSavegame(stream);
+        }
+        catch (const std::runtime_error&) {
+        }
+    }
+}
@@ -0,0 +1,176 @@
+#include "engine/dirty_list.h"
+
+#include "engine/component_collection.h"
+#include "engine/entity_manager.h"
+#include "engine/tests/test_component.h"
+#include "engine/touchable.h"
+#include "util/make_unique.h"
+
+#include <boost/thread.hpp>
+#include <gtest/gtest.h>
+#include <vector>
+
+using namespace thrive;
+
+namespace {
+
+class TrackedComponent : public TestComponent<0> {
+
+public:
+
+    void
+    trackChanges(
+        DirtyList* dirtyList
+    ) override {
+        m_first.track(dirtyList, this);
+        m_second.track(dirtyList, this);
+    }
+
+    Touchable m_first;
+
+    Touchable m_second;
+
+};
+
+}
+
+
+TEST(DirtyList, Versions) {
+    Touchable touchable;
+    Touchable::advanceVersion();
+    std::uint64_t version = Touchable::currentVersion();
+    EXPECT_FALSE(touchable.hasChangesSince(version));
+    touchable.touch();
+    EXPECT_TRUE(touchable.hasChangesSince(version));
+    // Touches within a phase share its version
+    Touchable other;
+    other.touch();
+    EXPECT_EQ(touchable.version(), other.version());
+    EXPECT_EQ(Touchable::currentVersion() + 1, touchable.version());
+    // Untouching doesn't affect other consumers
+    touchable.untouch();
+    EXPECT_FALSE(touchable.hasChanges());
+    EXPECT_TRUE(touchable.hasChangesSince(version));
+}
+
+
+TEST(DirtyList, ChangesSince) {
+    DirtyList dirtyList;
+    TestComponent<0> first;
+    TestComponent<0> second;
+    Touchable firstTouchable;
+    Touchable secondTouchable;
+    firstTouchable.track(&dirtyList, &first);
+    secondTouchable.track(&dirtyList, &second);
+    EXPECT_EQ(2u, dirtyList.size());
+    Touchable::advanceVersion();
+    std::uint64_t version = Touchable::currentVersion();
+    EXPECT_TRUE(dirtyList.changesSince(version).empty());
+    // Earlier phases first, list order within a phase
+    secondTouchable.touch();
+    Touchable::advanceVersion();
+    firstTouchable.touch();
+    secondTouchable.touch();
+    std::vector<Component*> expected = {&first, &second};
+    EXPECT_EQ(expected, dirtyList.changesSince(version));
+    // Each consumer sees changes since its own version
+    Touchable::advanceVersion();
+    std::uint64_t laterVersion = Touchable::currentVersion();
+    secondTouchable.touch();
+    expected = {&second};
+    EXPECT_EQ(expected, dirtyList.changesSince(laterVersion));
+    // Untracked touchables are forgotten
+    secondTouchable.track(nullptr, nullptr);
+    EXPECT_EQ(1u, dirtyList.size());
+    expected = {&first};
+    EXPECT_EQ(expected, dirtyList.changesSince(version));
+}
+
+
+TEST(DirtyList, Destruction) {
+    DirtyList dirtyList;
+    TestComponent<0> component;
+    {
+        Touchable touchable;
+        touchable.track(&dirtyList, &component);
+        EXPECT_EQ(1u, dirtyList.size());
+    }
+    EXPECT_EQ(0u, dirtyList.size());
+}
+
+
+TEST(DirtyList, Prune) {
+    DirtyList dirtyList;
+    TestComponent<0> component;
+    Touchable touchable;
+    touchable.track(&dirtyList, &component);
+    // Touching a listed touchable again doesn't grow the list
+    touchable.touch();
+    touchable.touch();
+    EXPECT_EQ(1u, dirtyList.size());
+    Touchable::advanceVersion();
+    std::uint64_t version = Touchable::currentVersion();
+    dirtyList.prune(version);
+    EXPECT_EQ(0u, dirtyList.size());
+    EXPECT_TRUE(dirtyList.changesSince(0).empty());
+    // The next touch lists it again
+    touchable.touch();
+    EXPECT_EQ(1u, dirtyList.size());
+    std::vector<Component*> expected = {&component};
+    EXPECT_EQ(expected, dirtyList.changesSince(version));
+}
+
+
+TEST(DirtyList, ConcurrentTouches) {
+    const std::size_t THREAD_COUNT = 4;
+    const std::size_t TOUCHABLE_COUNT = 100;
+    DirtyList dirtyList;
+    TestComponent<0> component;
+    std::vector<Touchable> touchables(THREAD_COUNT * TOUCHABLE_COUNT);
+    for (Touchable& touchable : touchables) {
+        touchable.track(&dirtyList, &component);
+    }
+    Touchable::advanceVersion();
+    dirtyList.prune(Touchable::currentVersion());
+    EXPECT_EQ(0u, dirtyList.size());
+    std::vector<boost::thread> threads;
+    for (std::size_t i = 0; i < THREAD_COUNT; ++i) {
+        threads.emplace_back([&touchables, i]() {
+            for (int repeat = 0; repeat < 10; ++repeat) {
+                for (std::size_t j = 0; j < TOUCHABLE_COUNT; ++j) {
+                    touchables[i * TOUCHABLE_COUNT + j].touch();
+                }
+            }
+        });
+    }
+    for (boost::thread& thread : threads) {
+        thread.join();
+    }
+    EXPECT_EQ(touchables.size(), dirtyList.size());
+}
+
+
+TEST(DirtyList, ComponentCollection) {
+    EntityManager entityManager;
+    DirtyList& dirtyList = entityManager.getComponentCollection(
+        TestComponent<0>::TYPE_ID
+    ).dirtyList();
+    std::uint64_t version = Touchable::currentVersion();
+    EntityId entityId = entityManager.generateNewId();
+    auto component = make_unique<TrackedComponent>();
+    TrackedComponent* rawComponent = component.get();
+    entityManager.addComponent(entityId, std::move(component));
+    // New components count as changed, but only once
+    EXPECT_EQ(2u, dirtyList.size());
+    std::vector<Component*> expected = {rawComponent};
+    EXPECT_EQ(expected, dirtyList.changesSince(version));
+    Touchable::advanceVersion();
+    version = Touchable::currentVersion();
+    EXPECT_TRUE(dirtyList.changesSince(version).empty());
+    rawComponent->m_second.touch();
+    EXPECT_EQ(expected, dirtyList.changesSince(version));
+    // Removed components are no longer tracked
+    entityManager.removeEntity(entityId);
+    entityManager.processRemovals();
+    EXPECT_EQ(0u, dirtyList.size());
+}
@@ -0,0 +1,110 @@
+#include "engine/entity_command_buffer.h"
+
+#include "engine/entity_filter.h"
+#include "engine/entity_manager.h"
+#include "engine/tests/test_component.h"
+#include "util/make_unique.h"
+
+#include <gtest/gtest.h>
+
+using namespace thrive;
+
+
+TEST(EntityCommandBuffer, Playback) {
+    EntityManager entityManager;
+    EntityFilter<TestComponent<0>> filter(true);
+    filter.setEntityManager(&entityManager);
+    EntityCommandBuffer commandBuffer(entityManager);
+    EXPECT_TRUE(commandBuffer.empty());
+    EntityId entityId = commandBuffer.createEntity();
+    EXPECT_NE(NULL_ENTITY, entityId);
+    auto component = commandBuffer.addComponent(
+        entityId,
+        make_unique<TestComponent<0>>()
+    );
+    EXPECT_EQ(1u, commandBuffer.size());
+    // Nothing happens before playback
+    EXPECT_FALSE(entityManager.exists(entityId));
+    EXPECT_EQ(0u, filter.addedEntities().size());
+    commandBuffer.playback();
+    EXPECT_TRUE(commandBuffer.empty());
+    EXPECT_EQ(component, entityManager.getComponent(entityId, TestComponent<0>::TYPE_ID));
+    EXPECT_EQ(1u, filter.addedEntities().count(entityId));
+    // Removals are still processed with the entity manager's removals
+    commandBuffer.removeEntity(entityId);
+    commandBuffer.playback();
+    EXPECT_TRUE(entityManager.exists(entityId));
+    entityManager.processRemovals();
+    EXPECT_FALSE(entityManager.exists(entityId));
+}
+
+
+TEST(EntityCommandBuffer, Append) {
+    EntityManager entityManager;
+    EntityCommandBuffer first(entityManager);
+    EntityCommandBuffer second(entityManager);
+    EntityId entityId = first.createEntity();
+    first.addComponent(entityId, make_unique<TestComponent<0>>());
+    second.addComponent(entityId, make_unique<TestComponent<1>>());
+    second.removeComponent(entityId, TestComponent<0>::TYPE_ID);
+    first.append(second);
+    EXPECT_TRUE(second.empty());
+    EXPECT_EQ(3u, first.size());
+    // Commands are applied in order
+    first.playback();
+    entityManager.processRemovals();
+    EXPECT_TRUE(nullptr == entityManager.getComponent(entityId, TestComponent<0>::TYPE_ID));
+    EXPECT_TRUE(nullptr != entityManager.getComponent(entityId, TestComponent<1>::TYPE_ID));
+}
+
+
+TEST(EntityCommandBuffer, DestroyedEntity) {
+    EntityManager entityManager;
+    EntityId destroyedId = entityManager.generateNewId();
+    entityManager.addComponent(destroyedId, make_unique<TestComponent<0>>());
+    EntityCommandBuffer commandBuffer(entityManager);
+    commandBuffer.addComponent(destroyedId, make_unique<TestComponent<1>>());
+    commandBuffer.removeComponent(destroyedId, TestComponent<0>::TYPE_ID);
+    EntityId entityId = commandBuffer.createEntity();
+    commandBuffer.addComponent(entityId, make_unique<TestComponent<0>>());
+    entityManager.removeEntity(destroyedId);
+    entityManager.processRemovals();
+    EXPECT_FALSE(entityManager.isCurrent(destroyedId));
+    EXPECT_TRUE(entityManager.isCurrent(entityId));
+    // The commands for the destroyed entity are skipped, the others
+    // are still applied
+    EXPECT_NO_THROW(commandBuffer.playback());
+    EXPECT_TRUE(commandBuffer.empty());
+    EXPECT_FALSE(entityManager.exists(destroyedId));
+    EXPECT_TRUE(nullptr != entityManager.getComponent(entityId, TestComponent<0>::TYPE_ID));
+}
+
+
+TEST(EntityCommandBuffer, ReservedIds) {
+    EntityManager entityManager;
+    EntityCommandBuffer commandBuffer(entityManager);
+    EntityId first = commandBuffer.createEntity();
+    EntityId second = commandBuffer.createEntity();
+    EXPECT_NE(first, second);
+    EXPECT_TRUE(entityManager.isCurrent(second));
+    // The rest of the block is reserved, but released at playback
+    EntityId reserved = entityManager.generateNewId();
+    EXPECT_EQ(entityIndex(first) + EntityCommandBuffer::ID_BLOCK_SIZE, entityIndex(reserved));
+    commandBuffer.addComponent(first, make_unique<TestComponent<0>>());
+    commandBuffer.playback();
+    entityManager.processRemovals();
+    EXPECT_TRUE(entityManager.exists(first));
+    EXPECT_TRUE(entityManager.isCurrent(second));
+    EXPECT_FALSE(entityManager.isCurrent(makeEntityId(entityIndex(second) + 1, 0)));
+}
+
+
+TEST(EntityCommandBuffer, AppendReservedIds) {
+    EntityManager entityManager;
+    EntityCommandBuffer first(entityManager);
+    EntityCommandBuffer second(entityManager);
+    EntityId entityId = second.createEntity();
+    first.append(second);
+    // The appended buffer's ids are used up first
+    EXPECT_EQ(entityIndex(entityId) + 1, entityIndex(first.createEntity()));
+}
@@ -1,10 +1,13 @@
 #include "engine/entity_filter.h"
 
+#include "engine/entity_command_buffer.h"
 #include "engine/entity_manager.h"
 #include "engine/tests/test_component.h"
 #include "util/make_unique.h"
 
+#include <atomic>
 #include <gtest/gtest.h>
+#include <vector>
 
 using namespace thrive;
 
@@ -212,3 +215,222 @@ TEST(EntityFilter, Record) {
 }
 
 
+
+
+TEST(EntityFilter, Iteration) {
+    EntityManager entityManager;
+    using TestFilter = EntityFilter<
+        TestComponent<0>
+    >;
+    TestFilter filter;
+    filter.setEntityManager(&entityManager);
+    std::vector<EntityId> entityIds;
+    for (int i = 0; i < 100; ++i) {
+        EntityId entityId = entityManager.generateNewId();
+        entityManager.addComponent(
+            entityId,
+            make_unique<TestComponent<0>>()
+        );
+        entityIds.push_back(entityId);
+    }
+    // Remove every third entity
+    for (size_t i = 0; i < entityIds.size(); i += 3) {
+        entityManager.removeEntity(entityIds[i]);
+    }
+    entityManager.processRemovals();
+    // Every remaining entry must still point to its entity's component
+    size_t count = 0;
+    for (const auto& value : filter) {
+        EXPECT_TRUE(filter.containsEntity(value.first));
+        EXPECT_EQ(value.first, std::get<0>(value.second)->owner());
+        ++count;
+    }
+    EXPECT_EQ(66u, count);
+    for (size_t i = 0; i < entityIds.size(); ++i) {
+        EXPECT_EQ(i % 3 != 0, filter.containsEntity(entityIds[i]));
+    }
+}
+
+
+TEST(EntityFilter, ParallelForEach) {
+    EntityManager entityManager;
+    using TestFilter = EntityFilter<
+        TestComponent<0>
+    >;
+    TestFilter filter;
+    filter.setEntityManager(&entityManager);
+    for (int i = 0; i < 1000; ++i) {
+        EntityId entityId = entityManager.generateNewId();
+        entityManager.addComponent(
+            entityId,
+            make_unique<TestComponent<0>>()
+        );
+    }
+    ThreadPool threadPool;
+    threadPool.start(3);
+    std::vector<std::atomic<int>> visits(1001);
+    filter.parallelForEach(
+        threadPool,
+        64,
+        [&visits](EntityId entityId, const TestFilter::ComponentGroup& components) {
+            EXPECT_EQ(entityId, std::get<0>(components)->owner());
+            visits[entityIndex(entityId)] += 1;
+        }
+    );
+    // Each entity was visited exactly once
+    for (const auto& value : filter) {
+        EXPECT_EQ(1, visits[entityIndex(value.first)]);
+    }
+}
+
+
+TEST(EntityFilter, ParallelForEachCommands) {
+    EntityManager entityManager;
+    using TestFilter = EntityFilter<
+        TestComponent<0>
+    >;
+    TestFilter filter;
+    filter.setEntityManager(&entityManager);
+    for (int i = 0; i < 1000; ++i) {
+        EntityId entityId = entityManager.generateNewId();
+        entityManager.addComponent(
+            entityId,
+            make_unique<TestComponent<0>>()
+        );
+    }
+    ThreadPool threadPool;
+    threadPool.start(3);
+    EntityCommandBuffer commandBuffer(entityManager);
+    filter.parallelForEach(
+        threadPool,
+        64,
+        commandBuffer,
+        [](EntityId, const TestFilter::ComponentGroup&, EntityCommandBuffer& chunkBuffer) {
+            EntityId entityId = chunkBuffer.createEntity();
+            chunkBuffer.addComponent(entityId, make_unique<TestComponent<1>>());
+        }
+    );
+    // All chunks' commands end up in the given buffer
+    EXPECT_EQ(1000u, commandBuffer.size());
+    commandBuffer.playback();
+    entityManager.processRemovals();
+    EXPECT_EQ(2000u, entityManager.entityCount());
+}
+
+
+TEST(EntityFilter, DeferredChanges) {
+    EntityManager entityManager;
+    using TestFilter = EntityFilter<
+        TestComponent<0>,
+        Optional<TestComponent<1>>
+    >;
+    TestFilter filter(true);
+    filter.setEntityManager(&entityManager);
+    entityManager.setDeferChanges(true);
+    EntityId first = entityManager.generateNewId();
+    EntityId second = entityManager.generateNewId();
+    entityManager.addComponent(first, make_unique<TestComponent<0>>());
+    entityManager.addComponent(first, make_unique<TestComponent<1>>());
+    entityManager.addComponent(second, make_unique<TestComponent<0>>());
+    // Components are there, but the filter doesn't know yet
+    EXPECT_TRUE(nullptr != entityManager.getComponent(first, TestComponent<0>::TYPE_ID));
+    EXPECT_EQ(0u, filter.entities().size());
+    entityManager.flushChanges();
+    EXPECT_EQ(2u, filter.entities().size());
+    EXPECT_EQ(2u, filter.addedEntities().size());
+    EXPECT_TRUE(std::get<1>(filter.entities().at(first)) != nullptr);
+    EXPECT_TRUE(std::get<1>(filter.entities().at(second)) == nullptr);
+    filter.clearChanges();
+    // Added and removed between two flushes is never reported
+    EntityId third = entityManager.generateNewId();
+    entityManager.addComponent(third, make_unique<TestComponent<0>>());
+    entityManager.removeEntity(third);
+    // Removing an entity flushes
+    entityManager.removeEntity(second);
+    entityManager.processRemovals();
+    EXPECT_EQ(1u, filter.entities().size());
+    EXPECT_EQ(0u, filter.addedEntities().size());
+    EXPECT_EQ(1u, filter.removedEntities().size());
+    EXPECT_EQ(1u, filter.removedEntities().count(second));
+    // Disabling deferred changes flushes
+    entityManager.removeComponent(first, TestComponent<1>::TYPE_ID);
+    entityManager.processRemovals();
+    EXPECT_TRUE(std::get<1>(filter.entities().at(first)) == nullptr);
+    entityManager.addComponent(first, make_unique<TestComponent<1>>());
+    entityManager.setDeferChanges(false);
+    EXPECT_TRUE(std::get<1>(filter.entities().at(first)) != nullptr);
+}
+
+
+TEST(EntityFilter, Tags) {
+    EntityManager entityManager;
+    EntityFilter<TestComponent<0>, TestTag> tagged(true);
+    EntityFilter<TestComponent<0>, Optional<TestTag>> optional;
+    tagged.setEntityManager(&entityManager);
+    optional.setEntityManager(&entityManager);
+    EntityId first = entityManager.generateNewId();
+    EntityId second = entityManager.generateNewId();
+    entityManager.addComponent(first, make_unique<TestComponent<0>>());
+    entityManager.addComponent(second, make_unique<TestComponent<0>>());
+    entityManager.addTag<TestTag>(first);
+    ASSERT_EQ(1u, tagged.entities().size());
+    EXPECT_EQ(1u, tagged.addedEntities().count(first));
+    EXPECT_TRUE(std::get<1>(tagged.entities().at(first)) != nullptr);
+    EXPECT_TRUE(std::get<1>(optional.entities().at(first)) != nullptr);
+    EXPECT_TRUE(std::get<1>(optional.entities().at(second)) == nullptr);
+    tagged.clearChanges();
+    // Tag changes are deferred like component changes
+    entityManager.setDeferChanges(true);
+    EXPECT_TRUE(entityManager.removeTag<TestTag>(first));
+    entityManager.addTag<TestTag>(second);
+    EXPECT_EQ(1u, tagged.entities().count(first));
+    // Tags are removed with the components
+    EXPECT_TRUE(entityManager.hasTag<TestTag>(first));
+    entityManager.processRemovals();
+    EXPECT_FALSE(entityManager.hasTag<TestTag>(first));
+    EXPECT_EQ(0u, tagged.entities().count(first));
+    EXPECT_EQ(1u, tagged.entities().count(second));
+    EXPECT_EQ(1u, tagged.removedEntities().count(first));
+    EXPECT_TRUE(std::get<1>(optional.entities().at(first)) == nullptr);
+    EXPECT_TRUE(std::get<1>(optional.entities().at(second)) != nullptr);
+    entityManager.setDeferChanges(false);
+}
+
+TEST(EntityFilter, Shared) {
+    EntityManager entityManager;
+    EntityId first = entityManager.generateNewId();
+    entityManager.addComponent(first, make_unique<TestComponent<0>>());
+    EntityFilter<TestComponent<0>> firstFilter(true);
+    firstFilter.setEntityManager(&entityManager);
+    EntityFilter<TestComponent<0>> secondFilter(true);
+    secondFilter.setEntityManager(&entityManager);
+    EntityFilter<TestComponent<0>> plainFilter;
+    plainFilter.setEntityManager(&entityManager);
+    // All filters share the same entities
+    EXPECT_EQ(&firstFilter.entities(), &secondFilter.entities());
+    EXPECT_EQ(&firstFilter.entities(), &plainFilter.entities());
+    // Entities that were there before count as added
+    EXPECT_EQ(1u, secondFilter.addedEntities().count(first));
+    // Each filter clears its own changes
+    firstFilter.clearChanges();
+    EntityId second = entityManager.generateNewId();
+    entityManager.addComponent(second, make_unique<TestComponent<0>>());
+    EXPECT_EQ(1u, firstFilter.addedEntities().size());
+    EXPECT_EQ(2u, secondFilter.addedEntities().size());
+    firstFilter.clearChanges();
+    entityManager.removeEntity(first);
+    entityManager.processRemovals();
+    EXPECT_EQ(1u, firstFilter.removedEntities().count(first));
+    // Added and removed before clearing
+    EXPECT_EQ(0u, secondFilter.removedEntities().size());
+    EXPECT_EQ(1u, secondFilter.addedEntities().size());
+    // Detaching one filter keeps the others up to date
+    firstFilter.setEntityManager(nullptr);
+    EXPECT_EQ(0u, firstFilter.entities().size());
+    entityManager.removeEntity(second);
+    entityManager.processRemovals();
+    EXPECT_EQ(0u, plainFilter.entities().size());
+    EXPECT_EQ(0u, secondFilter.addedEntities().size());
+    secondFilter.setEntityManager(nullptr);
+    plainFilter.setEntityManager(nullptr);
+}
@@ -0,0 +1,547 @@
+#include "engine/entity_manager.h"
+
+#include "engine/component_collection.h"
+#include "engine/component_factory.h"
+#include "engine/serialization.h"
+#include "engine/tests/test_component.h"
+#include "util/make_unique.h"
+
+#include <gtest/gtest.h>
+#include <sstream>
+#include <vector>
+
+using namespace thrive;
+
+REGISTER_TAG(TestTag)
+
+namespace {
+
+// Registered with a factory, like components defined in Lua
+class ReloadableComponent : public Component {
+
+public:
+
+    static ComponentTypeId TYPE_ID;
+
+    static const std::string&
+    TYPE_NAME() {
+        static std::string string = "ReloadableComponent";
+        return string;
+    }
+
+    void
+    load(
+        const StorageContainer& storage
+    ) override {
+        Component::load(storage);
+        m_value = storage.get<int>("value");
+    }
+
+    bool
+    reload(
+        const StorageContainer& storage
+    ) override {
+        this->load(storage);
+        m_reloads += 1;
+        return true;
+    }
+
+    StorageContainer
+    storage() const override {
+        StorageContainer storage = Component::storage();
+        storage.set<int>("value", m_value);
+        return storage;
+    }
+
+    ComponentTypeId
+    typeId() const override {
+        return TYPE_ID;
+    }
+
+    std::string
+    typeName() const override {
+        return TYPE_NAME();
+    }
+
+    int m_reloads = 0;
+
+    int m_value = 0;
+
+};
+
+ComponentTypeId ReloadableComponent::TYPE_ID = NULL_COMPONENT_TYPE;
+
+// Reads and writes its entries without a StorageContainer
+class StreamedComponent : public ReloadableComponent {
+
+public:
+
+    static ComponentTypeId TYPE_ID;
+
+    static const std::string&
+    TYPE_NAME() {
+        static std::string string = "StreamedComponent";
+        return string;
+    }
+
+    bool
+    read(
+        StorageReader& reader
+    ) override {
+        m_value = 0;
+        while (reader.next()) {
+            if (reader.key() == "value") {
+                m_value = reader.get<int>();
+            }
+        }
+        m_reads += 1;
+        return true;
+    }
+
+    ComponentTypeId
+    typeId() const override {
+        return TYPE_ID;
+    }
+
+    std::string
+    typeName() const override {
+        return TYPE_NAME();
+    }
+
+    void
+    write(
+        StorageWriter& writer
+    ) const override {
+        writer.set<EntityId>("owner", this->owner());
+        writer.set<int>("value", m_value);
+    }
+
+    int m_reads = 0;
+
+};
+
+ComponentTypeId StreamedComponent::TYPE_ID = NULL_COMPONENT_TYPE;
+
+}
+
+
+TEST(EntityManager, Signature) {
+    EntityManager entityManager;
+    EntityId entityId = entityManager.generateNewId();
+    EXPECT_TRUE(entityManager.signature(entityId).none());
+    entityManager.addComponent(
+        entityId,
+        make_unique<TestComponent<0>>()
+    );
+    entityManager.addComponent(
+        entityId,
+        make_unique<TestComponent<1>>()
+    );
+    size_t bit0 = entityManager.getComponentCollection(
+        TestComponent<0>::TYPE_ID
+    ).signatureBit();
+    size_t bit1 = entityManager.getComponentCollection(
+        TestComponent<1>::TYPE_ID
+    ).signatureBit();
+    EXPECT_NE(bit0, bit1);
+    ComponentSignature signature = entityManager.signature(entityId);
+    EXPECT_EQ(2u, signature.count());
+    EXPECT_TRUE(signature.test(bit0));
+    EXPECT_TRUE(signature.test(bit1));
+    // Remove one component
+    entityManager.removeComponent(entityId, TestComponent<0>::TYPE_ID);
+    entityManager.processRemovals();
+    signature = entityManager.signature(entityId);
+    EXPECT_FALSE(signature.test(bit0));
+    EXPECT_TRUE(signature.test(bit1));
+    EXPECT_TRUE(entityManager.exists(entityId));
+    // Remove the last component
+    entityManager.removeComponent(entityId, TestComponent<1>::TYPE_ID);
+    entityManager.processRemovals();
+    EXPECT_TRUE(entityManager.signature(entityId).none());
+    EXPECT_FALSE(entityManager.exists(entityId));
+}
+
+
+TEST(EntityManager, RemoveEntity) {
+    EntityManager entityManager;
+    EntityId entityId = entityManager.generateNewId();
+    entityManager.addComponent(
+        entityId,
+        make_unique<TestComponent<0>>()
+    );
+    entityManager.addComponent(
+        entityId,
+        make_unique<TestComponent<1>>()
+    );
+    EXPECT_TRUE(entityManager.exists(entityId));
+    entityManager.removeEntity(entityId);
+    entityManager.processRemovals();
+    EXPECT_FALSE(entityManager.exists(entityId));
+    EXPECT_TRUE(entityManager.signature(entityId).none());
+    EXPECT_TRUE(nullptr == entityManager.getComponent(entityId, TestComponent<0>::TYPE_ID));
+    EXPECT_TRUE(nullptr == entityManager.getComponent(entityId, TestComponent<1>::TYPE_ID));
+}
+
+
+
+TEST(EntityManager, StaleIds) {
+    EntityManager entityManager;
+    EntityId entityId = entityManager.generateNewId();
+    entityManager.addComponent(
+        entityId,
+        make_unique<TestComponent<0>>()
+    );
+    entityManager.removeEntity(entityId);
+    entityManager.processRemovals();
+    EXPECT_FALSE(entityManager.exists(entityId));
+    EXPECT_TRUE(nullptr == entityManager.getComponent(entityId, TestComponent<0>::TYPE_ID));
+    EXPECT_THROW(
+        entityManager.addComponent(entityId, make_unique<TestComponent<0>>()),
+        std::runtime_error
+    );
+    EXPECT_THROW(
+        entityManager.addComponent(NULL_ENTITY, make_unique<TestComponent<0>>()),
+        std::runtime_error
+    );
+}
+
+
+TEST(EntityManager, RecycleIds) {
+    EntityManager entityManager;
+    std::vector<EntityId> destroyed;
+    // Destroy enough entities for their indices to be recycled
+    for (int i = 0; i < 2000; ++i) {
+        EntityId entityId = entityManager.generateNewId();
+        entityManager.addComponent(
+            entityId,
+            make_unique<TestComponent<0>>()
+        );
+        entityManager.removeEntity(entityId);
+        destroyed.push_back(entityId);
+    }
+    entityManager.processRemovals();
+    EntityId recycled = entityManager.generateNewId();
+    EXPECT_EQ(entityIndex(destroyed.front()), entityIndex(recycled));
+    EXPECT_NE(destroyed.front(), recycled);
+    entityManager.addComponent(
+        recycled,
+        make_unique<TestComponent<0>>()
+    );
+    EXPECT_TRUE(entityManager.exists(recycled));
+    EXPECT_FALSE(entityManager.exists(destroyed.front()));
+    EXPECT_TRUE(nullptr == entityManager.getComponent(destroyed.front(), TestComponent<0>::TYPE_ID));
+    // Destroying a stale id does not affect the new entity
+    entityManager.removeEntity(destroyed.front());
+    entityManager.processRemovals();
+    EXPECT_TRUE(entityManager.exists(recycled));
+}
+
+
+TEST(EntityManager, NamedIds) {
+    EntityManager entityManager;
+    EntityId named = entityManager.getNamedId("named");
+    EntityId other = entityManager.getNamedId("other");
+    EXPECT_EQ(named, entityManager.getNamedId("named"));
+    // Destroying a named entity frees its name
+    entityManager.addComponent(named, make_unique<TestComponent<0>>());
+    entityManager.removeEntity(named);
+    entityManager.processRemovals();
+    EXPECT_NE(named, entityManager.getNamedId("named"));
+    EXPECT_EQ(other, entityManager.getNamedId("other"));
+}
+
+
+TEST(EntityManager, RestoreIds) {
+    ComponentFactory factory;
+    EntityManager entityManager;
+    for (int i = 0; i < 2000; ++i) {
+        entityManager.removeEntity(entityManager.generateNewId());
+    }
+    entityManager.processRemovals();
+    EntityId named = entityManager.getNamedId("named");
+    StorageContainer storage = entityManager.storage(factory);
+    EntityManager restored;
+    restored.restore(storage, factory);
+    EXPECT_EQ(named, restored.getNamedId("named"));
+    for (int i = 0; i < 10; ++i) {
+        EXPECT_EQ(entityManager.generateNewId(), restored.generateNewId());
+    }
+}
+
+
+TEST(EntityManager, Tags) {
+    EntityManager entityManager;
+    EntityId entityId = entityManager.generateNewId();
+    EXPECT_FALSE(entityManager.hasTag<TestTag>(entityId));
+    EXPECT_TRUE(entityManager.addTag<TestTag>(entityId));
+    EXPECT_FALSE(entityManager.addTag<TestTag>(entityId));
+    EXPECT_TRUE(entityManager.hasTag<TestTag>(entityId));
+    // A tag is enough for an entity to exist
+    EXPECT_TRUE(entityManager.exists(entityId));
+    EXPECT_TRUE(entityManager.getComponentCollection(TestTag::TYPE_ID).isTag());
+    EXPECT_TRUE(nullptr == entityManager.getComponent(entityId, TestTag::TYPE_ID));
+    EXPECT_THROW(
+        entityManager.addTag(entityId, TestComponent<0>::TYPE_ID),
+        std::runtime_error
+    );
+    // Tags are removed with the queued components
+    EXPECT_TRUE(entityManager.removeTag<TestTag>(entityId));
+    EXPECT_TRUE(entityManager.hasTag<TestTag>(entityId));
+    entityManager.processRemovals();
+    EXPECT_FALSE(entityManager.removeTag<TestTag>(entityId));
+    EXPECT_FALSE(entityManager.hasTag<TestTag>(entityId));
+    EXPECT_FALSE(entityManager.exists(entityId));
+    // Removing the entity removes its tags
+    entityManager.addTag<TestTag>(entityId);
+    entityManager.addComponent(entityId, make_unique<TestComponent<0>>());
+    entityManager.removeEntity(entityId);
+    entityManager.processRemovals();
+    EXPECT_TRUE(entityManager.getComponentCollection(TestTag::TYPE_ID).empty());
+    EXPECT_THROW(entityManager.addTag<TestTag>(entityId), std::runtime_error);
+}
+
+
+TEST(EntityManager, RestoreTags) {
+    ComponentFactory factory;
+    EntityManager entityManager;
+    EntityId tagged = entityManager.generateNewId();
+    EntityId volatileEntity = entityManager.generateNewId();
+    entityManager.addTag<TestTag>(tagged);
+    entityManager.addTag<TestTag>(volatileEntity);
+    entityManager.setVolatile(volatileEntity, true);
+    EXPECT_TRUE(entityManager.isVolatile(volatileEntity));
+    EXPECT_FALSE(entityManager.isVolatile(tagged));
+    StorageContainer storage = entityManager.storage(factory);
+    EntityManager restored;
+    restored.restore(storage, factory);
+    EXPECT_TRUE(restored.hasTag<TestTag>(tagged));
+    // Volatile entities and their tags are not saved
+    EXPECT_FALSE(restored.exists(volatileEntity));
+    entityManager.setVolatile(volatileEntity, false);
+    EXPECT_TRUE(entityManager.isVolatile(volatileEntity));
+    entityManager.processRemovals();
+    EXPECT_FALSE(entityManager.isVolatile(volatileEntity));
+    EXPECT_TRUE(entityManager.hasTag<TestTag>(volatileEntity));
+}
+
+
+TEST(EntityManager, WriteRead) {
+    ComponentFactory factory;
+    EntityManager entityManager;
+    for (int i = 0; i < 2000; ++i) {
+        entityManager.removeEntity(entityManager.generateNewId());
+    }
+    entityManager.processRemovals();
+    EntityId named = entityManager.getNamedId("named");
+    EntityId tagged = entityManager.generateNewId();
+    EntityId removed = entityManager.generateNewId();
+    entityManager.addTag<TestTag>(tagged);
+    entityManager.addTag<TestTag>(removed);
+    entityManager.removeEntity(removed);
+    std::stringstream stream(std::stringstream::in | std::stringstream::out | std::stringstream::binary);
+    StorageWriter writer(stream);
+    writer.set<std::string>("before", "before");
+    writer.beginContainer("entities");
+    entityManager.write(writer, factory);
+    writer.end();
+    writer.set<std::string>("after", "after");
+    writer.finish();
+    EntityManager restored;
+    StorageReader reader(stream);
+    ASSERT_TRUE(reader.next());
+    EXPECT_EQ("before", reader.get<std::string>());
+    ASSERT_TRUE(reader.next());
+    ASSERT_TRUE(reader.isContainer());
+    reader.enter();
+    restored.read(reader, factory);
+    // The reader is back in the outer container
+    ASSERT_TRUE(reader.next());
+    EXPECT_EQ("after", reader.get<std::string>());
+    EXPECT_EQ(named, restored.getNamedId("named"));
+    EXPECT_TRUE(restored.hasTag<TestTag>(tagged));
+    // Pending removals are restored and carried out
+    EXPECT_TRUE(restored.hasTag<TestTag>(removed));
+    restored.processRemovals();
+    EXPECT_FALSE(restored.exists(removed));
+    for (int i = 0; i < 10; ++i) {
+        EXPECT_EQ(entityManager.generateNewId(), restored.generateNewId());
+    }
+}
+
+
+TEST(EntityManager, ReadAnyOrder) {
+    ComponentFactory factory;
+    EntityManager entityManager;
+    for (int i = 0; i < 2000; ++i) {
+        entityManager.removeEntity(entityManager.generateNewId());
+    }
+    entityManager.processRemovals();
+    EntityId named = entityManager.getNamedId("named");
+    EntityId tagged = entityManager.generateNewId();
+    EntityId removed = entityManager.generateNewId();
+    entityManager.addTag<TestTag>(tagged);
+    entityManager.addTag<TestTag>(removed);
+    entityManager.removeEntity(removed);
+    // Serializing the tree doesn't keep the order of write()
+    std::stringstream stream(std::stringstream::in | std::stringstream::out | std::stringstream::binary);
+    stream << entityManager.storage(factory);
+    EntityManager restored;
+    StorageReader reader(stream);
+    restored.read(reader, factory);
+    EXPECT_EQ(named, restored.getNamedId("named"));
+    EXPECT_TRUE(restored.hasTag<TestTag>(tagged));
+    restored.processRemovals();
+    EXPECT_FALSE(restored.exists(removed));
+    for (int i = 0; i < 10; ++i) {
+        EXPECT_EQ(entityManager.generateNewId(), restored.generateNewId());
+    }
+}
+
+
+TEST(EntityManager, ReadIdsLast) {
+    ComponentFactory factory;
+    EntityManager entityManager;
+    EntityId tagged = entityManager.generateNewId();
+    std::stringstream stream(std::stringstream::in | std::stringstream::out | std::stringstream::binary);
+    StorageWriter writer(stream);
+    writer.beginContainer("tags");
+    writer.beginList(TestTag::TYPE_NAME());
+    writer.beginElement();
+    writer.set("id", tagged);
+    writer.end();
+    writer.end();
+    writer.end();
+    writer.set("nextIndex", EntityId(entityIndex(tagged) + 1));
+    writer.finish();
+    StorageReader reader(stream);
+    entityManager.read(reader, factory);
+    EXPECT_TRUE(entityManager.hasTag<TestTag>(tagged));
+    EXPECT_TRUE(entityManager.isCurrent(tagged));
+}
+
+
+TEST(EntityManager, ReadWithoutIds) {
+    ComponentFactory factory;
+    EntityManager entityManager;
+    int batches = 0;
+    entityManager.getComponentCollection(TestTag::TYPE_ID).registerBatchCallbacks(
+        [&batches](const std::vector<EntityId>&) { batches += 1; },
+        nullptr
+    );
+    std::stringstream stream(std::stringstream::in | std::stringstream::out | std::stringstream::binary);
+    StorageWriter writer(stream);
+    writer.beginList("namedIds");
+    writer.end();
+    writer.finish();
+    StorageReader reader(stream);
+    EXPECT_THROW(entityManager.read(reader, factory), std::runtime_error);
+    // Changes are not deferred after the failed read
+    entityManager.addTag<TestTag>(entityManager.generateNewId());
+    EXPECT_EQ(1, batches);
+}
+
+
+TEST(EntityManager, ReadInPlace) {
+    ComponentFactory factory;
+    ReloadableComponent::TYPE_ID = factory.registerComponentType(
+        ReloadableComponent::TYPE_NAME(),
+        [](const StorageContainer& storage) {
+            std::unique_ptr<Component> component = make_unique<ReloadableComponent>();
+            component->load(storage);
+            return component;
+        }
+    );
+    EntityManager entityManager;
+    EntityId kept = entityManager.generateNewId();
+    EntityId destroyed = entityManager.generateNewId();
+    EntityId untagged = entityManager.generateNewId();
+    auto keptComponent = entityManager.addComponent(kept, make_unique<ReloadableComponent>());
+    keptComponent->m_value = 1;
+    entityManager.addComponent(destroyed, make_unique<ReloadableComponent>());
+    entityManager.addTag<TestTag>(untagged);
+    std::stringstream stream(std::stringstream::in | std::stringstream::out | std::stringstream::binary);
+    StorageWriter writer(stream);
+    entityManager.write(writer, factory);
+    writer.finish();
+    // Change everything after the checkpoint
+    keptComponent->m_value = 2;
+    entityManager.removeEntity(destroyed);
+    entityManager.removeTag<TestTag>(untagged);
+    entityManager.processRemovals();
+    EntityId created = entityManager.generateNewId();
+    entityManager.addComponent(created, make_unique<ReloadableComponent>());
+    int added = 0;
+    int removed = 0;
+    entityManager.getComponentCollection(ReloadableComponent::TYPE_ID).registerBatchCallbacks(
+        [&added](const std::vector<EntityId>& entityIds) { added += entityIds.size(); },
+        [&removed](const std::vector<EntityId>& entityIds) { removed += entityIds.size(); }
+    );
+    StorageReader reader(stream);
+    entityManager.read(reader, factory);
+    // The existing component is reloaded
+    EXPECT_TRUE(keptComponent == entityManager.getComponent(kept, ReloadableComponent::TYPE_ID));
+    EXPECT_EQ(1, keptComponent->m_value);
+    EXPECT_EQ(1, keptComponent->m_reloads);
+    // Only the difference is created and destroyed
+    EXPECT_TRUE(entityManager.exists(destroyed));
+    EXPECT_TRUE(entityManager.hasTag<TestTag>(untagged));
+    EXPECT_FALSE(entityManager.exists(created));
+    EXPECT_FALSE(entityManager.isCurrent(created));
+    EXPECT_EQ(1, added);
+    EXPECT_EQ(1, removed);
+    EXPECT_EQ(3u, entityManager.entityCount());
+}
+
+
+TEST(EntityManager, ReadStreamed) {
+    ComponentFactory factory;
+    StreamedComponent::TYPE_ID = factory.registerComponentType(
+        StreamedComponent::TYPE_NAME(),
+        [](const StorageContainer& storage) {
+            std::unique_ptr<Component> component = make_unique<StreamedComponent>();
+            component->load(storage);
+            return component;
+        }
+    );
+    EntityManager entityManager;
+    EntityId kept = entityManager.generateNewId();
+    EntityId destroyed = entityManager.generateNewId();
+    auto keptComponent = entityManager.addComponent(kept, make_unique<StreamedComponent>());
+    keptComponent->m_value = 1;
+    entityManager.addComponent(destroyed, make_unique<StreamedComponent>())->m_value = 3;
+    std::stringstream stream(std::stringstream::in | std::stringstream::out | std::stringstream::binary);
+    StorageWriter writer(stream);
+    entityManager.write(writer, factory);
+    writer.finish();
+    keptComponent->m_value = 2;
+    entityManager.removeEntity(destroyed);
+    entityManager.processRemovals();
+    StorageReader reader(stream);
+    entityManager.read(reader, factory);
+    // The existing component reads itself in place
+    EXPECT_TRUE(keptComponent == entityManager.getComponent(kept, StreamedComponent::TYPE_ID));
+    EXPECT_EQ(1, keptComponent->m_value);
+    EXPECT_EQ(1, keptComponent->m_reads);
+    EXPECT_EQ(0, keptComponent->m_reloads);
+    // New components read themselves as well
+    auto restoredComponent = static_cast<StreamedComponent*>(
+        entityManager.getComponent(destroyed, StreamedComponent::TYPE_ID)
+    );
+    ASSERT_TRUE(restoredComponent != nullptr);
+    EXPECT_EQ(3, restoredComponent->m_value);
+    EXPECT_EQ(1, restoredComponent->m_reads);
+}
+
+
+TEST(EntityManager, CreateCollections) {
+    ComponentFactory factory;
+    ComponentTypeId typeId = factory.registerTagType("CreateCollectionsTag");
+    EntityManager entityManager;
+    entityManager.createCollections(factory);
+    std::vector<ComponentCollection::Statistics> statistics = entityManager.componentStatistics();
+    EXPECT_EQ(factory.typeIds().size(), statistics.size());
+    // Lookups find the collection without creating it
+    EXPECT_TRUE(nullptr == entityManager.getComponent(entityManager.generateNewId(), typeId));
+    EXPECT_EQ(statistics.size(), entityManager.componentStatistics().size());
+}
@@ -0,0 +1,87 @@
+#include "engine/prefab.h"
+
+#include "engine/component_collection.h"
+#include "engine/component_factory.h"
+#include "engine/entity_filter.h"
+#include "engine/entity_manager.h"
+#include "engine/serialization.h"
+#include "engine/tests/test_component.h"
+#include "util/make_unique.h"
+
+#include <gtest/gtest.h>
+#include <vector>
+
+using namespace thrive;
+
+
+TEST(Prefab, CreateComponents) {
+    Prefab prefab;
+    prefab.addComponent(make_unique<TestComponent<0>>());
+    prefab.addComponent(make_unique<TestComponent<1>>());
+    EXPECT_EQ(2u, prefab.size());
+    auto components = prefab.createComponents();
+    ASSERT_EQ(2u, components.size());
+    EXPECT_TRUE(TestComponent<0>::TYPE_ID == components[0]->typeId());
+    EXPECT_TRUE(TestComponent<1>::TYPE_ID == components[1]->typeId());
+    // Each call creates new clones
+    auto clones = prefab.createComponents();
+    EXPECT_NE(components[0].get(), clones[0].get());
+}
+
+
+TEST(Prefab, Storage) {
+    ComponentFactory factory;
+    factory.registerComponentType(
+        TestComponent<0>::TYPE_NAME(),
+        [](const StorageContainer& storage) {
+            std::unique_ptr<Component> component = make_unique<TestComponent<0>>();
+            component->load(storage);
+            return component;
+        }
+    );
+    Prefab prefab;
+    prefab.addComponent(TestComponent<0>(), factory);
+    EXPECT_THROW(prefab.addComponent(TestComponent<1>(), factory), std::runtime_error);
+    auto components = prefab.createComponents();
+    ASSERT_EQ(1u, components.size());
+    EXPECT_TRUE(TestComponent<0>::TYPE_ID == components[0]->typeId());
+}
+
+
+TEST(Prefab, Instantiate) {
+    EntityManager entityManager;
+    EntityFilter<TestComponent<0>, TestComponent<1>> filter(true);
+    filter.setEntityManager(&entityManager);
+    int batches = 0;
+    entityManager.getComponentCollection(TestComponent<0>::TYPE_ID).registerBatchCallbacks(
+        [&batches](const std::vector<EntityId>&) { batches += 1; },
+        nullptr
+    );
+    Prefab prefab;
+    prefab.addComponent(make_unique<TestComponent<0>>());
+    prefab.addComponent(make_unique<TestComponent<1>>());
+    std::vector<EntityId> initialized;
+    auto entityIds = entityManager.instantiate(prefab, 10, [&](EntityId entityId) {
+        // Components are in place, but filters don't know yet
+        EXPECT_TRUE(nullptr != entityManager.getComponent(entityId, TestComponent<1>::TYPE_ID));
+        EXPECT_EQ(0u, filter.entities().size());
+        initialized.push_back(entityId);
+    });
+    EXPECT_EQ(10u, entityIds.size());
+    EXPECT_EQ(entityIds, initialized);
+    // One batch for all entities
+    EXPECT_EQ(1, batches);
+    EXPECT_EQ(10u, filter.addedEntities().size());
+    EXPECT_EQ(10u, filter.entities().size());
+    filter.setEntityManager(nullptr);
+}
+
+
+TEST(Prefab, DuplicateTypes) {
+    EntityManager entityManager;
+    Prefab prefab;
+    prefab.addComponent(make_unique<TestComponent<0>>());
+    prefab.addComponent(make_unique<TestComponent<0>>());
+    EXPECT_THROW(entityManager.instantiate(prefab, 1), std::runtime_error);
+    EXPECT_TRUE(entityManager.entities().empty());
+}
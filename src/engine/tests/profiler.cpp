@@ -0,0 +1,137 @@
+#include "engine/profiler.h"
+
+#include "engine/system.h"
+#include "engine/system_scheduler.h"
+#include "engine/thread_pool.h"
+
+#include <boost/thread.hpp>
+#include <gtest/gtest.h>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace thrive;
+
+namespace {
+
+class IdleSystem : public System {
+
+public:
+
+    IdleSystem(
+        ComponentTypeId writes
+    ) {
+        this->writesComponent(writes);
+    }
+
+    void
+    update(int) override {}
+
+};
+
+}
+
+
+TEST(Profiler, Record) {
+    Profiler profiler(4);
+    auto first = profiler.registerName("First");
+    auto second = profiler.registerName("Second");
+    EXPECT_EQ(first, profiler.registerName("First"));
+    EXPECT_EQ("Second", profiler.name(second));
+    profiler.beginFrame();
+    profiler.record(first, 0, 1000);
+    profiler.record(second, 1000, 1500);
+    profiler.record(first, 1500, 2000);
+    profiler.endFrame();
+    auto samples = profiler.samples();
+    ASSERT_EQ(4u, samples.size());
+    EXPECT_EQ(first, samples[0].name);
+    EXPECT_EQ(1u, samples[0].frame);
+    EXPECT_EQ("Frame", profiler.name(samples[3].name));
+    auto times = profiler.frameTimes(1);
+    ASSERT_EQ(3u, times.size());
+    EXPECT_EQ("First", times[0].first);
+    EXPECT_DOUBLE_EQ(1.5, times[0].second);
+    EXPECT_EQ("Second", times[1].first);
+    EXPECT_DOUBLE_EQ(0.5, times[1].second);
+    // Full buffer overwrites the oldest sample
+    profiler.beginFrame();
+    profiler.record(second, 3000, 3100);
+    samples = profiler.samples();
+    ASSERT_EQ(4u, samples.size());
+    EXPECT_EQ(second, samples[0].name);
+    EXPECT_EQ(2u, samples[3].frame);
+    // Disabled profilers don't record
+    profiler.setEnabled(false);
+    profiler.record(first, 3100, 3200);
+    EXPECT_EQ(3100, profiler.samples()[3].end);
+}
+
+
+TEST(Profiler, ConcurrentRecord) {
+    Profiler profiler(16);
+    std::vector<Profiler::NameId> names;
+    for (int i = 0; i < 4; ++i) {
+        names.push_back(profiler.registerName("Thread " + std::to_string(i)));
+    }
+    profiler.beginFrame();
+    std::vector<boost::thread> threads;
+    for (int i = 0; i < 4; ++i) {
+        threads.emplace_back([&profiler, &names, i]() {
+            for (int j = 0; j < 10000; ++j) {
+                profiler.record(names[i], i, i + j);
+            }
+        });
+    }
+    // Samples read while the buffer wraps around are never torn
+    for (int round = 0; round < 1000; ++round) {
+        for (const Profiler::Sample& sample : profiler.samples()) {
+            ASSERT_GE(sample.begin, 0);
+            ASSERT_LT(sample.begin, 4);
+            ASSERT_EQ(names[sample.begin], sample.name);
+        }
+    }
+    for (boost::thread& thread : threads) {
+        thread.join();
+    }
+    profiler.endFrame();
+    auto times = profiler.frameTimes(profiler.frame());
+    ASSERT_EQ(5u, times.size());
+    for (const auto& time : times) {
+        if (time.first != "Frame") {
+            // Sum of j for j < 10000
+            EXPECT_DOUBLE_EQ(49995000 / 1000.0, time.second);
+        }
+    }
+}
+
+
+TEST(Profiler, ChromeTrace) {
+    Profiler profiler;
+    auto name = profiler.registerName("Quoted \"name\"");
+    profiler.record(name, 10, 25);
+    std::ostringstream stream;
+    profiler.writeChromeTrace(stream);
+    std::string trace = stream.str();
+    EXPECT_EQ(0u, trace.find("{\"traceEvents\":["));
+    EXPECT_NE(std::string::npos, trace.find("\"name\":\"Quoted \\\"name\\\"\""));
+    EXPECT_NE(std::string::npos, trace.find("\"ts\":10,\"dur\":15"));
+}
+
+
+TEST(Profiler, SystemScheduler) {
+    ThreadPool threadPool;
+    threadPool.start(2);
+    Profiler profiler;
+    IdleSystem first(1);
+    first.setName("First");
+    IdleSystem second(2);
+    second.setName("Second");
+    SystemScheduler scheduler({&first, &second}, &profiler);
+    profiler.beginFrame();
+    scheduler.update(10, threadPool);
+    profiler.endFrame();
+    auto times = profiler.frameTimes(profiler.frame());
+    ASSERT_EQ(3u, times.size());
+    EXPECT_EQ("Frame", times[2].first);
+}
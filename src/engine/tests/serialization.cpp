@@ -28,6 +28,29 @@ copy(
     return copy.get<T>("value");
 }
 
+template<typename T>
+static void
+writeRaw(
+    std::ostream& stream,
+    T value
+) {
+    stream.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+
+static void
+writeLegacyFloat(
+    std::ostream& stream,
+    const std::string& key,
+    const std::string& value
+) {
+    writeRaw<uint64_t>(stream, key.size());
+    stream.write(key.data(), key.size());
+    writeRaw<uint16_t>(stream, 176);
+    writeRaw<uint64_t>(stream, value.size());
+    stream.write(value.data(), value.size());
+}
+
 template<typename T>
 static void
 testSerialization(
@@ -108,4 +131,124 @@ TEST(Serialization, Vector3) {
 }
 
 
+TEST(Serialization, Quaternion) {
+    Ogre::Quaternion quaternion(0.5f, 0.5f, -0.5f, 0.5f);
+    testSerialization(quaternion);
+}
+
+
+TEST(Serialization, Plane) {
+    Ogre::Plane plane(Ogre::Vector3(0, 1, 0), 4.0f);
+    testSerialization(plane);
+}
+
+
+TEST(Serialization, CompactEncoding) {
+    StorageContainer container;
+    container.set("value", Ogre::Vector3(1, 2, 3));
+    std::ostringstream stream(std::ios_base::out | std::ios_base::binary);
+    stream << container;
+    // Header, new key marker, key, type id, three raw floats and end of
+    // container
+    EXPECT_EQ(8u + 4u + 8u + 5u + 2u + 3 * sizeof(float) + 4u, stream.str().size());
+}
 
+
+TEST(Serialization, KeyTable) {
+    StorageList list;
+    for (int i = 0; i < 100; ++i) {
+        StorageContainer element;
+        element.set("entityId", i);
+        list.append(std::move(element));
+    }
+    StorageContainer container;
+    container.set("entities", list);
+    std::ostringstream stream(std::ios_base::out | std::ios_base::binary);
+    stream << container;
+    // Each key is written once
+    std::string data = stream.str();
+    std::size_t position = data.find("entityId");
+    ASSERT_NE(std::string::npos, position);
+    EXPECT_EQ(std::string::npos, data.find("entityId", position + 1));
+    StorageList listCopy = copy(container).get<StorageList>("entities");
+    ASSERT_EQ(100u, listCopy.size());
+    EXPECT_EQ(42, listCopy[42].get<int>("entityId"));
+}
+
+
+TEST(Serialization, LegacyEncoding) {
+    // As written before StorageWriter and the compact encodings
+    std::ostringstream stream(std::ios_base::out | std::ios_base::binary);
+    writeRaw<uint64_t>(stream, 2);
+    writeLegacyFloat(stream, "float", "1.5");
+    writeRaw<uint64_t>(stream, 8);
+    stream.write("position", 8);
+    writeRaw<uint16_t>(stream, 304);
+    writeRaw<uint64_t>(stream, 3);
+    writeLegacyFloat(stream, "x", "1");
+    writeLegacyFloat(stream, "y", "2");
+    writeLegacyFloat(stream, "z", "-3.25");
+    StorageContainer container;
+    std::istringstream inputStream(
+        stream.str(),
+        std::ios_base::in | std::ios_base::binary
+    );
+    inputStream >> container;
+    EXPECT_FLOAT_EQ(1.5f, container.get<float>("float"));
+    EXPECT_TRUE(Ogre::Vector3(1, 2, -3.25f) == container.get<Ogre::Vector3>("position"));
+    // Written back in the compact encoding
+    EXPECT_FLOAT_EQ(1.5f, copy(container).get<float>("float"));
+}
+
+
+TEST(Serialization, StorageWriter) {
+    std::stringstream stream(std::ios_base::in | std::ios_base::out | std::ios_base::binary);
+    StorageWriter writer(stream);
+    writer.set<std::string>("name", "thrive");
+    writer.beginContainer("skipped");
+    writer.set("value", 1);
+    writer.end();
+    writer.beginList("entities");
+    for (int i = 0; i < 3; ++i) {
+        writer.beginElement();
+        writer.set("id", i);
+        writer.end();
+    }
+    writer.end();
+    StorageContainer nested;
+    nested.set("position", Ogre::Vector3(1, 2, 3));
+    writer.set("nested", nested);
+    writer.finish();
+    // Pull entries one by one
+    EXPECT_TRUE(StorageReader::canRead(stream));
+    StorageReader reader(stream);
+    ASSERT_TRUE(reader.next());
+    EXPECT_EQ("name", reader.key());
+    EXPECT_EQ("thrive", reader.get<std::string>());
+    EXPECT_THROW(reader.get<int>(), std::runtime_error);
+    ASSERT_TRUE(reader.next());
+    EXPECT_TRUE(reader.isContainer());
+    // Not entered, so it is skipped
+    ASSERT_TRUE(reader.next());
+    EXPECT_EQ("entities", reader.key());
+    ASSERT_TRUE(reader.isList());
+    reader.enter();
+    int count = 0;
+    while (reader.nextElement()) {
+        ASSERT_TRUE(reader.next());
+        EXPECT_EQ(count, reader.get<int>());
+        EXPECT_FALSE(reader.next());
+        count++;
+    }
+    EXPECT_EQ(3, count);
+    ASSERT_TRUE(reader.next());
+    StorageContainer nestedCopy = reader.get<StorageContainer>();
+    EXPECT_TRUE(Ogre::Vector3(1, 2, 3) == nestedCopy.get<Ogre::Vector3>("position"));
+    EXPECT_FALSE(reader.next());
+    // The same stream read as a whole
+    stream.seekg(0);
+    StorageContainer container;
+    stream >> container;
+    EXPECT_EQ("thrive", container.get<std::string>("name"));
+    EXPECT_EQ(3u, container.get<StorageList>("entities").size());
+}
@@ -0,0 +1,84 @@
+#include "engine/sparse_entity_map.h"
+
+#include <gtest/gtest.h>
+#include <memory>
+#include <unordered_map>
+
+using namespace thrive;
+
+
+TEST(SparseEntityMap, InsertAndFind) {
+    SparseEntityMap<int> map;
+    EXPECT_TRUE(map.empty());
+    EXPECT_TRUE(map.insert(std::make_pair(1, 10)).second);
+    EXPECT_TRUE(map.insert(std::make_pair(5000, 50)).second);
+    // Inserting again does not overwrite
+    EXPECT_FALSE(map.insert(std::make_pair(1, 20)).second);
+    EXPECT_EQ(2u, map.size());
+    EXPECT_EQ(1u, map.count(1));
+    EXPECT_EQ(1u, map.count(5000));
+    EXPECT_EQ(0u, map.count(2));
+    EXPECT_EQ(0u, map.count(100000));
+    EXPECT_EQ(10, map.at(1));
+    EXPECT_EQ(50, map.find(5000)->second);
+    EXPECT_TRUE(map.find(3) == map.end());
+    EXPECT_THROW(map.at(3), std::out_of_range);
+    map[3] = 30;
+    EXPECT_EQ(30, map.at(3));
+}
+
+
+TEST(SparseEntityMap, Erase) {
+    SparseEntityMap<int> map;
+    for (EntityId id = 1; id <= 100; ++id) {
+        map[id] = id * 2;
+    }
+    // Erase every other entity, which moves elements around
+    for (EntityId id = 1; id <= 100; id += 2) {
+        EXPECT_EQ(1u, map.erase(id));
+    }
+    EXPECT_EQ(0u, map.erase(1));
+    EXPECT_EQ(50u, map.size());
+    for (EntityId id = 1; id <= 100; ++id) {
+        if (id % 2) {
+            EXPECT_EQ(0u, map.count(id));
+        }
+        else {
+            EXPECT_EQ(static_cast<int>(id * 2), map.at(id));
+        }
+    }
+}
+
+
+TEST(SparseEntityMap, Iteration) {
+    SparseEntityMap<int> map;
+    std::unordered_map<EntityId, int> reference;
+    for (EntityId id = 1; id < 3000; id += 7) {
+        map[id] = id + 1;
+        reference[id] = id + 1;
+    }
+    map.erase(8);
+    reference.erase(8);
+    map.erase(22);
+    reference.erase(22);
+    EXPECT_EQ(reference.size(), map.size());
+    size_t visited = 0;
+    for (const auto& pair : map) {
+        EXPECT_EQ(reference.at(pair.first), pair.second);
+        ++visited;
+    }
+    EXPECT_EQ(reference.size(), visited);
+}
+
+
+TEST(SparseEntityMap, MoveOnlyValues) {
+    SparseEntityMap<std::unique_ptr<int>> map;
+    map.insert(std::make_pair(1, std::unique_ptr<int>(new int(1))));
+    map.insert(std::make_pair(2, std::unique_ptr<int>(new int(2))));
+    map.erase(1);
+    EXPECT_EQ(2, *map.at(2));
+    map.clear();
+    EXPECT_TRUE(map.empty());
+    EXPECT_EQ(0u, map.count(2));
+}
+
@@ -0,0 +1,131 @@
+#include "engine/system_scheduler.h"
+
+#include "engine/system.h"
+#include "engine/thread_pool.h"
+
+#include <atomic>
+#include <boost/thread.hpp>
+#include <gtest/gtest.h>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+using namespace thrive;
+
+namespace {
+
+class TestSystem : public System {
+
+public:
+
+    TestSystem(
+        std::atomic<int>& running,
+        std::vector<ComponentTypeId> reads,
+        std::vector<ComponentTypeId> writes,
+        bool mainThreadOnly = false
+    ) : m_running(running)
+    {
+        for (ComponentTypeId typeId : reads) {
+            this->readsComponent(typeId);
+        }
+        for (ComponentTypeId typeId : writes) {
+            this->writesComponent(typeId);
+        }
+        this->setMainThreadOnly(mainThreadOnly);
+    }
+
+    void
+    update(int) override {
+        m_threadId = boost::this_thread::get_id();
+        m_concurrent = m_running++;
+        boost::this_thread::sleep(boost::posix_time::milliseconds(5));
+        m_running--;
+        m_updates += 1;
+    }
+
+    int m_concurrent = 0;
+
+    std::atomic<int>& m_running;
+
+    boost::thread::id m_threadId;
+
+    int m_updates = 0;
+
+};
+
+class ThrowingSystem : public System {
+
+public:
+
+    ThrowingSystem() {
+        this->writesComponent(1);
+    }
+
+    void
+    update(int) override {
+        throw std::runtime_error("Failed");
+    }
+
+};
+
+}
+
+
+TEST(SystemScheduler, Dependencies) {
+    std::atomic<int> running(0);
+    TestSystem reader1(running, {1}, {});
+    TestSystem reader2(running, {1}, {2});
+    TestSystem writer(running, {}, {1});
+    TestSystem undeclared(running, {}, {});
+    TestSystem reader3(running, {1}, {});
+    SystemScheduler scheduler({&reader1, &reader2, &writer, &undeclared, &reader3});
+    EXPECT_TRUE(scheduler.dependencies(0).empty());
+    // Reading the same type doesn't conflict
+    EXPECT_TRUE(scheduler.dependencies(1).empty());
+    EXPECT_EQ(std::vector<std::size_t>({0, 1}), scheduler.dependencies(2));
+    // Undeclared systems act as barriers
+    EXPECT_EQ(std::vector<std::size_t>({0, 1, 2}), scheduler.dependencies(3));
+    EXPECT_EQ(std::vector<std::size_t>({2, 3}), scheduler.dependencies(4));
+}
+
+
+TEST(SystemScheduler, Update) {
+    ThreadPool threadPool;
+    threadPool.start(3);
+    std::atomic<int> running(0);
+    TestSystem first(running, {1}, {2});
+    TestSystem second(running, {1}, {3});
+    TestSystem third(running, {}, {4}, true);
+    TestSystem conflicting(running, {2}, {1});
+    TestSystem disabled(running, {}, {5});
+    disabled.setEnabled(false);
+    SystemScheduler scheduler({&first, &second, &third, &conflicting, &disabled});
+    for (int i = 0; i < 3; ++i) {
+        scheduler.update(10, threadPool);
+    }
+    EXPECT_EQ(3, first.m_updates);
+    EXPECT_EQ(3, second.m_updates);
+    EXPECT_EQ(3, third.m_updates);
+    EXPECT_EQ(3, conflicting.m_updates);
+    EXPECT_EQ(0, disabled.m_updates);
+    // The conflicting system never runs alongside the first two. The
+    // third could still be running, though.
+    EXPECT_GE(1, conflicting.m_concurrent);
+    EXPECT_EQ(boost::this_thread::get_id(), third.m_threadId);
+}
+
+
+TEST(SystemScheduler, Exception) {
+    ThreadPool threadPool;
+    threadPool.start(2);
+    std::atomic<int> running(0);
+    ThrowingSystem throwing;
+    TestSystem after(running, {1}, {});
+    SystemScheduler scheduler({&throwing, &after});
+    EXPECT_THROW(scheduler.update(10, threadPool), std::runtime_error);
+    // Systems depending on the failed one are skipped
+    EXPECT_EQ(0, after.m_updates);
+    // Without workers, systems are updated in turn
+    threadPool.stop();
+    EXPECT_THROW(scheduler.update(10, threadPool), std::runtime_error);
+}
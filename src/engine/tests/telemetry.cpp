@@ -0,0 +1,166 @@
+#include "engine/telemetry.h"
+
+#include "engine/component_factory.h"
+#include "engine/entity_manager.h"
+#include "engine/tests/test_component.h"
+#include "util/make_unique.h"
+
+#include <cstdio>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <sstream>
+
+using namespace thrive;
+
+
+TEST(Telemetry, Statistics) {
+    EntityManager entityManager;
+    ComponentCollection& collection = entityManager.getComponentCollection(
+        TestComponent<0>::TYPE_ID
+    );
+    EntityId first = entityManager.generateNewId();
+    EntityId second = entityManager.generateNewId();
+    entityManager.addComponent(first, make_unique<TestComponent<0>>());
+    entityManager.addComponent(second, make_unique<TestComponent<0>>());
+    // Replacing counts as one addition and one removal
+    entityManager.addComponent(second, make_unique<TestComponent<0>>());
+    entityManager.removeComponent(first, TestComponent<0>::TYPE_ID);
+    entityManager.processRemovals();
+    ComponentCollection::Statistics statistics = collection.statistics();
+    EXPECT_TRUE(TestComponent<0>::TYPE_ID == statistics.type);
+    EXPECT_EQ(3, statistics.added);
+    EXPECT_EQ(2, statistics.removed);
+    EXPECT_EQ(1, statistics.count);
+    EXPECT_EQ(2, statistics.peakCount);
+    // Test components don't allocate from a pool
+    EXPECT_EQ(0, statistics.bytesAllocated);
+    EXPECT_EQ(1, entityManager.entityCount());
+}
+
+
+TEST(Telemetry, Sample) {
+    EntityManager entityManager;
+    ComponentFactory factory;
+    Telemetry telemetry;
+    telemetry.setInterval(10);
+    for (int i = 0; i < 20; ++i) {
+        EntityId entityId = entityManager.generateNewId();
+        entityManager.addComponent(entityId, make_unique<TestComponent<0>>());
+    }
+    // First update always samples
+    telemetry.update(entityManager, factory, 1);
+    telemetry.update(entityManager, factory, 5);
+    ASSERT_EQ(1, telemetry.samples().size());
+    entityManager.clear();
+    telemetry.setGauge("Leaky", 42.0);
+    telemetry.update(entityManager, factory, 11);
+    ASSERT_EQ(2, telemetry.samples().size());
+    const Telemetry::Sample& sample = telemetry.samples().back();
+    EXPECT_EQ(11, sample.frame);
+    EXPECT_EQ(0, sample.entityCount);
+    ASSERT_EQ(1, sample.components.size());
+    const Telemetry::ComponentSample& component = sample.components[0];
+    EXPECT_EQ(0, component.count);
+    EXPECT_EQ(20, component.peakCount);
+    EXPECT_DOUBLE_EQ(0.0, component.addedPerFrame);
+    EXPECT_DOUBLE_EQ(2.0, component.removedPerFrame);
+    ASSERT_EQ(1, sample.gauges.size());
+    EXPECT_EQ("Leaky", sample.gauges[0].first);
+    // Disabled
+    telemetry.setInterval(0);
+    telemetry.update(entityManager, factory, 100);
+    EXPECT_EQ(2, telemetry.samples().size());
+}
+
+
+TEST(Telemetry, Write) {
+    EntityManager entityManager;
+    ComponentFactory factory;
+    Telemetry telemetry;
+    entityManager.addComponent(
+        entityManager.generateNewId(),
+        make_unique<TestComponent<0>>()
+    );
+    telemetry.setGauge("Gauge", 3.0);
+    telemetry.sample(entityManager, factory, 1);
+    std::ostringstream csv;
+    telemetry.writeCsv(csv);
+    std::string line;
+    std::istringstream lines(csv.str());
+    std::getline(lines, line);
+    EXPECT_EQ("frame,milliseconds,name,count,peakCount,addedPerFrame,removedPerFrame,bytesAllocated", line);
+    int rows = 0;
+    while (std::getline(lines, line)) {
+        rows += 1;
+    }
+    // Entities, one component type and one gauge
+    EXPECT_EQ(3, rows);
+    std::ostringstream json;
+    telemetry.writeJson(json);
+    EXPECT_NE(std::string::npos, json.str().find("\"entities\":1"));
+    EXPECT_NE(std::string::npos, json.str().find("\"Gauge\":3"));
+}
+
+
+TEST(Telemetry, OutputFile) {
+    const std::string filename = "telemetry_test_output.csv";
+    EntityManager entityManager;
+    ComponentFactory factory;
+    Telemetry telemetry;
+    telemetry.setOutputFile(filename);
+    auto countLines = [&filename]() {
+        std::ifstream stream(filename);
+        std::string line;
+        int lines = 0;
+        while (std::getline(stream, line)) {
+            lines += 1;
+        }
+        return lines;
+    };
+    // Header only
+    EXPECT_EQ(1, countLines());
+    // Each sample is in the file right away
+    telemetry.sample(entityManager, factory, 1);
+    EXPECT_EQ(2, countLines());
+    telemetry.sample(entityManager, factory, 2);
+    EXPECT_EQ(3, countLines());
+    telemetry.closeOutputFile();
+    EXPECT_TRUE(telemetry.outputFile().empty());
+    telemetry.sample(entityManager, factory, 3);
+    EXPECT_EQ(3, countLines());
+    std::remove(filename.c_str());
+}
+
+
+TEST(Telemetry, OutputFileJson) {
+    const std::string filename = "telemetry_test_output.json";
+    EntityManager entityManager;
+    ComponentFactory factory;
+    Telemetry telemetry;
+    // Samples taken before are written as well
+    telemetry.sample(entityManager, factory, 1);
+    telemetry.setOutputFile(filename);
+    telemetry.sample(entityManager, factory, 2);
+    telemetry.closeOutputFile();
+    std::ifstream stream(filename);
+    std::string content(
+        (std::istreambuf_iterator<char>(stream)),
+        std::istreambuf_iterator<char>()
+    );
+    std::ostringstream expected;
+    telemetry.writeJson(expected);
+    EXPECT_EQ(expected.str(), content);
+    std::remove(filename.c_str());
+}
+
+
+TEST(Telemetry, MaxSamples) {
+    EntityManager entityManager;
+    ComponentFactory factory;
+    Telemetry telemetry;
+    for (std::size_t frame = 1; frame <= Telemetry::MAX_SAMPLES + 10; ++frame) {
+        telemetry.sample(entityManager, factory, frame);
+    }
+    ASSERT_EQ(Telemetry::MAX_SAMPLES, telemetry.samples().size());
+    EXPECT_EQ(11u, telemetry.samples().front().frame);
+}
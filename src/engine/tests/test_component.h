@@ -2,6 +2,7 @@
 
 #include "engine/component.h"
 #include "engine/serialization.h"
+#include "engine/tag.h"
 #include "engine/typedefs.h"
 
 #include <boost/lexical_cast.hpp>
@@ -42,3 +43,8 @@ public:
     }
 
 };
+
+// Registered in tests/entity_manager.cpp
+class TestTag {
+    TAG(TestTag)
+};
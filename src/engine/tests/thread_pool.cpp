@@ -0,0 +1,115 @@
+#include "engine/thread_pool.h"
+
+#include "engine/task_graph.h"
+
+#include <atomic>
+#include <boost/thread.hpp>
+#include <gtest/gtest.h>
+#include <stdexcept>
+#include <vector>
+
+using namespace thrive;
+
+
+TEST(ThreadPool, Submit) {
+    ThreadPool threadPool;
+    std::atomic<int> counter(0);
+    // Without workers, tasks run right away
+    threadPool.submit([&counter]() { counter += 1; });
+    EXPECT_EQ(1, counter);
+    threadPool.start(2);
+    EXPECT_EQ(2u, threadPool.workerCount());
+    for (int i = 0; i < 100; ++i) {
+        threadPool.submit([&counter]() { counter += 1; });
+    }
+    // Stopping finishes the queued tasks
+    threadPool.stop();
+    EXPECT_EQ(101, counter);
+    EXPECT_EQ(0u, threadPool.workerCount());
+}
+
+
+TEST(ThreadPool, ParallelFor) {
+    ThreadPool threadPool;
+    threadPool.start(3);
+    std::vector<std::atomic<int>> visits(1000);
+    threadPool.parallelFor(
+        visits.size(),
+        7,
+        [&visits](std::size_t begin, std::size_t end) {
+            EXPECT_LE(end - begin, 7u);
+            for (std::size_t i = begin; i < end; ++i) {
+                visits[i] += 1;
+            }
+        }
+    );
+    for (const auto& count : visits) {
+        EXPECT_EQ(1, count);
+    }
+    // Nested in a task
+    std::atomic<int> total(0);
+    threadPool.submit([&threadPool, &total]() {
+        threadPool.parallelFor(100, 10, [&total](std::size_t begin, std::size_t end) {
+            total += static_cast<int>(end - begin);
+        });
+    });
+    while (total < 100) {
+        threadPool.runPendingTask();
+    }
+    EXPECT_THROW(
+        threadPool.parallelFor(100, 1, [](std::size_t begin, std::size_t) {
+            if (begin == 50) {
+                throw std::runtime_error("Failed");
+            }
+        }),
+        std::runtime_error
+    );
+}
+
+
+TEST(TaskGraph, Run) {
+    ThreadPool threadPool;
+    threadPool.start(3);
+    std::atomic<int> step(0);
+    std::vector<int> finishedAt(4, -1);
+    boost::thread::id pinnedThread;
+    TaskGraph graph;
+    auto first = graph.addTask([&]() { finishedAt[0] = step++; });
+    auto left = graph.addTask([&]() { finishedAt[1] = step++; });
+    auto right = graph.addTask([&]() { finishedAt[2] = step++; });
+    auto last = graph.addTask(
+        [&]() {
+            pinnedThread = boost::this_thread::get_id();
+            finishedAt[3] = step++;
+        },
+        true
+    );
+    graph.addDependency(first, left);
+    graph.addDependency(first, right);
+    graph.addDependency(left, last);
+    graph.addDependency(right, last);
+    EXPECT_EQ(4u, graph.size());
+    EXPECT_EQ(std::vector<TaskGraph::TaskId>({left, right}), graph.dependencies(last));
+    graph.run(threadPool);
+    EXPECT_EQ(0, finishedAt[first]);
+    EXPECT_LT(finishedAt[first], finishedAt[left]);
+    EXPECT_LT(finishedAt[first], finishedAt[right]);
+    EXPECT_EQ(3, finishedAt[last]);
+    EXPECT_EQ(boost::this_thread::get_id(), pinnedThread);
+    // Graphs can be run again
+    graph.run(threadPool);
+    EXPECT_EQ(8, step);
+}
+
+
+TEST(TaskGraph, Exception) {
+    ThreadPool threadPool;
+    threadPool.start(2);
+    bool ran = false;
+    TaskGraph graph;
+    auto failing = graph.addTask([]() { throw std::runtime_error("Failed"); });
+    auto dependent = graph.addTask([&ran]() { ran = true; });
+    graph.addDependency(failing, dependent);
+    EXPECT_THROW(graph.run(threadPool), std::runtime_error);
+    EXPECT_FALSE(ran);
+}
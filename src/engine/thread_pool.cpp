@@ -0,0 +1,318 @@
+#include "engine/thread_pool.h"
+
+#include <algorithm>
+#include <assert.h>
+#include <atomic>
+#include <boost/thread.hpp>
+#include <deque>
+#include <exception>
+#include <vector>
+
+using namespace thrive;
+
+namespace {
+
+struct ParallelFor {
+
+    std::size_t m_chunkCount;
+
+    std::size_t m_chunkSize;
+
+    std::size_t m_count;
+
+    boost::condition_variable m_done;
+
+    std::exception_ptr m_error;
+
+    std::size_t m_finishedChunks = 0;
+
+    std::function<void(std::size_t, std::size_t)> m_function;
+
+    boost::mutex m_mutex;
+
+    std::atomic<std::size_t> m_nextChunk{0};
+
+    // Claims and processes chunks until none are left
+    void
+    work() {
+        std::size_t chunk;
+        while ((chunk = m_nextChunk++) < m_chunkCount) {
+            std::size_t begin = chunk * m_chunkSize;
+            std::size_t end = std::min(begin + m_chunkSize, m_count);
+            std::exception_ptr error;
+            std::size_t skippedChunks = 0;
+            try {
+                m_function(begin, end);
+            }
+            catch (...) {
+                error = std::current_exception();
+                // Skip the chunks nobody has claimed yet
+                std::size_t unclaimed = m_nextChunk.exchange(m_chunkCount);
+                if (unclaimed < m_chunkCount) {
+                    skippedChunks = m_chunkCount - unclaimed;
+                }
+            }
+            boost::lock_guard<boost::mutex> lock(m_mutex);
+            if (error and not m_error) {
+                m_error = error;
+            }
+            m_finishedChunks += 1 + skippedChunks;
+            if (m_finishedChunks == m_chunkCount) {
+                m_done.notify_all();
+            }
+        }
+    }
+
+};
+
+struct Worker {
+
+    boost::mutex m_mutex;
+
+    std::deque<ThreadPool::Task> m_tasks;
+
+    boost::thread m_thread;
+
+};
+
+}
+
+struct ThreadPool::Implementation {
+
+    // Returns the index of the calling thread's worker or the number
+    // of workers if it isn't one of ours
+    std::size_t
+    currentWorker() const {
+        boost::thread::id threadId = boost::this_thread::get_id();
+        for (std::size_t i = 0; i < m_workers.size(); ++i) {
+            if (m_workers[i]->m_thread.get_id() == threadId) {
+                return i;
+            }
+        }
+        return m_workers.size();
+    }
+
+    bool
+    popTask(
+        std::size_t ownIndex,
+        Task& task
+    ) {
+        std::size_t workerCount = m_workers.size();
+        // Our own newest task first, its data is most likely still cached
+        if (ownIndex < workerCount and this->takeTask(*m_workers[ownIndex], true, task)) {
+            return true;
+        }
+        for (std::size_t i = 1; i <= workerCount; ++i) {
+            std::size_t victim = (ownIndex + i) % workerCount;
+            if (victim != ownIndex and this->takeTask(*m_workers[victim], false, task)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool
+    takeTask(
+        Worker& worker,
+        bool newest,
+        Task& task
+    ) {
+        boost::lock_guard<boost::mutex> lock(worker.m_mutex);
+        if (worker.m_tasks.empty()) {
+            return false;
+        }
+        if (newest) {
+            task = std::move(worker.m_tasks.back());
+            worker.m_tasks.pop_back();
+        }
+        else {
+            task = std::move(worker.m_tasks.front());
+            worker.m_tasks.pop_front();
+        }
+        m_pendingTasks -= 1;
+        return true;
+    }
+
+    void
+    work(
+        std::size_t index
+    ) {
+        Task task;
+        while (true) {
+            if (this->popTask(index, task)) {
+                task();
+                task = nullptr;
+                continue;
+            }
+            boost::unique_lock<boost::mutex> lock(m_sleepMutex);
+            while (m_pendingTasks == 0 and not m_stopping) {
+                m_wakeUp.wait(lock);
+            }
+            if (m_pendingTasks == 0 and m_stopping) {
+                return;
+            }
+        }
+    }
+
+    std::atomic<std::size_t> m_nextQueue{0};
+
+    std::atomic<std::size_t> m_pendingTasks{0};
+
+    boost::mutex m_sleepMutex;
+
+    bool m_stopping = false;
+
+    boost::condition_variable m_wakeUp;
+
+    std::vector<std::unique_ptr<Worker>> m_workers;
+
+};
+
+
+unsigned int
+ThreadPool::defaultWorkerCount() {
+    unsigned int hardwareThreads = boost::thread::hardware_concurrency();
+    return hardwareThreads > 1 ? hardwareThreads - 1 : 0;
+}
+
+
+ThreadPool::ThreadPool()
+  : m_impl(new Implementation())
+{
+}
+
+
+ThreadPool::~ThreadPool() {
+    this->stop();
+}
+
+
+void
+ThreadPool::parallelFor(
+    std::size_t count,
+    std::size_t chunkSize,
+    std::function<void(std::size_t, std::size_t)> function
+) {
+    if (count == 0) {
+        return;
+    }
+    chunkSize = std::max<std::size_t>(chunkSize, 1);
+    std::size_t chunkCount = (count + chunkSize - 1) / chunkSize;
+    if (chunkCount == 1 or m_impl->m_workers.empty()) {
+        for (std::size_t begin = 0; begin < count; begin += chunkSize) {
+            function(begin, std::min(begin + chunkSize, count));
+        }
+        return;
+    }
+    // Helpers may start after we have returned, they will find no
+    // chunks left then
+    auto state = std::make_shared<ParallelFor>();
+    state->m_chunkCount = chunkCount;
+    state->m_chunkSize = chunkSize;
+    state->m_count = count;
+    state->m_function = std::move(function);
+    std::size_t helpers = std::min<std::size_t>(
+        chunkCount - 1,
+        m_impl->m_workers.size()
+    );
+    for (std::size_t i = 0; i < helpers; ++i) {
+        this->submit([state]() {
+            state->work();
+        });
+    }
+    state->work();
+    boost::unique_lock<boost::mutex> lock(state->m_mutex);
+    while (state->m_finishedChunks < chunkCount) {
+        lock.unlock();
+        bool helped = this->runPendingTask();
+        lock.lock();
+        if (not helped and state->m_finishedChunks < chunkCount) {
+            state->m_done.wait(lock);
+        }
+    }
+    if (state->m_error) {
+        std::rethrow_exception(state->m_error);
+    }
+}
+
+
+bool
+ThreadPool::runPendingTask() {
+    if (m_impl->m_pendingTasks == 0) {
+        return false;
+    }
+    Task task;
+    if (m_impl->popTask(m_impl->currentWorker(), task)) {
+        task();
+        return true;
+    }
+    return false;
+}
+
+
+void
+ThreadPool::start(
+    unsigned int workerCount
+) {
+    assert(m_impl->m_workers.empty() && "Thread pool is already running");
+    m_impl->m_stopping = false;
+    // Create all queues before any worker starts stealing from them
+    for (unsigned int i = 0; i < workerCount; ++i) {
+        m_impl->m_workers.emplace_back(new Worker());
+    }
+    for (unsigned int i = 0; i < workerCount; ++i) {
+        m_impl->m_workers[i]->m_thread = boost::thread(
+            &Implementation::work,
+            m_impl.get(),
+            i
+        );
+    }
+}
+
+
+void
+ThreadPool::stop() {
+    {
+        boost::lock_guard<boost::mutex> lock(m_impl->m_sleepMutex);
+        m_impl->m_stopping = true;
+    }
+    m_impl->m_wakeUp.notify_all();
+    for (auto& worker : m_impl->m_workers) {
+        worker->m_thread.join();
+    }
+    m_impl->m_workers.clear();
+}
+
+
+void
+ThreadPool::submit(
+    Task task
+) {
+    std::size_t workerCount = m_impl->m_workers.size();
+    if (workerCount == 0) {
+        task();
+        return;
+    }
+    std::size_t index = m_impl->currentWorker();
+    if (index == workerCount) {
+        index = m_impl->m_nextQueue++ % workerCount;
+    }
+    Worker& worker = *m_impl->m_workers[index];
+    {
+        boost::lock_guard<boost::mutex> lock(worker.m_mutex);
+        worker.m_tasks.push_back(std::move(task));
+        m_impl->m_pendingTasks += 1;
+    }
+    // Take the sleep mutex so that a worker that has just seen no pending
+    // tasks is already waiting when we notify
+    {
+        boost::lock_guard<boost::mutex> lock(m_impl->m_sleepMutex);
+    }
+    m_impl->m_wakeUp.notify_one();
+}
+
+
+unsigned int
+ThreadPool::workerCount() const {
+    return static_cast<unsigned int>(m_impl->m_workers.size());
+}
@@ -0,0 +1,157 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+
+namespace thrive {
+
+/**
+* @brief A pool of worker threads executing tasks
+*
+* Each worker has its own task queue. Tasks submitted by a worker are pushed
+* onto that worker's queue, tasks submitted by other threads are distributed
+* over the workers' queues in turn. A worker takes the newest task from its
+* own queue and, once that is empty, steals the oldest task from the other
+* workers' queues.
+*
+* Threads waiting for submitted tasks to finish can help out by calling
+* runPendingTask(). parallelFor() and TaskGraph::run() do that already.
+*
+* The engine owns one thread pool, see Engine::threadPool().
+*/
+class ThreadPool {
+
+public:
+
+    /**
+    * @brief A unit of work
+    *
+    * Tasks must not throw. If a task can fail, it has to catch the exception
+    * and hand it to whoever is waiting for the task.
+    */
+    using Task = std::function<void()>;
+
+    /**
+    * @brief Suggested number of workers for this machine
+    *
+    * One less than the number of hardware threads, because the thread
+    * submitting the work usually keeps busy as well.
+    */
+    static unsigned int
+    defaultWorkerCount();
+
+    /**
+    * @brief Constructor
+    *
+    * The pool has no workers until start() is called.
+    */
+    ThreadPool();
+
+    /**
+    * @brief Non-copyable
+    */
+    ThreadPool(const ThreadPool&) = delete;
+
+    /**
+    * @brief Destructor
+    *
+    * Calls stop()
+    */
+    ~ThreadPool();
+
+    /**
+    * @brief Non-copyable
+    */
+    ThreadPool&
+    operator=(const ThreadPool&) = delete;
+
+    /**
+    * @brief Processes a range of indices in chunks, spread over the workers
+    *
+    * The range <tt>[0, count)</tt> is split into chunks of \a chunkSize
+    * indices. Idle workers and the calling thread claim one chunk after 
+    * another until all are processed, so uneven chunks balance out. 
+    * Returns once all chunks have been processed.
+    *
+    * May be called from a worker thread, e.g. from a system's update().
+    *
+    * @param count
+    *   The number of indices to process
+    * @param chunkSize
+    *   The number of indices processed by one call of \a function. 
+    *   Treated as \c 1 if zero.
+    * @param function
+    *   Called with the first and one past the last index of a chunk
+    *
+    * @throws
+    *   The first exception thrown by \a function. Chunks that have not
+    *   been started yet are skipped.
+    */
+    void
+    parallelFor(
+        std::size_t count,
+        std::size_t chunkSize,
+        std::function<void(std::size_t, std::size_t)> function
+    );
+
+    /**
+    * @brief Executes one queued task on the calling thread
+    *
+    * @return
+    *   \c true if a task was executed, \c false if no task was queued
+    */
+    bool
+    runPendingTask();
+
+    /**
+    * @brief Starts the worker threads
+    *
+    * @param workerCount
+    *   The number of threads to start. Must not be called while workers
+    *   are already running.
+    */
+    void
+    start(
+        unsigned int workerCount
+    );
+
+    /**
+    * @brief Stops the worker threads
+    *
+    * Tasks that are already queued are executed before the workers
+    * stop. Must not be called from a worker thread.
+    */
+    void
+    stop();
+
+    /**
+    * @brief Queues a task for execution
+    *
+    * This function is thread safe.
+    *
+    * If the pool has no workers, the task is executed immediately on the
+    * calling thread.
+    *
+    * @param task
+    *   The task to execute
+    */
+    void
+    submit(
+        Task task
+    );
+
+    /**
+    * @brief The number of worker threads
+    */
+    unsigned int
+    workerCount() const;
+
+private:
+
+    struct Implementation;
+    std::unique_ptr<Implementation> m_impl;
+
+};
+
+}
@@ -1,9 +1,17 @@
 #include "engine/touchable.h"
 
+#include "engine/dirty_list.h"
 #include "scripting/luabind.h"
 
+#include <atomic>
+
 using namespace thrive;
 
+// Version of the current phase, touches only ever load it
+static std::atomic<std::uint64_t> latestVersion{1};
+
+constexpr std::size_t Touchable::NOT_LISTED;
+
 
 luabind::scope
 Touchable::luaBindings() {
@@ -16,15 +24,92 @@ Touchable::luaBindings() {
 }
 
 
+void
+Touchable::advanceVersion() {
+    latestVersion.fetch_add(1, std::memory_order_relaxed);
+}
+
+
+std::uint64_t
+Touchable::currentVersion() {
+    return phaseVersion() - 1;
+}
+
+
+std::uint64_t
+Touchable::phaseVersion() {
+    return latestVersion.load(std::memory_order_relaxed);
+}
+
+
+Touchable::Touchable()
+  : m_version(phaseVersion())
+{
+}
+
+
+Touchable::Touchable(
+    const Touchable& other
+) : m_hasChanges(other.m_hasChanges),
+    m_version(phaseVersion())
+{
+}
+
+
+Touchable::~Touchable() {
+    if (m_dirtyList) {
+        m_dirtyList->forget(*this);
+    }
+}
+
+
+Touchable&
+Touchable::operator=(
+    const Touchable&
+) {
+    this->touch();
+    return *this;
+}
+
+
 bool
 Touchable::hasChanges() const {
     return m_hasChanges;
 }
 
 
+bool
+Touchable::hasChangesSince(
+    std::uint64_t version
+) const {
+    return m_version > version;
+}
+
+
 void
 Touchable::touch() {
     m_hasChanges = true;
+    m_version = phaseVersion();
+    // Touching a listed touchable again needs neither lock nor allocation
+    if (m_dirtyList and m_dirtyIndex == NOT_LISTED) {
+        m_dirtyList->record(*this);
+    }
+}
+
+
+void
+Touchable::track(
+    DirtyList* dirtyList,
+    Component* component
+) {
+    if (m_dirtyList) {
+        m_dirtyList->forget(*this);
+    }
+    m_dirtyList = dirtyList;
+    m_component = component;
+    if (m_dirtyList) {
+        this->touch();
+    }
 }
 
 
@@ -32,3 +117,9 @@ void
 Touchable::untouch() {
     m_hasChanges = false;
 }
+
+
+std::uint64_t
+Touchable::version() const {
+    return m_version;
+}
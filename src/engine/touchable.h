@@ -1,19 +1,39 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
 namespace luabind {
     class scope;
 }
 
 namespace thrive {
 
+class Component;
+class DirtyList;
+
 /**
 * @brief Helper class for keeping track of changing data
 *
 * Properties of components should be derived from Touchable so that the system
 * that handles the component can quickly check for any changes.
 *
+* Each touch() stamps the Touchable with the version of the current
+* GameState phase, which advanceVersion() bumps once per phase. Touches
+* only read the shared counter, so parallel systems don't contend on it.
+* A system that remembers the currentVersion() from its last update can
+* check for newer changes with hasChangesSince(), and any
+* number of systems can do so independently. Touchables of components can
+* also be tracked by their collection's DirtyList, so that systems only
+* need to visit the touched components.
+*
+* hasChanges() and untouch() are kept for systems that are the only
+* consumer of a Touchable.
+*
 * @note
 *   A Touchable starts out with <tt> Touchable::hasChanges() == true </tt>
+*   and the current phase's version
 */
 class Touchable {
 
@@ -33,27 +53,133 @@ public:
     static luabind::scope
     luaBindings();
 
+    /**
+    * @brief Starts a new version for the following touches
+    *
+    * Called by GameState before each phase. Must not run concurrently
+    * with touches.
+    */
+    static void
+    advanceVersion();
+
+    /**
+    * @brief The newest version that no further touch can get
+    *
+    * Remember this before applying changes and pass it to
+    * hasChangesSince() or DirtyList::changesSince() next time. Touches
+    * from earlier in the current phase are reported again then.
+    */
+    static std::uint64_t
+    currentVersion();
+
+    /**
+    * @brief Constructor
+    */
+    Touchable();
+
+    /**
+    * @brief Copy constructor
+    *
+    * The copy gets the current phase's version, but is not tracked.
+    */
+    Touchable(
+        const Touchable& other
+    );
+
+    /**
+    * @brief Destructor
+    *
+    * Removes the Touchable from its dirty list
+    */
+    ~Touchable();
+
+    /**
+    * @brief Copy assignment
+    *
+    * Counts as a touch. The dirty list is not copied.
+    */
+    Touchable&
+    operator=(
+        const Touchable& other
+    );
+
     /**
     * @brief Whether this Touchable has unapplied changes
     */
     bool
     hasChanges() const;
 
+    /**
+    * @brief Whether this Touchable has been touched after \a version
+    *
+    * @param version
+    *   Usually a currentVersion() remembered earlier
+    */
+    bool
+    hasChangesSince(
+        std::uint64_t version
+    ) const;
+
     /**
     * @brief Marks the Touchable as changed
+    *
+    * Stamps it with the current phase's version. If it is tracked and not
+    * in its dirty list yet, it is appended to the list.
     */
     void
     touch();
 
+    /**
+    * @brief Starts or stops recording touches in a dirty list
+    *
+    * Usually called from Component::trackChanges(). Starting to track
+    * counts as a touch, so that new components show up as changed.
+    *
+    * @param dirtyList
+    *   The list to record touches in. If \c nullptr, stops tracking.
+    * @param component
+    *   The component this Touchable belongs to
+    */
+    void
+    track(
+        DirtyList* dirtyList,
+        Component* component
+    );
+
     /**
     * @brief Marks all changes as applied
+    *
+    * Only affects hasChanges(), not the version.
     */
     void
     untouch();
 
+    /**
+    * @brief The version stamped by the last touch
+    */
+    std::uint64_t
+    version() const;
+
 private:
 
+    friend class DirtyList;
+
+    static constexpr std::size_t NOT_LISTED =
+        std::numeric_limits<std::size_t>::max();
+
+    static std::uint64_t
+    phaseVersion();
+
+    Component* m_component = nullptr;
+
+    // Position in m_dirtyList's entries
+    std::size_t m_dirtyIndex = NOT_LISTED;
+
+    DirtyList* m_dirtyList = nullptr;
+
     bool m_hasChanges = true;
+
+    std::uint64_t m_version;
 };
 
 /**
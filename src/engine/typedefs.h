@@ -1,5 +1,7 @@
 #pragma once
 
+#include <bitset>
+#include <cstddef>
 #include <cstdint>
 #include <utility>
 
@@ -18,6 +20,70 @@ namespace thrive {
     */
     static const EntityId NULL_ENTITY = 0;
 
+    /**
+    * @brief Number of low bits in an EntityId that hold the entity's index
+    *
+    * The remaining high bits hold the index' generation, which is 
+    * increased each time a destroyed entity's index is recycled. 
+    */
+    static const unsigned int ENTITY_INDEX_BITS = 20;
+
+    /**
+    * @brief Mask for the index part of an EntityId
+    */
+    static const EntityId ENTITY_INDEX_MASK = (EntityId(1) << ENTITY_INDEX_BITS) - 1;
+
+    /**
+    * @brief Mask for the generation part of an EntityId, after shifting
+    */
+    static const EntityId ENTITY_GENERATION_MASK = ~EntityId(0) >> ENTITY_INDEX_BITS;
+
+    /**
+    * @brief Extracts the index from an entity id
+    *
+    * Indices are small and dense, so they can be used to address arrays.
+    */
+    inline EntityId
+    entityIndex(
+        EntityId id
+    ) {
+        return id & ENTITY_INDEX_MASK;
+    }
+
+    /**
+    * @brief Extracts the generation from an entity id
+    */
+    inline EntityId
+    entityGeneration(
+        EntityId id
+    ) {
+        return id >> ENTITY_INDEX_BITS;
+    }
+
+    /**
+    * @brief Packs an index and a generation into an entity id
+    */
+    inline EntityId
+    makeEntityId(
+        EntityId index,
+        EntityId generation
+    ) {
+        return ((generation & ENTITY_GENERATION_MASK) << ENTITY_INDEX_BITS) | (index & ENTITY_INDEX_MASK);
+    }
+
     static const ComponentTypeId NULL_COMPONENT_TYPE = 0;
 
+    /**
+    * @brief Maximum number of component types per EntityManager
+    */
+    static const std::size_t MAX_COMPONENT_TYPES = 128;
+
+    /**
+    * @brief Bitmask of the component types an entity has
+    *
+    * Each EntityManager assigns the bit positions to its component 
+    * collections, see ComponentCollection::signatureBit().
+    */
+    using ComponentSignature = std::bitset<MAX_COMPONENT_TYPES>;
+
 }
@@ -6,6 +6,7 @@
 #include "util/make_unique.h"
 
 #include <boost/thread.hpp>
+#include <cmath>
 #include <type_traits>
 #include <unordered_map>
 
@@ -23,6 +24,8 @@ struct Game::Implementation {
 
     Engine m_engine;
 
+    unsigned int m_frameLimit = 0;
+
     boost::chrono::microseconds m_targetFrameDuration;
 
     unsigned short m_targetFrameRate = 60;
@@ -66,20 +69,38 @@ Game::run() {
         unsigned int fpsCount = 0;
         int fpsTime = 0;
         auto lastUpdate = Implementation::Clock::now();
+        // Simulate at the target frame rate, independent of the actual one.
+        // Scripts may change this during initialization. The step is
+        // rounded, truncating it would simulate noticeably too fast.
+        m_impl->m_engine.setSimulationTimestep(
+            static_cast<int>(std::lround(1000.0 / m_impl->m_targetFrameRate))
+        );
         m_impl->m_engine.init();
+        bool headless = m_impl->m_engine.headless();
+        unsigned int frames = 0;
         // Start game loop
         m_impl->m_quit = false;
         while (not m_impl->m_quit) {
             auto now = Implementation::Clock::now();
             auto delta = now - lastUpdate;
             int milliSeconds = boost::chrono::duration_cast<boost::chrono::milliseconds>(delta).count();
-            lastUpdate = now;
+            // Leave the fraction of a millisecond to the next frame, so
+            // that the simulation keeps up with the clock
+            lastUpdate += boost::chrono::milliseconds(milliSeconds);
+            if (headless and m_impl->m_engine.simulationTimestep() > 0) {
+                // Run uncapped, one simulation step per frame
+                milliSeconds = m_impl->m_engine.simulationTimestep();
+            }
             m_impl->m_engine.update(milliSeconds);
             auto frameDuration = Implementation::Clock::now() - now;
             auto sleepDuration = m_impl->m_targetFrameDuration - frameDuration;
-            if (sleepDuration.count() > 0) {
+            if (not headless and sleepDuration.count() > 0) {
                 boost::this_thread::sleep_for(sleepDuration);
             }
+            frames += 1;
+            if (m_impl->m_frameLimit > 0 and frames >= m_impl->m_frameLimit) {
+                this->quit();
+            }
             fpsCount += 1;
             fpsTime += boost::chrono::duration_cast<boost::chrono::milliseconds>(frameDuration).count();
             if (fpsTime >= 1000) {
@@ -97,6 +118,14 @@ Game::run() {
 }
 
 
+void
+Game::setFrameLimit(
+    unsigned int frames
+) {
+    m_impl->m_frameLimit = frames;
+}
+
+
 boost::chrono::microseconds
 Game::targetFrameDuration() const {
     return m_impl->m_targetFrameDuration;
@@ -44,10 +44,27 @@ public:
 
     /**
     * @brief Starts all engines
+    *
+    * If the engine is headless (see Engine::setHeadless()), frames are 
+    * not capped to the target frame rate. Instead, each frame advances
+    * the game by one simulation step, as fast as possible.
     */
     void
     run();
 
+    /**
+    * @brief Quits after a number of frames
+    *
+    * Useful for timing runs of a headless engine.
+    *
+    * @param frames
+    *   The number of frames to run, 0 for no limit. Defaults to 0.
+    */
+    void
+    setFrameLimit(
+        unsigned int frames
+    );
+
     /**
     * @brief The target frame duration
     */
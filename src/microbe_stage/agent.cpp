@@ -5,10 +5,13 @@
 #include "bullet/rigid_body_system.h"
 #include "engine/component_factory.h"
 #include "engine/engine.h"
+#include "engine/entity_command_buffer.h"
 #include "engine/entity_filter.h"
 #include "engine/game_state.h"
+#include "engine/prefab.h"
 #include "engine/serialization.h"
 #include "engine/rng.h"
+#include "engine/thread_pool.h"
 #include "game.h"
 #include "ogre/scene_node_system.h"
 #include "scripting/luabind.h"
@@ -18,6 +21,9 @@
 
 using namespace thrive;
 
+// Number of agents moved by one task of a parallel update
+static const std::size_t AGENTS_PER_TASK = 256;
+
 REGISTER_COMPONENT(AgentComponent)
 
 
@@ -52,6 +58,44 @@ AgentComponent::load(
 }
 
 
+bool
+AgentComponent::read(
+    StorageReader& reader
+) {
+    // Missing entries get the same defaults as in load()
+    m_agentId = NULL_AGENT;
+    m_potency = 0.0f;
+    m_timeToLive = 0;
+    m_velocity = Ogre::Vector3::ZERO;
+    while (reader.next()) {
+        const std::string& key = reader.key();
+        if (key == "agentId") {
+            m_agentId = reader.get<AgentId>();
+        }
+        else if (key == "potency") {
+            m_potency = reader.get<float>();
+        }
+        else if (key == "timeToLive") {
+            m_timeToLive = reader.get<Milliseconds>();
+        }
+        else if (key == "velocity") {
+            m_velocity = reader.get<Ogre::Vector3>();
+        }
+    }
+    return true;
+}
+
+
+bool
+AgentComponent::reload(
+    const StorageContainer& storage
+) {
+    // Plain data, loading it again replaces all of it
+    this->load(storage);
+    return true;
+}
+
+
 StorageContainer
 AgentComponent::storage() const {
     StorageContainer storage = Component::storage();
@@ -62,6 +106,18 @@ AgentComponent::storage() const {
     return storage;
 }
 
+
+void
+AgentComponent::write(
+    StorageWriter& writer
+) const {
+    writer.set<EntityId>("owner", this->owner());
+    writer.set<AgentId>("agentId", m_agentId);
+    writer.set<float>("potency", m_potency);
+    writer.set<Milliseconds>("timeToLive", m_timeToLive);
+    writer.set<Ogre::Vector3>("velocity", m_velocity);
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // AgentEmitterComponent
 ////////////////////////////////////////////////////////////////////////////////
@@ -298,6 +354,7 @@ struct AgentLifetimeSystem::Implementation {
 AgentLifetimeSystem::AgentLifetimeSystem()
   : m_impl(new Implementation())
 {
+    this->writesComponent(AgentComponent::TYPE_ID);
 }
 
 
@@ -322,13 +379,18 @@ AgentLifetimeSystem::shutdown() {
 
 void
 AgentLifetimeSystem::update(int milliseconds) {
-    for (auto& value : m_impl->m_entities) {
-        AgentComponent* agentComponent = std::get<0>(value.second);
-        agentComponent->m_timeToLive -= milliseconds;
-        if (agentComponent->m_timeToLive <= 0) {
-            this->entityManager()->removeEntity(value.first);
+    m_impl->m_entities.parallelForEach(
+        this->engine()->threadPool(),
+        AGENTS_PER_TASK,
+        this->commandBuffer(),
+        [milliseconds](EntityId entityId, const std::tuple<AgentComponent*>& components, EntityCommandBuffer& commandBuffer) {
+            AgentComponent* agentComponent = std::get<0>(components);
+            agentComponent->m_timeToLive -= milliseconds;
+            if (agentComponent->m_timeToLive <= 0) {
+                commandBuffer.removeEntity(entityId);
+            }
         }
-    }
+    );
 }
 
 
@@ -357,6 +419,8 @@ struct AgentMovementSystem::Implementation {
 AgentMovementSystem::AgentMovementSystem()
   : m_impl(new Implementation())
 {
+    this->readsComponent(AgentComponent::TYPE_ID);
+    this->writesComponent(RigidBodyComponent::TYPE_ID);
 }
 
 
@@ -381,12 +445,17 @@ AgentMovementSystem::shutdown() {
 
 void
 AgentMovementSystem::update(int milliseconds) {
-    for (auto& value : m_impl->m_entities) {
-        AgentComponent* agentComponent = std::get<0>(value.second);
-        RigidBodyComponent* rigidBodyComponent = std::get<1>(value.second);
-        Ogre::Vector3 delta = agentComponent->m_velocity * float(milliseconds) / 1000.0f;
-        rigidBodyComponent->m_dynamicProperties.position += delta;
-    }
+    float seconds = float(milliseconds) / 1000.0f;
+    m_impl->m_entities.parallelForEach(
+        this->engine()->threadPool(),
+        AGENTS_PER_TASK,
+        [seconds](EntityId, const std::tuple<AgentComponent*, RigidBodyComponent*>& components) {
+            AgentComponent* agentComponent = std::get<0>(components);
+            RigidBodyComponent* rigidBodyComponent = std::get<1>(components);
+            Ogre::Vector3 delta = agentComponent->m_velocity * seconds;
+            rigidBodyComponent->m_dynamicProperties.position += delta;
+        }
+    );
 }
 
 
@@ -405,12 +474,52 @@ AgentEmitterSystem::luaBindings() {
 
 struct AgentEmitterSystem::Implementation {
 
+    // Builds the template for particles of one agent type on first use
+    const Prefab&
+    agentPrefab(
+        AgentId agentId
+    ) {
+        auto iter = m_prefabs.find(agentId);
+        if (iter != m_prefabs.end()) {
+            return iter->second;
+        }
+        // Scene Node
+        auto agentSceneNodeComponent = make_unique<OgreSceneNodeComponent>();
+        auto meshScale = AgentRegistry::getAgentMeshScale(agentId);
+        agentSceneNodeComponent->m_transform.scale = Ogre::Vector3(meshScale,meshScale,meshScale);
+        agentSceneNodeComponent->m_meshName = AgentRegistry::getAgentMeshName(agentId);
+        // Collision Hull, the shape is shared by all particles
+        auto agentRigidBodyComponent = make_unique<RigidBodyComponent>(
+            btBroadphaseProxy::SensorTrigger,
+            btBroadphaseProxy::AllFilter & (~ btBroadphaseProxy::SensorTrigger)
+        );
+        agentRigidBodyComponent->m_properties.shape = std::make_shared<SphereShape>(0.01);
+        agentRigidBodyComponent->m_properties.hasContactResponse = false;
+        agentRigidBodyComponent->m_properties.kinematic = true;
+        // Agent Component
+        auto agentComponent = make_unique<AgentComponent>();
+        agentComponent->m_agentId = agentId;
+        auto collisionHandler = make_unique<CollisionComponent>();
+        collisionHandler->addCollisionGroup("agent");
+        // Build prefab
+        Prefab prefab;
+        prefab.addComponent(std::move(agentSceneNodeComponent));
+        prefab.addComponent(std::move(agentComponent));
+        prefab.addComponent(std::move(agentRigidBodyComponent));
+        prefab.addComponent(std::move(collisionHandler));
+        return m_prefabs.emplace(agentId, std::move(prefab)).first->second;
+    }
+
     EntityFilter<
         AgentEmitterComponent,
         OgreSceneNodeComponent,
         Optional<TimedAgentEmitterComponent>
     > m_entities;
 
+    // Cleared on init, so that agent types registered since then are
+    // picked up
+    std::unordered_map<AgentId, Prefab> m_prefabs;
+
     Ogre::SceneManager* m_sceneManager = nullptr;
 };
 
@@ -418,6 +527,15 @@ struct AgentEmitterSystem::Implementation {
 AgentEmitterSystem::AgentEmitterSystem()
   : m_impl(new Implementation())
 {
+    this->writesComponent(AgentEmitterComponent::TYPE_ID);
+    this->writesComponent(TimedAgentEmitterComponent::TYPE_ID);
+    // Components of the emitted particles
+    this->writesComponent(AgentComponent::TYPE_ID);
+    this->writesComponent(CollisionComponent::TYPE_ID);
+    this->writesComponent(OgreSceneNodeComponent::TYPE_ID);
+    this->writesComponent(RigidBodyComponent::TYPE_ID);
+    // Emission uses the engine's random number generator
+    this->setMainThreadOnly(true);
 }
 
 
@@ -430,6 +548,7 @@ AgentEmitterSystem::init(
 ) {
     System::init(gameState);
     m_impl->m_entities.setEntityManager(&gameState->entityManager());
+    m_impl->m_prefabs.clear();
     m_impl->m_sceneManager = gameState->sceneManager();
 }
 
@@ -437,74 +556,50 @@ AgentEmitterSystem::init(
 void
 AgentEmitterSystem::shutdown() {
     m_impl->m_entities.setEntityManager(nullptr);
+    m_impl->m_prefabs.clear();
     m_impl->m_sceneManager = nullptr;
     System::shutdown();
 }
 
 // Helper function for AgentEmitterSystem to emit agents
 static void
-emitAgent(
-    AgentId agentId,
+emitAgents(
+    const Prefab& prefab,
     double amount,
+    unsigned int count,
     Ogre::Vector3 emittorPosition,
     AgentEmitterComponent* emitterComponent
 ) {
-
-    Ogre::Vector3 emissionOffset(0,0,0);
-
-    Ogre::Degree emissionAngle{static_cast<Ogre::Real>(Game::instance().engine().rng().getDouble(
-        emitterComponent->m_minEmissionAngle.valueDegrees(),
-        emitterComponent->m_maxEmissionAngle.valueDegrees()
-    ))};
-    Ogre::Real emissionSpeed = Game::instance().engine().rng().getDouble(
-        emitterComponent->m_minInitialSpeed,
-        emitterComponent->m_maxInitialSpeed
-    );
-    Ogre::Vector3 emissionVelocity(
-        emissionSpeed * Ogre::Math::Sin(emissionAngle),
-        emissionSpeed * Ogre::Math::Cos(emissionAngle),
-        0.0
-    );
-    emissionOffset = Ogre::Vector3(
-        emitterComponent->m_emissionRadius * Ogre::Math::Sin(emissionAngle),
-        emitterComponent->m_emissionRadius * Ogre::Math::Cos(emissionAngle),
-        0.0
-    );
-    EntityId agentEntityId = Game::instance().engine().currentGameState()->entityManager().generateNewId();
-    // Scene Node
-    auto agentSceneNodeComponent = make_unique<OgreSceneNodeComponent>();
-    auto meshScale = AgentRegistry::getAgentMeshScale(agentId);
-    agentSceneNodeComponent->m_transform.scale = Ogre::Vector3(meshScale,meshScale,meshScale);
-    agentSceneNodeComponent->m_meshName = AgentRegistry::getAgentMeshName(agentId);
-    // Collision Hull
-    auto agentRigidBodyComponent = make_unique<RigidBodyComponent>(
-        btBroadphaseProxy::SensorTrigger,
-        btBroadphaseProxy::AllFilter & (~ btBroadphaseProxy::SensorTrigger)
-    );
-    agentRigidBodyComponent->m_properties.shape = std::make_shared<SphereShape>(0.01);
-    agentRigidBodyComponent->m_properties.hasContactResponse = false;
-    agentRigidBodyComponent->m_properties.kinematic = true;
-    agentRigidBodyComponent->m_dynamicProperties.position = emittorPosition + emissionOffset;
-    // Agent Component
-    auto agentComponent = make_unique<AgentComponent>();
-    agentComponent->m_timeToLive = emitterComponent->m_particleLifetime;
-    agentComponent->m_velocity = emissionVelocity;
-    agentComponent->m_agentId = agentId;
-    agentComponent->m_potency = amount;
-    auto collisionHandler = make_unique<CollisionComponent>();
-    collisionHandler->addCollisionGroup("agent");
-    // Build component list
-    std::list<std::unique_ptr<Component>> components;
-    components.emplace_back(std::move(agentSceneNodeComponent));
-    components.emplace_back(std::move(agentComponent));
-    components.emplace_back(std::move(agentRigidBodyComponent));
-    components.emplace_back(std::move(collisionHandler));
-    for (auto& component : components) {
-        Game::instance().engine().currentGameState()->entityManager().addComponent(
-            agentEntityId,
-            std::move(component)
+    EntityManager& entityManager = Game::instance().engine().currentGameState()->entityManager();
+    // All particles are added at once, filters are notified in one batch
+    entityManager.instantiate(prefab, count, [&](EntityId agentEntityId) {
+        Ogre::Vector3 emissionOffset(0,0,0);
+
+        Ogre::Degree emissionAngle{static_cast<Ogre::Real>(Game::instance().engine().rng().getDouble(
+            emitterComponent->m_minEmissionAngle.valueDegrees(),
+            emitterComponent->m_maxEmissionAngle.valueDegrees()
+        ))};
+        Ogre::Real emissionSpeed = Game::instance().engine().rng().getDouble(
+            emitterComponent->m_minInitialSpeed,
+            emitterComponent->m_maxInitialSpeed
         );
-    }
+        Ogre::Vector3 emissionVelocity(
+            emissionSpeed * Ogre::Math::Sin(emissionAngle),
+            emissionSpeed * Ogre::Math::Cos(emissionAngle),
+            0.0
+        );
+        emissionOffset = Ogre::Vector3(
+            emitterComponent->m_emissionRadius * Ogre::Math::Sin(emissionAngle),
+            emitterComponent->m_emissionRadius * Ogre::Math::Cos(emissionAngle),
+            0.0
+        );
+        auto agentRigidBodyComponent = entityManager.getComponent<RigidBodyComponent>(agentEntityId);
+        agentRigidBodyComponent->m_dynamicProperties.position = emittorPosition + emissionOffset;
+        auto agentComponent = entityManager.getComponent<AgentComponent>(agentEntityId);
+        agentComponent->m_timeToLive = emitterComponent->m_particleLifetime;
+        agentComponent->m_velocity = emissionVelocity;
+        agentComponent->m_potency = amount;
+    });
 }
 
 
@@ -518,7 +613,7 @@ AgentEmitterSystem::update(int milliseconds) {
 
         for (auto emission : emitterComponent->m_compoundEmissions)
         {
-            emitAgent(std::get<0>(emission), std::get<1>(emission), sceneNodeComponent->m_transform.position, emitterComponent);
+            emitAgents(m_impl->agentPrefab(std::get<0>(emission)), std::get<1>(emission), 1, sceneNodeComponent->m_transform.position, emitterComponent);
         }
         emitterComponent->m_compoundEmissions.clear();
         if (timedEmitterComponent)
@@ -529,9 +624,7 @@ AgentEmitterSystem::update(int milliseconds) {
                 timedEmitterComponent->m_timeSinceLastEmission >= timedEmitterComponent->m_emitInterval
             ) {
                 timedEmitterComponent->m_timeSinceLastEmission -= timedEmitterComponent->m_emitInterval;
-                for (unsigned int i = 0; i < timedEmitterComponent->m_particlesPerEmission; ++i) {
-                     emitAgent(timedEmitterComponent->m_agentId, timedEmitterComponent->m_potencyPerParticle, sceneNodeComponent->m_transform.position, emitterComponent);
-                }
+                emitAgents(m_impl->agentPrefab(timedEmitterComponent->m_agentId), timedEmitterComponent->m_potencyPerParticle, timedEmitterComponent->m_particlesPerEmission, sceneNodeComponent->m_transform.position, emitterComponent);
             }
         }
     }
@@ -73,9 +73,24 @@ public:
         const StorageContainer& storage
     ) override;
 
+    bool
+    read(
+        StorageReader& reader
+    ) override;
+
+    bool
+    reload(
+        const StorageContainer& storage
+    ) override;
+
     StorageContainer
     storage() const override;
 
+    void
+    write(
+        StorageWriter& writer
+    ) const override;
+
 };
 
 
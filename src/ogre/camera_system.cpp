@@ -134,6 +134,7 @@ struct OgreCameraSystem::Implementation {
 OgreCameraSystem::OgreCameraSystem()
   : m_impl(new Implementation())
 {
+    this->setPresentation(true);
 }
 
 
@@ -204,6 +204,10 @@ Keyboard::shutdown() {
 void
 Keyboard::update() {
     m_impl->m_queue.clear();
+    if (not m_impl->m_keyboard) {
+        // Not initialized (headless), no key is ever pressed
+        return;
+    }
     m_impl->m_keyboard->capture();
     std::swap(m_impl->m_currentKeyStates, m_impl->m_previousKeyStates);
     m_impl->m_keyboard->copyKeyStates(m_impl->m_currentKeyStates->data());
@@ -93,6 +93,8 @@ public:
     /**
     * @brief Initializes the keyboard
     *
+    * An uninitialized keyboard reports no keys pressed.
+    *
     * @param inputManager
     *   The input manager to use
     */
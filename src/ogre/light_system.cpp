@@ -1,8 +1,10 @@
 #include "ogre/light_system.h"
 
 #include "engine/component_factory.h"
+#include "engine/dirty_list.h"
 #include "engine/game_state.h"
 #include "engine/entity_filter.h"
+#include "engine/entity_manager.h"
 #include "engine/serialization.h"
 #include "ogre/scene_node_system.h"
 #include "scripting/luabind.h"
@@ -101,6 +103,14 @@ OgreLightComponent::storage() const {
     return storage;
 }
 
+
+void
+OgreLightComponent::trackChanges(
+    DirtyList* dirtyList
+) {
+    m_properties.track(dirtyList, this);
+}
+
 REGISTER_COMPONENT(OgreLightComponent)
 
 
@@ -119,6 +129,32 @@ OgreLightSystem::luaBindings() {
 
 struct OgreLightSystem::Implementation {
 
+    void
+    applyProperties(
+        OgreLightComponent* lightComponent
+    ) {
+        auto& properties = lightComponent->m_properties;
+        Ogre::Light* light = lightComponent->m_light;
+        light->setType(properties.type);
+        light->setDiffuseColour(properties.diffuseColour);
+        light->setSpecularColour(properties.specularColour);
+        light->setAttenuation(
+            properties.attenuationRange,
+            properties.attenuationConstant,
+            properties.attenuationLinear,
+            properties.attenuationQuadratic
+        );
+        light->setSpotlightRange(
+            properties.spotlightInnerAngle,
+            properties.spotlightOuterAngle,
+            properties.spotlightFalloff
+        );
+        light->setSpotlightNearClipDistance(properties.spotlightNearClipDistance);
+        properties.untouch();
+    }
+
+    DirtyList* m_dirtyList = nullptr;
+
     EntityFilter<
         OgreLightComponent,
         OgreSceneNodeComponent
@@ -128,12 +164,16 @@ struct OgreLightSystem::Implementation {
 
     Ogre::SceneManager* m_sceneManager = nullptr;
 
+    // Touchable::currentVersion() at the start of the last update
+    std::uint64_t m_syncedVersion = 0;
+
 };
 
 
 OgreLightSystem::OgreLightSystem()
   : m_impl(new Implementation())
 {
+    this->setPresentation(true);
 }
 
 
@@ -148,12 +188,16 @@ OgreLightSystem::init(
     assert(m_impl->m_sceneManager == nullptr && "Double init of system");
     m_impl->m_sceneManager = gameState->sceneManager();
     m_impl->m_entities.setEntityManager(&gameState->entityManager());
+    m_impl->m_dirtyList = &gameState->entityManager().getComponentCollection(
+        OgreLightComponent::TYPE_ID
+    ).dirtyList();
 }
 
 
 void
 OgreLightSystem::shutdown() {
     m_impl->m_entities.setEntityManager(nullptr);
+    m_impl->m_dirtyList = nullptr;
     m_impl->m_sceneManager = nullptr;
     System::shutdown();
 }
@@ -161,6 +205,8 @@ OgreLightSystem::shutdown() {
 
 void
 OgreLightSystem::update(int) {
+    // Touches after this point are picked up by the next update
+    std::uint64_t version = Touchable::currentVersion();
     for (EntityId entityId : m_impl->m_entities.removedEntities()) {
         Ogre::Light* light = m_impl->m_lights[entityId];
         if (light) {
@@ -176,32 +222,21 @@ OgreLightSystem::update(int) {
         lightComponent->m_light = light;
         m_impl->m_lights[entityId] = light;
         sceneNodeComponent->m_sceneNode->attachObject(light);
+        m_impl->applyProperties(lightComponent);
     }
     m_impl->m_entities.clearChanges();
-    for (const auto& value : m_impl->m_entities) {
-        OgreLightComponent* lightComponent = std::get<0>(value.second);
-        auto& properties = lightComponent->m_properties;
-        if (not properties.hasChanges()) {
+    const auto& entities = m_impl->m_entities.entities();
+    for (Component* component : m_impl->m_dirtyList->changesSince(m_impl->m_syncedVersion)) {
+        // Skip lights that are not (or no longer) part of the scene
+        auto iter = entities.find(component->owner());
+        if (iter == entities.end() or std::get<0>(iter->second) != component) {
             continue;
         }
-        Ogre::Light* light = lightComponent->m_light;
-        light->setType(properties.type);
-        light->setDiffuseColour(properties.diffuseColour);
-        light->setSpecularColour(properties.specularColour);
-        light->setAttenuation(
-            properties.attenuationRange,
-            properties.attenuationConstant,
-            properties.attenuationLinear,
-            properties.attenuationQuadratic
-        );
-        light->setSpotlightRange(
-            properties.spotlightInnerAngle,
-            properties.spotlightOuterAngle,
-            properties.spotlightFalloff
-        );
-        light->setSpotlightNearClipDistance(properties.spotlightNearClipDistance);
-        properties.untouch();
+        m_impl->applyProperties(std::get<0>(iter->second));
     }
+    // This system is the list's only consumer
+    m_impl->m_dirtyList->prune(version);
+    m_impl->m_syncedVersion = version;
 }
 
 
@@ -144,6 +144,14 @@ public:
     StorageContainer
     storage() const override;
 
+    /**
+    * @brief Tracks the light's properties
+    */
+    void
+    trackChanges(
+        DirtyList* dirtyList
+    ) override;
+
     /**
     * @brief Internal light, don't use this directly
     */
@@ -160,6 +168,9 @@ public:
 
 /**
 * @brief Creates lights and updates their properties
+*
+* Only lights whose properties have been touched since the last update are
+* visited (see DirtyList).
 */
 class OgreLightSystem : public System {
     
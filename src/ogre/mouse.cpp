@@ -72,12 +72,18 @@ bool
 Mouse::isButtonDown(
     OIS::MouseButtonID button
 ) const {
+    if (not m_impl->m_mouse) {
+        return false;
+    }
     return m_impl->m_mouse->getMouseState().buttonDown(button);
 }
 
 
 Ogre::Vector3
 Mouse::normalizedPosition() const {
+    if (not m_impl->m_mouse) {
+        return Ogre::Vector3(0.5, 0.5, 0);
+    }
     const OIS::MouseState& mouseState = m_impl->m_mouse->getMouseState();
     return Ogre::Vector3(
         double(mouseState.X.abs) / mouseState.width,
@@ -89,6 +95,13 @@ Mouse::normalizedPosition() const {
 
 Ogre::Vector3
 Mouse::position() const {
+    if (not m_impl->m_mouse) {
+        return Ogre::Vector3(
+            m_impl->m_windowWidth / 2,
+            m_impl->m_windowHeight / 2,
+            0
+        );
+    }
     return Ogre::Vector3(
         m_impl->m_mouse->getMouseState().X.abs,
         m_impl->m_mouse->getMouseState().Y.abs,
@@ -121,6 +134,9 @@ Mouse::shutdown() {
 
 void
 Mouse::update() {
+    if (not m_impl->m_mouse) {
+        return;
+    }
     m_impl->m_mouse->capture();
 }
 
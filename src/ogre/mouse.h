@@ -51,6 +51,9 @@ public:
     /**
     * @brief Initializes the mouse
     *
+    * An uninitialized mouse reports no buttons pressed and stays in the
+    * window's center.
+    *
     * @param inputManager
     *   The input manager to use
     */
@@ -27,6 +27,8 @@ struct RenderSystem::Implementation {
 RenderSystem::RenderSystem()
   : m_impl(new Implementation())
 {
+    this->setPresentation(true);
+    this->setRunsHeadless(false);
 }
 
 
@@ -1,6 +1,7 @@
 #include "ogre/scene_node_system.h"
 
 #include "engine/component_factory.h"
+#include "engine/engine.h"
 #include "engine/entity.h"
 #include "engine/entity_filter.h"
 #include "engine/entity_manager.h"
@@ -88,8 +89,70 @@ OgreSceneNodeComponent::load(
     m_transform.orientation = storage.get<Ogre::Quaternion>("orientation", Ogre::Quaternion::IDENTITY);
     m_transform.position = storage.get<Ogre::Vector3>("position", Ogre::Vector3(0,0,0));
     m_transform.scale = storage.get<Ogre::Vector3>("scale", Ogre::Vector3(1,1,1));
-    m_meshName = storage.get<Ogre::String>("meshName");
-    m_parentId = storage.get<EntityId>("parentId", NULL_ENTITY);
+    // Only touched when changed, so that a reload keeps the mesh and parent
+    Ogre::String meshName = storage.get<Ogre::String>("meshName");
+    if (meshName != m_meshName.get()) {
+        m_meshName = meshName;
+    }
+    EntityId parentId = storage.get<EntityId>("parentId", NULL_ENTITY);
+    if (parentId != m_parentId.get()) {
+        m_parentId = parentId;
+    }
+}
+
+
+bool
+OgreSceneNodeComponent::read(
+    StorageReader& reader
+) {
+    // Missing entries get the same defaults as in load()
+    Ogre::Quaternion orientation = Ogre::Quaternion::IDENTITY;
+    Ogre::Vector3 position(0,0,0);
+    Ogre::Vector3 scale(1,1,1);
+    Ogre::String meshName;
+    EntityId parentId = NULL_ENTITY;
+    while (reader.next()) {
+        const std::string& key = reader.key();
+        if (key == "orientation") {
+            orientation = reader.get<Ogre::Quaternion>();
+        }
+        else if (key == "position") {
+            position = reader.get<Ogre::Vector3>();
+        }
+        else if (key == "scale") {
+            scale = reader.get<Ogre::Vector3>();
+        }
+        else if (key == "meshName") {
+            meshName = reader.get<Ogre::String>();
+        }
+        else if (key == "parentId") {
+            parentId = reader.get<EntityId>();
+        }
+    }
+    m_transform.orientation = orientation;
+    m_transform.position = position;
+    m_transform.scale = scale;
+    m_transform.touch();
+    if (meshName != m_meshName.get()) {
+        m_meshName = meshName;
+    }
+    if (parentId != m_parentId.get()) {
+        m_parentId = parentId;
+    }
+    m_interpolation = Interpolation();
+    return true;
+}
+
+
+bool
+OgreSceneNodeComponent::reload(
+    const StorageContainer& storage
+) {
+    this->load(storage);
+    m_transform.touch();
+    // Jump to the restored transform instead of interpolating towards it
+    m_interpolation = Interpolation();
+    return true;
 }
 
 
@@ -104,6 +167,19 @@ OgreSceneNodeComponent::storage() const {
     return storage;
 }
 
+
+void
+OgreSceneNodeComponent::write(
+    StorageWriter& writer
+) const {
+    writer.set<EntityId>("owner", this->owner());
+    writer.set<Ogre::Quaternion>("orientation", m_transform.orientation);
+    writer.set<Ogre::Vector3>("position", m_transform.position);
+    writer.set<Ogre::Vector3>("scale", m_transform.scale);
+    writer.set<Ogre::String>("meshName", m_meshName);
+    writer.set<EntityId>("parentId", m_parentId);
+}
+
 void
 OgreSceneNodeComponent::playAnimation(
     std::string name,
@@ -160,6 +236,7 @@ struct OgreAddSceneNodeSystem::Implementation {
 OgreAddSceneNodeSystem::OgreAddSceneNodeSystem()
   : m_impl(new Implementation())
 {
+    this->setPresentation(true);
 }
 
 
@@ -243,6 +320,7 @@ struct OgreRemoveSceneNodeSystem::Implementation {
 OgreRemoveSceneNodeSystem::OgreRemoveSceneNodeSystem()
   : m_impl(new Implementation())
 {
+    this->setPresentation(true);
 }
 
 
@@ -324,6 +402,7 @@ struct OgreUpdateSceneNodeSystem::Implementation {
 OgreUpdateSceneNodeSystem::OgreUpdateSceneNodeSystem()
   : m_impl(new Implementation())
 {
+    this->setPresentation(true);
 }
 
 
@@ -350,21 +429,70 @@ OgreUpdateSceneNodeSystem::shutdown() {
 
 void
 OgreUpdateSceneNodeSystem::update(int milliseconds) {
+    unsigned long long step = this->gameState()->simulationStepCount();
+    float alpha = this->gameState()->interpolationFactor();
     for (const auto& entry : m_impl->m_entities) {
         OgreSceneNodeComponent* component = std::get<0>(entry.second);
         Ogre::SceneNode* sceneNode = component->m_sceneNode;
         auto& transform = component->m_transform;
-        if (transform.hasChanges()) {
-            sceneNode->setOrientation(
-                transform.orientation
-            );
-            sceneNode->setPosition(
-                transform.position
-            );
+        auto& interpolation = component->m_interpolation;
+        if (not interpolation.initialized or interpolation.step != step) {
+            // The simulation has advanced, pick up its latest transform
+            bool changed = not interpolation.initialized or transform.hasChanges();
+            if (not interpolation.initialized) {
+                interpolation.latestOrientation = transform.orientation;
+                interpolation.latestPosition = transform.position;
+            }
+            interpolation.previousOrientation = interpolation.latestOrientation;
+            interpolation.previousPosition = interpolation.latestPosition;
+            if (changed) {
+                interpolation.latestOrientation = transform.orientation;
+                interpolation.latestPosition = transform.position;
+                sceneNode->setScale(
+                    transform.scale
+                );
+                transform.untouch();
+            }
+            if (interpolation.direct) {
+                // Moved by a presentation system since the last step, keep
+                // following it without interpolating
+                interpolation.previousOrientation = interpolation.latestOrientation;
+                interpolation.previousPosition = interpolation.latestPosition;
+            }
+            // Keep moving for one more step to arrive at the latest transform
+            interpolation.moving = changed or interpolation.changed;
+            interpolation.changed = changed;
+            interpolation.direct = false;
+            interpolation.initialized = true;
+            interpolation.step = step;
+        }
+        else if (transform.hasChanges()) {
+            // Changed by a presentation system between two steps, show it
+            // right away
+            interpolation.latestOrientation = transform.orientation;
+            interpolation.latestPosition = transform.position;
+            interpolation.previousOrientation = transform.orientation;
+            interpolation.previousPosition = transform.position;
             sceneNode->setScale(
                 transform.scale
             );
             transform.untouch();
+            interpolation.moving = true;
+            interpolation.direct = true;
+        }
+        if (interpolation.moving) {
+            sceneNode->setOrientation(
+                Ogre::Quaternion::Slerp(
+                    alpha,
+                    interpolation.previousOrientation,
+                    interpolation.latestOrientation,
+                    true
+                )
+            );
+            sceneNode->setPosition(
+                interpolation.previousPosition + 
+                (interpolation.latestPosition - interpolation.previousPosition) * alpha
+            );
         }
         if (component->m_parentId.hasChanges()) {
             EntityId parentId = component->m_parentId;
@@ -397,7 +525,8 @@ OgreUpdateSceneNodeSystem::update(int milliseconds) {
                 m_impl->m_sceneManager->destroyEntity(component->m_entity);
                 component->m_entity = nullptr;
             }
-            if (component->m_meshName.get().size() > 0) {
+            // Without a render system (headless), meshes can't be loaded
+            if (component->m_meshName.get().size() > 0 and not this->engine()->headless()) {
                 component->m_entity = m_impl->m_sceneManager->createEntity(
                     component->m_meshName
                 );
@@ -413,7 +542,7 @@ OgreUpdateSceneNodeSystem::update(int milliseconds) {
             component->m_objectsToAttach.untouch();
         }
         if(component->m_attachToListener.hasChanges()){
-            if (component->m_attachToListener.get()) {
+            if (component->m_attachToListener.get() and this->engine()->soundManager()) {
                 OgreOggSound::OgreOggListener* listener = OgreOggSound::OgreOggSoundManager::getSingleton().getListener();
                 if (OgreSceneNodeComponent::s_soundListenerAttached){
                     listener->detachFromParent();
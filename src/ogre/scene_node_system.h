@@ -84,9 +84,24 @@ public:
         const StorageContainer& storage
     ) override;
 
+    bool
+    read(
+        StorageReader& reader
+    ) override;
+
+    bool
+    reload(
+        const StorageContainer& storage
+    ) override;
+
     StorageContainer
     storage() const override;
 
+    void
+    write(
+        StorageWriter& writer
+    ) const override;
+
     /**
     * @brief Sets the current animation to be played
     *
@@ -168,6 +183,21 @@ private:
     int m_animationTime = 0;
     bool m_loopingAnimation = false;
 
+    // The transform after the last two simulation steps, for interpolating
+    // between them in frames that fall between two steps. Transforms that
+    // presentation systems change between two steps are shown right away.
+    struct Interpolation {
+        bool changed = false;
+        bool direct = false;
+        bool initialized = false;
+        Ogre::Quaternion latestOrientation = Ogre::Quaternion::IDENTITY;
+        Ogre::Vector3 latestPosition = {0, 0, 0};
+        bool moving = false;
+        Ogre::Quaternion previousOrientation = Ogre::Quaternion::IDENTITY;
+        Ogre::Vector3 previousPosition = {0, 0, 0};
+        unsigned long long step = 0;
+    } m_interpolation;
+
     static bool s_soundListenerAttached;
 
 };
@@ -275,6 +305,15 @@ private:
 
 /**
 * @brief Updates scene node transformations
+*
+* This is a presentation system. If the simulation runs in fixed steps (see
+* Engine::setSimulationTimestep()), it places the scene nodes between the 
+* transforms of the last two simulation steps according to 
+* GameState::interpolationFactor().
+*
+* Transforms that change in a frame without a simulation step, e.g. the
+* camera's, were changed by presentation systems. They are applied
+* without interpolation, and so are their changes in the next step.
 */
 class OgreUpdateSceneNodeSystem : public System {
 
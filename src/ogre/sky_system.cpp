@@ -106,6 +106,10 @@ struct SkySystem::Implementation {
 SkySystem::SkySystem()
   : m_impl(new Implementation())
 {
+    this->writesComponent(SkyPlaneComponent::TYPE_ID);
+    this->setMainThreadOnly(true);
+    this->setPresentation(true);
+    this->setRunsHeadless(false);
 }
 
 
@@ -207,6 +207,10 @@ struct TextOverlaySystem::Implementation {
 TextOverlaySystem::TextOverlaySystem()
   : m_impl(new Implementation())
 {
+    this->writesComponent(TextOverlayComponent::TYPE_ID);
+    this->setMainThreadOnly(true);
+    this->setPresentation(true);
+    this->setRunsHeadless(false);
 }
 
 
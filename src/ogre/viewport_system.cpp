@@ -199,6 +199,8 @@ struct OgreViewportSystem::Implementation {
 OgreViewportSystem::OgreViewportSystem()
   : m_impl(new Implementation(*this))
 {
+    this->setPresentation(true);
+    this->setRunsHeadless(false);
 }
 
 
@@ -0,0 +1,117 @@
+#include "scripting/script_entity_filter.h"
+
+#include "benchmarks/benchmark.h"
+#include "engine/entity_manager.h"
+#include "engine/tests/test_component.h"
+#include "scripting/lua_state.h"
+#include "scripting/script_initializer.h"
+#include "util/make_unique.h"
+
+#include <luabind/luabind.hpp>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace thrive;
+
+namespace {
+
+// The filters only need the TYPE_ID of each component class
+const std::string SCRIPT =
+    "componentTypes = {\n"
+    "    { TYPE_ID = " + std::to_string(TestComponent<0>::TYPE_ID) + " },\n"
+    "    { TYPE_ID = " + std::to_string(TestComponent<1>::TYPE_ID) + " }\n"
+    "}\n"
+    "function countEntities(filter)\n"
+    "    local count = 0\n"
+    "    for _ in filter:entities() do\n"
+    "        count = count + 1\n"
+    "    end\n"
+    "    return count\n"
+    "end\n"
+    "function countChanges(filter)\n"
+    "    local count = 0\n"
+    "    for _ in filter:addedEntities() do\n"
+    "        count = count + 1\n"
+    "    end\n"
+    "    for _ in filter:removedEntities() do\n"
+    "        count = count + 1\n"
+    "    end\n"
+    "    filter:clearChanges()\n"
+    "    return count\n"
+    "end\n"
+;
+
+void
+initializeScript(
+    LuaState& L
+) {
+    initializeLua(L);
+    if (not L.doString(SCRIPT)) {
+        throw std::runtime_error("Could not run benchmark script");
+    }
+}
+
+std::vector<EntityId>
+populate(
+    EntityManager& entityManager,
+    std::size_t count
+) {
+    std::vector<EntityId> entities;
+    entities.reserve(count);
+    for (std::size_t i = 0; i < count; ++i) {
+        EntityId entityId = entityManager.generateNewId();
+        entityManager.addComponent(entityId, make_unique<TestComponent<0>>());
+        entityManager.addComponent(entityId, make_unique<TestComponent<1>>());
+        entities.push_back(entityId);
+    }
+    return entities;
+}
+
+}
+
+
+THRIVE_BENCHMARK(ScriptEntityFilter_iterate, 1000, 10000, 100000) {
+    LuaState L;
+    initializeScript(L);
+    luabind::object globals = luabind::globals(L);
+    EntityManager entityManager;
+    ScriptEntityFilter filter(globals["componentTypes"]);
+    filter.setEntityManager(&entityManager);
+    populate(entityManager, state.size());
+    luabind::object countEntities = globals["countEntities"];
+    while (state.keepRunning()) {
+        auto count = luabind::object_cast<std::size_t>(countEntities(&filter));
+        if (count != state.size()) {
+            throw std::logic_error("Filter is missing entities");
+        }
+    }
+    filter.shutdown();
+}
+
+
+// Removes and re-adds one component of every tenth entity, then lets Lua
+// process the changes
+THRIVE_BENCHMARK(ScriptEntityFilter_churn, 1000, 10000, 100000) {
+    LuaState L;
+    initializeScript(L);
+    luabind::object globals = luabind::globals(L);
+    EntityManager entityManager;
+    ScriptEntityFilter filter(globals["componentTypes"], true);
+    filter.setEntityManager(&entityManager);
+    std::vector<EntityId> entities = populate(entityManager, state.size());
+    filter.clearChanges();
+    luabind::object countChanges = globals["countChanges"];
+    while (state.keepRunning()) {
+        for (std::size_t i = 0; i < entities.size(); i += 10) {
+            entityManager.removeComponent(entities[i], TestComponent<1>::TYPE_ID);
+        }
+        entityManager.processRemovals();
+        for (std::size_t i = 0; i < entities.size(); i += 10) {
+            entityManager.addComponent(entities[i], make_unique<TestComponent<1>>());
+        }
+        entityManager.flushChanges();
+        countChanges(&filter);
+    }
+    filter.shutdown();
+}
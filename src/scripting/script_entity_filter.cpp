@@ -55,27 +55,28 @@ struct ScriptEntityFilter::Implementation {
         if (not m_entityManager or m_requiredComponents.empty()) {
             return false;
         }
-        for (ComponentTypeId typeId : m_requiredComponents) {
-            if (not m_entityManager->getComponent(id, typeId)) {
-                return false;
-            }
-        }
-        return true;
+        ComponentSignature signature = m_entityManager->signature(id);
+        return (signature & m_requiredSignature) == m_requiredSignature;
     }
 
     void
     registerCallbacks() {
         for (ComponentTypeId typeId : m_requiredComponents) {
             auto& collection = m_entityManager->getComponentCollection(typeId);
-            auto onAdded = [this] (EntityId id, Component&) {
-                if (this->isEligible(id)) {
-                    this->addEntity(id);
+            m_requiredSignature.set(collection.signatureBit());
+            auto onAdded = [this] (const std::vector<EntityId>& ids) {
+                for (EntityId id : ids) {
+                    if (this->isEligible(id)) {
+                        this->addEntity(id);
+                    }
                 }
             };
-            auto onRemoved = [this] (EntityId id, Component&) {
-                this->removeEntity(id);
+            auto onRemoved = [this] (const std::vector<EntityId>& ids) {
+                for (EntityId id : ids) {
+                    this->removeEntity(id);
+                }
             };
-            unsigned int handle = collection.registerChangeCallbacks(
+            unsigned int handle = collection.registerBatchCallbacks(
                 onAdded, 
                 onRemoved
             );
@@ -94,9 +95,10 @@ struct ScriptEntityFilter::Implementation {
         m_addedEntities.clear();
         m_removedEntities.clear();
         m_entities.clear();
+        m_requiredSignature.reset();
         if (entityManager) {
-            this->initialize();
             this->registerCallbacks();
+            this->initialize();
         }
     }
 
@@ -135,6 +137,8 @@ struct ScriptEntityFilter::Implementation {
 
     std::unordered_set<ComponentTypeId> m_requiredComponents;
 
+    ComponentSignature m_requiredSignature;
+
 };
 
 
@@ -212,7 +216,7 @@ void
 ScriptEntityFilter::init(
     GameState* gameState
 ) {
-    m_impl->setEntityManager(
+    this->setEntityManager(
         &gameState->entityManager()
     );
 }
@@ -224,6 +228,14 @@ ScriptEntityFilter::removedEntities() {
 }
 
 
+void
+ScriptEntityFilter::setEntityManager(
+    EntityManager* entityManager
+) {
+    m_impl->setEntityManager(entityManager);
+}
+
+
 void
 ScriptEntityFilter::shutdown() {
     m_impl->setEntityManager(nullptr);
@@ -9,6 +9,7 @@
 
 namespace thrive {
 
+class EntityManager;
 class GameState;
 
 /**
@@ -106,6 +107,8 @@ public:
 
     /**
     * @brief Initializes this filter
+    *
+    * Same as setEntityManager() with the game state's entity manager.
     */
     void
     init(
@@ -121,6 +124,19 @@ public:
     const std::unordered_set<EntityId>&
     removedEntities();
 
+    /**
+    * @brief Sets the entity manager to filter
+    *
+    * Useful for filters that don't belong to a game state. Call shutdown()
+    * or pass \c nullptr before the entity manager is destroyed.
+    *
+    * @param entityManager
+    */
+    void
+    setEntityManager(
+        EntityManager* entityManager
+    );
+
     /**
     * @brief Shuts this filter down
     */
@@ -6,6 +6,7 @@
 #include "engine/entity.h"
 #include "engine/serialization.h"
 #include "engine/rng.h"
+#include "engine/telemetry.h"
 #include "ogre/scene_node_system.h"
 #include "scripting/luabind.h"
 
@@ -310,7 +311,7 @@ struct SoundSourceSystem::Implementation {
             OgreOggSound::OgreOggISound* sound = pair.second;
             this->removeSound(sound);
         }
-        m_sounds[entityId].clear();
+        m_sounds.erase(entityId);
     }
 
     void
@@ -406,7 +407,8 @@ struct SoundSourceSystem::Implementation {
 SoundSourceSystem::SoundSourceSystem()
   : m_impl(new Implementation())
 {
-
+    this->setPresentation(true);
+    this->setRunsHeadless(false);
 }
 
 
@@ -453,6 +455,10 @@ SoundSourceSystem::update(int milliseconds) {
     for (EntityId entityId : m_impl->m_entities.removedEntities()) {
         m_impl->removeSoundsForEntity(entityId);
     }
+    this->engine()->telemetry().setGauge(
+        "SoundSourceSystem.sounds",
+        m_impl->m_sounds.size()
+    );
     for (auto& value : m_impl->m_entities.addedEntities()) {
         //Load the songs for any new soundSourceComponent containing entities that have been created
         EntityId entityId = value.first;